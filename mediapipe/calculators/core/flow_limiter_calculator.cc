@@ -13,11 +13,15 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <memory>
 #include <utility>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "mediapipe/calculators/core/flow_limiter_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deps/clock.h"
+#include "mediapipe/framework/deps/monotonic_clock.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/util/header_util.h"
@@ -65,6 +69,19 @@ namespace mediapipe {
 // input streams are treated as auxiliary input streams.  The auxiliary input
 // streams are limited to timestamps passed on the main input stream.
 //
+// With `adaptive` options, max_in_flight is only the initial limit, which is
+// then raised while frames finish within `adaptive.target_latency` and
+// lowered when they do not.  This suits graphs deployed on machines of
+// varying speed, where no single max_in_flight gives both good throughput and
+// bounded latency.  Frame latency is measured on the clock passed as the
+// optional input side packet "CLOCK" (a std::shared_ptr<mediapipe::Clock>),
+// by default a monotonic real-time clock.
+//
+// The calculator exports the counters "<node name>-FramesReleased" and
+// "<node name>-FramesDropped", from which the drop rate follows, and in
+// adaptive mode "<node name>-MaxInFlight", the current limit, and
+// "<node name>-LatencyUs", the latency of the latest finished frame.
+//
 class FlowLimiterCalculator : public CalculatorBase {
  public:
   static absl::Status GetContract(CalculatorContract* cc) {
@@ -78,6 +95,10 @@ class FlowLimiterCalculator : public CalculatorBase {
     }
     cc->Inputs().Get("FINISHED", 0).SetAny();
     cc->InputSidePackets().Tag("MAX_IN_FLIGHT").Set<int>().Optional();
+    cc->InputSidePackets()
+        .Tag("CLOCK")
+        .Set<std::shared_ptr<mediapipe::Clock>>()
+        .Optional();
     cc->Outputs().Tag("ALLOW").Set<bool>().Optional();
     cc->SetInputStreamHandler("ImmediateInputStreamHandler");
     cc->SetProcessTimestampBounds(true);
@@ -91,15 +112,92 @@ class FlowLimiterCalculator : public CalculatorBase {
       options_.set_max_in_flight(
           cc->InputSidePackets().Tag("MAX_IN_FLIGHT").Get<int>());
     }
+    if (cc->InputSidePackets().HasTag("CLOCK")) {
+      clock_ = cc->InputSidePackets()
+                   .Tag("CLOCK")
+                   .Get<std::shared_ptr<mediapipe::Clock>>();
+    } else {
+      clock_ = std::shared_ptr<mediapipe::Clock>(
+          mediapipe::MonotonicClock::CreateSynchronizedMonotonicClock());
+    }
+    frames_released_counter_ = cc->GetCounter("FramesReleased");
+    frames_dropped_counter_ = cc->GetCounter("FramesDropped");
+    max_in_flight_counter_ = cc->GetCounter("MaxInFlight");
+    latency_counter_ = cc->GetCounter("LatencyUs");
+    MP_RETURN_IF_ERROR(InitializeAdaptiveLimit());
     input_queues_.resize(cc->Inputs().NumEntries(""));
     RET_CHECK_OK(CopyInputHeadersToOutputs(cc->Inputs(), &(cc->Outputs())));
     return absl::OkStatus();
   }
 
+  // Validates the adaptive options and sets the initial limit, once the
+  // options enable adaptive mode.
+  absl::Status InitializeAdaptiveLimit() {
+    if (!options_.has_adaptive() || adaptive_limit_ > 0) {
+      return absl::OkStatus();
+    }
+    const auto& adaptive = options_.adaptive();
+    RET_CHECK_GT(adaptive.target_latency(), 0);
+    RET_CHECK_GE(adaptive.min_in_flight(), 1);
+    RET_CHECK_GE(adaptive.max_in_flight(), adaptive.min_in_flight());
+    RET_CHECK_GT(adaptive.additive_increase(), 0);
+    RET_CHECK(adaptive.multiplicative_decrease() > 0 &&
+              adaptive.multiplicative_decrease() < 1);
+    adaptive_limit_ = std::clamp<double>(options_.max_in_flight(),
+                                         adaptive.min_in_flight(),
+                                         adaptive.max_in_flight());
+    SetCounter(max_in_flight_counter_, MaxInFlight(),
+               &reported_max_in_flight_);
+    return absl::OkStatus();
+  }
+
+  // Returns the current limit on the number of frames in flight.
+  int MaxInFlight() const {
+    return options_.has_adaptive() ? static_cast<int>(adaptive_limit_)
+                                   : options_.max_in_flight();
+  }
+
   // Returns true if an additional frame can be released for processing.
   // The "ALLOW" output stream indicates this condition at each input frame.
-  bool ProcessingAllowed() {
-    return frames_in_flight_.size() < options_.max_in_flight();
+  bool ProcessingAllowed() { return frames_in_flight_.size() < MaxInFlight(); }
+
+  // Sets a counter used as a gauge to value.
+  static void SetCounter(Counter* counter, int64 value, int64* reported) {
+    counter->IncrementBy(value - *reported);
+    *reported = value;
+  }
+
+  // Removes a frame from the frames in flight, adapting the limit to its
+  // latency in adaptive mode.  Frames that time out count as late.
+  void FinishFrame(bool timed_out) {
+    const FrameInFlight frame = frames_in_flight_.front();
+    frames_in_flight_.pop_front();
+    if (!options_.has_adaptive()) {
+      return;
+    }
+    const auto& adaptive = options_.adaptive();
+    const absl::Time now = clock_->TimeNow();
+    const absl::Duration latency = now - frame.release_time;
+    if (timed_out || latency > absl::Microseconds(adaptive.target_latency())) {
+      // Frames released before the last decrease saw the old limit, and must
+      // not lower it again.
+      if (frame.release_time > last_decrease_time_) {
+        adaptive_limit_ = std::max<double>(
+            adaptive.min_in_flight(),
+            adaptive_limit_ * adaptive.multiplicative_decrease());
+        last_decrease_time_ = now;
+      }
+    } else {
+      adaptive_limit_ = std::min<double>(
+          adaptive.max_in_flight(),
+          adaptive_limit_ + adaptive.additive_increase() / adaptive_limit_);
+    }
+    if (!timed_out) {
+      SetCounter(latency_counter_, absl::ToInt64Microseconds(latency),
+                 &reported_latency_);
+    }
+    SetCounter(max_in_flight_counter_, MaxInFlight(),
+               &reported_max_in_flight_);
   }
 
   // Outputs a packet indicating whether a frame was sent or dropped.
@@ -120,8 +218,10 @@ class FlowLimiterCalculator : public CalculatorBase {
 
   // Returns true if a certain timestamp is being processed.
   bool IsInFlight(Timestamp timestamp) {
-    return std::find(frames_in_flight_.begin(), frames_in_flight_.end(),
-                     timestamp) != frames_in_flight_.end();
+    return std::find_if(frames_in_flight_.begin(), frames_in_flight_.end(),
+                        [timestamp](const FrameInFlight& frame) {
+                          return frame.timestamp == timestamp;
+                        }) != frames_in_flight_.end();
   }
 
   // Releases input packets up to the latest settled input timestamp.
@@ -153,13 +253,15 @@ class FlowLimiterCalculator : public CalculatorBase {
   // Releases input packets allowed by the max_in_flight constraint.
   absl::Status Process(CalculatorContext* cc) final {
     options_ = tool::RetrieveOptions(options_, cc->Inputs());
+    MP_RETURN_IF_ERROR(InitializeAdaptiveLimit());
 
     // Process the FINISHED input stream.
     Packet finished_packet = cc->Inputs().Tag("FINISHED").Value();
     if (finished_packet.Timestamp() == cc->InputTimestamp()) {
       while (!frames_in_flight_.empty() &&
-             frames_in_flight_.front() <= finished_packet.Timestamp()) {
-        frames_in_flight_.pop_front();
+             frames_in_flight_.front().timestamp <=
+                 finished_packet.Timestamp()) {
+        FinishFrame(/*timed_out=*/false);
       }
     }
 
@@ -178,8 +280,8 @@ class FlowLimiterCalculator : public CalculatorBase {
     if (timeout > 0 && latest_ts == cc->InputTimestamp() &&
         latest_ts < Timestamp::Max()) {
       while (!frames_in_flight_.empty() &&
-             (latest_ts - frames_in_flight_.front()) > timeout) {
-        frames_in_flight_.pop_front();
+             (latest_ts - frames_in_flight_.front().timestamp) > timeout) {
+        FinishFrame(/*timed_out=*/true);
       }
     }
 
@@ -190,7 +292,8 @@ class FlowLimiterCalculator : public CalculatorBase {
       input_queue.pop_front();
       cc->Outputs().Get("", 0).AddPacket(packet);
       SendAllow(true, packet.Timestamp(), cc);
-      frames_in_flight_.push_back(packet.Timestamp());
+      frames_in_flight_.push_back({packet.Timestamp(), clock_->TimeNow()});
+      frames_released_counter_->Increment();
     }
 
     // Limit the number of queued frames.
@@ -200,6 +303,7 @@ class FlowLimiterCalculator : public CalculatorBase {
       Packet packet = input_queue.front();
       input_queue.pop_front();
       SendAllow(false, packet.Timestamp(), cc);
+      frames_dropped_counter_->Increment();
     }
 
     // Propagate the input timestamp bound.
@@ -220,9 +324,27 @@ class FlowLimiterCalculator : public CalculatorBase {
   }
 
  private:
+  struct FrameInFlight {
+    Timestamp timestamp;
+    absl::Time release_time;
+  };
+
   FlowLimiterCalculatorOptions options_;
   std::vector<std::deque<Packet>> input_queues_;
-  std::deque<Timestamp> frames_in_flight_;
+  std::deque<FrameInFlight> frames_in_flight_;
+  std::shared_ptr<mediapipe::Clock> clock_;
+
+  // The limit on frames in flight in adaptive mode, 0 until initialized.
+  double adaptive_limit_ = 0;
+  // The time of the latest decrease of adaptive_limit_.
+  absl::Time last_decrease_time_ = absl::InfinitePast();
+
+  Counter* frames_released_counter_ = nullptr;
+  Counter* frames_dropped_counter_ = nullptr;
+  Counter* max_in_flight_counter_ = nullptr;
+  Counter* latency_counter_ = nullptr;
+  int64 reported_max_in_flight_ = 0;
+  int64 reported_latency_ = 0;
 };
 REGISTER_CALCULATOR(FlowLimiterCalculator);
 
@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "mediapipe/calculators/core/flow_limiter_calculator.pb.h"
@@ -756,5 +757,124 @@ TEST_F(FlowLimiterCalculatorTest, ZeroQueue) {
   EXPECT_EQ(out_2_packets, expected_output_2);
 }
 
+// Returns the value of a counter of the FlowLimiterCalculator.
+int64 LimiterCounter(CalculatorGraph* graph, const std::string& name) {
+  return graph->GetCounterFactory()
+      ->GetCounter(absl::StrCat("FlowLimiterCalculator-", name))
+      ->Get();
+}
+
+// Runs an adaptive FlowLimiterCalculator on 50 frames arriving every 10 ms,
+// each taking 10 ms to process.
+void RunAdaptiveGraph(const FlowLimiterCalculatorOptions& limiter_options,
+                      CalculatorGraph* graph) {
+  auto executor = std::make_shared<SimulationClockExecutor>(8);
+  std::shared_ptr<SimulationClock> clock = executor->GetClock();
+  MP_ASSERT_OK(graph->SetExecutor("", executor));
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+        input_stream: 'in_1'
+        node {
+          calculator: 'FlowLimiterCalculator'
+          input_side_packet: 'OPTIONS:limiter_options'
+          input_side_packet: 'CLOCK:limiter_clock'
+          input_stream: 'in_1'
+          input_stream: 'FINISHED:out_1'
+          input_stream_info: { tag_index: 'FINISHED' back_edge: true }
+          output_stream: 'in_1_sampled'
+        }
+        node {
+          calculator: 'SleepCalculator'
+          input_side_packet: 'WARMUP_TIME:sleep_time'
+          input_side_packet: 'SLEEP_TIME:sleep_time'
+          input_side_packet: 'CLOCK:clock'
+          input_stream: 'PACKET:in_1_sampled'
+          output_stream: 'PACKET:out_1'
+        }
+      )pb");
+  std::map<std::string, Packet> side_packets = {
+      {"limiter_options",
+       MakePacket<FlowLimiterCalculatorOptions>(limiter_options)},
+      {"limiter_clock", MakePacket<std::shared_ptr<Clock>>(clock)},
+      {"sleep_time", MakePacket<int64>(10000)},
+      {"clock", MakePacket<mediapipe::Clock*>(clock.get())},
+  };
+
+  MP_ASSERT_OK(graph->Initialize(graph_config));
+  clock->ThreadStart();
+  MP_ASSERT_OK(graph->StartRun(side_packets));
+  for (int i = 0; i < 50; ++i) {
+    MP_EXPECT_OK(graph->AddPacketToInputStream(
+        "in_1", MakePacket<int>(i).At(Timestamp(i * 10000))));
+    clock->Sleep(absl::Microseconds(10000));
+  }
+  MP_EXPECT_OK(graph->CloseAllPacketSources());
+  clock->Sleep(absl::Microseconds(100000));
+  MP_EXPECT_OK(graph->WaitUntilDone());
+  clock->ThreadFinish();
+}
+
+// Shows that the adaptive limit grows up to its maximum while frames finish
+// within the target latency.
+TEST(FlowLimiterCalculatorAdaptiveTest, RaisesLimitWithinTargetLatency) {
+  auto limiter_options = ParseTextProtoOrDie<FlowLimiterCalculatorOptions>(R"pb(
+    max_in_flight: 1
+    max_in_queue: 1
+    adaptive { target_latency: 1000000 max_in_flight: 4 }
+  )pb");
+  CalculatorGraph graph;
+  RunAdaptiveGraph(limiter_options, &graph);
+
+  EXPECT_EQ(LimiterCounter(&graph, "MaxInFlight"), 4);
+  EXPECT_EQ(LimiterCounter(&graph, "FramesReleased") +
+                LimiterCounter(&graph, "FramesDropped"),
+            50);
+  EXPECT_GE(LimiterCounter(&graph, "LatencyUs"), 10000);
+  EXPECT_LT(LimiterCounter(&graph, "LatencyUs"), 1000000);
+}
+
+// Shows that the adaptive limit drops to its minimum while frames finish
+// late.
+TEST(FlowLimiterCalculatorAdaptiveTest, LowersLimitAboveTargetLatency) {
+  auto limiter_options = ParseTextProtoOrDie<FlowLimiterCalculatorOptions>(R"pb(
+    max_in_flight: 4
+    max_in_queue: 1
+    adaptive { target_latency: 1000 }
+  )pb");
+  CalculatorGraph graph;
+  RunAdaptiveGraph(limiter_options, &graph);
+
+  EXPECT_EQ(LimiterCounter(&graph, "MaxInFlight"), 1);
+  EXPECT_EQ(LimiterCounter(&graph, "FramesReleased") +
+                LimiterCounter(&graph, "FramesDropped"),
+            50);
+  EXPECT_GE(LimiterCounter(&graph, "LatencyUs"), 10000);
+}
+
+// Shows that adaptive options are validated.
+TEST(FlowLimiterCalculatorAdaptiveTest, RequiresTargetLatency) {
+  auto limiter_options = ParseTextProtoOrDie<FlowLimiterCalculatorOptions>(R"pb(
+    adaptive { max_in_flight: 4 }
+  )pb");
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(ParseTextProtoOrDie<CalculatorGraphConfig>(
+      R"pb(
+        input_stream: 'in_1'
+        node {
+          calculator: 'FlowLimiterCalculator'
+          input_side_packet: 'OPTIONS:limiter_options'
+          input_stream: 'in_1'
+          input_stream: 'FINISHED:in_1_sampled'
+          input_stream_info: { tag_index: 'FINISHED' back_edge: true }
+          output_stream: 'in_1_sampled'
+        }
+      )pb")));
+  MP_ASSERT_OK(graph.StartRun(
+      {{"limiter_options",
+        MakePacket<FlowLimiterCalculatorOptions>(limiter_options)}}));
+  graph.CloseAllInputStreams().IgnoreError();
+  EXPECT_FALSE(graph.WaitUntilDone().ok());
+}
+
 }  // anonymous namespace
 }  // namespace mediapipe
@@ -17,14 +17,13 @@
 
 #include "absl/strings/str_replace.h"
 #include "mediapipe/calculators/image/bilateral_filter_calculator.pb.h"
+#include "mediapipe/calculators/image/bilateral_grid.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_options.pb.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
-#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
 #include "mediapipe/framework/port/logging.h"
-#include "mediapipe/framework/port/opencv_core_inc.h"
-#include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/vector.h"
 
@@ -53,10 +52,11 @@ enum { ATTRIB_VERTEX, ATTRIB_TEXTURE_POSITION, NUM_ATTRIBUTES };
 //
 // Inputs:
 //   One of the following two IMAGE tags:
-//   IMAGE: ImageFrame containing input image - Grayscale or RGB only.
+//   IMAGE: ImageFrame containing input image - Grayscale, RGB, RGBA or a
+//          VEC32F1 mask.
 //   IMAGE_GPU: GpuBuffer containing input image - Grayscale, RGB or RGBA.
 //
-//   GUIDE (optional): ImageFrame guide image used to filter IMAGE. (N/A).
+//   GUIDE (optional): ImageFrame guide image used to filter IMAGE.
 //   GUIDE_GPU (optional): GpuBuffer guide image used to filter IMAGE_GPU.
 //
 // Output:
@@ -75,7 +75,11 @@ enum { ATTRIB_VERTEX, ATTRIB_TEXTURE_POSITION, NUM_ATTRIBUTES };
 //   * On GPU the kernel window is subsampled by approximately sqrt(sigma_space)
 //     i.e. the step size is ~sqrt(sigma_space),
 //     prioritizing performance > quality.
-//   * TODO: Add CPU path for joint filter.
+//   * On CPU the filter is evaluated on a bilateral grid, whose cost does not
+//     depend on sigma_space, and color differences are those of the luminance
+//     of the guide (or input) image. IMAGE is sampled at the resolution of
+//     GUIDE, so a low resolution mask can be refined along the edges of a
+//     full resolution GUIDE.
 //
 class BilateralFilterCalculator : public CalculatorBase {
  public:
@@ -101,6 +105,8 @@ class BilateralFilterCalculator : public CalculatorBase {
   float sigma_space_ = -1.f;
 
   bool use_gpu_ = false;
+  // CPU output frames are drawn from this pool if set.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
   bool gpu_initialized_ = false;
 #if !MEDIAPIPE_DISABLE_GPU
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -162,6 +168,8 @@ absl::Status BilateralFilterCalculator::GetContract(CalculatorContract* cc) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  } else {
+    cc->UseService(kImageFramePoolService).Optional();
   }
 
   return absl::OkStatus();
@@ -185,7 +193,6 @@ absl::Status BilateralFilterCalculator::Open(CalculatorContext* cc) {
   sigma_space_ = options_.sigma_space();
   CHECK_GE(sigma_color_, 0.0);
   CHECK_GE(sigma_space_, 0.0);
-  if (!use_gpu_) sigma_color_ *= 255.0;
 
   if (use_gpu_) {
 #if !MEDIAPIPE_DISABLE_GPU
@@ -193,6 +200,13 @@ absl::Status BilateralFilterCalculator::Open(CalculatorContext* cc) {
 #endif  // !MEDIAPIPE_DISABLE_GPU
   }
 
+  if (!use_gpu_) {
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = &frame_pool_service.GetObject();
+    }
+  }
+
   return absl::OkStatus();
 }
 
@@ -237,29 +251,18 @@ absl::Status BilateralFilterCalculator::RenderCpu(CalculatorContext* cc) {
   }
 
   const auto& input_frame = cc->Inputs().Tag(kInputFrameTag).Get<ImageFrame>();
-  auto input_mat = mediapipe::formats::MatView(&input_frame);
-
-  // Only 1 or 3 channel images supported by OpenCV.
-  if ((input_mat.channels() == 1 || input_mat.channels() == 3)) {
-    return absl::InternalError(
-        "CPU filtering supports only 1 or 3 channel input images.");
-  }
-
-  auto output_frame = absl::make_unique<ImageFrame>(
-      input_frame.Format(), input_mat.cols, input_mat.rows);
   const bool has_guide_image = cc->Inputs().HasTag(kInputGuideTag) &&
                                !cc->Inputs().Tag(kInputGuideTag).IsEmpty();
-
-  if (has_guide_image) {
-    // cv::jointBilateralFilter() is in contrib module 'ximgproc'.
-    return absl::UnimplementedError(
-        "CPU joint filtering support is not implemented yet.");
-  } else {
-    auto output_mat = mediapipe::formats::MatView(output_frame.get());
-    // Prefer setting 'd = sigma_space * 2' to match GPU definition of radius.
-    cv::bilateralFilter(input_mat, output_mat, /*d=*/sigma_space_ * 2.0,
-                        sigma_color_, sigma_space_);
-  }
+  const auto& guide_frame =
+      has_guide_image ? cc->Inputs().Tag(kInputGuideTag).Get<ImageFrame>()
+                      : input_frame;
+
+  auto output_frame = AcquireImageFrame(frame_pool_, input_frame.Format(),
+                                        guide_frame.Width(),
+                                        guide_frame.Height());
+  MP_RETURN_IF_ERROR(BilateralGridFilter(input_frame, guide_frame,
+                                         sigma_space_, sigma_color_,
+                                         output_frame.get()));
 
   cc->Outputs()
       .Tag(kOutputFrameTag)
@@ -0,0 +1,325 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/bilateral_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/util/parallel_for_rows.h"
+
+namespace mediapipe {
+
+namespace {
+
+// The window of radius sigma_space used by the GPU path, as by
+// cv::bilateralFilter before, weighs pixels almost uniformly: its standard
+// deviation along each axis is about 0.57 sigma_space.
+constexpr float kWindowSigmaRatio = 0.57f;
+// Standard deviation, in cells, of the filter applied by the grid: splatting
+// to the nearest cell, blurring with [1 2 1] and slicing linearly.
+constexpr float kGridSigmaCells = 0.87f;
+// Bounds the depth of the grid for tiny color sigmas.
+constexpr int kMaxRangeCells = 256;
+
+// Number of cached grid rows. Blurred grid row g reads splatted rows g - 1 to
+// g + 1, and image rows are sliced from blurred rows g and g + 1.
+constexpr int kSplatSlots = 4;
+constexpr int kBlurSlots = 2;
+
+template <typename T>
+const T* Row(const ImageFrame& frame, int row) {
+  return reinterpret_cast<const T*>(frame.PixelData() +
+                                    row * frame.WidthStep());
+}
+
+template <typename T>
+T* MutableRow(ImageFrame* frame, int row) {
+  return reinterpret_cast<T*>(frame->MutablePixelData() +
+                              row * frame->WidthStep());
+}
+
+template <typename T>
+struct PixelTraits;
+
+template <>
+struct PixelTraits<uint8> {
+  static uint8 Store(float value) {
+    return static_cast<uint8>(std::min(std::max(value, 0.0f), 255.0f) + 0.5f);
+  }
+};
+
+template <>
+struct PixelTraits<float> {
+  static float Store(float value) { return value; }
+};
+
+bool IsSupportedFormat(ImageFormat::Format format) {
+  return format == ImageFormat::GRAY8 || format == ImageFormat::SRGB ||
+         format == ImageFormat::SRGBA || format == ImageFormat::VEC32F1;
+}
+
+// Reads the intensities of a row of guide, in [0, 1].
+void ReadGuideRow(const ImageFrame& guide, int y, float* intensities) {
+  const int width = guide.Width();
+  switch (guide.Format()) {
+    case ImageFormat::VEC32F1: {
+      const float* row = Row<float>(guide, y);
+      for (int x = 0; x < width; ++x) {
+        intensities[x] = std::min(std::max(row[x], 0.0f), 1.0f);
+      }
+      break;
+    }
+    case ImageFormat::GRAY8: {
+      const uint8* row = Row<uint8>(guide, y);
+      for (int x = 0; x < width; ++x) intensities[x] = row[x] / 255.0f;
+      break;
+    }
+    default: {
+      const int channels = guide.NumberOfChannels();
+      const uint8* row = Row<uint8>(guide, y);
+      for (int x = 0; x < width; ++x) {
+        const uint8* pixel = row + x * channels;
+        intensities[x] =
+            (0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2]) /
+            255.0f;
+      }
+      break;
+    }
+  }
+}
+
+// Filters bands of rows. The grid has cells_x_ x cells_z_ cells per row, with
+// one cell of padding on each side, and each cell holds the sums of the values
+// splatted into it followed by their count.
+template <typename T, int kChannels>
+class GridFilter {
+ public:
+  GridFilter(const ImageFrame& input, const ImageFrame& guide,
+             float cell_space, float cell_range)
+      : input_(input),
+        guide_(guide),
+        cell_space_(cell_space),
+        inv_cell_space_(1.0f / cell_space),
+        inv_cell_range_(1.0f / cell_range) {
+    const int width = guide.Width();
+    cells_x_ = static_cast<int>((width - 1) * inv_cell_space_) + 3;
+    cells_z_ = static_cast<int>(inv_cell_range_) + 3;
+    row_size_ = cells_x_ * cells_z_ * kCellSize;
+    input_x_.resize(width);
+    splat_x_.resize(width);
+    slice_x_.resize(width);
+    slice_wx_.resize(width);
+    for (int x = 0; x < width; ++x) {
+      input_x_[x] = std::min(
+          static_cast<int>((x + 0.5f) * input.Width() / width),
+          input.Width() - 1);
+      const float fx = x * inv_cell_space_ + 1.0f;
+      splat_x_[x] = static_cast<int>(fx + 0.5f) * cells_z_ * kCellSize;
+      const int x0 = static_cast<int>(fx);
+      slice_x_[x] = x0 * cells_z_ * kCellSize;
+      slice_wx_[x] = fx - x0;
+    }
+    intensities_.resize(width);
+    std::fill(splat_keys_, splat_keys_ + kSplatSlots, kNoRow);
+    std::fill(blur_keys_, blur_keys_ + kBlurSlots, kNoRow);
+    splat_rows_.resize(kSplatSlots * row_size_);
+    blur_rows_.resize(kBlurSlots * row_size_);
+    scratch_.resize(row_size_);
+  }
+
+  void FilterRows(int begin, int end, ImageFrame* output) {
+    const int width = guide_.Width();
+    const int cell_x_stride = cells_z_ * kCellSize;
+    for (int y = begin; y < end; ++y) {
+      const float fy = y * inv_cell_space_;
+      const int g0 = static_cast<int>(fy);
+      const float wy = fy - g0;
+      const float* row0 = BlurredRow(g0);
+      const float* row1 = BlurredRow(g0 + 1);
+      ReadGuideRow(guide_, y, intensities_.data());
+      T* dst = MutableRow<T>(output, y);
+      for (int x = 0; x < width; ++x) {
+        const float fz = intensities_[x] * inv_cell_range_ + 1.0f;
+        const int z0 = static_cast<int>(fz);
+        const float wz = fz - z0;
+        const float wx = slice_wx_[x];
+        const int offset = slice_x_[x] + z0 * kCellSize;
+        const float* cells[4] = {row0 + offset, row0 + offset + cell_x_stride,
+                                 row1 + offset, row1 + offset + cell_x_stride};
+        const float weights[4] = {(1 - wy) * (1 - wx), (1 - wy) * wx,
+                                  wy * (1 - wx), wy * wx};
+        float sum[kCellSize] = {};
+        for (int i = 0; i < 4; ++i) {
+          const float w0 = weights[i] * (1 - wz);
+          const float w1 = weights[i] * wz;
+          for (int c = 0; c < kCellSize; ++c) {
+            sum[c] += w0 * cells[i][c] + w1 * cells[i][kCellSize + c];
+          }
+        }
+        // The cells around a pixel always hold its own splatted value.
+        const float inv_count = 1.0f / std::max(sum[kChannels], 1e-6f);
+        for (int c = 0; c < kChannels; ++c) {
+          dst[x * kChannels + c] = PixelTraits<T>::Store(sum[c] * inv_count);
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr int kCellSize = kChannels + 1;
+  static constexpr int kNoRow = -2;
+
+  // Returns grid row g with the pixels of its image rows splatted into it,
+  // blurred along x and z.
+  const float* SplattedRow(int g) {
+    const int slot = (g + 1) % kSplatSlots;
+    float* row = &splat_rows_[slot * row_size_];
+    if (splat_keys_[slot] == g) return row;
+    splat_keys_[slot] = g;
+
+    // Pixels splat into their nearest grid row, which for grid row g are the
+    // image rows in [(g - 0.5) * cell_space, (g + 0.5) * cell_space).
+    std::fill(row, row + row_size_, 0.0f);
+    const int y_begin =
+        std::max(0, static_cast<int>(std::ceil((g - 0.5f) * cell_space_)));
+    const int y_end = std::min(
+        guide_.Height(), static_cast<int>(std::ceil((g + 0.5f) * cell_space_)));
+    const int width = guide_.Width();
+    for (int y = y_begin; y < y_end; ++y) {
+      ReadGuideRow(guide_, y, intensities_.data());
+      const int input_y = std::min(
+          static_cast<int>((y + 0.5f) * input_.Height() / guide_.Height()),
+          input_.Height() - 1);
+      const T* src = Row<T>(input_, input_y);
+      for (int x = 0; x < width; ++x) {
+        const int z =
+            static_cast<int>(intensities_[x] * inv_cell_range_ + 0.5f) + 1;
+        float* cell = row + splat_x_[x] + z * kCellSize;
+        const T* value = src + input_x_[x] * kChannels;
+        for (int c = 0; c < kChannels; ++c) cell[c] += value[c];
+        cell[kChannels] += 1.0f;
+      }
+    }
+    if (y_begin >= y_end) return row;
+
+    // Blurs along x with [1 2 1], into scratch_.
+    const int block = cells_z_ * kCellSize;
+    float* blurred = scratch_.data();
+    for (int k = 0; k < row_size_; ++k) blurred[k] = 2.0f * row[k];
+    for (int k = block; k < row_size_; ++k) blurred[k] += row[k - block];
+    for (int k = 0; k < row_size_ - block; ++k) blurred[k] += row[k + block];
+    // Blurs along z with [1 2 1], back into row.
+    for (int x = 0; x < cells_x_; ++x) {
+      const float* src_column = blurred + x * block;
+      float* dst_column = row + x * block;
+      for (int k = 0; k < block; ++k) dst_column[k] = 2.0f * src_column[k];
+      for (int k = kCellSize; k < block; ++k) {
+        dst_column[k] += src_column[k - kCellSize];
+      }
+      for (int k = 0; k < block - kCellSize; ++k) {
+        dst_column[k] += src_column[k + kCellSize];
+      }
+    }
+    return row;
+  }
+
+  // Returns grid row g, splatted and blurred along all three axes.
+  const float* BlurredRow(int g) {
+    const int slot = g % kBlurSlots;
+    float* row = &blur_rows_[slot * row_size_];
+    if (blur_keys_[slot] == g) return row;
+    blur_keys_[slot] = g;
+    const float* above = SplattedRow(g - 1);
+    const float* center = SplattedRow(g);
+    const float* below = SplattedRow(g + 1);
+    for (int k = 0; k < row_size_; ++k) {
+      row[k] = above[k] + 2.0f * center[k] + below[k];
+    }
+    return row;
+  }
+
+  const ImageFrame& input_;
+  const ImageFrame& guide_;
+  const float cell_space_;
+  const float inv_cell_space_;
+  const float inv_cell_range_;
+  int cells_x_ = 0;
+  int cells_z_ = 0;
+  int row_size_ = 0;
+  // Input column sampled for each guide column.
+  std::vector<int> input_x_;
+  // Offsets of the grid cells each guide column splats into, and slices
+  // from together with the next cell, with the weight of the next cell.
+  std::vector<int> splat_x_;
+  std::vector<int> slice_x_;
+  std::vector<float> slice_wx_;
+  std::vector<float> intensities_;
+  int splat_keys_[kSplatSlots];
+  int blur_keys_[kBlurSlots];
+  std::vector<float> splat_rows_;
+  std::vector<float> blur_rows_;
+  std::vector<float> scratch_;
+};
+
+template <typename T, int kChannels>
+void FilterImage(const ImageFrame& input, const ImageFrame& guide,
+                 float cell_space, float cell_range, ImageFrame* output) {
+  ParallelForRows(
+      guide.Height(), guide.Width(), [&](int begin, int end) {
+        GridFilter<T, kChannels> filter(input, guide, cell_space, cell_range);
+        filter.FilterRows(begin, end, output);
+      });
+}
+
+}  // namespace
+
+absl::Status BilateralGridFilter(const ImageFrame& input,
+                                 const ImageFrame& guide, float sigma_space,
+                                 float sigma_color, ImageFrame* output) {
+  RET_CHECK(output);
+  RET_CHECK(IsSupportedFormat(input.Format()))
+      << "Unsupported input format: " << input.Format();
+  RET_CHECK(IsSupportedFormat(guide.Format()))
+      << "Unsupported guide format: " << guide.Format();
+  RET_CHECK_EQ(output->Format(), input.Format());
+  RET_CHECK_EQ(output->Width(), guide.Width());
+  RET_CHECK_EQ(output->Height(), guide.Height());
+  RET_CHECK(!input.IsEmpty() && !guide.IsEmpty());
+
+  const float cell_space =
+      std::max(1.0f, sigma_space * kWindowSigmaRatio / kGridSigmaCells);
+  const float cell_range =
+      std::max(1.0f / kMaxRangeCells, sigma_color / kGridSigmaCells);
+  switch (input.Format()) {
+    case ImageFormat::GRAY8:
+      FilterImage<uint8, 1>(input, guide, cell_space, cell_range, output);
+      break;
+    case ImageFormat::SRGB:
+      FilterImage<uint8, 3>(input, guide, cell_space, cell_range, output);
+      break;
+    case ImageFormat::SRGBA:
+      FilterImage<uint8, 4>(input, guide, cell_space, cell_range, output);
+      break;
+    default:
+      FilterImage<float, 1>(input, guide, cell_space, cell_range, output);
+      break;
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe
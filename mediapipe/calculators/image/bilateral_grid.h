@@ -0,0 +1,50 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// CPU kernel of BilateralFilterCalculator, on a bilateral grid.
+//
+// Pixels are splatted into a coarse 3D grid indexed by their position and the
+// intensity of the guide image, with cells a fraction of sigma_space pixels
+// wide and of sigma_color deep. The grid is blurred with a small separable
+// kernel, and each output pixel is sliced from it by trilinear interpolation
+// at its position and guide intensity. The cost per pixel therefore does not
+// grow with the filter radius: larger sigmas only make the grid coarser.
+//
+// Grid rows are produced and consumed along the image rows, so that only a
+// handful of them are in memory at once, and bands of rows are filtered in
+// parallel, each with its own grid rows.
+#ifndef MEDIAPIPE_CALCULATORS_IMAGE_BILATERAL_GRID_H_
+#define MEDIAPIPE_CALCULATORS_IMAGE_BILATERAL_GRID_H_
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+// Filters input with a joint bilateral filter whose range weights come from
+// guide, which may be input itself. The spatial weights span a window of
+// radius sigma_space guide pixels, and the range weights a Gaussian of
+// sigma_color, in guide intensities normalized to [0, 1]. The intensity of
+// color guides is their luminance.
+//
+// input is GRAY8, SRGB, SRGBA or VEC32F1, and is sampled at the resolution of
+// guide, which is GRAY8, SRGB, SRGBA or VEC32F1 too. output must have the
+// format of input and the size of guide.
+absl::Status BilateralGridFilter(const ImageFrame& input,
+                                 const ImageFrame& guide, float sigma_space,
+                                 float sigma_color, ImageFrame* output);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_IMAGE_BILATERAL_GRID_H_
@@ -0,0 +1,234 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/bilateral_grid.h"
+
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Deterministic noise in [-0.5, 0.5).
+float Noise(int x, int y, int c) {
+  const float hash =
+      std::sin(x * 12.9898f + y * 78.233f + c * 37.719f) * 43758.5453f;
+  return hash - std::floor(hash) - 0.5f;
+}
+
+float Value(const ImageFrame& frame, int x, int y, int c) {
+  const uint8* row = frame.PixelData() + y * frame.WidthStep();
+  if (frame.Format() == ImageFormat::VEC32F1) {
+    return reinterpret_cast<const float*>(row)[x];
+  }
+  return row[x * frame.NumberOfChannels() + c];
+}
+
+void SetValue(ImageFrame* frame, int x, int y, int c, float value) {
+  uint8* row = frame->MutablePixelData() + y * frame->WidthStep();
+  if (frame->Format() == ImageFormat::VEC32F1) {
+    reinterpret_cast<float*>(row)[x] = value;
+  } else {
+    row[x * frame->NumberOfChannels() + c] =
+        static_cast<uint8>(std::min(std::max(value, 0.0f), 255.0f) + 0.5f);
+  }
+}
+
+float Intensity(const ImageFrame& guide, int x, int y) {
+  if (guide.Format() == ImageFormat::VEC32F1) return Value(guide, x, y, 0);
+  if (guide.NumberOfChannels() == 1) return Value(guide, x, y, 0) / 255.0f;
+  return (0.299f * Value(guide, x, y, 0) + 0.587f * Value(guide, x, y, 1) +
+          0.114f * Value(guide, x, y, 2)) /
+         255.0f;
+}
+
+// Brute-force joint bilateral filter over a disc of radius sigma_space, as
+// computed by cv::bilateralFilter with d = 2 * sigma_space. input is sampled
+// at the nearest pixel of each guide pixel.
+std::vector<float> ReferenceFilter(const ImageFrame& input,
+                                   const ImageFrame& guide, float sigma_space,
+                                   float sigma_color) {
+  const int width = guide.Width();
+  const int height = guide.Height();
+  const int channels = input.NumberOfChannels();
+  const int radius = static_cast<int>(sigma_space);
+  auto input_at = [&](int x, int y, int c) {
+    return Value(input, x * input.Width() / width, y * input.Height() / height,
+                 c);
+  };
+  std::vector<float> result(width * height * channels);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const float center = Intensity(guide, x, y);
+      std::vector<float> sum(channels, 0.0f);
+      float total = 0.0f;
+      for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+          const int sx = x + dx;
+          const int sy = y + dy;
+          if (sx < 0 || sx >= width || sy < 0 || sy >= height) continue;
+          const float distance2 = dx * dx + dy * dy;
+          if (distance2 > radius * radius) continue;
+          const float delta = Intensity(guide, sx, sy) - center;
+          const float weight =
+              std::exp(-distance2 / (2 * sigma_space * sigma_space) -
+                       delta * delta / (2 * sigma_color * sigma_color));
+          for (int c = 0; c < channels; ++c) {
+            sum[c] += weight * input_at(sx, sy, c);
+          }
+          total += weight;
+        }
+      }
+      for (int c = 0; c < channels; ++c) {
+        result[(y * width + x) * channels + c] = sum[c] / total;
+      }
+    }
+  }
+  return result;
+}
+
+// Mean absolute difference between output and the reference filter.
+float MeanError(const ImageFrame& output, const std::vector<float>& expected) {
+  const int channels = output.NumberOfChannels();
+  double error = 0.0;
+  for (int y = 0; y < output.Height(); ++y) {
+    for (int x = 0; x < output.Width(); ++x) {
+      for (int c = 0; c < channels; ++c) {
+        error += std::abs(Value(output, x, y, c) -
+                          expected[(y * output.Width() + x) * channels + c]);
+      }
+    }
+  }
+  return error / expected.size();
+}
+
+// A noisy image with a dark left half and a bright right half.
+void FillStep(ImageFrame* frame, float noise) {
+  for (int y = 0; y < frame->Height(); ++y) {
+    for (int x = 0; x < frame->Width(); ++x) {
+      for (int c = 0; c < frame->NumberOfChannels(); ++c) {
+        const float base = x < frame->Width() / 2 ? 50.0f + 10 * c : 200.0f;
+        SetValue(frame, x, y, c, base + noise * Noise(x, y, c));
+      }
+    }
+  }
+}
+
+TEST(BilateralGridTest, SmoothsNoiseAndPreservesEdges) {
+  ImageFrame input(ImageFormat::SRGB, 96, 64);
+  FillStep(&input, 30.0f);
+  ImageFrame output(ImageFormat::SRGB, 96, 64);
+  MP_ASSERT_OK(BilateralGridFilter(input, input, 8.0f, 0.15f, &output));
+
+  EXPECT_LT(MeanError(output, ReferenceFilter(input, input, 8.0f, 0.15f)),
+            1.0f);
+  for (int y = 8; y < 56; ++y) {
+    EXPECT_NEAR(Value(output, 20, y, 0), 50.0f, 5.0f) << y;
+    EXPECT_NEAR(Value(output, 47, y, 0), 50.0f, 6.0f) << y;
+    EXPECT_NEAR(Value(output, 48, y, 0), 200.0f, 6.0f) << y;
+    EXPECT_NEAR(Value(output, 76, y, 0), 200.0f, 5.0f) << y;
+  }
+}
+
+TEST(BilateralGridTest, MatchesReferenceOnSmoothImages) {
+  ImageFrame input(ImageFormat::GRAY8, 80, 60);
+  for (int y = 0; y < 60; ++y) {
+    for (int x = 0; x < 80; ++x) {
+      SetValue(&input, x, y, 0, 2.0f * x + y + 8.0f * Noise(x, y, 0));
+    }
+  }
+  ImageFrame output(ImageFormat::GRAY8, 80, 60);
+  MP_ASSERT_OK(BilateralGridFilter(input, input, 4.0f, 0.1f, &output));
+  EXPECT_LT(MeanError(output, ReferenceFilter(input, input, 4.0f, 0.1f)),
+            1.0f);
+}
+
+TEST(BilateralGridTest, RefinesMaskAlongGuideEdges) {
+  // A coarse mask whose edge is a blurry ramp, and a guide at four times its
+  // resolution with a sharp edge in the middle of the ramp.
+  ImageFrame mask(ImageFormat::VEC32F1, 24, 16);
+  for (int y = 0; y < 16; ++y) {
+    for (int x = 0; x < 24; ++x) {
+      SetValue(&mask, x, y, 0, std::min(std::max((x - 8) / 8.0f, 0.0f), 1.0f));
+    }
+  }
+  ImageFrame guide(ImageFormat::SRGBA, 96, 64);
+  FillStep(&guide, 4.0f);
+  ImageFrame output(ImageFormat::VEC32F1, 96, 64);
+  MP_ASSERT_OK(BilateralGridFilter(mask, guide, 12.0f, 0.1f, &output));
+
+  EXPECT_LT(MeanError(output, ReferenceFilter(mask, guide, 12.0f, 0.1f)),
+            0.015f);
+  // Across the guide edge, the mask jumps instead of following its ramp.
+  for (int y = 0; y < 64; ++y) {
+    EXPECT_GT(Value(output, 48, y, 0) - Value(output, 47, y, 0), 0.3f) << y;
+  }
+}
+
+TEST(BilateralGridTest, RejectsMismatchedOutput) {
+  ImageFrame input(ImageFormat::SRGB, 16, 16);
+  ImageFrame guide(ImageFormat::GRAY8, 32, 32);
+  ImageFrame small(ImageFormat::SRGB, 16, 16);
+  EXPECT_FALSE(BilateralGridFilter(input, guide, 4.0f, 0.1f, &small).ok());
+  ImageFrame gray(ImageFormat::GRAY8, 32, 32);
+  EXPECT_FALSE(BilateralGridFilter(input, guide, 4.0f, 0.1f, &gray).ok());
+  ImageFrame wide(ImageFormat::SRGB48, 16, 16);
+  EXPECT_FALSE(BilateralGridFilter(wide, wide, 4.0f, 0.1f, &wide).ok());
+}
+
+// Args: width, height, sigma_space.
+void BM_BilateralGridFilter(benchmark::State& state) {
+  ImageFrame input(ImageFormat::SRGB, state.range(0), state.range(1));
+  ImageFrame output(ImageFormat::SRGB, state.range(0), state.range(1));
+  FillStep(&input, 30.0f);
+  for (auto _ : state) {
+    BilateralGridFilter(input, input, state.range(2), 0.1f, &output)
+        .IgnoreError();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(BM_BilateralGridFilter)
+    ->Args({1280, 720, 4})
+    ->Args({1280, 720, 16})
+    ->Args({1280, 720, 64})
+    ->Args({1920, 1080, 16});
+
+// Args: width, height, sigma_space.
+void BM_BilateralGridFilterMask(benchmark::State& state) {
+  ImageFrame mask(ImageFormat::VEC32F1, 256, 256);
+  ImageFrame guide(ImageFormat::SRGB, state.range(0), state.range(1));
+  ImageFrame output(ImageFormat::VEC32F1, state.range(0), state.range(1));
+  FillStep(&guide, 30.0f);
+  for (int y = 0; y < 256; ++y) {
+    for (int x = 0; x < 256; ++x) SetValue(&mask, x, y, 0, x / 255.0f);
+  }
+  for (auto _ : state) {
+    BilateralGridFilter(mask, guide, state.range(2), 0.1f, &output)
+        .IgnoreError();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(BM_BilateralGridFilterMask)
+    ->Args({1280, 720, 8})
+    ->Args({1280, 720, 32});
+
+}  // namespace
+}  // namespace mediapipe
@@ -15,6 +15,7 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
@@ -83,6 +84,10 @@ class ColorConvertCalculator : public CalculatorBase {
 
   absl::Status Open(CalculatorContext* cc) override {
     cc->SetOffset(TimestampDiff(0));
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = &frame_pool_service.GetObject();
+    }
     return absl::OkStatus();
   }
 
@@ -96,6 +101,9 @@ class ColorConvertCalculator : public CalculatorBase {
                                 ImageFormat::Format output_format,
                                 int open_cv_convert_code,
                                 CalculatorContext* cc);
+
+  // Output frames are drawn from this pool if set.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
 };
 
 REGISTER_CALCULATOR(ColorConvertCalculator);
@@ -138,6 +146,8 @@ absl::Status ColorConvertCalculator::GetContract(CalculatorContract* cc) {
     cc->Outputs().Tag(kBgraOutTag).Set<ImageFrame>();
   }
 
+  cc->UseService(kImageFramePoolService).Optional();
+
   return absl::OkStatus();
 }
 
@@ -147,8 +157,8 @@ absl::Status ColorConvertCalculator::ConvertAndOutput(
     CalculatorContext* cc) {
   const cv::Mat& input_mat =
       formats::MatView(&cc->Inputs().Tag(input_tag).Get<ImageFrame>());
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(output_format, input_mat.cols, input_mat.rows));
+  std::unique_ptr<ImageFrame> output_frame = AcquireImageFrame(
+      frame_pool_, output_format, input_mat.cols, input_mat.rows);
   cv::Mat output_mat = formats::MatView(output_frame.get());
   cv::cvtColor(input_mat, output_mat, open_cv_convert_code);
 
@@ -18,6 +18,7 @@
 
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
@@ -113,6 +114,8 @@ absl::Status ImageCroppingCalculator::GetContract(CalculatorContract* cc) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  } else {
+    cc->UseService(kImageFramePoolService).Optional();
   }
 
   return absl::OkStatus();
@@ -144,6 +147,10 @@ absl::Status ImageCroppingCalculator::Open(CalculatorContext* cc) {
     MP_RETURN_IF_ERROR(ValidateBorderModeForGPU(cc));
   } else {
     MP_RETURN_IF_ERROR(ValidateBorderModeForCPU(cc));
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = &frame_pool_service.GetObject();
+    }
   }
 
   return absl::OkStatus();
@@ -243,6 +250,30 @@ absl::Status ImageCroppingCalculator::RenderCpu(CalculatorContext* cc) {
   output_width *= scale;
   output_height *= scale;
 
+  if (options_.output_view() && rotation == 0.0f && scale == 1.0f) {
+    const int left = rect_center_x - target_width / 2;
+    const int top = rect_center_y - target_height / 2;
+    if (target_width > 0 && target_height > 0 && left >= 0 && top >= 0 &&
+        left + target_width <= input_img.Width() &&
+        top + target_height <= input_img.Height()) {
+      // The view aliases the input pixels. Its deleter holds a copy of the
+      // input packet, which keeps them alive, and it is marked shared so that
+      // in-place consumers copy it instead.
+      const Packet input_packet = cc->Inputs().Tag(kImageTag).Value();
+      uint8* pixels = const_cast<uint8*>(input_img.PixelData()) +
+                      top * input_img.WidthStep() +
+                      left * input_img.NumberOfChannels() *
+                          input_img.ByteDepth();
+      auto output_frame = absl::make_unique<ImageFrame>(
+          input_img.Format(), target_width, target_height,
+          input_img.WidthStep(), pixels, [input_packet](uint8*) {});
+      output_frame->MarkPixelDataShared();
+      cc->Outputs().Tag(kImageTag).Add(output_frame.release(),
+                                       cc->InputTimestamp());
+      return absl::OkStatus();
+    }
+  }
+
   float dst_corners[8] = {0,
                           output_height - 1,
                           0,
@@ -254,16 +285,15 @@ absl::Status ImageCroppingCalculator::RenderCpu(CalculatorContext* cc) {
   cv::Mat dst_points = cv::Mat(4, 2, CV_32F, dst_corners);
   cv::Mat projection_matrix =
       cv::getPerspectiveTransform(src_points, dst_points);
-  cv::Mat cropped_image;
-  cv::warpPerspective(input_mat, cropped_image, projection_matrix,
+  // Warp directly into the output frame.
+  std::unique_ptr<ImageFrame> output_frame = AcquireImageFrame(
+      frame_pool_, input_img.Format(), output_width, output_height);
+  cv::Mat output_mat = formats::MatView(output_frame.get());
+  cv::warpPerspective(input_mat, output_mat, projection_matrix,
                       cv::Size(output_width, output_height),
                       /* flags = */ 0,
                       /* borderMode = */ border_mode);
 
-  std::unique_ptr<ImageFrame> output_frame(new ImageFrame(
-      input_img.Format(), cropped_image.cols, cropped_image.rows));
-  cv::Mat output_mat = formats::MatView(output_frame.get());
-  cropped_image.copyTo(output_mat);
   cc->Outputs().Tag(kImageTag).Add(output_frame.release(),
                                    cc->InputTimestamp());
   return absl::OkStatus();
@@ -5,6 +5,7 @@
 
 #include "mediapipe/calculators/image/image_cropping_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
 
 #if !MEDIAPIPE_DISABLE_GPU
 #include "mediapipe/gpu/gl_calculator_helper.h"
@@ -13,7 +14,9 @@
 // Crops the input texture to the given rectangle region. The rectangle can
 // be at arbitrary location on the image with rotation. If there's rotation, the
 // output texture will have the size of the input rectangle. The rotation should
-// be in radian, see rect.proto for detail.
+// be in radian, see rect.proto for detail. On CPU, crops without rotation can
+// be output as views of the input pixels instead of copies, see output_view in
+// image_cropping_calculator.proto.
 //
 // Input:
 //   One of the following two tags:
@@ -83,6 +86,8 @@ class ImageCroppingCalculator : public CalculatorBase {
   float transformed_points_[8];
   float output_max_width_ = FLT_MAX;
   float output_max_height_ = FLT_MAX;
+  // CPU output frames are drawn from this pool if set.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
 #if !MEDIAPIPE_DISABLE_GPU
   bool gpu_initialized_ = false;
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -16,9 +16,12 @@
 
 #include <cmath>
 #include <memory>
+#include <string>
 
 #include "mediapipe/calculators/image/image_cropping_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
@@ -33,6 +36,7 @@ namespace {
 constexpr int input_width = 100;
 constexpr int input_height = 100;
 
+constexpr char kImageTag[] = "IMAGE";
 constexpr char kRectTag[] = "RECT";
 constexpr char kHeightTag[] = "HEIGHT";
 constexpr char kWidthTag[] = "WIDTH";
@@ -212,5 +216,63 @@ TEST(ImageCroppingCalculatorTest, RedundantSpecWithInputStream) {
             expectRect);
 }  // TEST
 
+// Runs a CPU crop of an SRGB input_width x input_height frame with the given
+// options and returns the input and output frames.
+void RunCpuCrop(const std::string& options, Packet* input, Packet* output) {
+  mediapipe::CalculatorGraphConfig::Node node;
+  node.set_calculator("ImageCroppingCalculator");
+  node.add_input_stream("IMAGE:input_frames");
+  node.add_output_stream("IMAGE:cropped_output_frames");
+  *node.mutable_options()->MutableExtension(
+      mediapipe::ImageCroppingCalculatorOptions::ext) =
+      ParseTextProtoOrDie<mediapipe::ImageCroppingCalculatorOptions>(options);
+  CalculatorRunner runner(node);
+  auto input_frame = absl::make_unique<ImageFrame>(ImageFormat::SRGB,
+                                                   input_width, input_height);
+  for (int y = 0; y < input_height; ++y) {
+    uint8* row = input_frame->MutablePixelData() + y * input_frame->WidthStep();
+    for (int x = 0; x < input_width * 3; ++x) row[x] = (x + 7 * y) % 256;
+  }
+  *input = Adopt(input_frame.release()).At(Timestamp(0));
+  runner.MutableInputs()->Tag(kImageTag).packets.push_back(*input);
+  MP_ASSERT_OK(runner.Run());
+  const auto& outputs = runner.Outputs().Tag(kImageTag).packets;
+  ASSERT_EQ(outputs.size(), 1);
+  *output = outputs[0];
+}
+
+// Test that axis-aligned crops within the image are output as views when
+// output_view is set.
+TEST(ImageCroppingCalculatorTest, OutputsViewOfInputPixels) {
+  Packet input;
+  Packet output;
+  RunCpuCrop("width: 40 height: 20 output_view: true", &input, &output);
+  const auto& input_frame = input.Get<ImageFrame>();
+  const auto& output_frame = output.Get<ImageFrame>();
+  EXPECT_EQ(output_frame.Width(), 40);
+  EXPECT_EQ(output_frame.Height(), 20);
+  EXPECT_EQ(output_frame.WidthStep(), input_frame.WidthStep());
+  // The crop is centered, at (30, 40).
+  EXPECT_EQ(output_frame.PixelData(),
+            input_frame.PixelData() + 40 * input_frame.WidthStep() + 30 * 3);
+  EXPECT_TRUE(output_frame.IsPixelDataShared());
+}  // TEST
+
+// Test that crops reaching beyond the image are copied even when output_view
+// is set.
+TEST(ImageCroppingCalculatorTest, CopiesCropsBeyondImage) {
+  Packet input;
+  Packet output;
+  RunCpuCrop("width: 120 height: 20 output_view: true", &input, &output);
+  const auto& input_frame = input.Get<ImageFrame>();
+  const auto& output_frame = output.Get<ImageFrame>();
+  EXPECT_EQ(output_frame.Width(), 120);
+  const uint8* begin = input_frame.PixelData();
+  const uint8* end = begin + input_frame.Height() * input_frame.WidthStep();
+  EXPECT_TRUE(output_frame.PixelData() < begin ||
+              output_frame.PixelData() >= end);
+  EXPECT_FALSE(output_frame.IsPixelDataShared());
+}  // TEST
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,101 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/image/image_pyramid_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
+#include "mediapipe/framework/formats/image_pyramid.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+namespace {
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kPyramidTag[] = "PYRAMID";
+}  // namespace
+
+// Publishes the ImagePyramid of each input frame, so that the calculators
+// that need downscaled copies of the frame share the levels of the pyramid
+// instead of each resizing the frame. The frame itself is shared rather than
+// copied, and the other levels are only computed once a consumer asks for
+// them, see image_pyramid.h. Levels are drawn from kImageFramePoolService if
+// the graph provides it.
+//
+// So far, ImageTransformationCalculator (via its IMAGE_PYRAMID input) is the
+// only calculator that consumes the pyramid; others still take the frame.
+//
+// Inputs:
+//   IMAGE: ImageFrame.
+//
+// Outputs:
+//   PYRAMID: ImagePyramid of IMAGE.
+//
+// Example config:
+// node {
+//   calculator: "ImagePyramidCalculator"
+//   input_stream: "IMAGE:input_video"
+//   output_stream: "PYRAMID:input_video_pyramid"
+//   options {
+//     [mediapipe.ImagePyramidCalculatorOptions.ext] {
+//       num_levels: 4
+//     }
+//   }
+// }
+class ImagePyramidCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+    cc->Outputs().Tag(kPyramidTag).Set<ImagePyramid>();
+    cc->UseService(kImageFramePoolService).Optional();
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(TimestampDiff(0));
+    num_levels_ = cc->Options<ImagePyramidCalculatorOptions>().num_levels();
+    RET_CHECK_GT(num_levels_, 0);
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = frame_pool_service.GetObject().shared_from_this();
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->Inputs().Tag(kImageTag).IsEmpty()) {
+      return absl::OkStatus();
+    }
+    auto pyramid = absl::make_unique<ImagePyramid>(
+        SharedPtrWithPacket<ImageFrame>(cc->Inputs().Tag(kImageTag).Value()),
+        num_levels_, frame_pool_);
+    cc->Outputs()
+        .Tag(kPyramidTag)
+        .Add(pyramid.release(), cc->InputTimestamp());
+    return absl::OkStatus();
+  }
+
+ private:
+  int num_levels_ = 0;
+  // Levels are drawn from this pool while it exists, see ImagePyramid.
+  std::weak_ptr<ImageFrameBufferPool> frame_pool_;
+};
+REGISTER_CALCULATOR(ImagePyramidCalculator);
+
+}  // namespace mediapipe
@@ -0,0 +1,138 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_pyramid.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/tool/sink.h"
+
+namespace mediapipe {
+namespace {
+
+std::unique_ptr<ImageFrame> MakeFrame(int width, int height) {
+  auto frame =
+      absl::make_unique<ImageFrame>(ImageFormat::SRGB, width, height);
+  for (int y = 0; y < height; ++y) {
+    uint8* row = frame->MutablePixelData() + y * frame->WidthStep();
+    for (int x = 0; x < width * 3; ++x) {
+      row[x] = (x * 7 + y * 13) % 256;
+    }
+  }
+  return frame;
+}
+
+TEST(ImagePyramidCalculatorTest, SharesInputFrame) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"pb(
+    calculator: "ImagePyramidCalculator"
+    input_stream: "IMAGE:image"
+    output_stream: "PYRAMID:pyramid"
+    options {
+      [mediapipe.ImagePyramidCalculatorOptions.ext] { num_levels: 3 }
+    }
+  )pb"));
+  auto frame = MakeFrame(64, 36);
+  const uint8* pixels = frame->PixelData();
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      Adopt(frame.release()).At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& outputs = runner.Outputs().Tag("PYRAMID").packets;
+  ASSERT_EQ(outputs.size(), 1);
+  const auto& pyramid = outputs[0].Get<ImagePyramid>();
+  ASSERT_EQ(pyramid.NumLevels(), 3);
+  EXPECT_EQ(pyramid.Level(0).PixelData(), pixels);
+  EXPECT_EQ(pyramid.Level(2).Width(), 16);
+  EXPECT_EQ(pyramid.Level(2).Height(), 9);
+}
+
+// Scaling from the pyramid matches scaling the frame itself, up to the
+// rounding of the intermediate level: the 32x16 image is level 2 of the
+// 128x64 frame, before rotation.
+TEST(ImagePyramidCalculatorTest, FeedsImageTransformationCalculator) {
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+        input_stream: "image"
+        output_stream: "from_image"
+        output_stream: "from_pyramid"
+        node {
+          calculator: "ImagePyramidCalculator"
+          input_stream: "IMAGE:image"
+          output_stream: "PYRAMID:pyramid"
+        }
+        node {
+          calculator: "ImageTransformationCalculator"
+          input_stream: "IMAGE:image"
+          output_stream: "IMAGE:from_image"
+          options {
+            [mediapipe.ImageTransformationCalculatorOptions.ext] {
+              output_width: 32
+              output_height: 32
+              scale_mode: FIT
+              rotation_mode: ROTATION_90
+            }
+          }
+        }
+        node {
+          calculator: "ImageTransformationCalculator"
+          input_stream: "IMAGE_PYRAMID:pyramid"
+          output_stream: "IMAGE:from_pyramid"
+          options {
+            [mediapipe.ImageTransformationCalculatorOptions.ext] {
+              output_width: 32
+              output_height: 32
+              scale_mode: FIT
+              rotation_mode: ROTATION_90
+            }
+          }
+        }
+      )pb");
+  std::vector<Packet> from_image;
+  std::vector<Packet> from_pyramid;
+  tool::AddVectorSink("from_image", &config, &from_image);
+  tool::AddVectorSink("from_pyramid", &config, &from_pyramid);
+
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "image", Adopt(MakeFrame(128, 64).release()).At(Timestamp(0))));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(from_image.size(), 1);
+  ASSERT_EQ(from_pyramid.size(), 1);
+  const auto& expected = from_image[0].Get<ImageFrame>();
+  const auto& actual = from_pyramid[0].Get<ImageFrame>();
+  ASSERT_EQ(actual.Width(), 32);
+  ASSERT_EQ(actual.Height(), 32);
+  for (int y = 0; y < 32; ++y) {
+    const uint8* expected_row = expected.PixelData() + y * expected.WidthStep();
+    const uint8* actual_row = actual.PixelData() + y * actual.WidthStep();
+    for (int x = 0; x < 32 * 3; ++x) {
+      EXPECT_LE(std::abs(expected_row[x] - actual_row[x]), 1) << x << "," << y;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -12,12 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+
 #include "mediapipe/calculators/image/image_transformation_calculator.pb.h"
+#include "mediapipe/calculators/image/image_transformation_utils.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
-#include "mediapipe/framework/formats/image_frame_opencv.h"
-#include "mediapipe/framework/port/opencv_core_inc.h"
-#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
+#include "mediapipe/framework/formats/image_pyramid.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/gpu/scale_mode.pb.h"
@@ -48,6 +51,7 @@ namespace mediapipe {
 
 namespace {
 constexpr char kImageFrameTag[] = "IMAGE";
+constexpr char kImagePyramidTag[] = "IMAGE_PYRAMID";
 constexpr char kGpuBufferTag[] = "IMAGE_GPU";
 
 int RotationModeToDegrees(mediapipe::RotationMode_Mode rotation) {
@@ -100,6 +104,10 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
 // Input:
 //   One of the following tags:
 //   IMAGE: ImageFrame representing the input image.
+//   IMAGE_PYRAMID: ImagePyramid of the input image, as output by
+//   ImagePyramidCalculator. The image is scaled from the smallest level of the
+//   pyramid that is at least as large as the scaled image, which other
+//   consumers of the pyramid share.
 //   IMAGE_GPU: GpuBuffer representing the input image.
 //
 //   ROTATION_DEGREES (optional): The counterclockwise rotation angle in
@@ -155,8 +163,12 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
 // Note: To enable horizontal or vertical flipping, specify them in the
 // calculator options. Flipping is applied after rotation.
 //
+// Note: On CPU, scaling, rotation, flipping and padding are applied in a
+// single resampling pass that writes the output frame directly (see
+// image_transformation_utils.h).
+//
 // Note: Input defines output, so only matchig types supported:
-// IMAGE -> IMAGE  or  IMAGE_GPU -> IMAGE_GPU
+// IMAGE -> IMAGE, IMAGE_PYRAMID -> IMAGE  or  IMAGE_GPU -> IMAGE_GPU
 //
 class ImageTransformationCalculator : public CalculatorBase {
  public:
@@ -189,6 +201,8 @@ class ImageTransformationCalculator : public CalculatorBase {
   bool flip_vertically_ = false;
 
   bool use_gpu_ = false;
+  // CPU output frames are drawn from this pool if set.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
 #if !MEDIAPIPE_DISABLE_GPU
   GlCalculatorHelper gpu_helper_;
   std::unique_ptr<QuadRenderer> rgb_renderer_;
@@ -202,8 +216,10 @@ REGISTER_CALCULATOR(ImageTransformationCalculator);
 absl::Status ImageTransformationCalculator::GetContract(
     CalculatorContract* cc) {
   // Only one input can be set, and the output type must match.
-  RET_CHECK(cc->Inputs().HasTag(kImageFrameTag) ^
-            cc->Inputs().HasTag(kGpuBufferTag));
+  RET_CHECK_EQ(cc->Inputs().HasTag(kImageFrameTag) +
+                   cc->Inputs().HasTag(kImagePyramidTag) +
+                   cc->Inputs().HasTag(kGpuBufferTag),
+               1);
 
   bool use_gpu = false;
 
@@ -212,6 +228,11 @@ absl::Status ImageTransformationCalculator::GetContract(
     cc->Inputs().Tag(kImageFrameTag).Set<ImageFrame>();
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
   }
+  if (cc->Inputs().HasTag(kImagePyramidTag)) {
+    RET_CHECK(cc->Outputs().HasTag(kImageFrameTag));
+    cc->Inputs().Tag(kImagePyramidTag).Set<ImagePyramid>();
+    cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+  }
 #if !MEDIAPIPE_DISABLE_GPU
   if (cc->Inputs().HasTag(kGpuBufferTag)) {
     RET_CHECK(cc->Outputs().HasTag(kGpuBufferTag));
@@ -252,6 +273,8 @@ absl::Status ImageTransformationCalculator::GetContract(
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(GlCalculatorHelper::UpdateContract(cc));
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  } else {
+    cc->UseService(kImageFramePoolService).Optional();
   }
 
   return absl::OkStatus();
@@ -309,6 +332,11 @@ absl::Status ImageTransformationCalculator::Open(CalculatorContext* cc) {
 #else
     RET_CHECK_FAIL() << "GPU processing not enabled.";
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  } else {
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = &frame_pool_service.GetObject();
+    }
   }
 
   return absl::OkStatus();
@@ -339,7 +367,10 @@ absl::Status ImageTransformationCalculator::Process(CalculatorContext* cc) {
         [this, cc]() -> absl::Status { return RenderGpu(cc); });
 #endif  // !MEDIAPIPE_DISABLE_GPU
   } else {
-    if (cc->Inputs().Tag(kImageFrameTag).IsEmpty()) {
+    const char* input_tag = cc->Inputs().HasTag(kImagePyramidTag)
+                                ? kImagePyramidTag
+                                : kImageFrameTag;
+    if (cc->Inputs().Tag(input_tag).IsEmpty()) {
       return absl::OkStatus();
     }
     return RenderCpu(cc);
@@ -374,56 +405,49 @@ absl::Status ImageTransformationCalculator::Close(CalculatorContext* cc) {
 }
 
 absl::Status ImageTransformationCalculator::RenderCpu(CalculatorContext* cc) {
-  cv::Mat input_mat;
-  mediapipe::ImageFormat::Format format;
-
-  const auto& input = cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
-  input_mat = formats::MatView(&input);
-  format = input.Format();
-
-  const int input_width = input_mat.cols;
-  const int input_height = input_mat.rows;
+  const ImagePyramid* pyramid = nullptr;
+  if (cc->Inputs().HasTag(kImagePyramidTag)) {
+    pyramid = &cc->Inputs().Tag(kImagePyramidTag).Get<ImagePyramid>();
+  }
+  const auto& input = pyramid
+                          ? pyramid->Level(0)
+                          : cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
+  const int input_width = input.Width();
+  const int input_height = input.Height();
   int output_width;
   int output_height;
   ComputeOutputDimensions(input_width, input_height, &output_width,
                           &output_height);
 
-  if (output_width_ > 0 && output_height_ > 0) {
-    cv::Mat scaled_mat;
-    if (scale_mode_ == mediapipe::ScaleMode_Mode_STRETCH) {
-      int scale_flag =
-          input_mat.cols > output_width_ && input_mat.rows > output_height_
-              ? cv::INTER_AREA
-              : cv::INTER_LINEAR;
-      cv::resize(input_mat, scaled_mat, cv::Size(output_width_, output_height_),
-                 0, 0, scale_flag);
+  // Rotation, flips, scaling and padding are applied in a single pass that
+  // writes the output frame directly.
+  ImageTransform transform;
+  transform.rotation_degrees = RotationModeToDegrees(rotation_);
+  transform.flip_horizontally = flip_horizontally_;
+  transform.flip_vertically = flip_vertically_;
+  if (output_width_ > 0 && output_height_ > 0 &&
+      scale_mode_ != mediapipe::ScaleMode_Mode_STRETCH) {
+    int rotated_width = input_width;
+    int rotated_height = input_height;
+    if (rotation_ == mediapipe::RotationMode_Mode_ROTATION_90 ||
+        rotation_ == mediapipe::RotationMode_Mode_ROTATION_270) {
+      std::swap(rotated_width, rotated_height);
+    }
+    const float scale =
+        std::min(static_cast<float>(output_width_) / rotated_width,
+                 static_cast<float>(output_height_) / rotated_height);
+    const int target_width = std::round(rotated_width * scale);
+    const int target_height = std::round(rotated_height * scale);
+    if (scale_mode_ == mediapipe::ScaleMode_Mode_FIT) {
+      transform.left = (output_width_ - target_width) / 2;
+      transform.top = (output_height_ - target_height) / 2;
+      transform.width = target_width;
+      transform.height = target_height;
+      transform.replicate_border = !options_.constant_padding();
     } else {
-      const float scale =
-          std::min(static_cast<float>(output_width_) / input_width,
-                   static_cast<float>(output_height_) / input_height);
-      const int target_width = std::round(input_width * scale);
-      const int target_height = std::round(input_height * scale);
-      int scale_flag = scale < 1.0f ? cv::INTER_AREA : cv::INTER_LINEAR;
-      if (scale_mode_ == mediapipe::ScaleMode_Mode_FIT) {
-        cv::Mat intermediate_mat;
-        cv::resize(input_mat, intermediate_mat,
-                   cv::Size(target_width, target_height), 0, 0, scale_flag);
-        const int top = (output_height_ - target_height) / 2;
-        const int bottom = output_height_ - target_height - top;
-        const int left = (output_width_ - target_width) / 2;
-        const int right = output_width_ - target_width - left;
-        cv::copyMakeBorder(intermediate_mat, scaled_mat, top, bottom, left,
-                           right,
-                           options_.constant_padding() ? cv::BORDER_CONSTANT
-                                                       : cv::BORDER_REPLICATE);
-      } else {
-        cv::resize(input_mat, scaled_mat, cv::Size(target_width, target_height),
-                   0, 0, scale_flag);
-        output_width = target_width;
-        output_height = target_height;
-      }
+      output_width = target_width;
+      output_height = target_height;
     }
-    input_mat = scaled_mat;
   }
 
   if (cc->Outputs().HasTag("LETTERBOX_PADDING")) {
@@ -435,44 +459,23 @@ absl::Status ImageTransformationCalculator::RenderCpu(CalculatorContext* cc) {
         .Add(padding.release(), cc->InputTimestamp());
   }
 
-  cv::Mat rotated_mat;
-  cv::Size rotated_size(output_width, output_height);
-  if (input_mat.size() == rotated_size) {
-    const int angle = RotationModeToDegrees(rotation_);
-    cv::Point2f src_center(input_mat.cols / 2.0, input_mat.rows / 2.0);
-    cv::Mat rotation_mat = cv::getRotationMatrix2D(src_center, angle, 1.0);
-    cv::warpAffine(input_mat, rotated_mat, rotation_mat, rotated_size);
-  } else {
-    switch (rotation_) {
-      case mediapipe::RotationMode_Mode_UNKNOWN:
-      case mediapipe::RotationMode_Mode_ROTATION_0:
-        rotated_mat = input_mat;
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_90:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_90_COUNTERCLOCKWISE);
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_180:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_180);
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_270:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_90_CLOCKWISE);
-        break;
+  // Pyramid levels at least as large as the scaled image lose none of the
+  // detail that scaling the input would keep, and cost less to scale.
+  const ImageFrame* source = &input;
+  if (pyramid) {
+    int scaled_width = transform.width > 0 ? transform.width : output_width;
+    int scaled_height = transform.height > 0 ? transform.height : output_height;
+    if (rotation_ == mediapipe::RotationMode_Mode_ROTATION_90 ||
+        rotation_ == mediapipe::RotationMode_Mode_ROTATION_270) {
+      std::swap(scaled_width, scaled_height);
     }
+    source =
+        &pyramid->Level(pyramid->LevelForSize(scaled_width, scaled_height));
   }
 
-  cv::Mat flipped_mat;
-  if (flip_horizontally_ || flip_vertically_) {
-    const int flip_code =
-        flip_horizontally_ && flip_vertically_ ? -1 : flip_horizontally_;
-    cv::flip(rotated_mat, flipped_mat, flip_code);
-  } else {
-    flipped_mat = rotated_mat;
-  }
-
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(format, output_width, output_height));
-  cv::Mat output_mat = formats::MatView(output_frame.get());
-  flipped_mat.copyTo(output_mat);
+  std::unique_ptr<ImageFrame> output_frame = AcquireImageFrame(
+      frame_pool_, input.Format(), output_width, output_height);
+  MP_RETURN_IF_ERROR(TransformImage(*source, transform, output_frame.get()));
   cc->Outputs()
       .Tag(kImageFrameTag)
       .Add(output_frame.release(), cc->InputTimestamp());
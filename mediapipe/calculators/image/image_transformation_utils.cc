@@ -0,0 +1,528 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/image_transformation_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/util/parallel_for_rows.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Transposed rows are written in strips of this many rows, so that each input
+// row is read sequentially once per strip instead of once per output row.
+constexpr int kTransposeStripRows = 16;
+
+// Resampling weights of one output axis. Output index i is the sum of
+// weight[t] * source[index[t]] for the num_taps taps t starting at
+// i * num_taps, where the source indices run along the input axis that the
+// output axis maps to. Indices that need fewer taps are padded with taps of
+// weight 0 on their first source index.
+struct AxisTaps {
+  // Whether the axis keeps its size: a single tap of weight 1 per index.
+  bool identity = false;
+  // Whether output index 0 maps to the last source index.
+  bool reversed = false;
+  // Exact integer reduction factor of the axis, or 0.
+  int factor = 0;
+  // Number of source indices.
+  int src_size = 0;
+  int num_taps = 0;
+  std::vector<int> index;
+  std::vector<float> weight;
+};
+
+// The composed transform, as separable taps for the rectangle of the output
+// covered by the image.
+struct Layout {
+  // Whether output rows run along input columns.
+  bool transposed = false;
+  AxisTaps x;
+  AxisTaps y;
+  int left = 0;
+  int top = 0;
+  int width = 0;
+  int height = 0;
+};
+
+AxisTaps ComputeTaps(int src_size, int dst_size, bool reversed) {
+  AxisTaps taps;
+  taps.identity = src_size == dst_size;
+  taps.reversed = reversed;
+  taps.src_size = src_size;
+  if (dst_size < src_size && src_size % dst_size == 0) {
+    taps.factor = src_size / dst_size;
+  }
+  std::vector<std::vector<std::pair<int, float>>> dst_taps(dst_size);
+  const double scale = static_cast<double>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; ++i) {
+    auto& pixel_taps = dst_taps[i];
+    if (taps.identity) {
+      pixel_taps.emplace_back(i, 1.0f);
+    } else if (dst_size < src_size) {
+      // Averages the source pixels covered by the output pixel, weighted by
+      // their coverage, as cv::INTER_AREA does.
+      const double begin = i * scale;
+      const double end = (i + 1) * scale;
+      for (int s = static_cast<int>(begin); s < src_size && s < end; ++s) {
+        const double coverage =
+            std::min<double>(end, s + 1) - std::max<double>(begin, s);
+        if (coverage > 1e-6) pixel_taps.emplace_back(s, coverage / scale);
+      }
+    } else {
+      // Interpolates the two nearest source pixels, with pixel centers
+      // aligned as cv::INTER_LINEAR does.
+      const double position =
+          std::min(std::max((i + 0.5) * scale - 0.5, 0.0), src_size - 1.0);
+      const int s = static_cast<int>(position);
+      const float fraction = position - s;
+      pixel_taps.emplace_back(s, 1.0f - fraction);
+      if (fraction > 0.0f) pixel_taps.emplace_back(s + 1, fraction);
+    }
+    taps.num_taps = std::max<int>(taps.num_taps, pixel_taps.size());
+  }
+  taps.index.reserve(dst_size * taps.num_taps);
+  taps.weight.reserve(dst_size * taps.num_taps);
+  for (const auto& pixel_taps : dst_taps) {
+    for (int t = 0; t < taps.num_taps; ++t) {
+      const bool padding = t >= static_cast<int>(pixel_taps.size());
+      const int s = pixel_taps[padding ? 0 : t].first;
+      taps.index.push_back(reversed ? src_size - 1 - s : s);
+      taps.weight.push_back(padding ? 0.0f : pixel_taps[t].second);
+    }
+  }
+  return taps;
+}
+
+template <typename T>
+const T* Row(const ImageFrame& frame, int row) {
+  return reinterpret_cast<const T*>(frame.PixelData() +
+                                    row * frame.WidthStep());
+}
+
+template <typename T>
+T* MutableRow(ImageFrame* frame, int row) {
+  return reinterpret_cast<T*>(frame->MutablePixelData() +
+                              row * frame->WidthStep());
+}
+
+template <typename T>
+struct PixelTraits;
+
+template <>
+struct PixelTraits<uint8> {
+  static uint8 Store(float value) {
+    return static_cast<uint8>(std::min(std::max(value, 0.0f), 255.0f) + 0.5f);
+  }
+};
+
+template <>
+struct PixelTraits<uint16> {
+  static uint16 Store(float value) {
+    return static_cast<uint16>(std::min(std::max(value, 0.0f), 65535.0f) +
+                               0.5f);
+  }
+};
+
+template <>
+struct PixelTraits<float> {
+  static float Store(float value) { return value; }
+};
+
+// Signature of the kernels below, which fill rows [begin, end) of the
+// rectangle of the output covered by the image.
+using RowsKernel = void (*)(const ImageFrame& input, const Layout& layout,
+                            int begin, int end, ImageFrame* output);
+
+// Copies pixels for transforms that do not scale the image.
+template <int kPixelBytes>
+void PermuteRows(const ImageFrame& input, const Layout& layout, int begin,
+                 int end, ImageFrame* output) {
+  const AxisTaps& x = layout.x;
+  const AxisTaps& y = layout.y;
+  const int row_bytes = layout.width * kPixelBytes;
+  if (!layout.transposed) {
+    for (int j = begin; j < end; ++j) {
+      const uint8* src = Row<uint8>(input, y.index[j]);
+      uint8* dst = MutableRow<uint8>(output, layout.top + j) +
+                   layout.left * kPixelBytes;
+      if (!x.reversed) {
+        std::memcpy(dst, src, row_bytes);
+        continue;
+      }
+      for (int i = 0; i < layout.width; ++i) {
+        std::memcpy(dst + i * kPixelBytes, src + x.index[i] * kPixelBytes,
+                    kPixelBytes);
+      }
+    }
+    return;
+  }
+  // Output column i is input row x.index[i], and output row j is input
+  // column y.index[j].
+  uint8* dst_rows[kTransposeStripRows];
+  for (int strip = begin; strip < end; strip += kTransposeStripRows) {
+    const int strip_rows = std::min(kTransposeStripRows, end - strip);
+    for (int r = 0; r < strip_rows; ++r) {
+      dst_rows[r] = MutableRow<uint8>(output, layout.top + strip + r) +
+                    layout.left * kPixelBytes;
+    }
+    const int* src_columns = &y.index[strip];
+    for (int i = 0; i < layout.width; ++i) {
+      const uint8* src = Row<uint8>(input, x.index[i]);
+      for (int r = 0; r < strip_rows; ++r) {
+        std::memcpy(dst_rows[r] + i * kPixelBytes,
+                    src + src_columns[r] * kPixelBytes, kPixelBytes);
+      }
+    }
+  }
+}
+
+// Averages kFactor x kFactor blocks of 8-bit pixels with integer arithmetic.
+// Only used when both axes shrink by kFactor.
+template <int kChannels, int kFactor>
+void BoxFilterRows(const ImageFrame& input, const Layout& layout, int begin,
+                   int end, ImageFrame* output) {
+  constexpr int kArea = kFactor * kFactor;
+  const AxisTaps& x = layout.x;
+  const AxisTaps& y = layout.y;
+  const int line_size = input.Width() * kChannels;
+  std::vector<uint16> sums(line_size);
+  for (int j = begin; j < end; ++j) {
+    const int* rows = &y.index[j * kFactor];
+    const uint8* src = Row<uint8>(input, rows[0]);
+    for (int k = 0; k < line_size; ++k) sums[k] = src[k];
+    for (int r = 1; r < kFactor; ++r) {
+      src = Row<uint8>(input, rows[r]);
+      for (int k = 0; k < line_size; ++k) sums[k] += src[k];
+    }
+    uint8* dst =
+        MutableRow<uint8>(output, layout.top + j) + layout.left * kChannels;
+    for (int i = 0; i < layout.width; ++i) {
+      const int* columns = &x.index[i * kFactor];
+      const uint16* block =
+          &sums[std::min(columns[0], columns[kFactor - 1]) * kChannels];
+      for (int c = 0; c < kChannels; ++c) {
+        int sum = kArea / 2;
+        for (int d = 0; d < kFactor; ++d) sum += block[d * kChannels + c];
+        dst[i * kChannels + c] = sum / kArea;
+      }
+    }
+  }
+}
+
+// Resamples a line of input pixels along the output columns.
+template <int kChannels>
+void ResampleLine(const float* src, const AxisTaps& x, int width,
+                  float* line) {
+  const int num_taps = x.num_taps;
+  const int* index = x.index.data();
+  const float* weight = x.weight.data();
+  for (int i = 0; i < width; ++i) {
+    float sum[kChannels] = {};
+    for (int t = 0; t < num_taps; ++t) {
+      const float* pixel = src + index[t] * kChannels;
+      for (int c = 0; c < kChannels; ++c) sum[c] += weight[t] * pixel[c];
+    }
+    for (int c = 0; c < kChannels; ++c) line[i * kChannels + c] = sum[c];
+    index += num_taps;
+    weight += num_taps;
+  }
+}
+
+template <typename T>
+void StoreLine(const float* line, int size, T* dst) {
+  for (int k = 0; k < size; ++k) dst[k] = PixelTraits<T>::Store(line[k]);
+}
+
+// Resamples rows that shrink in two steps: the input rows of each output row
+// are blended into a line of floats, which is resampled along the output
+// columns.
+template <typename T, int kChannels>
+void ShrinkRows(const ImageFrame& input, const Layout& layout, int begin,
+                int end, ImageFrame* output) {
+  const AxisTaps& x = layout.x;
+  const AxisTaps& y = layout.y;
+  const int num_taps = y.num_taps;
+  const int input_size = input.Width() * kChannels;
+  const int line_size = layout.width * kChannels;
+  std::vector<float> sums(input_size);
+  std::vector<float> line(line_size);
+  for (int j = begin; j < end; ++j) {
+    const int* rows = &y.index[j * num_taps];
+    const float* weights = &y.weight[j * num_taps];
+    const T* src = Row<T>(input, rows[0]);
+    for (int k = 0; k < input_size; ++k) sums[k] = weights[0] * src[k];
+    for (int t = 1; t < num_taps; ++t) {
+      const float weight = weights[t];
+      if (weight == 0.0f) continue;
+      src = Row<T>(input, rows[t]);
+      for (int k = 0; k < input_size; ++k) sums[k] += weight * src[k];
+    }
+    ResampleLine<kChannels>(sums.data(), x, layout.width, line.data());
+    StoreLine(line.data(), line_size,
+              MutableRow<T>(output, layout.top + j) + layout.left * kChannels);
+  }
+}
+
+// Resamples rows that grow or keep their number in two steps: input rows are
+// resampled along the output columns into lines of floats, and output rows
+// are blended from those lines. Lines are kept for the following output rows,
+// so that each input row is resampled once.
+template <typename T, int kChannels>
+void GrowRows(const ImageFrame& input, const Layout& layout, int begin,
+              int end, ImageFrame* output) {
+  const AxisTaps& x = layout.x;
+  const AxisTaps& y = layout.y;
+  const int num_taps = y.num_taps;
+  const int input_size = input.Width() * kChannels;
+  const int line_size = layout.width * kChannels;
+  std::vector<float> input_line(input_size);
+  // Input row held by each cached line, or -1.
+  std::vector<int> cached_rows(num_taps, -1);
+  std::vector<float> cached_lines(num_taps * line_size);
+  std::vector<float> sums(line_size);
+  for (int j = begin; j < end; ++j) {
+    const int* rows = &y.index[j * num_taps];
+    const float* weights = &y.weight[j * num_taps];
+    for (int t = 0; t < num_taps; ++t) {
+      // The first tap always has a weight.
+      if (weights[t] == 0.0f) continue;
+      int slot = std::find(cached_rows.begin(), cached_rows.end(), rows[t]) -
+                 cached_rows.begin();
+      if (slot == num_taps) {
+        // Evicts a line that this output row does not use.
+        slot = std::find_if(cached_rows.begin(), cached_rows.end(),
+                            [rows, num_taps](int row) {
+                              return std::find(rows, rows + num_taps, row) ==
+                                     rows + num_taps;
+                            }) -
+               cached_rows.begin();
+        cached_rows[slot] = rows[t];
+        const T* src = Row<T>(input, rows[t]);
+        for (int k = 0; k < input_size; ++k) input_line[k] = src[k];
+        ResampleLine<kChannels>(input_line.data(), x, layout.width,
+                                &cached_lines[slot * line_size]);
+      }
+      const float* line = &cached_lines[slot * line_size];
+      const float weight = weights[t];
+      if (t == 0) {
+        for (int k = 0; k < line_size; ++k) sums[k] = weight * line[k];
+      } else {
+        for (int k = 0; k < line_size; ++k) sums[k] += weight * line[k];
+      }
+    }
+    StoreLine(sums.data(), line_size,
+              MutableRow<T>(output, layout.top + j) + layout.left * kChannels);
+  }
+}
+
+RowsKernel GetPermuteKernel(int pixel_bytes) {
+  switch (pixel_bytes) {
+    case 1:
+      return &PermuteRows<1>;
+    case 2:
+      return &PermuteRows<2>;
+    case 3:
+      return &PermuteRows<3>;
+    case 4:
+      return &PermuteRows<4>;
+    case 6:
+      return &PermuteRows<6>;
+    case 8:
+      return &PermuteRows<8>;
+    case 12:
+      return &PermuteRows<12>;
+    case 16:
+      return &PermuteRows<16>;
+  }
+  return nullptr;
+}
+
+template <int kFactor>
+RowsKernel GetBoxFilterKernel(int channels) {
+  switch (channels) {
+    case 1:
+      return &BoxFilterRows<1, kFactor>;
+    case 2:
+      return &BoxFilterRows<2, kFactor>;
+    case 3:
+      return &BoxFilterRows<3, kFactor>;
+    case 4:
+      return &BoxFilterRows<4, kFactor>;
+  }
+  return nullptr;
+}
+
+template <typename T>
+RowsKernel GetResampleKernel(bool shrink, int channels) {
+  switch (channels) {
+    case 1:
+      return shrink ? &ShrinkRows<T, 1> : &GrowRows<T, 1>;
+    case 2:
+      return shrink ? &ShrinkRows<T, 2> : &GrowRows<T, 2>;
+    case 3:
+      return shrink ? &ShrinkRows<T, 3> : &GrowRows<T, 3>;
+    case 4:
+      return shrink ? &ShrinkRows<T, 4> : &GrowRows<T, 4>;
+  }
+  return nullptr;
+}
+
+RowsKernel GetKernel(const Layout& layout, int channels, int byte_depth) {
+  if (layout.x.identity && layout.y.identity) {
+    return GetPermuteKernel(channels * byte_depth);
+  }
+  if (byte_depth == 1 && layout.x.factor == layout.y.factor) {
+    if (layout.x.factor == 2) return GetBoxFilterKernel<2>(channels);
+    if (layout.x.factor == 4) return GetBoxFilterKernel<4>(channels);
+  }
+  // Blending input rows first is cheaper when there are fewer output rows.
+  const bool shrink = layout.height < layout.y.src_size;
+  switch (byte_depth) {
+    case 1:
+      return GetResampleKernel<uint8>(shrink, channels);
+    case 2:
+      return GetResampleKernel<uint16>(shrink, channels);
+    case 4:
+      return GetResampleKernel<float>(shrink, channels);
+  }
+  return nullptr;
+}
+
+// Fills the columns of a row left and right of the rectangle.
+void PadColumns(const Layout& layout, int pixel_bytes, bool replicate,
+                uint8* row, int row_pixels) {
+  const int right = layout.left + layout.width;
+  if (!replicate) {
+    std::memset(row, 0, layout.left * pixel_bytes);
+    std::memset(row + right * pixel_bytes, 0,
+                (row_pixels - right) * pixel_bytes);
+    return;
+  }
+  const uint8* first = row + layout.left * pixel_bytes;
+  for (int i = 0; i < layout.left; ++i) {
+    std::memcpy(row + i * pixel_bytes, first, pixel_bytes);
+  }
+  const uint8* last = row + (right - 1) * pixel_bytes;
+  for (int i = right; i < row_pixels; ++i) {
+    std::memcpy(row + i * pixel_bytes, last, pixel_bytes);
+  }
+}
+
+// Fills the rectangle of output described by layout, then its padding.
+absl::Status ApplyLayout(const ImageFrame& input, const Layout& layout,
+                         bool replicate_border, ImageFrame* output) {
+  const int pixel_bytes = input.NumberOfChannels() * input.ByteDepth();
+  const RowsKernel kernel =
+      GetKernel(layout, input.NumberOfChannels(), input.ByteDepth());
+  RET_CHECK(kernel) << "Unsupported format: " << input.Format();
+  const bool pad_columns = layout.width < output->Width();
+  // Each output row reads about input pixels / output rows pixels.
+  const int row_cost = std::max<int64>(
+      layout.width,
+      static_cast<int64>(input.Width()) * input.Height() / layout.height);
+  ParallelForRows(
+      layout.height, row_cost, [&](int begin, int end) {
+        kernel(input, layout, begin, end, output);
+        if (!pad_columns) return;
+        for (int j = begin; j < end; ++j) {
+          PadColumns(layout, pixel_bytes, replicate_border,
+                     MutableRow<uint8>(output, layout.top + j),
+                     output->Width());
+        }
+      });
+
+  const int row_bytes = output->Width() * pixel_bytes;
+  const int bottom = layout.top + layout.height;
+  for (int j = 0; j < output->Height(); ++j) {
+    if (j >= layout.top && j < bottom) continue;
+    uint8* row = MutableRow<uint8>(output, j);
+    if (replicate_border) {
+      const int edge = j < layout.top ? layout.top : bottom - 1;
+      std::memcpy(row, MutableRow<uint8>(output, edge), row_bytes);
+    } else {
+      std::memset(row, 0, row_bytes);
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status TransformImage(const ImageFrame& input,
+                            const ImageTransform& transform,
+                            ImageFrame* output) {
+  RET_CHECK(output);
+  RET_CHECK_EQ(input.Format(), output->Format());
+  RET_CHECK(!input.IsEmpty() && !output->IsEmpty());
+  const int rotation = transform.rotation_degrees;
+  RET_CHECK(rotation == 0 || rotation == 90 || rotation == 180 ||
+            rotation == 270)
+      << "Unsupported rotation: " << rotation;
+
+  Layout layout;
+  if (transform.width > 0 && transform.height > 0) {
+    RET_CHECK(transform.left >= 0 && transform.top >= 0 &&
+              transform.left + transform.width <= output->Width() &&
+              transform.top + transform.height <= output->Height())
+        << "The image rectangle must lie within the output.";
+    layout.left = transform.left;
+    layout.top = transform.top;
+    layout.width = transform.width;
+    layout.height = transform.height;
+  } else {
+    layout.width = output->Width();
+    layout.height = output->Height();
+  }
+  // Rotated by 90 degrees counterclockwise, output column x' is input row x',
+  // and output row y' is input column (input width - 1 - y'). The other
+  // rotations follow by reversing both axes.
+  layout.transposed = rotation == 90 || rotation == 270;
+  const bool reverse_x =
+      (rotation == 180 || rotation == 270) != transform.flip_horizontally;
+  const bool reverse_y =
+      (rotation == 90 || rotation == 180) != transform.flip_vertically;
+  layout.x =
+      ComputeTaps(layout.transposed ? input.Height() : input.Width(),
+                  layout.width, reverse_x);
+  layout.y =
+      ComputeTaps(layout.transposed ? input.Width() : input.Height(),
+                  layout.height, reverse_y);
+
+  if (!layout.transposed || (layout.x.identity && layout.y.identity)) {
+    return ApplyLayout(input, layout, transform.replicate_border, output);
+  }
+  // Transposed rows would blend input columns, which are scattered in memory.
+  // Instead, the image is scaled in its own orientation first, which is a
+  // frame of at most the output size, and then transposed.
+  Layout scaling;
+  scaling.x = std::move(layout.y);
+  scaling.y = std::move(layout.x);
+  scaling.width = layout.height;
+  scaling.height = layout.width;
+  ImageFrame scaled(input.Format(), scaling.width, scaling.height);
+  MP_RETURN_IF_ERROR(ApplyLayout(input, scaling, false, &scaled));
+  layout.x = ComputeTaps(scaled.Height(), layout.width, false);
+  layout.y = ComputeTaps(scaled.Width(), layout.height, false);
+  return ApplyLayout(scaled, layout, transform.replicate_border, output);
+}
+
+}  // namespace mediapipe
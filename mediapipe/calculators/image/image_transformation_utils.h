@@ -0,0 +1,67 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// CPU kernel of ImageTransformationCalculator.
+//
+// Rotations by multiples of 90 degrees and flips only permute the axes of the
+// image, so together with scaling they compose into a separable resampling:
+// each output row is a weighted sum of a few input rows (or input columns,
+// when the image is transposed), and each output pixel a weighted sum of a
+// few pixels of that line. The kernel evaluates both sums for one output row
+// at a time and writes the result and its padding straight into the output
+// frame, instead of going through a resized, a padded, a rotated and a
+// flipped intermediate image. Only images that are both scaled and rotated by
+// 90 or 270 degrees are scaled into an intermediate frame first, so that
+// input rows are read sequentially, and then transposed into the output.
+#ifndef MEDIAPIPE_CALCULATORS_IMAGE_IMAGE_TRANSFORMATION_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_IMAGE_IMAGE_TRANSFORMATION_UTILS_H_
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+// How the input of TransformImage is laid out in its output: rotated, then
+// flipped, then scaled to cover a rectangle of the output. Output pixels
+// outside of that rectangle are padding.
+struct ImageTransform {
+  // Counterclockwise rotation, one of 0, 90, 180 or 270 degrees.
+  int rotation_degrees = 0;
+  bool flip_horizontally = false;
+  bool flip_vertically = false;
+
+  // Rectangle of the output covered by the image. An empty rectangle (the
+  // default) covers the whole output.
+  int left = 0;
+  int top = 0;
+  int width = 0;
+  int height = 0;
+
+  // Whether padding repeats the pixels on the edge of the rectangle instead of
+  // being zero.
+  bool replicate_border = false;
+};
+
+// Writes input, transformed as described by transform, into output, which
+// must be allocated with the same format as input. Each axis is resampled on
+// its own: by averaging the covered input pixels when it shrinks, with exact
+// integer averages for 2x and 4x reductions of 8-bit images, and bilinearly
+// when it grows. Axes that keep their size are copied without resampling.
+absl::Status TransformImage(const ImageFrame& input,
+                            const ImageTransform& transform,
+                            ImageFrame* output);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_IMAGE_IMAGE_TRANSFORMATION_UTILS_H_
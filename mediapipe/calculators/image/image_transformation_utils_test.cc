@@ -0,0 +1,336 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/image_transformation_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Fills frame with a deterministic pattern covering the whole value range.
+void FillFrame(ImageFrame* frame) {
+  const int num_values = frame->Width() * frame->NumberOfChannels();
+  for (int row = 0; row < frame->Height(); ++row) {
+    uint8* data = frame->MutablePixelData() + row * frame->WidthStep();
+    for (int i = 0; i < num_values; ++i) {
+      data[i] = (i * 37 + row * 11) % 256;
+    }
+  }
+}
+
+// Returns a GRAY8 frame with the given rows.
+std::unique_ptr<ImageFrame> MakeGrayFrame(
+    const std::vector<std::vector<uint8>>& rows) {
+  auto frame = absl::make_unique<ImageFrame>(ImageFormat::GRAY8,
+                                             rows[0].size(), rows.size());
+  for (int y = 0; y < rows.size(); ++y) {
+    std::copy(rows[y].begin(), rows[y].end(),
+              frame->MutablePixelData() + y * frame->WidthStep());
+  }
+  return frame;
+}
+
+std::vector<std::vector<uint8>> GrayRows(const ImageFrame& frame) {
+  std::vector<std::vector<uint8>> rows;
+  for (int y = 0; y < frame.Height(); ++y) {
+    const uint8* row = frame.PixelData() + y * frame.WidthStep();
+    rows.emplace_back(row, row + frame.Width());
+  }
+  return rows;
+}
+
+const uint8* PixelAt(const ImageFrame& frame, int x, int y) {
+  return frame.PixelData() + y * frame.WidthStep() +
+         x * frame.NumberOfChannels();
+}
+
+TEST(ImageTransformationUtilsTest, RotatesCounterclockwise) {
+  auto input = MakeGrayFrame({{1, 2, 3}, {4, 5, 6}});
+  ImageTransform transform;
+  ImageFrame rotated(ImageFormat::GRAY8, 2, 3);
+
+  transform.rotation_degrees = 90;
+  MP_ASSERT_OK(TransformImage(*input, transform, &rotated));
+  EXPECT_EQ(GrayRows(rotated),
+            (std::vector<std::vector<uint8>>{{3, 6}, {2, 5}, {1, 4}}));
+
+  transform.rotation_degrees = 270;
+  MP_ASSERT_OK(TransformImage(*input, transform, &rotated));
+  EXPECT_EQ(GrayRows(rotated),
+            (std::vector<std::vector<uint8>>{{4, 1}, {5, 2}, {6, 3}}));
+
+  ImageFrame output(ImageFormat::GRAY8, 3, 2);
+  transform.rotation_degrees = 180;
+  MP_ASSERT_OK(TransformImage(*input, transform, &output));
+  EXPECT_EQ(GrayRows(output),
+            (std::vector<std::vector<uint8>>{{6, 5, 4}, {3, 2, 1}}));
+}
+
+TEST(ImageTransformationUtilsTest, FlipsAfterRotating) {
+  auto input = MakeGrayFrame({{1, 2, 3}, {4, 5, 6}});
+  ImageTransform transform;
+  ImageFrame output(ImageFormat::GRAY8, 3, 2);
+
+  transform.flip_horizontally = true;
+  MP_ASSERT_OK(TransformImage(*input, transform, &output));
+  EXPECT_EQ(GrayRows(output),
+            (std::vector<std::vector<uint8>>{{3, 2, 1}, {6, 5, 4}}));
+
+  transform.flip_horizontally = false;
+  transform.flip_vertically = true;
+  MP_ASSERT_OK(TransformImage(*input, transform, &output));
+  EXPECT_EQ(GrayRows(output),
+            (std::vector<std::vector<uint8>>{{4, 5, 6}, {1, 2, 3}}));
+
+  ImageFrame rotated(ImageFormat::GRAY8, 2, 3);
+  transform.rotation_degrees = 90;
+  MP_ASSERT_OK(TransformImage(*input, transform, &rotated));
+  EXPECT_EQ(GrayRows(rotated),
+            (std::vector<std::vector<uint8>>{{1, 4}, {2, 5}, {3, 6}}));
+}
+
+TEST(ImageTransformationUtilsTest, RotatesLargeImagesLosslessly) {
+  ImageFrame input(ImageFormat::SRGB, 67, 41);
+  FillFrame(&input);
+  ImageFrame output(ImageFormat::SRGB, 41, 67);
+  ImageTransform transform;
+  transform.rotation_degrees = 270;
+  transform.flip_vertically = true;
+  MP_ASSERT_OK(TransformImage(input, transform, &output));
+  for (int y = 0; y < output.Height(); ++y) {
+    for (int x = 0; x < output.Width(); ++x) {
+      const uint8* expected = PixelAt(input, output.Height() - 1 - y,
+                                      input.Height() - 1 - x);
+      const uint8* actual = PixelAt(output, x, y);
+      for (int c = 0; c < 3; ++c) {
+        ASSERT_EQ(actual[c], expected[c]) << x << "," << y;
+      }
+    }
+  }
+}
+
+TEST(ImageTransformationUtilsTest, AveragesExactReductions) {
+  for (const int factor : {2, 3, 4}) {
+    ImageFrame input(ImageFormat::SRGBA, 12 * factor, 5 * factor);
+    FillFrame(&input);
+    ImageFrame output(ImageFormat::SRGBA, 12, 5);
+    MP_ASSERT_OK(TransformImage(input, ImageTransform(), &output));
+    for (int y = 0; y < output.Height(); ++y) {
+      for (int x = 0; x < output.Width(); ++x) {
+        for (int c = 0; c < 4; ++c) {
+          int sum = 0;
+          for (int dy = 0; dy < factor; ++dy) {
+            for (int dx = 0; dx < factor; ++dx) {
+              sum += PixelAt(input, x * factor + dx, y * factor + dy)[c];
+            }
+          }
+          EXPECT_NEAR(PixelAt(output, x, y)[c],
+                      static_cast<float>(sum) / (factor * factor), 0.5f)
+              << factor << ": " << x << "," << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(ImageTransformationUtilsTest, ScalesRotatedImages) {
+  auto input = MakeGrayFrame({{0, 10, 20, 30}, {40, 50, 60, 70}});
+  ImageFrame output(ImageFormat::GRAY8, 1, 2);
+  ImageTransform transform;
+  transform.rotation_degrees = 90;
+  MP_ASSERT_OK(TransformImage(*input, transform, &output));
+  EXPECT_EQ(GrayRows(output), (std::vector<std::vector<uint8>>{{45}, {25}}));
+}
+
+TEST(ImageTransformationUtilsTest, AveragesCoveredPixelsWhenShrinking) {
+  auto input = MakeGrayFrame({{0, 90, 180}});
+  ImageFrame output(ImageFormat::GRAY8, 2, 1);
+  MP_ASSERT_OK(TransformImage(*input, ImageTransform(), &output));
+  EXPECT_EQ(GrayRows(output), (std::vector<std::vector<uint8>>{{30, 150}}));
+}
+
+TEST(ImageTransformationUtilsTest, InterpolatesWhenGrowing) {
+  auto input = MakeGrayFrame({{0, 100}});
+  ImageFrame output(ImageFormat::GRAY8, 4, 1);
+  MP_ASSERT_OK(TransformImage(*input, ImageTransform(), &output));
+  EXPECT_EQ(GrayRows(output),
+            (std::vector<std::vector<uint8>>{{0, 25, 75, 100}}));
+}
+
+TEST(ImageTransformationUtilsTest, ResamplesFloatImages) {
+  ImageFrame input(ImageFormat::VEC32F1, 4, 2);
+  for (int y = 0; y < 2; ++y) {
+    float* row = reinterpret_cast<float*>(input.MutablePixelData() +
+                                          y * input.WidthStep());
+    for (int x = 0; x < 4; ++x) row[x] = 0.25f * x + y;
+  }
+  ImageFrame output(ImageFormat::VEC32F1, 2, 1);
+  MP_ASSERT_OK(TransformImage(input, ImageTransform(), &output));
+  const float* result = reinterpret_cast<const float*>(output.PixelData());
+  EXPECT_FLOAT_EQ(result[0], 0.625f);
+  EXPECT_FLOAT_EQ(result[1], 1.125f);
+}
+
+TEST(ImageTransformationUtilsTest, PadsAroundRectangle) {
+  auto input = MakeGrayFrame({{1, 2}, {3, 4}});
+  ImageFrame output(ImageFormat::GRAY8, 4, 4);
+  ImageTransform transform;
+  transform.left = 1;
+  transform.top = 1;
+  transform.width = 2;
+  transform.height = 2;
+  MP_ASSERT_OK(TransformImage(*input, transform, &output));
+  EXPECT_EQ(GrayRows(output), (std::vector<std::vector<uint8>>{
+                                  {0, 0, 0, 0},
+                                  {0, 1, 2, 0},
+                                  {0, 3, 4, 0},
+                                  {0, 0, 0, 0},
+                              }));
+
+  transform.replicate_border = true;
+  MP_ASSERT_OK(TransformImage(*input, transform, &output));
+  EXPECT_EQ(GrayRows(output), (std::vector<std::vector<uint8>>{
+                                  {1, 1, 2, 2},
+                                  {1, 1, 2, 2},
+                                  {3, 3, 4, 4},
+                                  {3, 3, 4, 4},
+                              }));
+}
+
+TEST(ImageTransformationUtilsTest, RejectsInvalidTransforms) {
+  ImageFrame input(ImageFormat::SRGB, 8, 8);
+  ImageFrame output(ImageFormat::SRGB, 8, 8);
+  ImageTransform transform;
+  transform.rotation_degrees = 45;
+  EXPECT_FALSE(TransformImage(input, transform, &output).ok());
+
+  transform.rotation_degrees = 0;
+  transform.left = 4;
+  transform.width = 8;
+  transform.height = 8;
+  EXPECT_FALSE(TransformImage(input, transform, &output).ok());
+
+  ImageFrame gray(ImageFormat::GRAY8, 8, 8);
+  EXPECT_FALSE(TransformImage(input, ImageTransform(), &gray).ok());
+}
+
+// Returns the transform of ImageTransformationCalculator for the given output
+// size, with the image fitted into the output when fit is set, and stretched
+// to it otherwise.
+ImageTransform MakeTransform(int input_width, int input_height,
+                             int output_width, int output_height,
+                             int rotation, bool fit) {
+  ImageTransform transform;
+  transform.rotation_degrees = rotation;
+  if (rotation == 90 || rotation == 270) std::swap(input_width, input_height);
+  if (fit) {
+    const float scale =
+        std::min(static_cast<float>(output_width) / input_width,
+                 static_cast<float>(output_height) / input_height);
+    transform.width = std::round(input_width * scale);
+    transform.height = std::round(input_height * scale);
+    transform.left = (output_width - transform.width) / 2;
+    transform.top = (output_height - transform.height) / 2;
+  }
+  return transform;
+}
+
+// Args: input width, input height, output width, output height, rotation,
+// fit.
+void BM_TransformImage(benchmark::State& state) {
+  ImageFrame input(ImageFormat::SRGB, state.range(0), state.range(1));
+  ImageFrame output(ImageFormat::SRGB, state.range(2), state.range(3));
+  FillFrame(&input);
+  const ImageTransform transform =
+      MakeTransform(state.range(0), state.range(1), state.range(2),
+                    state.range(3), state.range(4), state.range(5));
+  for (auto _ : state) {
+    TransformImage(input, transform, &output).IgnoreError();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+
+// The previous implementation of the calculator, for comparison: separate
+// OpenCV passes to resize, pad and rotate the image, and a final copy into
+// the output frame.
+void BM_TransformImageMultiPass(benchmark::State& state) {
+  ImageFrame input(ImageFormat::SRGB, state.range(0), state.range(1));
+  ImageFrame output(ImageFormat::SRGB, state.range(2), state.range(3));
+  FillFrame(&input);
+  const int rotation = state.range(4);
+  const bool transposed = rotation == 90 || rotation == 270;
+  const ImageTransform transform =
+      MakeTransform(state.range(0), state.range(1), state.range(2),
+                    state.range(3), rotation, state.range(5));
+  int target_width = transform.width > 0 ? transform.width : output.Width();
+  int target_height = transform.height > 0 ? transform.height : output.Height();
+  if (transposed) std::swap(target_width, target_height);
+  const int scale_flag =
+      target_width < input.Width() && target_height < input.Height()
+          ? cv::INTER_AREA
+          : cv::INTER_LINEAR;
+  for (auto _ : state) {
+    cv::Mat input_mat = formats::MatView(&input);
+    cv::Mat scaled_mat;
+    cv::resize(input_mat, scaled_mat, cv::Size(target_width, target_height),
+               0, 0, scale_flag);
+    cv::Mat rotated_mat = scaled_mat;
+    if (rotation == 90) {
+      cv::rotate(scaled_mat, rotated_mat, cv::ROTATE_90_COUNTERCLOCKWISE);
+    } else if (rotation == 180) {
+      cv::rotate(scaled_mat, rotated_mat, cv::ROTATE_180);
+    } else if (rotation == 270) {
+      cv::rotate(scaled_mat, rotated_mat, cv::ROTATE_90_CLOCKWISE);
+    }
+    if (transform.width > 0) {
+      cv::Mat padded_mat;
+      const int right = output.Width() - transform.width - transform.left;
+      const int bottom = output.Height() - transform.height - transform.top;
+      cv::copyMakeBorder(rotated_mat, padded_mat, transform.top, bottom,
+                         transform.left, right, cv::BORDER_CONSTANT);
+      rotated_mat = padded_mat;
+    }
+    cv::Mat output_mat = formats::MatView(&output);
+    rotated_mat.copyTo(output_mat);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+
+void TransformImageArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Args({1920, 1080, 960, 540, 0, 0})
+      ->Args({1920, 1080, 480, 270, 0, 0})
+      ->Args({1920, 1080, 640, 480, 0, 0})
+      ->Args({1920, 1080, 256, 256, 0, 1})
+      ->Args({1080, 1920, 256, 256, 90, 1})
+      ->Args({1280, 720, 720, 1280, 270, 0})
+      ->Args({640, 480, 1280, 960, 0, 0});
+}
+BENCHMARK(BM_TransformImage)->Apply(TransformImageArgs);
+BENCHMARK(BM_TransformImageMultiPass)->Apply(TransformImageArgs);
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,575 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/mask_utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/util/parallel_for_rows.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MASK_UTILS_USE_SSE2 1
+#endif
+
+namespace mediapipe {
+namespace mask_utils {
+
+namespace {
+
+template <typename T>
+const T* Row(const ImageFrame& frame, int row) {
+  return reinterpret_cast<const T*>(frame.PixelData() +
+                                    row * frame.WidthStep());
+}
+
+template <typename T>
+T* MutableRow(ImageFrame* frame, int row) {
+  return reinterpret_cast<T*>(frame->MutablePixelData() +
+                              row * frame->WidthStep());
+}
+
+inline uint8 ToUint8(float value) {
+  return static_cast<uint8>(std::min(std::max(value, 0.0f), 255.0f) + 0.5f);
+}
+
+inline float Min(float a, float b) { return std::min(a, b); }
+
+absl::Status CheckSameSize(const ImageFrame& a, const ImageFrame& b) {
+  RET_CHECK_EQ(a.Width(), b.Width());
+  RET_CHECK_EQ(a.Height(), b.Height());
+  return absl::OkStatus();
+}
+
+// Four float lanes, one per pixel. Row loops process four pixels at a time as
+// Float4 and the remaining ones as float, with the same templated arithmetic,
+// and Float4 rounds like ToUint8(), so results do not depend on the lanes.
+// Lanes are SSE2 registers on x86 and GCC/Clang vector extensions elsewhere,
+// which lower to NEON on ARM. Other compilers get plain arrays.
+#if MASK_UTILS_USE_SSE2
+class Float4 {
+ public:
+  Float4() = default;
+  // Broadcasts value, so that scalar constants mix with lanes.
+  Float4(float value) : v_(_mm_set1_ps(value)) {}  // NOLINT
+
+  static Float4 Load(const float* values) {
+    return Float4(_mm_loadu_ps(values));
+  }
+  static Float4 FromInts(int a, int b, int c, int d) {
+    return Float4(_mm_cvtepi32_ps(_mm_setr_epi32(a, b, c, d)));
+  }
+  // Converts 4 consecutive bytes.
+  static Float4 LoadBytes(const uint8* bytes) {
+    int32 packed;
+    std::memcpy(&packed, bytes, sizeof(packed));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+    return Float4(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)));
+  }
+
+  void Store(float* values) const { _mm_storeu_ps(values, v_); }
+  // Stores the lanes rounded to uint8 as by ToUint8() to 4 consecutive bytes.
+  void StoreBytes(uint8* bytes) const {
+    const __m128i words = _mm_packs_epi32(Round(), Round());
+    const int32 packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+    std::memcpy(bytes, &packed, sizeof(packed));
+  }
+
+  friend Float4 operator+(Float4 a, Float4 b) {
+    return Float4(_mm_add_ps(a.v_, b.v_));
+  }
+  friend Float4 operator-(Float4 a, Float4 b) {
+    return Float4(_mm_sub_ps(a.v_, b.v_));
+  }
+  friend Float4 operator*(Float4 a, Float4 b) {
+    return Float4(_mm_mul_ps(a.v_, b.v_));
+  }
+  friend Float4 Min(Float4 a, Float4 b) {
+    return Float4(_mm_min_ps(a.v_, b.v_));
+  }
+
+  // Converts 4 interleaved RGB pixels to one Float4 per channel.
+  friend void LoadRgb(const uint8* pixels, Float4* r, Float4* g, Float4* b) {
+    // v0 = r0 g0 b0 r1, v1 = g1 b1 r2 g2, v2 = b2 r3 g3 b3.
+    const __m128 v0 = LoadBytes(pixels).v_;
+    const __m128 v1 = LoadBytes(pixels + 4).v_;
+    const __m128 v2 = LoadBytes(pixels + 8).v_;
+    const __m128 r_hi = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 1, 2, 2));
+    r->v_ = _mm_shuffle_ps(v0, r_hi, _MM_SHUFFLE(2, 0, 3, 0));
+    const __m128 g_lo = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 1, 1));
+    const __m128 g_hi = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 2, 3, 3));
+    g->v_ = _mm_shuffle_ps(g_lo, g_hi, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 b_lo = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 1, 2, 2));
+    const __m128 b_hi = _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(3, 3, 0, 0));
+    b->v_ = _mm_shuffle_ps(b_lo, b_hi, _MM_SHUFFLE(2, 0, 2, 0));
+  }
+
+  // Stores one Float4 per channel, rounded, as 4 interleaved RGB pixels.
+  friend void StoreRgb(Float4 r, Float4 g, Float4 b, uint8* pixels) {
+    const __m128 r01_g01 = _mm_shuffle_ps(r.v_, g.v_, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m128 b01_r12 = _mm_shuffle_ps(b.v_, r.v_, _MM_SHUFFLE(2, 1, 1, 0));
+    const __m128 g12_b12 = _mm_shuffle_ps(g.v_, b.v_, _MM_SHUFFLE(2, 1, 2, 1));
+    const __m128 r22_g22 = _mm_shuffle_ps(r.v_, g.v_, _MM_SHUFFLE(2, 2, 2, 2));
+    const __m128 b22_r33 = _mm_shuffle_ps(b.v_, r.v_, _MM_SHUFFLE(3, 3, 2, 2));
+    const __m128 g33_b33 = _mm_shuffle_ps(g.v_, b.v_, _MM_SHUFFLE(3, 3, 3, 3));
+    Float4(_mm_shuffle_ps(r01_g01, b01_r12, _MM_SHUFFLE(2, 0, 2, 0)))
+        .StoreBytes(pixels);
+    Float4(_mm_shuffle_ps(g12_b12, r22_g22, _MM_SHUFFLE(2, 0, 2, 0)))
+        .StoreBytes(pixels + 4);
+    Float4(_mm_shuffle_ps(b22_r33, g33_b33, _MM_SHUFFLE(2, 0, 2, 0)))
+        .StoreBytes(pixels + 8);
+  }
+
+ private:
+  explicit Float4(__m128 v) : v_(v) {}
+
+  __m128i Round() const {
+    const __m128 clamped =
+        _mm_min_ps(_mm_max_ps(v_, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(clamped, _mm_set1_ps(0.5f)));
+  }
+
+  __m128 v_;
+};
+#elif defined(__GNUC__)
+class Float4 {
+ public:
+  Float4() = default;
+  // Broadcasts value, so that scalar constants mix with lanes.
+  Float4(float value) : v_{value, value, value, value} {}  // NOLINT
+
+  static Float4 Load(const float* values) {
+    Vector v;
+    std::memcpy(&v, values, sizeof(v));
+    return Float4(v);
+  }
+  static Float4 FromInts(int a, int b, int c, int d) {
+    return Float4(__builtin_convertvector(IntVector{a, b, c, d}, Vector));
+  }
+  // Converts 4 consecutive bytes.
+  static Float4 LoadBytes(const uint8* bytes) {
+    return FromInts(bytes[0], bytes[1], bytes[2], bytes[3]);
+  }
+
+  void Store(float* values) const { std::memcpy(values, &v_, sizeof(v_)); }
+  // Stores the lanes rounded to uint8 as by ToUint8() to 4 consecutive bytes.
+  void StoreBytes(uint8* bytes) const { StoreBytes(bytes, 1); }
+
+  friend Float4 operator+(Float4 a, Float4 b) { return Float4(a.v_ + b.v_); }
+  friend Float4 operator-(Float4 a, Float4 b) { return Float4(a.v_ - b.v_); }
+  friend Float4 operator*(Float4 a, Float4 b) { return Float4(a.v_ * b.v_); }
+  friend Float4 Min(Float4 a, Float4 b) {
+    const IntVector a_is_less = a.v_ < b.v_;
+    return Float4(reinterpret_cast<Vector>(
+        (a_is_less & reinterpret_cast<IntVector>(a.v_)) |
+        (~a_is_less & reinterpret_cast<IntVector>(b.v_))));
+  }
+
+  // Converts 4 interleaved RGB pixels to one Float4 per channel.
+  friend void LoadRgb(const uint8* pixels, Float4* r, Float4* g, Float4* b) {
+    *r = FromInts(pixels[0], pixels[3], pixels[6], pixels[9]);
+    *g = FromInts(pixels[1], pixels[4], pixels[7], pixels[10]);
+    *b = FromInts(pixels[2], pixels[5], pixels[8], pixels[11]);
+  }
+
+  // Stores one Float4 per channel, rounded, as 4 interleaved RGB pixels.
+  friend void StoreRgb(Float4 r, Float4 g, Float4 b, uint8* pixels) {
+    r.StoreBytes(pixels, 3);
+    g.StoreBytes(pixels + 1, 3);
+    b.StoreBytes(pixels + 2, 3);
+  }
+
+ private:
+  typedef float Vector __attribute__((vector_size(16)));
+  typedef int32 IntVector __attribute__((vector_size(16)));
+
+  explicit Float4(Vector v) : v_(v) {}
+
+  void StoreBytes(uint8* bytes, int step) const {
+    const IntVector is_negative = v_ < Vector{};
+    const Float4 non_negative(reinterpret_cast<Vector>(
+        ~is_negative & reinterpret_cast<IntVector>(v_)));
+    const Float4 clamped = Min(non_negative, 255.0f);
+    const IntVector rounded =
+        __builtin_convertvector((clamped + 0.5f).v_, IntVector);
+    for (int i = 0; i < 4; ++i) bytes[i * step] = rounded[i];
+  }
+
+  Vector v_;
+};
+#else
+class Float4 {
+ public:
+  Float4() = default;
+  // Broadcasts value, so that scalar constants mix with lanes.
+  Float4(float value) : v_{value, value, value, value} {}  // NOLINT
+
+  static Float4 Load(const float* values) {
+    return Float4(values[0], values[1], values[2], values[3]);
+  }
+  static Float4 FromInts(int a, int b, int c, int d) {
+    return Float4(a, b, c, d);
+  }
+  // Converts 4 consecutive bytes.
+  static Float4 LoadBytes(const uint8* bytes) {
+    return Float4(bytes[0], bytes[1], bytes[2], bytes[3]);
+  }
+
+  void Store(float* values) const {
+    for (int i = 0; i < 4; ++i) values[i] = v_[i];
+  }
+  // Stores the lanes rounded to uint8 as by ToUint8() to 4 consecutive bytes.
+  void StoreBytes(uint8* bytes) const {
+    for (int i = 0; i < 4; ++i) bytes[i] = ToUint8(v_[i]);
+  }
+
+  friend Float4 operator+(Float4 a, Float4 b) {
+    return Float4(a.v_[0] + b.v_[0], a.v_[1] + b.v_[1], a.v_[2] + b.v_[2],
+                  a.v_[3] + b.v_[3]);
+  }
+  friend Float4 operator-(Float4 a, Float4 b) {
+    return Float4(a.v_[0] - b.v_[0], a.v_[1] - b.v_[1], a.v_[2] - b.v_[2],
+                  a.v_[3] - b.v_[3]);
+  }
+  friend Float4 operator*(Float4 a, Float4 b) {
+    return Float4(a.v_[0] * b.v_[0], a.v_[1] * b.v_[1], a.v_[2] * b.v_[2],
+                  a.v_[3] * b.v_[3]);
+  }
+  friend Float4 Min(Float4 a, Float4 b) {
+    return Float4(std::min(a.v_[0], b.v_[0]), std::min(a.v_[1], b.v_[1]),
+                  std::min(a.v_[2], b.v_[2]), std::min(a.v_[3], b.v_[3]));
+  }
+
+  // Converts 4 interleaved RGB pixels to one Float4 per channel.
+  friend void LoadRgb(const uint8* pixels, Float4* r, Float4* g, Float4* b) {
+    *r = Float4(pixels[0], pixels[3], pixels[6], pixels[9]);
+    *g = Float4(pixels[1], pixels[4], pixels[7], pixels[10]);
+    *b = Float4(pixels[2], pixels[5], pixels[8], pixels[11]);
+  }
+
+  // Stores one Float4 per channel, rounded, as 4 interleaved RGB pixels.
+  friend void StoreRgb(Float4 r, Float4 g, Float4 b, uint8* pixels) {
+    for (int i = 0; i < 4; ++i) {
+      pixels[i * 3 + 0] = ToUint8(r.v_[i]);
+      pixels[i * 3 + 1] = ToUint8(g.v_[i]);
+      pixels[i * 3 + 2] = ToUint8(b.v_[i]);
+    }
+  }
+
+ private:
+  Float4(float a, float b, float c, float d) : v_{a, b, c, d} {}
+
+  float v_[4];
+};
+#endif  // MASK_UTILS_USE_SSE2
+
+// Mask values as floats in [0, 1].
+template <typename T>
+struct MaskTraits;
+
+template <>
+struct MaskTraits<float> {
+  static constexpr float kScale = 1.0f;
+  template <int kStep>
+  static Float4 Load4(const float* values) {
+    static_assert(kStep == 1, "Float masks have a single channel.");
+    return Float4::Load(values);
+  }
+  static void Store(float value, float* values) { values[0] = value; }
+  static void Store4(Float4 value, float* values) { value.Store(values); }
+};
+
+template <>
+struct MaskTraits<uint8> {
+  static constexpr float kScale = 1.0f / 255.0f;
+  template <int kStep>
+  static Float4 Load4(const uint8* values) {
+    return kStep == 1 ? Float4::LoadBytes(values)
+                      : Float4::FromInts(values[0], values[kStep],
+                                         values[2 * kStep], values[3 * kStep]);
+  }
+  static void Store(float value, uint8* values) {
+    values[0] = ToUint8(value * 255.0f);
+  }
+  static void Store4(Float4 value, uint8* values) {
+    (value * 255.0f).StoreBytes(values);
+  }
+};
+
+// Blends previous into current by the uncertainty of current, for 4 pixels
+// as Float4 or for one as float.
+template <typename V>
+V SmoothMask(V new_mask_value, V prev_mask_value,
+             float combine_with_previous_ratio) {
+  // Assume p := new_mask_value
+  // H(p) := 1 + (p * log(p) + (1-p) * log(1-p)) / log(2)
+  // uncertainty alpha(p) =
+  //   Clamp(1 - (1 - H(p)) * (1 - H(p)), 0, 1) [squaring the uncertainty]
+  //
+  // The following polynomial approximates uncertainty alpha as a function
+  // of (p + 0.5):
+  constexpr float c1 = 5.68842f;
+  constexpr float c2 = -0.748699f;
+  constexpr float c3 = -57.8051f;
+  constexpr float c4 = 291.309f;
+  constexpr float c5 = -624.717f;
+  const V t = new_mask_value - 0.5f;
+  const V x = t * t;
+  const V uncertainty =
+      1.0f - Min(1.0f, x * (c1 + x * (c2 + x * (c3 + x * (c4 + x * c5)))));
+  return new_mask_value + (prev_mask_value - new_mask_value) *
+                              (uncertainty * combine_with_previous_ratio);
+}
+
+template <typename T>
+void SmoothRows(const ImageFrame& current, const ImageFrame& previous,
+                float combine_with_previous_ratio, ImageFrame* output,
+                int row_begin, int row_end) {
+  using Traits = MaskTraits<T>;
+  constexpr float kScale = Traits::kScale;
+  const int width = output->Width();
+  for (int row = row_begin; row < row_end; ++row) {
+    const T* curr_ptr = Row<T>(current, row);
+    const T* prev_ptr = Row<T>(previous, row);
+    T* out_ptr = MutableRow<T>(output, row);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+      Traits::Store4(
+          SmoothMask(Traits::template Load4<1>(curr_ptr + i) * kScale,
+                     Traits::template Load4<1>(prev_ptr + i) * kScale,
+                     combine_with_previous_ratio),
+          out_ptr + i);
+    }
+    for (; i < width; ++i) {
+      Traits::Store(SmoothMask(curr_ptr[i] * kScale, prev_ptr[i] * kScale,
+                               combine_with_previous_ratio),
+                    out_ptr + i);
+    }
+  }
+}
+
+// kAlphaStep is the number of channels of the alpha mask, or 0 to use
+// alpha_value.
+template <int kInChannels, int kAlphaStep>
+void SetAlphaRows(const ImageFrame& input, const ImageFrame* alpha_mask,
+                  uint8 alpha_value, ImageFrame* output, int row_begin,
+                  int row_end) {
+  constexpr int kOutChannels = 4;
+  const int width = output->Width();
+  for (int row = row_begin; row < row_end; ++row) {
+    const uint8* in_ptr = Row<uint8>(input, row);
+    const uint8* alpha_ptr =
+        kAlphaStep > 0 ? Row<uint8>(*alpha_mask, row) : nullptr;
+    uint8* out_ptr = MutableRow<uint8>(output, row);
+    // Copies whole pixels as words and then overwrites alpha. A word of RGB
+    // input reaches into the next pixel, so the last one is copied bytewise.
+    const int word_width = kInChannels == 4 ? width : width - 1;
+    int i = 0;
+    for (; i < word_width; ++i) {
+      std::memcpy(out_ptr + i * kOutChannels, in_ptr + i * kInChannels, 4);
+      out_ptr[i * kOutChannels + 3] =
+          kAlphaStep > 0 ? alpha_ptr[i * kAlphaStep] : alpha_value;
+    }
+    for (; i < width; ++i) {
+      out_ptr[i * kOutChannels + 0] = in_ptr[i * kInChannels + 0];
+      out_ptr[i * kOutChannels + 1] = in_ptr[i * kInChannels + 1];
+      out_ptr[i * kOutChannels + 2] = in_ptr[i * kInChannels + 2];
+      out_ptr[i * kOutChannels + 3] =
+          kAlphaStep > 0 ? alpha_ptr[i * kAlphaStep] : alpha_value;
+    }
+  }
+}
+
+template <int kInChannels>
+absl::Status SetAlphaWithInput(const ImageFrame& input,
+                               const ImageFrame* alpha_mask, uint8 alpha_value,
+                               ImageFrame* output) {
+  using RowsFn = void (*)(const ImageFrame&, const ImageFrame*, uint8,
+                          ImageFrame*, int, int);
+  RowsFn rows_fn;
+  switch (alpha_mask ? alpha_mask->NumberOfChannels() : 0) {
+    case 0:
+      rows_fn = SetAlphaRows<kInChannels, 0>;
+      break;
+    case 1:
+      rows_fn = SetAlphaRows<kInChannels, 1>;
+      break;
+    case 2:
+      rows_fn = SetAlphaRows<kInChannels, 2>;
+      break;
+    case 3:
+      rows_fn = SetAlphaRows<kInChannels, 3>;
+      break;
+    case 4:
+      rows_fn = SetAlphaRows<kInChannels, 4>;
+      break;
+    default:
+      RET_CHECK_FAIL() << "Unsupported alpha mask format "
+                       << alpha_mask->Format();
+  }
+  ParallelForRows(output->Height(), output->Width(), [&](int begin, int end) {
+    rows_fn(input, alpha_mask, alpha_value, output, begin, end);
+  });
+  return absl::OkStatus();
+}
+
+// Mixes color into the input channels by weight, for 4 pixels as Float4 or
+// for one as float. Branch-free forms of the options, as in the GPU shader.
+template <typename V>
+void Recolor(V weight, float invert, float adjust, const float color[3],
+             V* r, V* g, V* b) {
+  weight = (1.0f - invert) * weight + invert * (1.0f - weight);
+  const V luminance =
+      (1.0f - adjust) +
+      adjust * (*r * 0.299f + *g * 0.587f + *b * 0.114f) * (1.0f / 255.0f);
+  const V mix_value = weight * luminance;
+  *r = *r + (color[0] - *r) * mix_value;
+  *g = *g + (color[1] - *g) * mix_value;
+  *b = *b + (color[2] - *b) * mix_value;
+}
+
+template <typename MaskT, int kMaskStep>
+void RecolorRows(const ImageFrame& input, const ImageFrame& mask,
+                 int mask_channel, const uint8 color[3], bool invert_mask,
+                 bool adjust_with_luminance, ImageFrame* output, int row_begin,
+                 int row_end) {
+  using Traits = MaskTraits<MaskT>;
+  constexpr int kChannels = 3;
+  constexpr float kMaskScale = Traits::kScale;
+  const float invert = invert_mask ? 1.0f : 0.0f;
+  const float adjust = adjust_with_luminance ? 1.0f : 0.0f;
+  const float rgb[3] = {static_cast<float>(color[0]),
+                        static_cast<float>(color[1]),
+                        static_cast<float>(color[2])};
+  const int width = output->Width();
+  for (int row = row_begin; row < row_end; ++row) {
+    const uint8* in_ptr = Row<uint8>(input, row);
+    const MaskT* mask_ptr = Row<MaskT>(mask, row) + mask_channel;
+    uint8* out_ptr = MutableRow<uint8>(output, row);
+    int i = 0;
+    for (; i + 4 <= width; i += 4) {
+      Float4 r, g, b;
+      LoadRgb(in_ptr + i * kChannels, &r, &g, &b);
+      Recolor(Traits::template Load4<kMaskStep>(mask_ptr + i * kMaskStep) *
+                  kMaskScale,
+              invert, adjust, rgb, &r, &g, &b);
+      StoreRgb(r, g, b, out_ptr + i * kChannels);
+    }
+    for (; i < width; ++i) {
+      float r = in_ptr[i * kChannels + 0];
+      float g = in_ptr[i * kChannels + 1];
+      float b = in_ptr[i * kChannels + 2];
+      Recolor(mask_ptr[i * kMaskStep] * kMaskScale, invert, adjust, rgb, &r,
+              &g, &b);
+      out_ptr[i * kChannels + 0] = ToUint8(r);
+      out_ptr[i * kChannels + 1] = ToUint8(g);
+      out_ptr[i * kChannels + 2] = ToUint8(b);
+    }
+  }
+}
+
+}  // namespace
+
+absl::Status SmoothSegmentationMask(const ImageFrame& current,
+                                    const ImageFrame& previous,
+                                    float combine_with_previous_ratio,
+                                    ImageFrame* output) {
+  RET_CHECK(output);
+  RET_CHECK(current.Format() == ImageFormat::VEC32F1 ||
+            current.Format() == ImageFormat::GRAY8)
+      << "Only 1-channel float or 8-bit masks are supported.";
+  RET_CHECK_EQ(previous.Format(), current.Format())
+      << "Mixing mask formats is not supported.";
+  RET_CHECK_EQ(output->Format(), current.Format());
+  MP_RETURN_IF_ERROR(CheckSameSize(current, previous));
+  MP_RETURN_IF_ERROR(CheckSameSize(current, *output));
+  const bool is_float = current.Format() == ImageFormat::VEC32F1;
+  ParallelForRows(output->Height(), output->Width(), [&](int begin, int end) {
+    if (is_float) {
+      SmoothRows<float>(current, previous, combine_with_previous_ratio, output,
+                        begin, end);
+    } else {
+      SmoothRows<uint8>(current, previous, combine_with_previous_ratio, output,
+                        begin, end);
+    }
+  });
+  return absl::OkStatus();
+}
+
+absl::Status SetAlpha(const ImageFrame& input, const ImageFrame* alpha_mask,
+                      uint8 alpha_value, ImageFrame* output) {
+  RET_CHECK(output);
+  RET_CHECK_EQ(output->Format(), ImageFormat::SRGBA);
+  MP_RETURN_IF_ERROR(CheckSameSize(input, *output));
+  if (alpha_mask) {
+    RET_CHECK_EQ(alpha_mask->ByteDepth(), 1)
+        << "Only 8-bit alpha masks are supported.";
+    MP_RETURN_IF_ERROR(CheckSameSize(input, *alpha_mask));
+  }
+  switch (input.Format()) {
+    case ImageFormat::SRGB:
+      return SetAlphaWithInput<3>(input, alpha_mask, alpha_value, output);
+    case ImageFormat::SRGBA:
+      return SetAlphaWithInput<4>(input, alpha_mask, alpha_value, output);
+    default:
+      RET_CHECK_FAIL() << "Only 3 or 4 channel 8-bit input image supported";
+  }
+}
+
+absl::Status RecolorWithMask(const ImageFrame& input, const ImageFrame& mask,
+                             int mask_channel, const uint8 color[3],
+                             bool invert_mask, bool adjust_with_luminance,
+                             ImageFrame* output) {
+  RET_CHECK(output);
+  RET_CHECK_EQ(input.Format(), ImageFormat::SRGB) << "RGB only.";
+  RET_CHECK_EQ(output->Format(), ImageFormat::SRGB);
+  MP_RETURN_IF_ERROR(CheckSameSize(input, mask));
+  MP_RETURN_IF_ERROR(CheckSameSize(input, *output));
+  RET_CHECK(mask.Format() == ImageFormat::VEC32F1 || mask.ByteDepth() == 1)
+      << "Unsupported mask format " << mask.Format();
+  RET_CHECK(mask_channel >= 0 && mask_channel < mask.NumberOfChannels())
+      << "Mask has no channel " << mask_channel;
+  using RowsFn = void (*)(const ImageFrame&, const ImageFrame&, int,
+                          const uint8[3], bool, bool, ImageFrame*, int, int);
+  RowsFn rows_fn;
+  if (mask.Format() == ImageFormat::VEC32F1) {
+    rows_fn = RecolorRows<float, 1>;
+  } else {
+    switch (mask.NumberOfChannels()) {
+      case 1:
+        rows_fn = RecolorRows<uint8, 1>;
+        break;
+      case 3:
+        rows_fn = RecolorRows<uint8, 3>;
+        break;
+      case 4:
+        rows_fn = RecolorRows<uint8, 4>;
+        break;
+      default:
+        RET_CHECK_FAIL() << "Unsupported mask format " << mask.Format();
+    }
+  }
+  ParallelForRows(output->Height(), output->Width(), [&](int begin, int end) {
+    rows_fn(input, mask, mask_channel, color, invert_mask,
+            adjust_with_luminance, output, begin, end);
+  });
+  return absl::OkStatus();
+}
+
+}  // namespace mask_utils
+}  // namespace mediapipe
@@ -0,0 +1,58 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// CPU kernels for mask operations shared by SegmentationSmoothingCalculator,
+// SetAlphaCalculator and RecolorCalculator.
+//
+// Each kernel processes rows in tiles, which run in parallel via
+// ParallelForRows once frames are large enough to amortize the scheduling.
+// Within a row, the floating point kernels process four pixels at a time in
+// SSE2 or NEON registers, and SetAlpha copies whole pixels as words.
+#ifndef MEDIAPIPE_CALCULATORS_IMAGE_MASK_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_IMAGE_MASK_UTILS_H_
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace mask_utils {
+
+// Mixes the current segmentation mask with the previous one where the current
+// mask is uncertain, i.e. close to 0.5. Both masks and output must have the
+// same size and format, VEC32F1 or GRAY8.
+absl::Status SmoothSegmentationMask(const ImageFrame& current,
+                                    const ImageFrame& previous,
+                                    float combine_with_previous_ratio,
+                                    ImageFrame* output);
+
+// Copies the RGB channels of input (SRGB or SRGBA) into output (SRGBA) and
+// sets its alpha channel to the first channel of alpha_mask (any 8-bit
+// format of the same size), or to alpha_value if alpha_mask is null.
+absl::Status SetAlpha(const ImageFrame& input, const ImageFrame* alpha_mask,
+                      uint8 alpha_value, ImageFrame* output);
+
+// Blends color into input (SRGB) where mask (GRAY8, SRGB, SRGBA or VEC32F1,
+// same size as input) is set, reading the mask from mask_channel. With
+// invert_mask, the mask weight w is replaced by 1 - w; with
+// adjust_with_luminance, it is scaled by the luminance of the input pixel.
+absl::Status RecolorWithMask(const ImageFrame& input, const ImageFrame& mask,
+                             int mask_channel, const uint8 color[3],
+                             bool invert_mask, bool adjust_with_luminance,
+                             ImageFrame* output);
+
+}  // namespace mask_utils
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_IMAGE_MASK_UTILS_H_
@@ -0,0 +1,245 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/mask_utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace mask_utils {
+namespace {
+
+// Fills frame with a deterministic pattern covering the whole value range.
+void FillFrame(ImageFrame* frame) {
+  const int num_values = frame->Width() * frame->NumberOfChannels();
+  for (int row = 0; row < frame->Height(); ++row) {
+    uint8* data = frame->MutablePixelData() + row * frame->WidthStep();
+    if (frame->Format() == ImageFormat::VEC32F1) {
+      float* values = reinterpret_cast<float*>(data);
+      for (int i = 0; i < num_values; ++i) {
+        values[i] = 0.5f + 0.5f * std::sin(0.13f * i + 0.71f * row);
+      }
+    } else {
+      for (int i = 0; i < num_values; ++i) {
+        data[i] = (i * 37 + row * 11) % 256;
+      }
+    }
+  }
+}
+
+float FloatAt(const ImageFrame& frame, int x, int y) {
+  return reinterpret_cast<const float*>(frame.PixelData() +
+                                        y * frame.WidthStep())[x];
+}
+
+const uint8* PixelAt(const ImageFrame& frame, int x, int y) {
+  return frame.PixelData() + y * frame.WidthStep() +
+         x * frame.NumberOfChannels();
+}
+
+float Smooth(float current, float previous, float ratio) {
+  const float t = current - 0.5f;
+  const float x = t * t;
+  const float uncertainty =
+      1.0f - std::min(1.0f, x * (5.68842f +
+                                 x * (-0.748699f +
+                                      x * (-57.8051f +
+                                           x * (291.309f + x * -624.717f)))));
+  return current + (previous - current) * (uncertainty * ratio);
+}
+
+TEST(MaskUtilsTest, SmoothsFloatMasks) {
+  ImageFrame current(ImageFormat::VEC32F1, 37, 19);
+  ImageFrame previous(ImageFormat::VEC32F1, 37, 19);
+  FillFrame(&current);
+  FillFrame(&previous);
+  // Shift previous so that it differs from current.
+  std::reverse(reinterpret_cast<float*>(previous.MutablePixelData()),
+               reinterpret_cast<float*>(previous.MutablePixelData()) + 37);
+  ImageFrame output(ImageFormat::VEC32F1, 37, 19);
+  MP_ASSERT_OK(SmoothSegmentationMask(current, previous, 0.7f, &output));
+  for (int y = 0; y < 19; ++y) {
+    for (int x = 0; x < 37; ++x) {
+      EXPECT_NEAR(FloatAt(output, x, y),
+                  Smooth(FloatAt(current, x, y), FloatAt(previous, x, y), 0.7f),
+                  1e-6f);
+    }
+  }
+}
+
+TEST(MaskUtilsTest, SmoothsGray8Masks) {
+  ImageFrame current(ImageFormat::GRAY8, 40, 8);
+  ImageFrame previous(ImageFormat::GRAY8, 40, 8);
+  FillFrame(&current);
+  previous.SetToZero();
+  ImageFrame output(ImageFormat::GRAY8, 40, 8);
+  MP_ASSERT_OK(SmoothSegmentationMask(current, previous, 1.0f, &output));
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 40; ++x) {
+      const float expected =
+          Smooth(PixelAt(current, x, y)[0] / 255.0f, 0.0f, 1.0f) * 255.0f;
+      EXPECT_NEAR(PixelAt(output, x, y)[0], expected, 0.5f);
+    }
+  }
+}
+
+TEST(MaskUtilsTest, SmoothRejectsMismatchedMasks) {
+  ImageFrame current(ImageFormat::VEC32F1, 8, 8);
+  ImageFrame previous(ImageFormat::GRAY8, 8, 8);
+  ImageFrame output(ImageFormat::VEC32F1, 8, 8);
+  EXPECT_FALSE(SmoothSegmentationMask(current, previous, 0.5f, &output).ok());
+  ImageFrame small(ImageFormat::VEC32F1, 4, 8);
+  EXPECT_FALSE(SmoothSegmentationMask(current, small, 0.5f, &output).ok());
+}
+
+TEST(MaskUtilsTest, SetsAlphaFromMaskChannel) {
+  ImageFrame input(ImageFormat::SRGB, 13, 5);
+  ImageFrame mask(ImageFormat::SRGBA, 13, 5);
+  FillFrame(&input);
+  FillFrame(&mask);
+  ImageFrame output(ImageFormat::SRGBA, 13, 5);
+  MP_ASSERT_OK(SetAlpha(input, &mask, 0, &output));
+  for (int y = 0; y < 5; ++y) {
+    for (int x = 0; x < 13; ++x) {
+      const uint8* out = PixelAt(output, x, y);
+      const uint8* in = PixelAt(input, x, y);
+      EXPECT_EQ(out[0], in[0]);
+      EXPECT_EQ(out[1], in[1]);
+      EXPECT_EQ(out[2], in[2]);
+      EXPECT_EQ(out[3], PixelAt(mask, x, y)[0]);
+    }
+  }
+}
+
+TEST(MaskUtilsTest, SetsConstantAlpha) {
+  ImageFrame input(ImageFormat::SRGBA, 9, 3);
+  FillFrame(&input);
+  ImageFrame output(ImageFormat::SRGBA, 9, 3);
+  MP_ASSERT_OK(SetAlpha(input, nullptr, 77, &output));
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 9; ++x) {
+      EXPECT_EQ(PixelAt(output, x, y)[2], PixelAt(input, x, y)[2]);
+      EXPECT_EQ(PixelAt(output, x, y)[3], 77);
+    }
+  }
+  ImageFrame gray(ImageFormat::GRAY8, 9, 3);
+  EXPECT_FALSE(SetAlpha(gray, nullptr, 77, &output).ok());
+}
+
+TEST(MaskUtilsTest, RecolorsWithMask) {
+  ImageFrame input(ImageFormat::SRGB, 11, 7);
+  ImageFrame mask(ImageFormat::VEC32F1, 11, 7);
+  FillFrame(&input);
+  FillFrame(&mask);
+  const uint8 color[3] = {255, 0, 128};
+  ImageFrame output(ImageFormat::SRGB, 11, 7);
+  MP_ASSERT_OK(RecolorWithMask(input, mask, 0, color, /*invert_mask=*/true,
+                               /*adjust_with_luminance=*/true, &output));
+  for (int y = 0; y < 7; ++y) {
+    for (int x = 0; x < 11; ++x) {
+      const uint8* in = PixelAt(input, x, y);
+      const float weight = 1.0f - FloatAt(mask, x, y);
+      const float luminance =
+          (in[0] * 0.299f + in[1] * 0.587f + in[2] * 0.114f) / 255.0f;
+      const float mix = weight * luminance;
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_NEAR(PixelAt(output, x, y)[c],
+                    in[c] * (1.0f - mix) + color[c] * mix, 0.5f + 1e-3f);
+      }
+    }
+  }
+}
+
+TEST(MaskUtilsTest, RecolorsWithAlphaChannelOfMask) {
+  ImageFrame input(ImageFormat::SRGB, 4, 4);
+  input.SetToZero();
+  ImageFrame mask(ImageFormat::SRGBA, 4, 4);
+  mask.SetToZero();
+  // Only the alpha channel of pixel (1, 2) is set.
+  mask.MutablePixelData()[2 * mask.WidthStep() + 4 + 3] = 255;
+  const uint8 color[3] = {10, 20, 30};
+  ImageFrame output(ImageFormat::SRGB, 4, 4);
+  MP_ASSERT_OK(RecolorWithMask(input, mask, 3, color, false, false, &output));
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      const bool set = x == 1 && y == 2;
+      EXPECT_EQ(PixelAt(output, x, y)[2], set ? 30 : 0) << x << "," << y;
+    }
+  }
+}
+
+// Args: width, height.
+void BM_SmoothSegmentationMask(benchmark::State& state) {
+  ImageFrame current(ImageFormat::VEC32F1, state.range(0), state.range(1));
+  ImageFrame previous(ImageFormat::VEC32F1, state.range(0), state.range(1));
+  ImageFrame output(ImageFormat::VEC32F1, state.range(0), state.range(1));
+  FillFrame(&current);
+  FillFrame(&previous);
+  for (auto _ : state) {
+    SmoothSegmentationMask(current, previous, 0.9f, &output).IgnoreError();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(BM_SmoothSegmentationMask)
+    ->Args({1280, 720})
+    ->Args({1920, 1080})
+    ->Args({3840, 2160});
+
+// Args: width, height.
+void BM_SetAlpha(benchmark::State& state) {
+  ImageFrame input(ImageFormat::SRGB, state.range(0), state.range(1));
+  ImageFrame mask(ImageFormat::GRAY8, state.range(0), state.range(1));
+  ImageFrame output(ImageFormat::SRGBA, state.range(0), state.range(1));
+  FillFrame(&input);
+  FillFrame(&mask);
+  for (auto _ : state) {
+    SetAlpha(input, &mask, 0, &output).IgnoreError();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(BM_SetAlpha)
+    ->Args({1280, 720})
+    ->Args({1920, 1080})
+    ->Args({3840, 2160});
+
+// Args: width, height.
+void BM_RecolorWithMask(benchmark::State& state) {
+  ImageFrame input(ImageFormat::SRGB, state.range(0), state.range(1));
+  ImageFrame mask(ImageFormat::VEC32F1, state.range(0), state.range(1));
+  ImageFrame output(ImageFormat::SRGB, state.range(0), state.range(1));
+  FillFrame(&input);
+  FillFrame(&mask);
+  const uint8 color[3] = {255, 0, 0};
+  for (auto _ : state) {
+    RecolorWithMask(input, mask, 0, color, false, true, &output).IgnoreError();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(1));
+}
+BENCHMARK(BM_RecolorWithMask)
+    ->Args({1280, 720})
+    ->Args({1920, 1080})
+    ->Args({3840, 2160});
+
+}  // namespace
+}  // namespace mask_utils
+}  // namespace mediapipe
@@ -12,6 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+#include <vector>
+
+#include "mediapipe/calculators/image/opencv_encoded_image_to_image_frame_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/deps/file_path.h"
@@ -102,5 +106,135 @@ TEST(OpenCvEncodedImageToImageFrameCalculatorTest, TestGrayscaleJpeg) {
   EXPECT_LE(max_val, 10);
 }
 
+TEST(OpenCvEncodedImageToImageFrameCalculatorTest, TestDownscaledJpeg) {
+  const std::string path =
+      file::JoinPath("./", "/mediapipe/calculators/image/testdata/dino.jpg");
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(path, &contents));
+
+  CalculatorGraphConfig::Node node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"pb(
+        calculator: "OpenCvEncodedImageToImageFrameCalculator"
+        input_stream: "encoded_image"
+        output_stream: "image_frame"
+        options {
+          [mediapipe.OpenCvEncodedImageToImageFrameCalculatorOptions.ext] {
+            downscale_factor: 4
+          }
+        }
+      )pb");
+  CalculatorRunner runner(node_config);
+  runner.MutableInputs()->Index(0).packets.push_back(
+      MakePacket<std::string>(contents).At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+  const std::vector<Packet>& packets = runner.Outputs().Index(0).packets;
+  ASSERT_EQ(1, packets.size());
+  const ImageFrame& output_frame = packets[0].Get<ImageFrame>();
+
+  cv::Mat input_mat = cv::imread(
+      path, cv::IMREAD_REDUCED_COLOR_4 | cv::IMREAD_IGNORE_ORIENTATION);
+  ASSERT_EQ(input_mat.cols, output_frame.Width());
+  ASSERT_EQ(input_mat.rows, output_frame.Height());
+  EXPECT_EQ(ImageFormat::SRGB, output_frame.Format());
+  cv::Mat output_mat;
+  cv::cvtColor(formats::MatView(&output_frame), output_mat, cv::COLOR_RGB2BGR);
+  cv::Mat diff;
+  cv::absdiff(input_mat, output_mat, diff);
+  double max_val;
+  cv::minMaxLoc(diff, nullptr, &max_val);
+  EXPECT_EQ(max_val, 0);
+}
+
+TEST(OpenCvEncodedImageToImageFrameCalculatorTest,
+     TestWorkerThreadsOutputInOrder) {
+  cv::Mat input_mat = cv::imread(
+      file::JoinPath("./", "/mediapipe/calculators/image/testdata/dino.jpg"));
+  CalculatorGraphConfig::Node node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"pb(
+        calculator: "OpenCvEncodedImageToImageFrameCalculator"
+        input_stream: "encoded_image"
+        output_stream: "image_frame"
+        options {
+          [mediapipe.OpenCvEncodedImageToImageFrameCalculatorOptions.ext] {
+            num_worker_threads: 3
+          }
+        }
+      )pb");
+  CalculatorRunner runner(node_config);
+  // Images of different sizes, which take different times to decode.
+  constexpr int kNumImages = 8;
+  for (int i = 0; i < kNumImages; ++i) {
+    cv::Mat resized_mat;
+    cv::resize(input_mat, resized_mat,
+               cv::Size(input_mat.cols / (i % 3 + 1),
+                        input_mat.rows / (i % 3 + 1)));
+    std::vector<uchar> encode_buffer;
+    cv::imencode(".png", resized_mat, encode_buffer);
+    runner.MutableInputs()->Index(0).packets.push_back(
+        MakePacket<std::string>(
+            std::string(encode_buffer.begin(), encode_buffer.end()))
+            .At(Timestamp(i)));
+  }
+  MP_ASSERT_OK(runner.Run());
+  const std::vector<Packet>& packets = runner.Outputs().Index(0).packets;
+  ASSERT_EQ(kNumImages, packets.size());
+  for (int i = 0; i < kNumImages; ++i) {
+    EXPECT_EQ(Timestamp(i), packets[i].Timestamp());
+    EXPECT_EQ(input_mat.cols / (i % 3 + 1),
+              packets[i].Get<ImageFrame>().Width());
+  }
+}
+
+TEST(OpenCvEncodedImageToImageFrameCalculatorTest, TestInvalidImageFails) {
+  CalculatorGraphConfig::Node node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"pb(
+        calculator: "OpenCvEncodedImageToImageFrameCalculator"
+        input_stream: "encoded_image"
+        output_stream: "image_frame"
+        options {
+          [mediapipe.OpenCvEncodedImageToImageFrameCalculatorOptions.ext] {
+            fail_on_decoding_error: true
+          }
+        }
+      )pb");
+  CalculatorRunner runner(node_config);
+  runner.MutableInputs()->Index(0).packets.push_back(
+      MakePacket<std::string>("not an image").At(Timestamp(0)));
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+TEST(OpenCvEncodedImageToImageFrameCalculatorTest,
+     TestInvalidImagesAreSkipped) {
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(
+      file::JoinPath("./", "/mediapipe/calculators/image/testdata/dino.jpg"),
+      &contents));
+  for (int num_worker_threads : {0, 2}) {
+    CalculatorGraphConfig::Node node_config =
+        ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"pb(
+          calculator: "OpenCvEncodedImageToImageFrameCalculator"
+          input_stream: "encoded_image"
+          output_stream: "image_frame"
+        )pb");
+    node_config.mutable_options()
+        ->MutableExtension(OpenCvEncodedImageToImageFrameCalculatorOptions::ext)
+        ->set_num_worker_threads(num_worker_threads);
+    CalculatorRunner runner(node_config);
+    // Valid images at even timestamps, empty and corrupt ones in between.
+    const std::vector<std::string> inputs = {contents, "", contents,
+                                             "not an image", contents};
+    for (int i = 0; i < static_cast<int>(inputs.size()); ++i) {
+      runner.MutableInputs()->Index(0).packets.push_back(
+          MakePacket<std::string>(inputs[i]).At(Timestamp(i)));
+    }
+    MP_ASSERT_OK(runner.Run());
+    const std::vector<Packet>& packets = runner.Outputs().Index(0).packets;
+    ASSERT_EQ(3, packets.size()) << num_worker_threads << " worker threads";
+    for (int i = 0; i < static_cast<int>(packets.size()); ++i) {
+      EXPECT_EQ(Timestamp(2 * i), packets[i].Timestamp());
+    }
+  }
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -12,56 +12,53 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
 #include "mediapipe/calculators/image/opencv_image_encoder_calculator.pb.h"
+#include "mediapipe/calculators/image/ordered_task_queue.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/port/statusor.h"
 
 namespace mediapipe {
 
-// Calculator to encode raw image frames. This will result in considerable space
-// savings if the frames need to be stored on disk.
-//
-// Example config:
-// node {
-//   calculator: "OpenCvImageEncoderCalculator"
-//   input_stream: "image"
-//   output_stream: "encoded_image"
-//   node_options {
-//     [type.googleapis.com/mediapipe.OpenCvImageEncoderCalculatorOptions]: {
-//       quality: 80
-//     }
-//   }
-// }
-class OpenCvImageEncoderCalculator : public CalculatorBase {
- public:
-  static absl::Status GetContract(CalculatorContract* cc);
-  absl::Status Open(CalculatorContext* cc) override;
-  absl::Status Process(CalculatorContext* cc) override;
-  absl::Status Close(CalculatorContext* cc) override;
-
- private:
-  int encoding_quality_;
-};
-
-absl::Status OpenCvImageEncoderCalculator::GetContract(CalculatorContract* cc) {
-  cc->Inputs().Index(0).Set<ImageFrame>();
-  cc->Outputs().Index(0).Set<OpenCvImageEncoderCalculatorResults>();
-  return absl::OkStatus();
-}
+namespace {
 
-absl::Status OpenCvImageEncoderCalculator::Open(CalculatorContext* cc) {
-  auto options = cc->Options<OpenCvImageEncoderCalculatorOptions>();
-  encoding_quality_ = options.quality();
-  return absl::OkStatus();
+// Returns the cv::imencode() parameters for options.
+std::vector<int> GetEncodeParameters(
+    const OpenCvImageEncoderCalculatorOptions& options) {
+  int quality = options.quality();
+  bool optimize = false;
+  switch (options.preset()) {
+    case OpenCvImageEncoderCalculatorOptions::FAST:
+      quality = 75;
+      break;
+    case OpenCvImageEncoderCalculatorOptions::BALANCED:
+      quality = 85;
+      optimize = true;
+      break;
+    case OpenCvImageEncoderCalculatorOptions::HIGH_QUALITY:
+      quality = 95;
+      optimize = true;
+      break;
+    default:
+      break;
+  }
+  return {cv::IMWRITE_JPEG_QUALITY, quality, cv::IMWRITE_JPEG_OPTIMIZE,
+          optimize ? 1 : 0};
 }
 
-absl::Status OpenCvImageEncoderCalculator::Process(CalculatorContext* cc) {
-  const ImageFrame& image_frame = cc->Inputs().Index(0).Get<ImageFrame>();
-  CHECK_EQ(1, image_frame.ByteDepth());
+absl::StatusOr<std::unique_ptr<OpenCvImageEncoderCalculatorResults>>
+EncodeImage(const ImageFrame& image_frame,
+            const std::vector<int>& parameters) {
+  RET_CHECK_EQ(1, image_frame.ByteDepth());
 
   std::unique_ptr<OpenCvImageEncoderCalculatorResults> encoded_result =
       absl::make_unique<OpenCvImageEncoderCalculatorResults>();
@@ -90,10 +87,6 @@ absl::Status OpenCvImageEncoderCalculator::Process(CalculatorContext* cc) {
              << "Unsupported number of channels: " << original_mat.channels();
   }
 
-  std::vector<int> parameters;
-  parameters.push_back(cv::IMWRITE_JPEG_QUALITY);
-  parameters.push_back(encoding_quality_);
-
   std::vector<uchar> encode_buffer;
   // Note that imencode() will store the data in RGB order.
   // Check its JpegEncoder::write() in "imgcodecs/src/grfmt_jpeg.cpp" for more
@@ -104,13 +97,77 @@ absl::Status OpenCvImageEncoderCalculator::Process(CalculatorContext* cc) {
   }
 
   encoded_result->set_encoded_image(&encode_buffer[0], encode_buffer.size());
+  return encoded_result;
+}
+
+}  // namespace
+
+// Calculator to encode raw image frames. This will result in considerable space
+// savings if the frames need to be stored on disk.
+//
+// The encoding parameters are either set by `quality`, or by a `preset`. With
+// `num_worker_threads`, images of several timestamps are encoded concurrently
+// on background threads, and output in timestamp order.
+//
+// Example config:
+// node {
+//   calculator: "OpenCvImageEncoderCalculator"
+//   input_stream: "image"
+//   output_stream: "encoded_image"
+//   node_options {
+//     [type.googleapis.com/mediapipe.OpenCvImageEncoderCalculatorOptions]: {
+//       quality: 80
+//     }
+//   }
+// }
+class OpenCvImageEncoderCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc);
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+  absl::Status Close(CalculatorContext* cc) override;
+
+ private:
+  std::vector<int> encode_parameters_;
+  int num_worker_threads_ = 0;
+  std::unique_ptr<OrderedTaskQueue> encode_queue_;
+};
+
+absl::Status OpenCvImageEncoderCalculator::GetContract(CalculatorContract* cc) {
+  cc->Inputs().Index(0).Set<ImageFrame>();
+  cc->Outputs().Index(0).Set<OpenCvImageEncoderCalculatorResults>();
+  return absl::OkStatus();
+}
 
-  cc->Outputs().Index(0).Add(encoded_result.release(), cc->InputTimestamp());
+absl::Status OpenCvImageEncoderCalculator::Open(CalculatorContext* cc) {
+  auto options = cc->Options<OpenCvImageEncoderCalculatorOptions>();
+  RET_CHECK_GE(options.num_worker_threads(), 0);
+  encode_parameters_ = GetEncodeParameters(options);
+  num_worker_threads_ = options.num_worker_threads();
+  encode_queue_ = absl::make_unique<OrderedTaskQueue>("opencv_image_encoder",
+                                                      num_worker_threads_);
   return absl::OkStatus();
 }
 
+absl::Status OpenCvImageEncoderCalculator::Process(CalculatorContext* cc) {
+  const Packet input_packet = cc->Inputs().Index(0).Value();
+  encode_queue_->Schedule(
+      [input_packet,
+       parameters = encode_parameters_]() -> absl::StatusOr<Packet> {
+        ASSIGN_OR_RETURN(
+            std::unique_ptr<OpenCvImageEncoderCalculatorResults> encoded_result,
+            EncodeImage(input_packet.Get<ImageFrame>(), parameters));
+        return Adopt(encoded_result.release()).At(input_packet.Timestamp());
+      });
+  return encode_queue_->AddFinished(num_worker_threads_,
+                                    &cc->Outputs().Index(0));
+}
+
 absl::Status OpenCvImageEncoderCalculator::Close(CalculatorContext* cc) {
-  return absl::OkStatus();
+  absl::Status status =
+      encode_queue_->AddFinished(0, &cc->Outputs().Index(0));
+  encode_queue_.reset();
+  return status;
 }
 
 REGISTER_CALCULATOR(OpenCvImageEncoderCalculator);
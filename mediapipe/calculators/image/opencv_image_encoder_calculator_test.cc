@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+#include <vector>
+
 #include "mediapipe/calculators/image/opencv_image_encoder_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
@@ -83,5 +86,66 @@ TEST(OpenCvImageEncoderCalculatorTest, TestJpegWithQualities) {
   }
 }
 
+TEST(OpenCvImageEncoderCalculatorTest, TestPresetsWithWorkerThreads) {
+  cv::Mat input_mat;
+  cv::cvtColor(cv::imread(file::JoinPath("./",
+                                         "/mediapipe/calculators/"
+                                         "image/testdata/dino.jpg")),
+               input_mat, cv::COLOR_BGR2RGB);
+  Packet input_packet = MakePacket<ImageFrame>(
+      ImageFormat::SRGB, input_mat.size().width, input_mat.size().height);
+  input_mat.copyTo(formats::MatView(&(input_packet.Get<ImageFrame>())));
+
+  std::vector<size_t> sizes;
+  for (const std::string preset : {"FAST", "HIGH_QUALITY"}) {
+    CalculatorGraphConfig::Node node_config =
+        ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+            absl::Substitute(R"(
+        calculator: "OpenCvImageEncoderCalculator"
+        input_stream: "image_frames"
+        output_stream: "encoded_images"
+        node_options {
+          [type.googleapis.com/mediapipe.OpenCvImageEncoderCalculatorOptions]: {
+            preset: $0
+            num_worker_threads: 2
+          }
+        })",
+                             preset));
+    CalculatorRunner runner(node_config);
+    constexpr int kNumImages = 5;
+    for (int i = 0; i < kNumImages; ++i) {
+      runner.MutableInputs()->Index(0).packets.push_back(
+          input_packet.At(Timestamp(i)));
+    }
+    MP_ASSERT_OK(runner.Run());
+    const std::vector<Packet>& packets = runner.Outputs().Index(0).packets;
+    ASSERT_EQ(kNumImages, packets.size());
+    for (int i = 0; i < kNumImages; ++i) {
+      EXPECT_EQ(Timestamp(i), packets[i].Timestamp());
+      // Encoding is deterministic.
+      EXPECT_EQ(packets[0]
+                    .Get<OpenCvImageEncoderCalculatorResults>()
+                    .encoded_image(),
+                packets[i]
+                    .Get<OpenCvImageEncoderCalculatorResults>()
+                    .encoded_image());
+    }
+    const std::string& encoded_image =
+        packets[0].Get<OpenCvImageEncoderCalculatorResults>().encoded_image();
+    sizes.push_back(encoded_image.size());
+
+    const std::vector<char> contents_vector(encoded_image.begin(),
+                                            encoded_image.end());
+    cv::Mat decoded_output;
+    cv::cvtColor(cv::imdecode(contents_vector, cv::IMREAD_COLOR),
+                 decoded_output, cv::COLOR_BGR2RGB);
+    cv::Mat diff;
+    cv::absdiff(input_mat, decoded_output, diff);
+    // Expects that the mean absolute pixel-by-pixel difference is less than 8.
+    EXPECT_LE(cv::mean(diff)[0], 8);
+  }
+  EXPECT_LT(sizes[0], sizes[1]);
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,77 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/ordered_task_queue.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+
+namespace mediapipe {
+
+OrderedTaskQueue::OrderedTaskQueue(const std::string& name_prefix,
+                                   int num_threads) {
+  if (num_threads > 0) {
+    pool_ = absl::make_unique<ThreadPool>(name_prefix, num_threads);
+    pool_->StartWorkers();
+  }
+}
+
+OrderedTaskQueue::~OrderedTaskQueue() {
+  // Runs the remaining tasks and joins the workers.
+  pool_.reset();
+}
+
+void OrderedTaskQueue::Schedule(Task task) {
+  auto result = std::make_shared<Result>();
+  {
+    absl::MutexLock lock(&mutex_);
+    results_.push_back(result);
+  }
+  auto run = [this, result, task = std::move(task)]() {
+    absl::StatusOr<Packet> packet = task();
+    absl::MutexLock lock(&mutex_);
+    result->packet = std::move(packet);
+    result->done = true;
+  };
+  if (pool_) {
+    pool_->Schedule(std::move(run));
+  } else {
+    run();
+  }
+}
+
+absl::Status OrderedTaskQueue::AddFinished(int max_pending,
+                                           OutputStream* output) {
+  while (true) {
+    std::shared_ptr<Result> result;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (results_.empty()) break;
+      result = results_.front();
+      if (!result->done) {
+        if (results_.size() <= static_cast<size_t>(max_pending)) break;
+        mutex_.Await(absl::Condition(&result->done));
+      }
+      results_.pop_front();
+    }
+    MP_RETURN_IF_ERROR(result->packet.status());
+    if (!result->packet->IsEmpty()) {
+      output->AddPacket(std::move(result->packet).value());
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,83 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Lets a calculator work on several input timestamps at once, on its own
+// worker threads, while its outputs stay in timestamp order. Each Process call
+// schedules a task for its input packet and then outputs the packets of the
+// tasks that have finished, oldest first, so that outputs lag inputs by at
+// most the number of tasks allowed in flight. Close outputs the rest:
+//
+//   absl::Status Process(CalculatorContext* cc) override {
+//     Packet input = cc->Inputs().Index(0).Value();
+//     queue_->Schedule([input]() -> absl::StatusOr<Packet> {
+//       ...
+//       return Adopt(result.release()).At(input.Timestamp());
+//     });
+//     return queue_->AddFinished(num_threads_, &cc->Outputs().Index(0));
+//   }
+//
+//   absl::Status Close(CalculatorContext* cc) override {
+//     return queue_->AddFinished(0, &cc->Outputs().Index(0));
+//   }
+#ifndef MEDIAPIPE_CALCULATORS_IMAGE_ORDERED_TASK_QUEUE_H_
+#define MEDIAPIPE_CALCULATORS_IMAGE_ORDERED_TASK_QUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/output_stream.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+
+class OrderedTaskQueue {
+ public:
+  // Returns the packet to output, which may be empty to output nothing, or
+  // the error to fail the calculator with.
+  using Task = std::function<absl::StatusOr<Packet>()>;
+
+  // Runs tasks on num_threads worker threads named after name_prefix, or
+  // inline in Schedule if num_threads is 0.
+  OrderedTaskQueue(const std::string& name_prefix, int num_threads);
+  // Waits for the scheduled tasks to finish, and discards their packets.
+  ~OrderedTaskQueue();
+
+  void Schedule(Task task);
+
+  // Adds the packets of the finished tasks at the head of the queue to output,
+  // first waiting for the oldest tasks until at most max_pending remain.
+  // Stops at, and returns, the error of the first failed task.
+  absl::Status AddFinished(int max_pending, OutputStream* output);
+
+ private:
+  struct Result {
+    bool done = false;
+    absl::StatusOr<Packet> packet;
+  };
+
+  std::unique_ptr<ThreadPool> pool_;
+  absl::Mutex mutex_;
+  // Results of the tasks not output yet, in scheduling order.
+  std::deque<std::shared_ptr<Result>> results_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_IMAGE_ORDERED_TASK_QUEUE_H_
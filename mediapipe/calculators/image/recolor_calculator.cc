@@ -14,10 +14,12 @@
 
 #include <vector>
 
+#include "mediapipe/calculators/image/mask_utils.h"
 #include "mediapipe/calculators/image/recolor_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -38,21 +40,6 @@ constexpr char kMaskCpuTag[] = "MASK";
 constexpr char kGpuBufferTag[] = "IMAGE_GPU";
 constexpr char kMaskGpuTag[] = "MASK_GPU";
 
-inline cv::Vec3b Blend(const cv::Vec3b& color1, const cv::Vec3b& color2,
-                       float weight, int invert_mask,
-                       int adjust_with_luminance) {
-  weight = (1 - invert_mask) * weight + invert_mask * (1.0f - weight);
-
-  float luminance =
-      (1 - adjust_with_luminance) * 1.0f +
-      adjust_with_luminance *
-          (color1[0] * 0.299 + color1[1] * 0.587 + color1[2] * 0.114) / 255;
-
-  float mix_value = weight * luminance;
-
-  return color1 * (1.0 - mix_value) + color2 * mix_value;
-}
-
 }  // namespace
 
 namespace mediapipe {
@@ -117,6 +104,8 @@ class RecolorCalculator : public CalculatorBase {
   mediapipe::RecolorCalculatorOptions::MaskChannel mask_channel_;
 
   bool use_gpu_ = false;
+  // CPU output frames are drawn from this pool if set.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
   bool invert_mask_ = false;
   bool adjust_with_luminance_ = false;
 #if !MEDIAPIPE_DISABLE_GPU
@@ -174,6 +163,8 @@ absl::Status RecolorCalculator::GetContract(CalculatorContract* cc) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  } else {
+    cc->UseService(kImageFramePoolService).Optional();
   }
 
   return absl::OkStatus();
@@ -191,6 +182,13 @@ absl::Status RecolorCalculator::Open(CalculatorContext* cc) {
 
   MP_RETURN_IF_ERROR(LoadOptions(cc));
 
+  if (!use_gpu_) {
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = &frame_pool_service.GetObject();
+    }
+  }
+
   return absl::OkStatus();
 }
 
@@ -235,61 +233,33 @@ absl::Status RecolorCalculator::RenderCpu(CalculatorContext* cc) {
   const auto& input_img = cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
   const auto& mask_img = cc->Inputs().Tag(kMaskCpuTag).Get<ImageFrame>();
 
-  cv::Mat input_mat = formats::MatView(&input_img);
-  cv::Mat mask_mat = formats::MatView(&mask_img);
-
-  RET_CHECK(input_mat.channels() == 3);  // RGB only.
-
-  if (mask_mat.channels() > 1) {
-    std::vector<cv::Mat> channels;
-    cv::split(mask_mat, channels);
-    if (mask_channel_ == mediapipe::RecolorCalculatorOptions_MaskChannel_ALPHA)
-      mask_mat = channels[3];
-    else
-      mask_mat = channels[0];
+  // Multi-channel masks are read from the channel selected in the options.
+  int mask_channel = 0;
+  if (mask_img.NumberOfChannels() > 1 &&
+      mask_channel_ == mediapipe::RecolorCalculatorOptions_MaskChannel_ALPHA) {
+    mask_channel = 3;
   }
-  cv::Mat mask_full;
-  cv::resize(mask_mat, mask_full, input_mat.size());
-  const cv::Vec3b recolor = {color_[0], color_[1], color_[2]};
-
-  auto output_img = absl::make_unique<ImageFrame>(
-      input_img.Format(), input_mat.cols, input_mat.rows);
-  cv::Mat output_mat = mediapipe::formats::MatView(output_img.get());
-
-  const int invert_mask = invert_mask_ ? 1 : 0;
-  const int adjust_with_luminance = adjust_with_luminance_ ? 1 : 0;
-
-  // From GPU shader:
-  /*
-      vec4 weight = texture2D(mask, sample_coordinate);
-      vec4 color1 = texture2D(frame, sample_coordinate);
-      vec4 color2 = vec4(recolor, 1.0);
-
-      float luminance = dot(color1.rgb, vec3(0.299, 0.587, 0.114));
-      float mix_value = weight.MASK_COMPONENT * luminance;
-
-      fragColor = mix(color1, color2, mix_value);
-  */
-  if (mask_img.Format() == ImageFormat::VEC32F1) {
-    for (int i = 0; i < output_mat.rows; ++i) {
-      for (int j = 0; j < output_mat.cols; ++j) {
-        const float weight = mask_full.at<float>(i, j);
-        output_mat.at<cv::Vec3b>(i, j) =
-            Blend(input_mat.at<cv::Vec3b>(i, j), recolor, weight, invert_mask,
-                  adjust_with_luminance);
-      }
-    }
-  } else {
-    for (int i = 0; i < output_mat.rows; ++i) {
-      for (int j = 0; j < output_mat.cols; ++j) {
-        const float weight = mask_full.at<uchar>(i, j) * (1.0 / 255.0);
-        output_mat.at<cv::Vec3b>(i, j) =
-            Blend(input_mat.at<cv::Vec3b>(i, j), recolor, weight, invert_mask,
-                  adjust_with_luminance);
-      }
-    }
+  RET_CHECK_LT(mask_channel, mask_img.NumberOfChannels())
+      << "Mask has no alpha channel.";
+
+  // Resize the mask to the image if needed.
+  const ImageFrame* mask_full = &mask_img;
+  ImageFrame resized_mask;
+  if (mask_img.Width() != input_img.Width() ||
+      mask_img.Height() != input_img.Height()) {
+    resized_mask.Reset(mask_img.Format(), input_img.Width(), input_img.Height(),
+                       ImageFrame::kDefaultAlignmentBoundary);
+    cv::Mat resized_mat = formats::MatView(&resized_mask);
+    cv::resize(formats::MatView(&mask_img), resized_mat, resized_mat.size());
+    mask_full = &resized_mask;
   }
 
+  auto output_img = AcquireImageFrame(frame_pool_, input_img.Format(),
+                                      input_img.Width(), input_img.Height());
+  MP_RETURN_IF_ERROR(mask_utils::RecolorWithMask(
+      input_img, *mask_full, mask_channel, color_.data(), invert_mask_,
+      adjust_with_luminance_, output_img.get()));
+
   cc->Outputs()
       .Tag(kImageFrameTag)
       .Add(output_img.release(), cc->InputTimestamp());
@@ -15,16 +15,16 @@
 #include <algorithm>
 #include <memory>
 
+#include "mediapipe/calculators/image/mask_utils.h"
 #include "mediapipe/calculators/image/segmentation_smoothing_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_options.pb.h"
 #include "mediapipe/framework/formats/image.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
-#include "mediapipe/framework/formats/image_frame_opencv.h"
-#include "mediapipe/framework/formats/image_opencv.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
 #include "mediapipe/framework/port/logging.h"
-#include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/vector.h"
 
@@ -49,7 +49,7 @@ enum { ATTRIB_VERTEX, ATTRIB_TEXTURE_POSITION, NUM_ATTRIBUTES };
 //
 // Inputs:
 //   MASK - Image containing the new/current mask.
-//          [ImageFormat::VEC32F1, or
+//          [ImageFormat::VEC32F1 or GRAY8, or
 //           GpuBufferFormat::kBGRA32/kRGB24/kGrayHalf16/kGrayFloat32]
 //   MASK_PREVIOUS - Image containing previous mask.
 //                   [Same format as MASK_CURRENT]
@@ -97,6 +97,9 @@ class SegmentationSmoothingCalculator : public CalculatorBase {
 
   float combine_with_previous_ratio_;
 
+  // Pool for CPU output masks, null if the graph provides none.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
+
   bool gpu_initialized_ = false;
 #if !MEDIAPIPE_DISABLE_GPU
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -113,6 +116,8 @@ absl::Status SegmentationSmoothingCalculator::GetContract(
   cc->Inputs().Tag(kPreviousMaskTag).Set<Image>();
   cc->Outputs().Tag(kOutputMaskTag).Set<Image>();
 
+  cc->UseService(kImageFramePoolService).Optional();
+
 #if !MEDIAPIPE_DISABLE_GPU
   MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
 #endif  // !MEDIAPIPE_DISABLE_GPU
@@ -127,6 +132,11 @@ absl::Status SegmentationSmoothingCalculator::Open(CalculatorContext* cc) {
       cc->Options<mediapipe::SegmentationSmoothingCalculatorOptions>();
   combine_with_previous_ratio_ = options.combine_with_previous_ratio();
 
+  auto frame_pool_service = cc->Service(kImageFramePoolService);
+  if (frame_pool_service.IsAvailable()) {
+    frame_pool_ = &frame_pool_service.GetObject();
+  }
+
 #if !MEDIAPIPE_DISABLE_GPU
   MP_RETURN_IF_ERROR(gpu_helper_.Open(cc));
 #endif  //  !MEDIAPIPE_DISABLE_GPU
@@ -183,64 +193,18 @@ absl::Status SegmentationSmoothingCalculator::Close(CalculatorContext* cc) {
 absl::Status SegmentationSmoothingCalculator::RenderCpu(CalculatorContext* cc) {
   // Setup source images.
   const auto& current_frame = cc->Inputs().Tag(kCurrentMaskTag).Get<Image>();
-  const cv::Mat current_mat = mediapipe::formats::MatView(&current_frame);
-  RET_CHECK_EQ(current_mat.type(), CV_32FC1)
-      << "Only 1-channel float input image is supported.";
-
   const auto& previous_frame = cc->Inputs().Tag(kPreviousMaskTag).Get<Image>();
-  const cv::Mat previous_mat = mediapipe::formats::MatView(&previous_frame);
-  RET_CHECK_EQ(previous_mat.type(), current_mat.type())
-      << "Warning: mixing input format types: " << previous_mat.type()
-      << " != " << previous_mat.type();
-
-  RET_CHECK_EQ(current_mat.rows, previous_mat.rows);
-  RET_CHECK_EQ(current_mat.cols, previous_mat.cols);
+  const ImageFrameSharedPtr& current = current_frame.GetImageFrameSharedPtr();
+  const ImageFrameSharedPtr& previous =
+      previous_frame.GetImageFrameSharedPtr();
+  RET_CHECK(current && previous);
 
   // Setup destination image.
-  auto output_frame = std::make_shared<ImageFrame>(
-      current_frame.image_format(), current_mat.cols, current_mat.rows);
-  cv::Mat output_mat = mediapipe::formats::MatView(output_frame.get());
-  output_mat.setTo(cv::Scalar(0));
-
-  // Blending function.
-  const auto blending_fn = [&](const float prev_mask_value,
-                               const float new_mask_value) {
-    /*
-     * Assume p := new_mask_value
-     * H(p) := 1 + (p * log(p) + (1-p) * log(1-p)) / log(2)
-     * uncertainty alpha(p) =
-     *   Clamp(1 - (1 - H(p)) * (1 - H(p)), 0, 1) [squaring the uncertainty]
-     *
-     * The following polynomial approximates uncertainty alpha as a function
-     * of (p + 0.5):
-     */
-    const float c1 = 5.68842;
-    const float c2 = -0.748699;
-    const float c3 = -57.8051;
-    const float c4 = 291.309;
-    const float c5 = -624.717;
-    const float t = new_mask_value - 0.5f;
-    const float x = t * t;
-
-    const float uncertainty =
-        1.0f -
-        std::min(1.0f, x * (c1 + x * (c2 + x * (c3 + x * (c4 + x * c5)))));
-
-    return new_mask_value + (prev_mask_value - new_mask_value) *
-                                (uncertainty * combine_with_previous_ratio_);
-  };
+  std::shared_ptr<ImageFrame> output_frame = AcquireImageFrame(
+      frame_pool_, current->Format(), current->Width(), current->Height());
 
-  // Write directly to the first channel of output.
-  for (int i = 0; i < output_mat.rows; ++i) {
-    float* out_ptr = output_mat.ptr<float>(i);
-    const float* curr_ptr = current_mat.ptr<float>(i);
-    const float* prev_ptr = previous_mat.ptr<float>(i);
-    for (int j = 0; j < output_mat.cols; ++j) {
-      const float new_mask_value = curr_ptr[j];
-      const float prev_mask_value = prev_ptr[j];
-      out_ptr[j] = blending_fn(prev_mask_value, new_mask_value);
-    }
-  }
+  MP_RETURN_IF_ERROR(mask_utils::SmoothSegmentationMask(
+      *current, *previous, combine_with_previous_ratio_, output_frame.get()));
 
   cc->Outputs()
       .Tag(kOutputMaskTag)
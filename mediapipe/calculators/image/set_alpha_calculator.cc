@@ -12,16 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
 
+#include "mediapipe/calculators/image/mask_utils.h"
 #include "mediapipe/calculators/image/set_alpha_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_options.pb.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
-#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
 #include "mediapipe/framework/port/logging.h"
-#include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/vector.h"
 
@@ -43,8 +44,6 @@ constexpr char kInputFrameTagGpu[] = "IMAGE_GPU";
 constexpr char kInputAlphaTagGpu[] = "ALPHA_GPU";
 constexpr char kOutputFrameTagGpu[] = "IMAGE_GPU";
 
-constexpr int kNumChannelsRGBA = 4;
-
 enum { ATTRIB_VERTEX, ATTRIB_TEXTURE_POSITION, NUM_ATTRIBUTES };
 }  // namespace
 
@@ -105,6 +104,8 @@ class SetAlphaCalculator : public CalculatorBase {
   float alpha_value_ = -1.f;
 
   bool use_gpu_ = false;
+  // CPU output frames are drawn from this pool if set.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
   bool gpu_initialized_ = false;
 #if !MEDIAPIPE_DISABLE_GPU
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -164,6 +165,8 @@ absl::Status SetAlphaCalculator::GetContract(CalculatorContract* cc) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  } else {
+    cc->UseService(kImageFramePoolService).Optional();
   }
 
   return absl::OkStatus();
@@ -198,6 +201,13 @@ absl::Status SetAlphaCalculator::Open(CalculatorContext* cc) {
 #endif
   }  //  !MEDIAPIPE_DISABLE_GPU
 
+  if (!use_gpu_) {
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = &frame_pool_service.GetObject();
+    }
+  }
+
   return absl::OkStatus();
 }
 
@@ -238,56 +248,23 @@ absl::Status SetAlphaCalculator::RenderCpu(CalculatorContext* cc) {
 
   // Setup source image
   const auto& input_frame = cc->Inputs().Tag(kInputFrameTag).Get<ImageFrame>();
-  const cv::Mat input_mat = mediapipe::formats::MatView(&input_frame);
-  if (!(input_mat.type() == CV_8UC3 || input_mat.type() == CV_8UC4)) {
-    LOG(ERROR) << "Only 3 or 4 channel 8-bit input image supported";
-  }
 
   // Setup destination image
-  auto output_frame = absl::make_unique<ImageFrame>(
-      ImageFormat::SRGBA, input_mat.cols, input_mat.rows);
-  cv::Mat output_mat = mediapipe::formats::MatView(output_frame.get());
+  auto output_frame = AcquireImageFrame(frame_pool_, ImageFormat::SRGBA,
+                                        input_frame.Width(),
+                                        input_frame.Height());
 
   const bool has_alpha_mask = cc->Inputs().HasTag(kInputAlphaTag) &&
                               !cc->Inputs().Tag(kInputAlphaTag).IsEmpty();
   const bool use_alpa_mask = alpha_value_ < 0 && has_alpha_mask;
 
   // Setup alpha image and Update image in CPU.
-  if (use_alpa_mask) {
-    const auto& alpha_mask = cc->Inputs().Tag(kInputAlphaTag).Get<ImageFrame>();
-    cv::Mat alpha_mat = mediapipe::formats::MatView(&alpha_mask);
-    RET_CHECK_EQ(input_mat.rows, alpha_mat.rows);
-    RET_CHECK_EQ(input_mat.cols, alpha_mat.cols);
-
-    for (int i = 0; i < output_mat.rows; ++i) {
-      const uchar* in_ptr = input_mat.ptr<uchar>(i);
-      uchar* alpha_ptr = alpha_mat.ptr<uchar>(i);
-      uchar* out_ptr = output_mat.ptr<uchar>(i);
-      for (int j = 0; j < output_mat.cols; ++j) {
-        const int out_idx = j * kNumChannelsRGBA;
-        const int in_idx = j * input_mat.channels();
-        const int alpha_idx = j * alpha_mat.channels();
-        out_ptr[out_idx + 0] = in_ptr[in_idx + 0];
-        out_ptr[out_idx + 1] = in_ptr[in_idx + 1];
-        out_ptr[out_idx + 2] = in_ptr[in_idx + 2];
-        out_ptr[out_idx + 3] = alpha_ptr[alpha_idx + 0];  // channel 0 of mask
-      }
-    }
-  } else {
-    const uchar alpha_value = std::min(std::max(0.0f, alpha_value_), 255.0f);
-    for (int i = 0; i < output_mat.rows; ++i) {
-      const uchar* in_ptr = input_mat.ptr<uchar>(i);
-      uchar* out_ptr = output_mat.ptr<uchar>(i);
-      for (int j = 0; j < output_mat.cols; ++j) {
-        const int out_idx = j * kNumChannelsRGBA;
-        const int in_idx = j * input_mat.channels();
-        out_ptr[out_idx + 0] = in_ptr[in_idx + 0];
-        out_ptr[out_idx + 1] = in_ptr[in_idx + 1];
-        out_ptr[out_idx + 2] = in_ptr[in_idx + 2];
-        out_ptr[out_idx + 3] = alpha_value;  // use value from options
-      }
-    }
-  }
+  const ImageFrame* alpha_mask =
+      use_alpa_mask ? &cc->Inputs().Tag(kInputAlphaTag).Get<ImageFrame>()
+                    : nullptr;
+  const uint8 alpha_value = std::min(std::max(0.0f, alpha_value_), 255.0f);
+  MP_RETURN_IF_ERROR(mask_utils::SetAlpha(input_frame, alpha_mask, alpha_value,
+                                          output_frame.get()));
 
   cc->Outputs()
       .Tag(kOutputFrameTag)
@@ -0,0 +1,198 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/calculators/ipc/shared_memory_receiver_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Passes packets with even timestamps, and only the timestamp bound for the
+// others.
+class DropOddPacketsCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).SetSameAs(&cc->Inputs().Index(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    if (cc->InputTimestamp().Value() % 2 == 0) {
+      cc->Outputs().Index(0).AddPacket(cc->Inputs().Index(0).Value());
+    } else {
+      cc->Outputs().Index(0).SetNextTimestampBound(
+          cc->InputTimestamp().NextAllowedInStream());
+    }
+    return absl::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(DropOddPacketsCalculator);
+
+std::string UniqueName(const std::string& test_name) {
+  return absl::StrCat("mediapipe_", test_name, "_", getpid());
+}
+
+CalculatorGraphConfig SenderConfig(const std::string& name, int num_slots,
+                                   int64 send_timeout_us) {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(absl::Substitute(
+      R"(
+        input_stream: "in"
+        node {
+          calculator: "DropOddPacketsCalculator"
+          input_stream: "in"
+          output_stream: "filtered"
+        }
+        node {
+          calculator: "SharedMemorySenderCalculator"
+          input_stream: "filtered"
+          options {
+            [mediapipe.SharedMemorySenderCalculatorOptions.ext] {
+              name: "$0"
+              num_slots: $1
+              slot_size: 65536
+              send_timeout_us: $2
+            }
+          }
+        }
+      )",
+      name, num_slots, send_timeout_us));
+}
+
+CalculatorGraphConfig ReceiverConfig(const std::string& name) {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(absl::Substitute(
+      R"(
+        node {
+          calculator: "SharedMemoryReceiverCalculator"
+          output_stream: "out"
+          options {
+            [mediapipe.SharedMemoryReceiverCalculatorOptions.ext] {
+              name: "$0"
+            }
+          }
+        }
+      )",
+      name));
+}
+
+Packet MakeFrame(int value, Timestamp timestamp) {
+  auto frame = absl::make_unique<ImageFrame>(ImageFormat::GRAY8, 8, 4);
+  std::fill(frame->MutablePixelData(),
+            frame->MutablePixelData() + frame->PixelDataSize(), value);
+  return Adopt(frame.release()).At(timestamp);
+}
+
+TEST(SharedMemoryCalculatorsTest, PassesPacketsAndTimestampBounds) {
+  const std::string name = UniqueName("PassesPacketsAndTimestampBounds");
+  CalculatorGraph sender;
+  MP_ASSERT_OK(sender.Initialize(SenderConfig(name, 4, 0)));
+  CalculatorGraph receiver;
+  MP_ASSERT_OK(receiver.Initialize(ReceiverConfig(name)));
+  absl::Mutex mutex;
+  std::vector<Timestamp> packet_timestamps;
+  std::vector<Timestamp> bound_timestamps;
+  std::vector<int> pixels;
+  MP_ASSERT_OK(receiver.ObserveOutputStream(
+      "out",
+      [&](const Packet& packet) {
+        absl::MutexLock lock(&mutex);
+        if (packet.IsEmpty()) {
+          bound_timestamps.push_back(packet.Timestamp());
+        } else {
+          packet_timestamps.push_back(packet.Timestamp());
+          pixels.push_back(packet.Get<ImageFrame>().PixelData()[0]);
+        }
+        return absl::OkStatus();
+      },
+      /*observe_timestamp_bounds=*/true));
+
+  MP_ASSERT_OK(sender.StartRun({}));
+  MP_ASSERT_OK(receiver.StartRun({}));
+  for (int i = 0; i < 6; ++i) {
+    MP_ASSERT_OK(
+        sender.AddPacketToInputStream("in", MakeFrame(i * 10, Timestamp(i))));
+  }
+  MP_ASSERT_OK(sender.CloseAllInputStreams());
+  MP_ASSERT_OK(sender.WaitUntilDone());
+  MP_ASSERT_OK(receiver.WaitUntilDone());
+
+  EXPECT_THAT(packet_timestamps,
+              testing::ElementsAre(Timestamp(0), Timestamp(2), Timestamp(4)));
+  EXPECT_THAT(pixels, testing::ElementsAre(0, 20, 40));
+  EXPECT_THAT(bound_timestamps,
+              testing::IsSupersetOf({Timestamp(1), Timestamp(3)}));
+}
+
+TEST(SharedMemoryCalculatorsTest, HeldFramesHoldBackSender) {
+  const std::string name = UniqueName("HeldFramesHoldBackSender");
+  CalculatorGraph sender;
+  MP_ASSERT_OK(sender.Initialize(SenderConfig(name, 2, 100000)));
+  CalculatorGraph receiver;
+  MP_ASSERT_OK(receiver.Initialize(ReceiverConfig(name)));
+  absl::Mutex mutex;
+  // Received frames reference their slots until released.
+  std::vector<Packet> held;
+  MP_ASSERT_OK(receiver.ObserveOutputStream("out", [&](const Packet& packet) {
+    absl::MutexLock lock(&mutex);
+    held.push_back(packet);
+    return absl::OkStatus();
+  }));
+
+  MP_ASSERT_OK(sender.StartRun({}));
+  MP_ASSERT_OK(receiver.StartRun({}));
+  for (int i = 0; i < 3; ++i) {
+    MP_ASSERT_OK(
+        sender.AddPacketToInputStream("in", MakeFrame(i, Timestamp(2 * i))));
+  }
+  MP_ASSERT_OK(sender.CloseAllInputStreams());
+  absl::Status status = sender.WaitUntilDone();
+  EXPECT_TRUE(absl::IsDeadlineExceeded(status)) << status;
+  {
+    absl::MutexLock lock(&mutex);
+    EXPECT_EQ(held.size(), 2);
+    held.clear();
+  }
+  receiver.Cancel();
+  receiver.WaitUntilDone().IgnoreError();
+}
+
+TEST(SharedMemoryCalculatorsTest, ReceiverFailsWithoutSender) {
+  CalculatorGraphConfig config =
+      ReceiverConfig(UniqueName("ReceiverFailsWithoutSender"));
+  config.mutable_node(0)
+      ->mutable_options()
+      ->MutableExtension(SharedMemoryReceiverCalculatorOptions::ext)
+      ->set_open_timeout_us(1000);
+  CalculatorGraph receiver;
+  MP_ASSERT_OK(receiver.Initialize(config));
+  EXPECT_TRUE(absl::IsDeadlineExceeded(receiver.Run()));
+}
+
+}  // namespace
+}  // namespace mediapipe
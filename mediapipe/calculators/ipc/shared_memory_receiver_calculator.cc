@@ -0,0 +1,120 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/calculators/ipc/shared_memory_receiver_calculator.pb.h"
+#include "mediapipe/calculators/ipc/shared_memory_ring.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/tool/status_util.h"
+#include "mediapipe/util/packet_codec.h"
+
+namespace mediapipe {
+
+namespace {
+
+// How long a single Process call waits for a record, so that the graph can
+// still be cancelled while the sender is idle.
+constexpr absl::Duration kReadPollInterval = absl::Milliseconds(10);
+
+}  // namespace
+
+// Outputs the packets and timestamp bounds sent by the
+// SharedMemorySenderCalculator with the same name, typically from a graph in
+// another process on the same machine.
+//
+// Received ImageFrames reference the pixel data in shared memory, and hold
+// their slot until they are destroyed; the sender waits for a free slot when
+// all are held. Matrix and Tensor packets are copied out of their slot, and
+// protocol buffer messages are parsed, which requires the message type to be
+// linked into this process. The stream ends when the sender closes.
+//
+// Example config:
+// node {
+//   calculator: "SharedMemoryReceiverCalculator"
+//   output_stream: "frames"
+//   options {
+//     [mediapipe.SharedMemoryReceiverCalculatorOptions.ext] {
+//       name: "camera_frames"
+//     }
+//   }
+// }
+class SharedMemoryReceiverCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Outputs().Index(0).SetAny();
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options =
+        cc->Options<SharedMemoryReceiverCalculatorOptions>();
+    RET_CHECK(!options.name().empty())
+        << "SharedMemoryReceiverCalculator requires a name.";
+    idle_timeout_ = options.idle_timeout_us() > 0
+                        ? absl::Microseconds(options.idle_timeout_us())
+                        : absl::InfiniteDuration();
+    ASSIGN_OR_RETURN(
+        ring_, SharedMemoryRing::Open(
+                   options.name(),
+                   absl::Microseconds(options.open_timeout_us())));
+    last_record_time_ = absl::Now();
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    auto record_or = ring_->Read(kReadPollInterval);
+    if (absl::IsDeadlineExceeded(record_or.status())) {
+      if (absl::Now() - last_record_time_ > idle_timeout_) {
+        return absl::DeadlineExceededError(
+            "SharedMemoryReceiverCalculator received nothing within "
+            "idle_timeout_us.");
+      }
+      return absl::OkStatus();
+    }
+    MP_RETURN_IF_ERROR(record_or.status());
+    SharedMemoryRing::Record& record = record_or.value();
+    last_record_time_ = absl::Now();
+
+    switch (record.kind) {
+      case SharedMemoryRing::RecordKind::kPacket: {
+        ASSIGN_OR_RETURN(Packet packet,
+                         DecodePacketPayload(record.payload, record.size,
+                                             std::move(record.lease)));
+        cc->Outputs().Index(0).AddPacket(packet.At(record.timestamp));
+        return absl::OkStatus();
+      }
+      case SharedMemoryRing::RecordKind::kTimestampBound:
+        cc->Outputs().Index(0).SetNextTimestampBound(
+            record.timestamp.NextAllowedInStream());
+        return absl::OkStatus();
+      case SharedMemoryRing::RecordKind::kClose:
+        return tool::StatusStop();
+    }
+    return absl::DataLossError("Unknown shared memory record kind.");
+  }
+
+ private:
+  std::shared_ptr<SharedMemoryRing> ring_;
+  absl::Duration idle_timeout_;
+  absl::Time last_record_time_;
+};
+REGISTER_CALCULATOR(SharedMemoryReceiverCalculator);
+
+}  // namespace mediapipe
@@ -0,0 +1,276 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/ipc/shared_memory_ring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_builder.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr uint32 kRingMagic = 0x4d50524e;  // "MPRN"
+constexpr size_t kAlignment = 64;
+
+// Slot states.
+constexpr uint32 kSlotFree = 0;
+constexpr uint32 kSlotWritten = 1;
+constexpr uint32 kSlotLeased = 2;
+
+struct RingHeader {
+  // Set last by the creator, once the rest of the ring is initialized.
+  std::atomic<uint32> magic;
+  uint32 num_slots;
+  uint64 slot_size;
+};
+
+// Precedes the payload of each slot.
+struct SlotHeader {
+  // Written by the writer to hand the slot over, and by the reader to
+  // give it back.
+  std::atomic<uint32> state;
+  uint32 kind;
+  int64 timestamp;
+  uint64 size;
+};
+
+static_assert(std::atomic<uint32>::is_always_lock_free,
+              "Shared-memory rings need lock-free atomics.");
+
+size_t AlignUp(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+size_t SlotStride(size_t slot_size) {
+  return AlignUp(sizeof(SlotHeader)) + AlignUp(slot_size);
+}
+
+size_t MappedSize(int num_slots, size_t slot_size) {
+  return AlignUp(sizeof(RingHeader)) + num_slots * SlotStride(slot_size);
+}
+
+std::string ShmName(const std::string& name) {
+  return name.empty() || name[0] != '/' ? absl::StrCat("/", name) : name;
+}
+
+// Polls condition until it holds or deadline passes, backing off from
+// spinning to sleeping. Returns whether condition holds.
+template <typename Condition>
+bool PollUntil(Condition condition, absl::Time deadline) {
+  absl::Duration sleep = absl::Microseconds(10);
+  for (int spins = 0;; ++spins) {
+    if (condition()) return true;
+    if (spins < 100) continue;
+    if (absl::Now() >= deadline) return false;
+    absl::SleepFor(sleep);
+    sleep = std::min(sleep * 2, absl::Milliseconds(1));
+  }
+}
+
+absl::Time DeadlineAfter(absl::Duration timeout) {
+  return timeout == absl::InfiniteDuration() ? absl::InfiniteFuture()
+                                              : absl::Now() + timeout;
+}
+
+}  // namespace
+
+// static
+absl::StatusOr<std::shared_ptr<SharedMemoryRing>> SharedMemoryRing::Create(
+    const std::string& name, int num_slots, size_t slot_size) {
+  RET_CHECK_GT(num_slots, 0);
+  RET_CHECK_GT(slot_size, 0);
+  const std::string shm_name = ShmName(name);
+  shm_unlink(shm_name.c_str());
+  int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "shm_open(" << shm_name << ") failed: " << std::strerror(errno);
+  }
+  const size_t mapped_size = MappedSize(num_slots, slot_size);
+  void* base = MAP_FAILED;
+  if (ftruncate(fd, mapped_size) == 0) {
+    base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+  }
+  const int error = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(shm_name.c_str());
+    return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot map " << mapped_size << " bytes of shared memory "
+           << shm_name << ": " << std::strerror(error);
+  }
+
+  // The new memory is zeroed, so all slots start free.
+  std::shared_ptr<SharedMemoryRing> ring(new SharedMemoryRing(
+      shm_name, /*owner=*/true, static_cast<uint8*>(base), mapped_size));
+  auto* header = reinterpret_cast<RingHeader*>(base);
+  header->num_slots = num_slots;
+  header->slot_size = slot_size;
+  header->magic.store(kRingMagic, std::memory_order_release);
+  ring->num_slots_ = num_slots;
+  ring->slot_size_ = slot_size;
+  ring->slot_stride_ = SlotStride(slot_size);
+  return ring;
+}
+
+// static
+absl::StatusOr<std::shared_ptr<SharedMemoryRing>> SharedMemoryRing::Open(
+    const std::string& name, absl::Duration timeout) {
+  const std::string shm_name = ShmName(name);
+  std::shared_ptr<SharedMemoryRing> ring;
+  const bool opened = PollUntil(
+      [&shm_name, &ring]() {
+        int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+        if (fd < 0) return false;
+        struct stat info;
+        void* base = MAP_FAILED;
+        if (fstat(fd, &info) == 0 &&
+            info.st_size >= static_cast<off_t>(sizeof(RingHeader))) {
+          base = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (base == MAP_FAILED) return false;
+        ring.reset(new SharedMemoryRing(shm_name, /*owner=*/false,
+                                        static_cast<uint8*>(base),
+                                        info.st_size));
+        auto* header = reinterpret_cast<RingHeader*>(base);
+        if (header->magic.load(std::memory_order_acquire) != kRingMagic ||
+            MappedSize(header->num_slots, header->slot_size) >
+                static_cast<size_t>(info.st_size)) {
+          // Not initialized yet.
+          ring.reset();
+          return false;
+        }
+        ring->num_slots_ = header->num_slots;
+        ring->slot_size_ = header->slot_size;
+        ring->slot_stride_ = SlotStride(header->slot_size);
+        return true;
+      },
+      DeadlineAfter(timeout));
+  if (!opened) {
+    return absl::DeadlineExceededError(
+        absl::StrCat("Shared memory ", shm_name, " was not created within ",
+                     absl::FormatDuration(timeout)));
+  }
+  return ring;
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name, bool owner,
+                                   uint8* base, size_t mapped_size)
+    : name_(name), owner_(owner), base_(base), mapped_size_(mapped_size) {}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  munmap(base_, mapped_size_);
+  if (owner_) {
+    // The reader keeps its mapping, and can finish reading.
+    shm_unlink(name_.c_str());
+  }
+}
+
+uint8* SharedMemoryRing::Slot(int index) const {
+  return base_ + AlignUp(sizeof(RingHeader)) + index * slot_stride_;
+}
+
+absl::StatusOr<uint8*> SharedMemoryRing::BeginWrite(absl::Duration timeout) {
+  auto* slot = reinterpret_cast<SlotHeader*>(Slot(next_index_ % num_slots_));
+  if (!PollUntil(
+          [slot]() {
+            return slot->state.load(std::memory_order_acquire) == kSlotFree;
+          },
+          DeadlineAfter(timeout))) {
+    return absl::DeadlineExceededError(absl::StrCat(
+        "No free slot in ", name_, " within ", absl::FormatDuration(timeout)));
+  }
+  return reinterpret_cast<uint8*>(slot) + AlignUp(sizeof(SlotHeader));
+}
+
+void SharedMemoryRing::EndWrite(RecordKind kind, Timestamp timestamp,
+                                size_t size) {
+  CHECK_LE(size, slot_size_);
+  auto* slot = reinterpret_cast<SlotHeader*>(Slot(next_index_ % num_slots_));
+  slot->kind = static_cast<uint32>(kind);
+  slot->timestamp = timestamp.Value();
+  slot->size = size;
+  slot->state.store(kSlotWritten, std::memory_order_release);
+  ++next_index_;
+}
+
+absl::Status SharedMemoryRing::WaitUntilRead(absl::Duration timeout) {
+  const bool read = PollUntil(
+      [this]() {
+        for (int i = 0; i < num_slots_; ++i) {
+          if (reinterpret_cast<SlotHeader*>(Slot(i))->state.load(
+                  std::memory_order_acquire) == kSlotWritten) {
+            return false;
+          }
+        }
+        return true;
+      },
+      DeadlineAfter(timeout));
+  if (!read) {
+    return absl::DeadlineExceededError(
+        absl::StrCat("Records in ", name_, " were not read within ",
+                     absl::FormatDuration(timeout)));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<SharedMemoryRing::Record> SharedMemoryRing::Read(
+    absl::Duration timeout) {
+  auto* slot = reinterpret_cast<SlotHeader*>(Slot(next_index_ % num_slots_));
+  if (!PollUntil(
+          [slot]() {
+            return slot->state.load(std::memory_order_acquire) ==
+                   kSlotWritten;
+          },
+          DeadlineAfter(timeout))) {
+    return absl::DeadlineExceededError(absl::StrCat(
+        "No record in ", name_, " within ", absl::FormatDuration(timeout)));
+  }
+  slot->state.store(kSlotLeased, std::memory_order_relaxed);
+  ++next_index_;
+
+  Record record;
+  record.kind = static_cast<RecordKind>(slot->kind);
+  record.timestamp = Timestamp::CreateNoErrorChecking(slot->timestamp);
+  record.payload =
+      reinterpret_cast<uint8*>(slot) + AlignUp(sizeof(SlotHeader));
+  record.size = std::min<uint64>(slot->size, slot_size_);
+  // The lease frees the slot, and keeps the mapping until then.
+  std::shared_ptr<SharedMemoryRing> self = shared_from_this();
+  record.lease = std::shared_ptr<const void>(
+      slot, [self](const void* leased) {
+        static_cast<SlotHeader*>(const_cast<void*>(leased))
+            ->state.store(kSlotFree, std::memory_order_release);
+      });
+  return record;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,114 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A single-producer, single-consumer ring of fixed-size slots in POSIX shared
+// memory, used to pass records between two processes on the same machine.
+//
+// The writer fills the slots in order, and waits for the next slot to be
+// released when the ring is full. The reader reads the slots in order, and
+// holds each slot until the lease of the record read from it is released, so
+// that the record payload can be used in place. Waiting is done by polling
+// the slot states, since the processes share no other synchronization.
+
+#ifndef MEDIAPIPE_CALCULATORS_IPC_SHARED_MEMORY_RING_H_
+#define MEDIAPIPE_CALCULATORS_IPC_SHARED_MEMORY_RING_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/time/time.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+
+class SharedMemoryRing
+    : public std::enable_shared_from_this<SharedMemoryRing> {
+ public:
+  enum class RecordKind : uint32 {
+    // An encoded packet.
+    kPacket = 1,
+    // A timestamp bound without a packet.
+    kTimestampBound = 2,
+    // The end of the stream.
+    kClose = 3,
+  };
+
+  struct Record {
+    RecordKind kind;
+    Timestamp timestamp;
+    const uint8* payload = nullptr;
+    size_t size = 0;
+    // Keeps the slot of the record, and the ring, until released.
+    std::shared_ptr<const void> lease;
+  };
+
+  // Creates the ring with the given name, replacing any stale ring of that
+  // name. The name is removed again when the ring is destroyed. num_slots
+  // records of up to slot_size bytes can be in flight.
+  static absl::StatusOr<std::shared_ptr<SharedMemoryRing>> Create(
+      const std::string& name, int num_slots, size_t slot_size);
+
+  // Opens the ring created with the given name, waiting up to timeout for it
+  // to be created.
+  static absl::StatusOr<std::shared_ptr<SharedMemoryRing>> Open(
+      const std::string& name, absl::Duration timeout);
+
+  ~SharedMemoryRing();
+  SharedMemoryRing(const SharedMemoryRing&) = delete;
+  SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+  // The maximum payload size of a record.
+  size_t slot_size() const { return slot_size_; }
+
+  // Waits up to timeout for the next slot to be free, and returns its payload
+  // buffer, which holds slot_size() bytes aligned to 64 bytes. Returns
+  // DeadlineExceededError on timeout. Writer only.
+  absl::StatusOr<uint8*> BeginWrite(absl::Duration timeout);
+  // Hands the slot returned by BeginWrite over to the reader.
+  void EndWrite(RecordKind kind, Timestamp timestamp, size_t size);
+
+  // Waits up to timeout for the reader to take all written records. Writer
+  // only.
+  absl::Status WaitUntilRead(absl::Duration timeout);
+
+  // Waits up to timeout for the next record. Returns DeadlineExceededError on
+  // timeout. Reader only.
+  absl::StatusOr<Record> Read(absl::Duration timeout);
+
+ private:
+  SharedMemoryRing(const std::string& name, bool owner, uint8* base,
+                   size_t mapped_size);
+
+  // Returns the start of the slot with the given index.
+  uint8* Slot(int index) const;
+
+  const std::string name_;
+  // Whether this is the creating side, which removes the name.
+  const bool owner_;
+  uint8* const base_;
+  const size_t mapped_size_;
+  int num_slots_ = 0;
+  size_t slot_size_ = 0;
+  size_t slot_stride_ = 0;
+  // Index of the next slot to write or read by this side.
+  int64 next_index_ = 0;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_IPC_SHARED_MEMORY_RING_H_
@@ -0,0 +1,111 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "absl/time/time.h"
+#include "mediapipe/calculators/ipc/shared_memory_ring.h"
+#include "mediapipe/calculators/ipc/shared_memory_sender_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/packet_codec.h"
+
+namespace mediapipe {
+
+// Sends the packets and timestamp bounds of its input stream to a
+// SharedMemoryReceiverCalculator, typically in a graph of another process on
+// the same machine, through a ring of slots in POSIX shared memory.
+//
+// ImageFrame, Matrix and Tensor packets are copied into a slot once, and
+// protocol buffer messages are serialized (see mediapipe/util/packet_codec.h).
+// Once all slots are taken, Process waits for the receiver to release one, so
+// that a slow receiver holds back the sending graph. Close sends the end of
+// the stream, and waits for the receiver to read everything sent.
+//
+// Example config:
+// node {
+//   calculator: "SharedMemorySenderCalculator"
+//   input_stream: "frames"
+//   options {
+//     [mediapipe.SharedMemorySenderCalculatorOptions.ext] {
+//       name: "camera_frames"
+//       slot_size: 8388608
+//     }
+//   }
+// }
+class SharedMemorySenderCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->SetProcessTimestampBounds(true);
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options =
+        cc->Options<SharedMemorySenderCalculatorOptions>();
+    RET_CHECK(!options.name().empty())
+        << "SharedMemorySenderCalculator requires a name.";
+    send_timeout_ = options.send_timeout_us() > 0
+                        ? absl::Microseconds(options.send_timeout_us())
+                        : absl::InfiniteDuration();
+    ASSIGN_OR_RETURN(ring_,
+                     SharedMemoryRing::Create(options.name(),
+                                              options.num_slots(),
+                                              options.slot_size()));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    const Packet& packet = cc->Inputs().Index(0).Value();
+    ASSIGN_OR_RETURN(uint8 * slot, ring_->BeginWrite(send_timeout_));
+    if (packet.IsEmpty()) {
+      // Only the timestamp bound advanced.
+      ring_->EndWrite(SharedMemoryRing::RecordKind::kTimestampBound,
+                      cc->InputTimestamp(), 0);
+      return absl::OkStatus();
+    }
+    ASSIGN_OR_RETURN(size_t size, EncodedPacketPayloadSize(packet));
+    RET_CHECK_LE(size, ring_->slot_size())
+        << "A packet of type " << packet.DebugTypeName() << " takes " << size
+        << " bytes, more than slot_size.";
+    MP_RETURN_IF_ERROR(EncodePacketPayload(packet, slot, size));
+    ring_->EndWrite(SharedMemoryRing::RecordKind::kPacket, packet.Timestamp(),
+                    size);
+    return absl::OkStatus();
+  }
+
+  absl::Status Close(CalculatorContext* cc) override {
+    if (ring_ == nullptr) {
+      return absl::OkStatus();
+    }
+    // After a graph error, the receiver may be gone; do not wait for it.
+    const absl::Duration timeout =
+        cc->GraphStatus().ok() ? send_timeout_ : absl::ZeroDuration();
+    auto ring = std::move(ring_);
+    MP_RETURN_IF_ERROR(ring->BeginWrite(timeout).status());
+    ring->EndWrite(SharedMemoryRing::RecordKind::kClose, Timestamp::Done(), 0);
+    // The shared memory is removed with the ring, so a receiver that has not
+    // opened it yet would miss the end of the stream.
+    return ring->WaitUntilRead(timeout);
+  }
+
+ private:
+  std::shared_ptr<SharedMemoryRing> ring_;
+  absl::Duration send_timeout_;
+};
+REGISTER_CALCULATOR(SharedMemorySenderCalculator);
+
+}  // namespace mediapipe
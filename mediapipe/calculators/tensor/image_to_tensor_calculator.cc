@@ -18,6 +18,7 @@
 
 #include "mediapipe/calculators/tensor/image_to_tensor_calculator.pb.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_yuv.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -25,6 +26,7 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -68,7 +70,8 @@ using GpuBuffer = mediapipe::GpuBuffer;
 // Inputs:
 //   IMAGE - Image[ImageFormat::SRGB / SRGBA, GpuBufferFormat::kBGRA32] or
 //           ImageFrame [ImageFormat::SRGB/SRGBA] (for backward compatibility
-//           with existing graphs that use IMAGE for ImageFrame input)
+//           with existing graphs that use IMAGE for ImageFrame input) or
+//           YUVImage [I420/NV12/NV21]
 //   IMAGE_GPU - GpuBuffer [GpuBufferFormat::kBGRA32]
 //     Image to extract from.
 //
@@ -77,6 +80,10 @@ using GpuBuffer = mediapipe::GpuBuffer;
 //   - IMAGE input of type Image is processed on GPU if the data is already on
 //     GPU (i.e., Image::UsesGpu() returns true), or otherwise processed on CPU.
 //   - IMAGE input of type ImageFrame is always processed on CPU.
+//   - IMAGE input of type YUVImage is always processed on CPU, reading only
+//     the pixels of the ROI and converting them to RGB on the fly, which is
+//     much cheaper than converting the whole image to RGB upfront when the
+//     ROI is small.
 //   - IMAGE_GPU input (of type GpuBuffer) is always processed on GPU.
 //
 //   NORM_RECT - NormalizedRect @Optional
@@ -125,8 +132,8 @@ using GpuBuffer = mediapipe::GpuBuffer;
 // }
 class ImageToTensorCalculator : public Node {
  public:
-  static constexpr Input<
-      OneOf<mediapipe::Image, mediapipe::ImageFrame>>::Optional kIn{"IMAGE"};
+  static constexpr Input<OneOf<mediapipe::Image, mediapipe::ImageFrame,
+                               mediapipe::YUVImage>>::Optional kIn{"IMAGE"};
   static constexpr Input<GpuBuffer>::Optional kInGpu{"IMAGE_GPU"};
   static constexpr Input<mediapipe::NormalizedRect>::Optional kInNormRect{
       "NORM_RECT"};
@@ -207,22 +214,14 @@ class ImageToTensorCalculator : public Node {
       }
     }
 
+    if (kIn(cc).IsConnected() && kIn(cc).Has<mediapipe::YUVImage>()) {
+      return ProcessYuvImage(cc, norm_rect);
+    }
+
     ASSIGN_OR_RETURN(auto image, GetInputImage(cc));
     const Size size{image->width(), image->height()};
-    RotatedRect roi = GetRoi(size.width, size.height, norm_rect);
-    ASSIGN_OR_RETURN(auto padding, PadRoi(options_.output_tensor_width(),
-                                          options_.output_tensor_height(),
-                                          options_.keep_aspect_ratio(), &roi));
-    if (kOutLetterboxPadding(cc).IsConnected()) {
-      kOutLetterboxPadding(cc).Send(padding);
-    }
-    if (kOutMatrix(cc).IsConnected()) {
-      std::array<float, 16> matrix;
-      GetRotatedSubRectToRectTransformMatrix(roi, size.width, size.height,
-                                             /*flip_horizontaly=*/false,
-                                             &matrix);
-      kOutMatrix(cc).Send(std::move(matrix));
-    }
+    ASSIGN_OR_RETURN(RotatedRect roi,
+                     GetRoiAndSendTransforms(cc, size, norm_rect));
 
     // Lazy initialization of the GPU or CPU converter.
     MP_RETURN_IF_ERROR(InitConverterIfNecessary(cc, image->UsesGpu()));
@@ -240,6 +239,50 @@ class ImageToTensorCalculator : public Node {
   }
 
  private:
+  absl::Status ProcessYuvImage(
+      CalculatorContext* cc,
+      const absl::optional<mediapipe::NormalizedRect>& norm_rect) {
+    const auto& image = kIn(cc).Get<mediapipe::YUVImage>();
+    const Size size{image.width(), image.height()};
+    ASSIGN_OR_RETURN(RotatedRect roi,
+                     GetRoiAndSendTransforms(cc, size, norm_rect));
+    if (!yuv_converter_) {
+      yuv_converter_ =
+          std::make_unique<YuvImageToTensorConverter>(GetBorderMode());
+    }
+    ASSIGN_OR_RETURN(Tensor tensor,
+                     yuv_converter_->Convert(image, roi,
+                                             {output_width_, output_height_},
+                                             range_min_, range_max_));
+
+    auto result = std::make_unique<std::vector<Tensor>>();
+    result->push_back(std::move(tensor));
+    kOutTensors(cc).Send(std::move(result));
+    return absl::OkStatus();
+  }
+
+  // Computes the ROI to extract from an image of the given size, and sends
+  // the letterbox padding and transformation matrix if requested.
+  absl::StatusOr<RotatedRect> GetRoiAndSendTransforms(
+      CalculatorContext* cc, const Size& size,
+      const absl::optional<mediapipe::NormalizedRect>& norm_rect) {
+    RotatedRect roi = GetRoi(size.width, size.height, norm_rect);
+    ASSIGN_OR_RETURN(auto padding, PadRoi(options_.output_tensor_width(),
+                                          options_.output_tensor_height(),
+                                          options_.keep_aspect_ratio(), &roi));
+    if (kOutLetterboxPadding(cc).IsConnected()) {
+      kOutLetterboxPadding(cc).Send(padding);
+    }
+    if (kOutMatrix(cc).IsConnected()) {
+      std::array<float, 16> matrix;
+      GetRotatedSubRectToRectTransformMatrix(roi, size.width, size.height,
+                                             /*flip_horizontaly=*/false,
+                                             &matrix);
+      kOutMatrix(cc).Send(std::move(matrix));
+    }
+    return roi;
+  }
+
   bool DoesGpuInputStartAtBottom() {
     return options_.gpu_origin() != mediapipe::GpuOrigin_Mode_TOP_LEFT;
   }
@@ -262,13 +305,20 @@ class ImageToTensorCalculator : public Node {
     if (kIn(cc).IsConnected()) {
       const auto& packet = kIn(cc).packet();
       return kIn(cc).Visit(
-          [&packet](const mediapipe::Image&) {
+          [&packet](const mediapipe::Image&)
+              -> absl::StatusOr<std::shared_ptr<const mediapipe::Image>> {
             return SharedPtrWithPacket<mediapipe::Image>(packet);
           },
-          [&packet](const mediapipe::ImageFrame&) {
+          [&packet](const mediapipe::ImageFrame&)
+              -> absl::StatusOr<std::shared_ptr<const mediapipe::Image>> {
             return std::make_shared<const mediapipe::Image>(
                 std::const_pointer_cast<mediapipe::ImageFrame>(
                     SharedPtrWithPacket<mediapipe::ImageFrame>(packet)));
+          },
+          [](const mediapipe::YUVImage&)
+              -> absl::StatusOr<std::shared_ptr<const mediapipe::Image>> {
+            return absl::InvalidArgumentError(
+                "YUVImage input is converted by ProcessYuvImage.");
           });
     } else {  // if (kInGpu(cc).IsConnected())
 #if !MEDIAPIPE_DISABLE_GPU
@@ -318,6 +368,7 @@ class ImageToTensorCalculator : public Node {
 
   std::unique_ptr<ImageToTensorConverter> gpu_converter_;
   std::unique_ptr<ImageToTensorConverter> cpu_converter_;
+  std::unique_ptr<YuvImageToTensorConverter> yuv_converter_;
   mediapipe::ImageToTensorCalculatorOptions options_;
   int output_width_ = 0;
   int output_height_ = 0;
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -29,6 +30,7 @@
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
@@ -433,5 +435,34 @@ TEST(ImageToTensorCalculatorTest, NoOpExceptRangeBorderZero) {
           BorderMode::kZero, roi);
 }
 
+TEST(ImageToTensorCalculatorTest, YuvImageInput) {
+  // A gray I420 image: luma 126 with neutral chroma is RGB 128 in BT.601
+  // limited range.
+  constexpr int kWidth = 64;
+  constexpr int kHeight = 48;
+  auto y_data = absl::make_unique<uint8[]>(kWidth * kHeight);
+  auto u_data = absl::make_unique<uint8[]>(kWidth * kHeight / 4);
+  auto v_data = absl::make_unique<uint8[]>(kWidth * kHeight / 4);
+  std::fill_n(y_data.get(), kWidth * kHeight, 126);
+  std::fill_n(u_data.get(), kWidth * kHeight / 4, 128);
+  std::fill_n(v_data.get(), kWidth * kHeight / 4, 128);
+  auto input = absl::make_unique<YUVImage>(
+      libyuv::FOURCC_I420, std::move(y_data), kWidth, std::move(u_data),
+      kWidth / 2, std::move(v_data), kWidth / 2, kWidth, kHeight);
+
+  mediapipe::NormalizedRect roi;
+  roi.set_x_center(0.5f);
+  roi.set_y_center(0.5f);
+  roi.set_width(0.5f);
+  roi.set_height(0.5f);
+  roi.set_rotation(M_PI / 6);
+  RunTestWithInputImagePacket(
+      Adopt(input.release()).At(Timestamp(0)),
+      cv::Mat(32, 32, CV_8UC3, cv::Scalar(128, 128, 128)),
+      /*range_min=*/-1.0f, /*range_max=*/1.0f,
+      /*tensor_width=*/32, /*tensor_height=*/32, /*keep_aspect=*/false,
+      BorderMode::kReplicate, roi);
+}
+
 }  // namespace
 }  // namespace mediapipe
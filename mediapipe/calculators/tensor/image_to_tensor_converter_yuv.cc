@@ -0,0 +1,248 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_yuv.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "absl/strings/str_cat.h"
+#include "libyuv/video_common.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+
+namespace {
+
+// A plane of 8-bit samples, step bytes apart within a row.
+struct Plane {
+  const uint8* data;
+  int stride;
+  int step;
+  int width;
+  int height;
+};
+
+// Bilinearly samples plane at (x, y), where sample centers lie at integer
+// coordinates. Taps outside the plane are clamped to its border if replicate
+// is set, and skipped otherwise; weight receives the total weight of the taps
+// used.
+inline float Sample(const Plane& plane, float x, float y, bool replicate,
+                    float* weight) {
+  const float x_floor = std::floor(x);
+  const float y_floor = std::floor(y);
+  const int x0 = static_cast<int>(x_floor);
+  const int y0 = static_cast<int>(y_floor);
+  const float fx = x - x_floor;
+  const float fy = y - y_floor;
+  const bool inside = x0 >= 0 && y0 >= 0 && x0 + 1 < plane.width &&
+                      y0 + 1 < plane.height;
+  if (inside) {
+    const uint8* row0 = plane.data + y0 * plane.stride + x0 * plane.step;
+    const uint8* row1 = row0 + plane.stride;
+    const float top = row0[0] + fx * (row0[plane.step] - row0[0]);
+    const float bottom = row1[0] + fx * (row1[plane.step] - row1[0]);
+    *weight = 1.0f;
+    return top + fy * (bottom - top);
+  }
+
+  const int xs[2] = {x0, x0 + 1};
+  const int ys[2] = {y0, y0 + 1};
+  const float wxs[2] = {1.0f - fx, fx};
+  const float wys[2] = {1.0f - fy, fy};
+  float sum = 0.0f;
+  *weight = 0.0f;
+  for (int j = 0; j < 2; ++j) {
+    int y_tap = ys[j];
+    if (y_tap < 0 || y_tap >= plane.height) {
+      if (!replicate) continue;
+      y_tap = std::min(std::max(y_tap, 0), plane.height - 1);
+    }
+    for (int i = 0; i < 2; ++i) {
+      int x_tap = xs[i];
+      if (x_tap < 0 || x_tap >= plane.width) {
+        if (!replicate) continue;
+        x_tap = std::min(std::max(x_tap, 0), plane.width - 1);
+      }
+      const float w = wxs[i] * wys[j];
+      sum += w * plane.data[y_tap * plane.stride + x_tap * plane.step];
+      *weight += w;
+    }
+  }
+  return sum;
+}
+
+// Coefficients of the YUV to RGB conversion:
+//   R = y_scale * (Y - y_offset) + r_v * (V - 128)
+//   G = y_scale * (Y - y_offset) - g_u * (U - 128) - g_v * (V - 128)
+//   B = y_scale * (Y - y_offset) + b_u * (U - 128)
+struct YuvToRgbCoefficients {
+  float y_scale;
+  float y_offset;
+  float r_v;
+  float g_u;
+  float g_v;
+  float b_u;
+};
+
+YuvToRgbCoefficients GetYuvToRgbCoefficients(const YUVImage& image) {
+  float kr;
+  float kb;
+  switch (image.matrix_coefficients()) {
+    case YUVImage::COLOR_MATRIX_COEFFICIENTS_BT709:
+      kr = 0.2126f;
+      kb = 0.0722f;
+      break;
+    case YUVImage::COLOR_MATRIX_COEFFICIENTS_BT2020_NCL:
+    case YUVImage::COLOR_MATRIX_COEFFICIENTS_BT2020_CL:
+      kr = 0.2627f;
+      kb = 0.0593f;
+      break;
+    case YUVImage::COLOR_MATRIX_COEFFICIENTS_SMPTE240M:
+      kr = 0.212f;
+      kb = 0.087f;
+      break;
+    default:
+      // BT.601.
+      kr = 0.299f;
+      kb = 0.114f;
+      break;
+  }
+  const float kg = 1.0f - kr - kb;
+  const float c_scale = image.full_range() ? 1.0f : 255.0f / 224.0f;
+  YuvToRgbCoefficients coeffs;
+  coeffs.y_scale = image.full_range() ? 1.0f : 255.0f / 219.0f;
+  coeffs.y_offset = image.full_range() ? 0.0f : 16.0f;
+  coeffs.r_v = c_scale * 2.0f * (1.0f - kr);
+  coeffs.b_u = c_scale * 2.0f * (1.0f - kb);
+  coeffs.g_u = c_scale * 2.0f * (1.0f - kb) * kb / kg;
+  coeffs.g_v = c_scale * 2.0f * (1.0f - kr) * kr / kg;
+  return coeffs;
+}
+
+}  // namespace
+
+absl::StatusOr<Tensor> YuvImageToTensorConverter::Convert(
+    const YUVImage& input, const RotatedRect& roi, const Size& output_dims,
+    float range_min, float range_max) {
+  RET_CHECK_EQ(input.bit_depth(), 8) << "Only 8-bit YUVImages are supported.";
+  const int chroma_width = (input.width() + 1) / 2;
+  const int chroma_height = (input.height() + 1) / 2;
+  const Plane y_plane = {input.data(0), input.stride(0), 1, input.width(),
+                         input.height()};
+  Plane u_plane;
+  Plane v_plane;
+  switch (input.fourcc()) {
+    case libyuv::FOURCC_I420:
+      u_plane = {input.data(1), input.stride(1), 1, chroma_width,
+                 chroma_height};
+      v_plane = {input.data(2), input.stride(2), 1, chroma_width,
+                 chroma_height};
+      break;
+    case libyuv::FOURCC_NV12:
+      u_plane = {input.data(1), input.stride(1), 2, chroma_width,
+                 chroma_height};
+      v_plane = {input.data(1) + 1, input.stride(1), 2, chroma_width,
+                 chroma_height};
+      break;
+    case libyuv::FOURCC_NV21:
+      v_plane = {input.data(1), input.stride(1), 2, chroma_width,
+                 chroma_height};
+      u_plane = {input.data(1) + 1, input.stride(1), 2, chroma_width,
+                 chroma_height};
+      break;
+    default:
+      return InvalidArgumentError(
+          absl::StrCat("Only I420, NV12 and NV21 YUVImages are supported, "
+                       "passed fourcc: ",
+                       static_cast<uint32_t>(input.fourcc())));
+  }
+
+  constexpr float kInputImageRangeMin = 0.0f;
+  constexpr float kInputImageRangeMax = 255.0f;
+  ASSIGN_OR_RETURN(
+      auto transform,
+      GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
+                                  range_min, range_max));
+  const YuvToRgbCoefficients coeffs = GetYuvToRgbCoefficients(input);
+  const bool replicate = border_mode_ == BorderMode::kReplicate;
+
+  // Output pixel (x, y) samples the image at
+  //   top_left + x * x_step + y * y_step,
+  // which maps the corners of the output onto the corners of the ROI, as
+  // cv::warpPerspective does with the ROI's box points in the OpenCV
+  // converter.
+  const float cos_r = std::cos(roi.rotation);
+  const float sin_r = std::sin(roi.rotation);
+  const float x_step_x = roi.width / output_dims.width * cos_r;
+  const float x_step_y = roi.width / output_dims.width * sin_r;
+  const float y_step_x = -roi.height / output_dims.height * sin_r;
+  const float y_step_y = roi.height / output_dims.height * cos_r;
+  const float top_left_x =
+      roi.center_x - 0.5f * roi.width * cos_r + 0.5f * roi.height * sin_r;
+  const float top_left_y =
+      roi.center_y - 0.5f * roi.width * sin_r - 0.5f * roi.height * cos_r;
+
+  constexpr int kNumChannels = 3;
+  Tensor tensor(
+      Tensor::ElementType::kFloat32,
+      Tensor::Shape{1, output_dims.height, output_dims.width, kNumChannels});
+  {
+    auto buffer_view = tensor.GetCpuWriteView();
+    float* output = buffer_view.buffer<float>();
+    for (int y = 0; y < output_dims.height; ++y) {
+      float src_x = top_left_x + y * y_step_x;
+      float src_y = top_left_y + y * y_step_y;
+      for (int x = 0; x < output_dims.width; ++x) {
+        // Chroma samples are centered between 2x2 luma samples.
+        const float chroma_x = 0.5f * src_x - 0.25f;
+        const float chroma_y = 0.5f * src_y - 0.25f;
+        float y_weight;
+        float u_weight;
+        float v_weight;
+        const float luma = Sample(y_plane, src_x, src_y, replicate, &y_weight);
+        const float u = Sample(u_plane, chroma_x, chroma_y, replicate,
+                               &u_weight);
+        const float v = Sample(v_plane, chroma_x, chroma_y, replicate,
+                               &v_weight);
+        // With zero border, taps outside the image are black in RGB, so each
+        // plane's offset only applies to the weight of the taps inside.
+        const float yy = coeffs.y_scale * (luma - coeffs.y_offset * y_weight);
+        const float uu = u - 128.0f * u_weight;
+        const float vv = v - 128.0f * v_weight;
+        const float r = yy + coeffs.r_v * vv;
+        const float g = yy - coeffs.g_u * uu - coeffs.g_v * vv;
+        const float b = yy + coeffs.b_u * uu;
+        output[0] =
+            std::min(std::max(r, 0.0f), 255.0f) * transform.scale +
+            transform.offset;
+        output[1] =
+            std::min(std::max(g, 0.0f), 255.0f) * transform.scale +
+            transform.offset;
+        output[2] =
+            std::min(std::max(b, 0.0f), 255.0f) * transform.scale +
+            transform.offset;
+        output += kNumChannels;
+        src_x += x_step_x;
+        src_y += x_step_y;
+      }
+    }
+  }
+  return tensor;
+}
+
+}  // namespace mediapipe
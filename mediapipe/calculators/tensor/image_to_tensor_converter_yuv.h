@@ -0,0 +1,49 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_YUV_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_YUV_H_
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+// Converts 8-bit 4:2:0 YUVImages (I420, NV12 or NV21) to RGB tensors.
+//
+// Unlike converting the whole image to RGB first, only the pixels covered by
+// the ROI are read: each output pixel is bilinearly sampled from the luma and
+// chroma planes, converted to RGB with the matrix coefficients and range of
+// the image (BT.601 if unspecified), and normalized, in a single pass over the
+// output tensor. The ROI is mapped to the tensor like in the OpenCV converter.
+class YuvImageToTensorConverter {
+ public:
+  explicit YuvImageToTensorConverter(BorderMode border_mode)
+      : border_mode_(border_mode) {}
+
+  // Same semantics as ImageToTensorConverter::Convert.
+  absl::StatusOr<Tensor> Convert(const YUVImage& input, const RotatedRect& roi,
+                                 const Size& output_dims, float range_min,
+                                 float range_max);
+
+ private:
+  BorderMode border_mode_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_YUV_H_
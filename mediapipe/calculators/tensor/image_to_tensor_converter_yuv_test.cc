@@ -0,0 +1,141 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_yuv.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "libyuv/video_common.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Returns an I420 image whose luma increases by one per column, starting at
+// 16, with constant chroma.
+std::unique_ptr<YUVImage> MakeI420Image(int width, int height, uint8 u,
+                                        uint8 v) {
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  auto y_data = absl::make_unique<uint8[]>(width * height);
+  for (int row = 0; row < height; ++row) {
+    for (int col = 0; col < width; ++col) {
+      y_data[row * width + col] = 16 + col;
+    }
+  }
+  auto u_data = absl::make_unique<uint8[]>(chroma_width * chroma_height);
+  auto v_data = absl::make_unique<uint8[]>(chroma_width * chroma_height);
+  std::memset(u_data.get(), u, chroma_width * chroma_height);
+  std::memset(v_data.get(), v, chroma_width * chroma_height);
+  return absl::make_unique<YUVImage>(
+      libyuv::FOURCC_I420, std::move(y_data), width, std::move(u_data),
+      chroma_width, std::move(v_data), chroma_width, width, height);
+}
+
+// Returns the RGB values of output pixel (x, y).
+const float* Pixel(const Tensor::CpuReadView& view, int width, int x, int y) {
+  return view.buffer<float>() + (y * width + x) * 3;
+}
+
+TEST(YuvImageToTensorConverterTest, ConvertsGrayRoi) {
+  auto image = MakeI420Image(64, 32, 128, 128);
+  // The central 16x8 pixels, i.e. luma 40 to 55.
+  RotatedRect roi = {/*center_x=*/32.0f, /*center_y=*/16.0f, /*width=*/16.0f,
+                     /*height=*/8.0f, /*rotation=*/0.0f};
+  YuvImageToTensorConverter converter(BorderMode::kReplicate);
+  auto tensor_or = converter.Convert(*image, roi, {16, 8}, 0.0f, 255.0f);
+  MP_ASSERT_OK(tensor_or.status());
+  const Tensor& tensor = tensor_or.value();
+  EXPECT_EQ(tensor.shape().dims, std::vector<int>({1, 8, 16, 3}));
+
+  auto view = tensor.GetCpuReadView();
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 16; ++x) {
+      const float expected = (40 + x - 16) * 255.0f / 219.0f;
+      const float* rgb = Pixel(view, 16, x, y);
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_NEAR(rgb[c], expected, 1e-3f) << x << "," << y << "," << c;
+      }
+    }
+  }
+}
+
+TEST(YuvImageToTensorConverterTest, ConvertsChromaAndRange) {
+  // Limited range BT.601 red.
+  auto image = MakeI420Image(8, 8, 90, 240);
+  RotatedRect roi = {4.0f, 4.0f, 8.0f, 8.0f, 0.0f};
+  YuvImageToTensorConverter converter(BorderMode::kReplicate);
+  auto tensor_or = converter.Convert(*image, roi, {8, 8}, -1.0f, 1.0f);
+  MP_ASSERT_OK(tensor_or.status());
+  auto view = tensor_or.value().GetCpuReadView();
+  // Column 4 has luma 20; green and blue clamp to the bottom of the range.
+  const float* rgb = Pixel(view, 8, 4, 4);
+  EXPECT_GT(rgb[0], rgb[1]);
+  EXPECT_GT(rgb[0], rgb[2]);
+  EXPECT_NEAR(rgb[1], -1.0f, 1e-3f);
+  for (int c = 0; c < 3; ++c) {
+    EXPECT_GE(rgb[c], -1.0f);
+    EXPECT_LE(rgb[c], 1.0f);
+  }
+}
+
+TEST(YuvImageToTensorConverterTest, RotatesRoi) {
+  auto image = MakeI420Image(32, 32, 128, 128);
+  // Rotated by 90 degrees, output rows run along image columns, from right to
+  // left.
+  RotatedRect roi = {16.0f, 16.0f, 8.0f, 8.0f, static_cast<float>(M_PI / 2)};
+  YuvImageToTensorConverter converter(BorderMode::kReplicate);
+  auto tensor_or = converter.Convert(*image, roi, {8, 8}, 0.0f, 255.0f);
+  MP_ASSERT_OK(tensor_or.status());
+  auto view = tensor_or.value().GetCpuReadView();
+  for (int y = 1; y < 8; ++y) {
+    EXPECT_NEAR(Pixel(view, 8, 3, y)[0] - Pixel(view, 8, 3, y - 1)[0],
+                -255.0f / 219.0f, 1e-3f);
+    EXPECT_NEAR(Pixel(view, 8, 3, y)[0], Pixel(view, 8, 5, y)[0], 1e-3f);
+  }
+}
+
+TEST(YuvImageToTensorConverterTest, ZeroBorderIsBlack) {
+  auto image = MakeI420Image(16, 16, 60, 200);
+  // The left half of the ROI lies outside of the image.
+  RotatedRect roi = {0.0f, 8.0f, 16.0f, 16.0f, 0.0f};
+  YuvImageToTensorConverter converter(BorderMode::kZero);
+  auto tensor_or = converter.Convert(*image, roi, {16, 16}, 0.0f, 1.0f);
+  MP_ASSERT_OK(tensor_or.status());
+  auto view = tensor_or.value().GetCpuReadView();
+  for (int x = 0; x < 7; ++x) {
+    for (int c = 0; c < 3; ++c) {
+      EXPECT_EQ(Pixel(view, 16, x, 8)[c], 0.0f);
+    }
+  }
+  EXPECT_GT(Pixel(view, 16, 12, 8)[0], 0.0f);
+}
+
+TEST(YuvImageToTensorConverterTest, RejectsUnsupportedFormats) {
+  auto image = MakeI420Image(8, 8, 128, 128);
+  image->set_fourcc(libyuv::FOURCC_ANY);
+  YuvImageToTensorConverter converter(BorderMode::kReplicate);
+  EXPECT_FALSE(converter
+                   .Convert(*image, {4.0f, 4.0f, 8.0f, 8.0f, 0.0f}, {8, 8},
+                            0.0f, 1.0f)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
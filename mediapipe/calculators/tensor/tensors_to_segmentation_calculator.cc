@@ -17,13 +17,14 @@
 #include "absl/strings/str_format.h"
 #include "absl/types/span.h"
 #include "mediapipe/calculators/tensor/tensors_to_segmentation_calculator.pb.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_utils.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image.h"
-#include "mediapipe/framework/formats/image_opencv.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
 #include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/port.h"
-#include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/statusor.h"
 #include "mediapipe/gpu/gpu_origin.pb.h"
@@ -108,7 +109,10 @@ using ::tflite::gpu::gl::GlShader;
 // mask are both on CPU.
 //
 // On GPU, the mask is an RGBA image, in both the R & A channels, scaled 0-1.
-// On CPU, the mask is a ImageFormat::VEC32F1 image, with values scaled 0-1.
+// On CPU, the mask is a ImageFormat::VEC32F1 image, with values scaled 0-1, or
+// a ImageFormat::GRAY8 image scaled 0-255 if cpu_mask_format is GRAY8. The
+// activation and upscaling are fused into a single pass writing the output
+// mask, which is drawn from the graph's ImageFrame pool if one is provided.
 //
 //
 // Inputs:
@@ -119,7 +123,7 @@ using ::tflite::gpu::gl::GlShader;
 //                          If provided, the size to upscale mask to.
 //
 // Output:
-//   MASK: An Image output mask, RGBA(GPU) / VEC32F1(CPU).
+//   MASK: An Image output mask, RGBA(GPU) / VEC32F1 or GRAY8(CPU).
 //
 // Options:
 //   See tensors_to_segmentation_calculator.proto
@@ -160,10 +164,9 @@ class TensorsToSegmentationCalculator : public CalculatorBase {
     return options_.gpu_origin() != mediapipe::GpuOrigin_Mode_TOP_LEFT;
   }
 
-  template <class T>
-  absl::Status ApplyActivation(cv::Mat& tensor_mat, cv::Mat* small_mask_mat);
-
   ::mediapipe::TensorsToSegmentationCalculatorOptions options_;
+  // Pool for CPU output masks, null if the graph provides none.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
 
 #if !MEDIAPIPE_DISABLE_GPU
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -196,6 +199,8 @@ absl::Status TensorsToSegmentationCalculator::GetContract(
   // Outputs.
   cc->Outputs().Tag(kMaskTag).Set<Image>();
 
+  cc->UseService(kImageFramePoolService).Optional();
+
   if (CanUseGpu()) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
@@ -225,6 +230,11 @@ absl::Status TensorsToSegmentationCalculator::Open(CalculatorContext* cc) {
 
   MP_RETURN_IF_ERROR(LoadOptions(cc));
 
+  auto frame_pool_service = cc->Service(kImageFramePoolService);
+  if (frame_pool_service.IsAvailable()) {
+    frame_pool_ = &frame_pool_service.GetObject();
+  }
+
   if (use_gpu) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(InitGpu(cc));
@@ -325,93 +335,27 @@ absl::Status TensorsToSegmentationCalculator::ProcessCpu(
     output_height = size.second;
   }
 
-  // Create initial working mask.
-  cv::Mat small_mask_mat(cv::Size(tensor_width, tensor_height), CV_32FC1);
-
-  // Wrap input tensor.
-  auto raw_input_tensor = &input_tensors[0];
-  auto raw_input_view = raw_input_tensor->GetCpuReadView();
-  const float* raw_input_data = raw_input_view.buffer<float>();
-  cv::Mat tensor_mat(cv::Size(tensor_width, tensor_height),
-                     CV_MAKETYPE(CV_32F, tensor_channels),
-                     const_cast<float*>(raw_input_data));
-
-  // Process mask tensor and apply activation function.
-  if (tensor_channels == 2) {
-    MP_RETURN_IF_ERROR(ApplyActivation<cv::Vec2f>(tensor_mat, &small_mask_mat));
-  } else if (tensor_channels == 1) {
-    RET_CHECK(mediapipe::TensorsToSegmentationCalculatorOptions::SOFTMAX !=
-              options_.activation());  // Requires 2 channels.
-    if (mediapipe::TensorsToSegmentationCalculatorOptions::NONE ==
-        options_.activation())  // Pass-through optimization.
-      tensor_mat.copyTo(small_mask_mat);
-    else
-      MP_RETURN_IF_ERROR(ApplyActivation<float>(tensor_mat, &small_mask_mat));
-  } else {
-    RET_CHECK_FAIL() << "Unsupported number of tensor channels "
-                     << tensor_channels;
-  }
+  // Activate and upsample the tensor straight into the output mask.
+  auto raw_input_view = input_tensors[0].GetCpuReadView();
+  const ImageFormat::Format mask_format =
+      options_.cpu_mask_format() ==
+              mediapipe::TensorsToSegmentationCalculatorOptions::GRAY8
+          ? ImageFormat::GRAY8
+          : ImageFormat::VEC32F1;
+  std::shared_ptr<ImageFrame> mask_frame = AcquireImageFrame(
+      frame_pool_, mask_format, output_width, output_height);
+  MP_RETURN_IF_ERROR(ActivateAndResizeSegmentation(
+      raw_input_view.buffer<float>(), tensor_width, tensor_height,
+      tensor_channels, options_.activation(), options_.output_layer_index(),
+      mask_frame.get()));
 
   // Send out image as CPU packet.
-  std::shared_ptr<ImageFrame> mask_frame = std::make_shared<ImageFrame>(
-      ImageFormat::VEC32F1, output_width, output_height);
   std::unique_ptr<Image> output_mask = absl::make_unique<Image>(mask_frame);
-  cv::Mat output_mat = formats::MatView(output_mask.get());
-  // Upsample small mask into output.
-  cv::resize(small_mask_mat, output_mat, cv::Size(output_width, output_height));
   cc->Outputs().Tag(kMaskTag).Add(output_mask.release(), cc->InputTimestamp());
 
   return absl::OkStatus();
 }
 
-template <class T>
-absl::Status TensorsToSegmentationCalculator::ApplyActivation(
-    cv::Mat& tensor_mat, cv::Mat* small_mask_mat) {
-  // Configure activation function.
-  const int output_layer_index = options_.output_layer_index();
-  typedef mediapipe::TensorsToSegmentationCalculatorOptions Options;
-  const auto activation_fn = [&](const cv::Vec2f& mask_value) {
-    float new_mask_value = 0;
-    // TODO consider moving switch out of the loop,
-    // and also avoid float/Vec2f casting.
-    switch (options_.activation()) {
-      case Options::NONE: {
-        new_mask_value = mask_value[0];
-        break;
-      }
-      case Options::SIGMOID: {
-        const float pixel0 = mask_value[0];
-        new_mask_value = 1.0 / (std::exp(-pixel0) + 1.0);
-        break;
-      }
-      case Options::SOFTMAX: {
-        const float pixel0 = mask_value[0];
-        const float pixel1 = mask_value[1];
-        const float max_pixel = std::max(pixel0, pixel1);
-        const float min_pixel = std::min(pixel0, pixel1);
-        const float softmax_denom =
-            /*exp(max_pixel - max_pixel)=*/1.0f +
-            std::exp(min_pixel - max_pixel);
-        new_mask_value = std::exp(mask_value[output_layer_index] - max_pixel) /
-                         softmax_denom;
-        break;
-      }
-    }
-    return new_mask_value;
-  };
-
-  // Process mask tensor.
-  for (int i = 0; i < tensor_mat.rows; ++i) {
-    for (int j = 0; j < tensor_mat.cols; ++j) {
-      const T& input_pix = tensor_mat.at<T>(i, j);
-      const float mask_value = activation_fn(input_pix);
-      small_mask_mat->at<float>(i, j) = mask_value;
-    }
-  }
-
-  return absl::OkStatus();
-}
-
 // Steps:
 // 1. receive tensor
 // 2. process segmentation tensor into small mask
@@ -0,0 +1,187 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+
+namespace {
+
+using Options = TensorsToSegmentationCalculatorOptions;
+
+// Bilinear taps along one axis: output position i interpolates source
+// positions index[i] and index[i] + 1 with weight[i] on the latter. index[i]
+// + 1 may equal the source size, in which case weight[i] is zero.
+struct Taps {
+  std::vector<int> index;
+  std::vector<float> weight;
+};
+
+// Same sample positions as cv::resize with INTER_LINEAR.
+Taps ComputeTaps(int src_size, int dst_size) {
+  Taps taps;
+  taps.index.resize(dst_size);
+  taps.weight.resize(dst_size);
+  const float scale = static_cast<float>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; ++i) {
+    const float pos = (i + 0.5f) * scale - 0.5f;
+    int index = static_cast<int>(std::floor(pos));
+    float weight = pos - index;
+    if (index < 0) {
+      index = 0;
+      weight = 0.0f;
+    }
+    if (index >= src_size - 1) {
+      index = src_size - 1;
+      weight = 0.0f;
+    }
+    taps.index[i] = index;
+    taps.weight[i] = weight;
+  }
+  return taps;
+}
+
+// Activates one tensor row of width pixels of channels interleaved channels
+// into out. NONE and SIGMOID read the first channel.
+void ActivateRow(const float* in, int width, int channels,
+                 Options::Activation activation, int output_layer_index,
+                 float* out) {
+  switch (activation) {
+    case Options::NONE:
+      if (channels == 1) {
+        std::copy(in, in + width, out);
+      } else {
+        for (int i = 0; i < width; ++i) {
+          out[i] = in[channels * i];
+        }
+      }
+      break;
+    case Options::SIGMOID:
+      for (int i = 0; i < width; ++i) {
+        out[i] = 1.0f / (1.0f + std::exp(-in[channels * i]));
+      }
+      break;
+    case Options::SOFTMAX: {
+      // For two channels, softmax reduces to a sigmoid of their difference.
+      const float* selected = in + output_layer_index;
+      const float* other = in + (1 - output_layer_index);
+      for (int i = 0; i < width; ++i) {
+        out[i] = 1.0f / (1.0f + std::exp(other[2 * i] - selected[2 * i]));
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+absl::Status ActivateAndResizeSegmentation(
+    const float* tensor_data, int tensor_width, int tensor_height,
+    int tensor_channels, Options::Activation activation,
+    int output_layer_index, ImageFrame* mask) {
+  RET_CHECK(mask);
+  RET_CHECK(mask->Format() == ImageFormat::VEC32F1 ||
+            mask->Format() == ImageFormat::GRAY8)
+      << "Unsupported mask format " << mask->Format();
+  RET_CHECK_GT(tensor_width, 0);
+  RET_CHECK_GT(tensor_height, 0);
+  RET_CHECK(activation == Options::SOFTMAX
+                ? tensor_channels == 2
+                : tensor_channels == 1 || tensor_channels == 2)
+      << "Unsupported number of tensor channels " << tensor_channels
+      << " for activation " << Options::Activation_Name(activation);
+  if (activation == Options::SOFTMAX) {
+    RET_CHECK(output_layer_index == 0 || output_layer_index == 1)
+        << "Invalid output_layer_index " << output_layer_index;
+  }
+
+  const int output_width = mask->Width();
+  const int output_height = mask->Height();
+  const Taps x_taps = ComputeTaps(tensor_width, output_width);
+  const Taps y_taps = ComputeTaps(tensor_height, output_height);
+
+  // The two activated tensor rows the current output row interpolates, each
+  // padded with one element so that index + 1 is always readable.
+  std::vector<float> top_row(tensor_width + 1, 0.0f);
+  std::vector<float> bottom_row(tensor_width + 1, 0.0f);
+  int top_index = -1;
+  int bottom_index = -1;
+  const auto activate = [&](int row, std::vector<float>* out) {
+    ActivateRow(tensor_data + row * tensor_width * tensor_channels,
+                tensor_width, tensor_channels, activation, output_layer_index,
+                out->data());
+    (*out)[tensor_width] = (*out)[tensor_width - 1];
+  };
+  std::vector<float> blended_row(tensor_width + 1);
+  // Float masks are written in place, 8-bit masks are converted from a
+  // scratch row.
+  const bool float_mask = mask->Format() == ImageFormat::VEC32F1;
+  std::vector<float> output_row(float_mask ? 0 : output_width);
+
+  for (int y = 0; y < output_height; ++y) {
+    const int y0 = y_taps.index[y];
+    const int y1 = std::min(y0 + 1, tensor_height - 1);
+    // Output rows visit tensor rows in increasing order, so the previous
+    // bottom row usually becomes the new top row.
+    if (top_index != y0) {
+      if (bottom_index == y0) {
+        std::swap(top_row, bottom_row);
+        std::swap(top_index, bottom_index);
+      } else {
+        activate(y0, &top_row);
+        top_index = y0;
+      }
+    }
+    if (bottom_index != y1) {
+      activate(y1, &bottom_row);
+      bottom_index = y1;
+    }
+
+    const float wy = y_taps.weight[y];
+    const float* top = top_row.data();
+    const float* bottom = bottom_row.data();
+    float* blended = blended_row.data();
+    for (int x = 0; x <= tensor_width; ++x) {
+      blended[x] = top[x] + wy * (bottom[x] - top[x]);
+    }
+    const int* x0 = x_taps.index.data();
+    const float* wx = x_taps.weight.data();
+    uint8* dst = mask->MutablePixelData() + y * mask->WidthStep();
+    float* out =
+        float_mask ? reinterpret_cast<float*>(dst) : output_row.data();
+    for (int x = 0; x < output_width; ++x) {
+      const float left = blended[x0[x]];
+      const float right = blended[x0[x] + 1];
+      out[x] = left + wx[x] * (right - left);
+    }
+
+    if (!float_mask) {
+      for (int x = 0; x < output_width; ++x) {
+        const float value = std::min(std::max(out[x], 0.0f), 1.0f);
+        dst[x] = static_cast<uint8>(value * 255.0f + 0.5f);
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,47 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_UTILS_H_
+
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_calculator.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+// Applies activation to a segmentation tensor of tensor_height x tensor_width
+// x tensor_channels floats, and bilinearly resizes the result to the size of
+// mask, which must be a VEC32F1 or GRAY8 frame. GRAY8 masks hold the
+// activated values scaled to [0, 255].
+//
+// Both steps happen in a single pass over the output: each tensor row is
+// activated at most once, when the first output row interpolating it is
+// produced, and output rows are interpolated from the two activated tensor
+// rows around them with precomputed horizontal taps. Sample positions match
+// cv::resize with INTER_LINEAR. The inner loops are plain loops over
+// contiguous floats, which compilers vectorize.
+//
+// SIGMOID and NONE take one or two channels and activate the first one.
+// SOFTMAX requires two channels and yields the probability of channel
+// output_layer_index.
+absl::Status ActivateAndResizeSegmentation(
+    const float* tensor_data, int tensor_width, int tensor_height,
+    int tensor_channels,
+    TensorsToSegmentationCalculatorOptions::Activation activation,
+    int output_layer_index, ImageFrame* mask);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_UTILS_H_
@@ -0,0 +1,180 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using Options = TensorsToSegmentationCalculatorOptions;
+
+// Returns a tensor of width x height x channels logits in [-4, 4].
+std::vector<float> MakeTensor(int width, int height, int channels) {
+  std::vector<float> tensor(width * height * channels);
+  for (int i = 0; i < tensor.size(); ++i) {
+    tensor[i] = 4.0f * std::sin(0.37f * i);
+  }
+  return tensor;
+}
+
+float Sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+// Reference bilinear resize with cv::resize INTER_LINEAR sample positions.
+float ResizeAt(const std::vector<float>& src, int src_width, int src_height,
+               int dst_width, int dst_height, int x, int y) {
+  const auto source_position = [](int i, int src_size, int dst_size) {
+    const float pos = (i + 0.5f) * src_size / dst_size - 0.5f;
+    return std::min(std::max(pos, 0.0f), src_size - 1.0f);
+  };
+  const float sx = source_position(x, src_width, dst_width);
+  const float sy = source_position(y, src_height, dst_height);
+  const int x0 = static_cast<int>(sx);
+  const int y0 = static_cast<int>(sy);
+  const int x1 = std::min(x0 + 1, src_width - 1);
+  const int y1 = std::min(y0 + 1, src_height - 1);
+  const float fx = sx - x0;
+  const float fy = sy - y0;
+  const auto at = [&](int xx, int yy) { return src[yy * src_width + xx]; };
+  const float top = at(x0, y0) + fx * (at(x1, y0) - at(x0, y0));
+  const float bottom = at(x0, y1) + fx * (at(x1, y1) - at(x0, y1));
+  return top + fy * (bottom - top);
+}
+
+float FloatAt(const ImageFrame& frame, int x, int y) {
+  return reinterpret_cast<const float*>(frame.PixelData() +
+                                        y * frame.WidthStep())[x];
+}
+
+TEST(TensorsToSegmentationUtilsTest, SigmoidUpsampleMatchesReference) {
+  constexpr int kWidth = 7;
+  constexpr int kHeight = 5;
+  const std::vector<float> tensor = MakeTensor(kWidth, kHeight, 1);
+  std::vector<float> activated(tensor.size());
+  std::transform(tensor.begin(), tensor.end(), activated.begin(), Sigmoid);
+
+  ImageFrame mask(ImageFormat::VEC32F1, 23, 17);
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), kWidth, kHeight,
+                                             1, Options::SIGMOID, 1, &mask));
+  for (int y = 0; y < mask.Height(); ++y) {
+    for (int x = 0; x < mask.Width(); ++x) {
+      EXPECT_NEAR(FloatAt(mask, x, y),
+                  ResizeAt(activated, kWidth, kHeight, mask.Width(),
+                           mask.Height(), x, y),
+                  1e-5f)
+          << x << "," << y;
+    }
+  }
+}
+
+TEST(TensorsToSegmentationUtilsTest, NoneWithoutResizeCopiesTensor) {
+  const std::vector<float> tensor = MakeTensor(6, 4, 1);
+  ImageFrame mask(ImageFormat::VEC32F1, 6, 4);
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), 6, 4, 1,
+                                             Options::NONE, 1, &mask));
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 6; ++x) {
+      EXPECT_EQ(FloatAt(mask, x, y), tensor[y * 6 + x]);
+    }
+  }
+}
+
+TEST(TensorsToSegmentationUtilsTest, SoftmaxSelectsOutputLayer) {
+  const std::vector<float> tensor = MakeTensor(8, 8, 2);
+  ImageFrame background(ImageFormat::VEC32F1, 8, 8);
+  ImageFrame foreground(ImageFormat::VEC32F1, 8, 8);
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), 8, 8, 2,
+                                             Options::SOFTMAX, 0, &background));
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), 8, 8, 2,
+                                             Options::SOFTMAX, 1, &foreground));
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 8; ++x) {
+      const float* logits = &tensor[(y * 8 + x) * 2];
+      const float expected =
+          std::exp(logits[1]) / (std::exp(logits[0]) + std::exp(logits[1]));
+      EXPECT_NEAR(FloatAt(foreground, x, y), expected, 1e-5f);
+      EXPECT_NEAR(FloatAt(background, x, y) + FloatAt(foreground, x, y), 1.0f,
+                  1e-5f);
+    }
+  }
+}
+
+TEST(TensorsToSegmentationUtilsTest, TwoChannelSigmoidActivatesFirstChannel) {
+  const std::vector<float> tensor = MakeTensor(5, 3, 2);
+  ImageFrame mask(ImageFormat::VEC32F1, 5, 3);
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), 5, 3, 2,
+                                             Options::SIGMOID, 1, &mask));
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      EXPECT_NEAR(FloatAt(mask, x, y), Sigmoid(tensor[(y * 5 + x) * 2]),
+                  1e-6f)
+          << x << "," << y;
+    }
+  }
+}
+
+TEST(TensorsToSegmentationUtilsTest, TwoChannelNoneCopiesFirstChannel) {
+  const std::vector<float> tensor = MakeTensor(5, 3, 2);
+  ImageFrame mask(ImageFormat::VEC32F1, 5, 3);
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), 5, 3, 2,
+                                             Options::NONE, 1, &mask));
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      EXPECT_EQ(FloatAt(mask, x, y), tensor[(y * 5 + x) * 2]);
+    }
+  }
+}
+
+TEST(TensorsToSegmentationUtilsTest, Gray8MaskMatchesFloatMask) {
+  const std::vector<float> tensor = MakeTensor(9, 6, 1);
+  ImageFrame float_mask(ImageFormat::VEC32F1, 40, 30);
+  ImageFrame gray_mask(ImageFormat::GRAY8, 40, 30);
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), 9, 6, 1,
+                                             Options::SIGMOID, 1, &float_mask));
+  MP_ASSERT_OK(ActivateAndResizeSegmentation(tensor.data(), 9, 6, 1,
+                                             Options::SIGMOID, 1, &gray_mask));
+  for (int y = 0; y < 30; ++y) {
+    const uint8* gray_row = gray_mask.PixelData() + y * gray_mask.WidthStep();
+    for (int x = 0; x < 40; ++x) {
+      EXPECT_EQ(gray_row[x], std::lround(FloatAt(float_mask, x, y) * 255.0f))
+          << x << "," << y;
+    }
+  }
+}
+
+TEST(TensorsToSegmentationUtilsTest, RejectsInvalidArguments) {
+  const std::vector<float> tensor = MakeTensor(4, 4, 3);
+  ImageFrame mask(ImageFormat::VEC32F1, 4, 4);
+  // Softmax requires two channels, sigmoid one or two.
+  EXPECT_FALSE(ActivateAndResizeSegmentation(tensor.data(), 4, 4, 1,
+                                             Options::SOFTMAX, 1, &mask)
+                   .ok());
+  EXPECT_FALSE(ActivateAndResizeSegmentation(tensor.data(), 4, 4, 3,
+                                             Options::SIGMOID, 1, &mask)
+                   .ok());
+  ImageFrame rgb_mask(ImageFormat::SRGB, 4, 4);
+  EXPECT_FALSE(ActivateAndResizeSegmentation(tensor.data(), 4, 4, 2,
+                                             Options::SOFTMAX, 1, &rgb_mask)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
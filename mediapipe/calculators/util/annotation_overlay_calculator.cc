@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <memory>
+#include <utility>
 
 #include "absl/strings/str_cat.h"
 #include "mediapipe/calculators/util/annotation_overlay_calculator.pb.h"
@@ -21,6 +22,7 @@
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/video_stream_header.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
@@ -45,6 +47,8 @@ namespace {
 constexpr char kVectorTag[] = "VECTOR";
 constexpr char kGpuBufferTag[] = "IMAGE_GPU";
 constexpr char kImageFrameTag[] = "IMAGE";
+constexpr char kOverlayTag[] = "OVERLAY";
+constexpr char kOverlayRectTag[] = "OVERLAY_RECT";
 
 enum { ATTRIB_VERTEX, ATTRIB_TEXTURE_POSITION, NUM_ATTRIBUTES };
 
@@ -58,6 +62,12 @@ constexpr uchar kAnnotationBackgroundColor = 2;  // Grayscale value.
 
 // Future Image type.
 inline bool HasImageTag(mediapipe::CalculatorContext* cc) { return false; }
+
+#if !MEDIAPIPE_DISABLE_GPU
+constexpr uint32 kOutputAlignment = ImageFrame::kGlDefaultAlignmentBoundary;
+#else
+constexpr uint32 kOutputAlignment = ImageFrame::kDefaultAlignmentBoundary;
+#endif  // !MEDIAPIPE_DISABLE_GPU
 }  // namespace
 
 // A calculator for rendering data on images.
@@ -77,10 +87,20 @@ inline bool HasImageTag(mediapipe::CalculatorContext* cc) { return false; }
 // Output:
 //  1. IMAGE or IMAGE_GPU: A rendered ImageFrame (or GpuBuffer),
 //  Note: Output types should match their corresponding input stream type.
+//  2. OVERLAY (optional, CPU only): An SRGBA ImageFrame with the annotations
+//     rendered on a transparent background, for compositing them elsewhere.
+//     It is cropped to the bounding box of the rendered pixels, and is not
+//     output when nothing is rendered. IMAGE may be left out when this output
+//     is used.
+//  3. OVERLAY_RECT (optional, requires OVERLAY): A Rect, in pixels of the
+//     image (or canvas), where OVERLAY is to be placed.
 //
 // For CPU input frames, only SRGBA, SRGB and GRAY8 format are supported. The
 // output format is the same as input except for GRAY8 where the output is in
-// SRGB to support annotations in color.
+// SRGB to support annotations in color. SRGBA and SRGB frames are rendered in
+// place, without copying their pixels, when this calculator holds the only
+// reference to them and their pixels are not shared with other frames (see
+// ImageFrame::IsPixelDataShared()).
 //
 // For GPU input frames, only 4-channel images are supported.
 //
@@ -133,16 +153,16 @@ class AnnotationOverlayCalculator : public CalculatorBase {
 
  private:
   absl::Status CreateRenderTargetCpu(CalculatorContext* cc,
-                                     std::unique_ptr<cv::Mat>& image_mat,
-                                     ImageFormat::Format* target_format);
+                                     std::unique_ptr<ImageFrame>* frame);
   template <typename Type, const char* Tag>
   absl::Status CreateRenderTargetGpu(CalculatorContext* cc,
                                      std::unique_ptr<cv::Mat>& image_mat);
   template <typename Type, const char* Tag>
   absl::Status RenderToGpu(CalculatorContext* cc, uchar* overlay_image);
-  absl::Status RenderToCpu(CalculatorContext* cc,
-                           const ImageFormat::Format& target_format,
-                           uchar* data_image);
+  absl::Status RenderToCpu(CalculatorContext* cc);
+  absl::Status RenderOverlayToCpu(CalculatorContext* cc);
+  // Renders the RenderData inputs onto the image adopted by renderer_.
+  absl::Status RenderAnnotations(CalculatorContext* cc);
 
   absl::Status GlRender(CalculatorContext* cc);
   template <typename Type, const char* Tag>
@@ -154,6 +174,10 @@ class AnnotationOverlayCalculator : public CalculatorBase {
   // Underlying helper renderer library.
   std::unique_ptr<AnnotationRenderer> renderer_;
 
+  // Transparent layer the OVERLAY output is rendered on and cropped from. It
+  // is kept between packets, and only its rendered pixels are cleared again.
+  std::unique_ptr<ImageFrame> overlay_layer_;
+
   // Indicates if image frame is available as input.
   bool image_frame_available_ = false;
 
@@ -195,7 +219,15 @@ absl::Status AnnotationOverlayCalculator::GetContract(CalculatorContract* cc) {
 #endif  // !MEDIAPIPE_DISABLE_GPU
   if (cc->Inputs().HasTag(kImageFrameTag)) {
     cc->Inputs().Tag(kImageFrameTag).Set<ImageFrame>();
-    CHECK(cc->Outputs().HasTag(kImageFrameTag));
+    CHECK(cc->Outputs().HasTag(kImageFrameTag) ||
+          cc->Outputs().HasTag(kOverlayTag));
+  }
+  if (cc->Outputs().HasTag(kOverlayTag) && use_gpu) {
+    return absl::InternalError("OVERLAY output requires CPU input.");
+  }
+  if (cc->Outputs().HasTag(kOverlayRectTag) &&
+      !cc->Outputs().HasTag(kOverlayTag)) {
+    return absl::InternalError("OVERLAY_RECT output requires OVERLAY.");
   }
 
   // Data streams to render.
@@ -220,6 +252,12 @@ absl::Status AnnotationOverlayCalculator::GetContract(CalculatorContract* cc) {
   if (cc->Outputs().HasTag(kImageFrameTag)) {
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
   }
+  if (cc->Outputs().HasTag(kOverlayTag)) {
+    cc->Outputs().Tag(kOverlayTag).Set<ImageFrame>();
+  }
+  if (cc->Outputs().HasTag(kOverlayRectTag)) {
+    cc->Outputs().Tag(kOverlayRectTag).Set<Rect>();
+  }
 
   if (use_gpu) {
 #if !MEDIAPIPE_DISABLE_GPU
@@ -251,15 +289,20 @@ absl::Status AnnotationOverlayCalculator::Open(CalculatorContext* cc) {
   // Initialize the helper renderer library.
   renderer_ = absl::make_unique<AnnotationRenderer>();
   renderer_->SetFlipTextVertically(options_.flip_text_vertically());
-  if (use_gpu_) renderer_->SetScaleFactor(options_.gpu_scale_factor());
+  if (use_gpu_) {
+    renderer_->SetScaleFactor(options_.gpu_scale_factor());
+  } else {
+    renderer_->SetAntialiasing(options_.antialiasing());
+  }
 
-  // Set the output header based on the input header (if present).
+  // Set the output headers based on the input header (if present).
   const char* tag = use_gpu_ ? kGpuBufferTag : kImageFrameTag;
   if (image_frame_available_ && !cc->Inputs().Tag(tag).Header().IsEmpty()) {
     const auto& input_header =
         cc->Inputs().Tag(tag).Header().Get<VideoHeader>();
-    auto* output_video_header = new VideoHeader(input_header);
-    cc->Outputs().Tag(tag).SetHeader(Adopt(output_video_header));
+    if (cc->Outputs().HasTag(tag)) {
+      cc->Outputs().Tag(tag).SetHeader(Adopt(new VideoHeader(input_header)));
+    }
   }
 
   if (use_gpu_) {
@@ -281,33 +324,52 @@ absl::Status AnnotationOverlayCalculator::Process(CalculatorContext* cc) {
     return absl::OkStatus();
   }
 
-  // Initialize render target, drawn with OpenCV.
-  std::unique_ptr<cv::Mat> image_mat;
-  ImageFormat::Format target_format;
-  if (use_gpu_) {
-#if !MEDIAPIPE_DISABLE_GPU
-    if (!gpu_initialized_) {
-      MP_RETURN_IF_ERROR(
-          gpu_helper_.RunInGlContext([this, cc]() -> absl::Status {
-            return GlSetup<mediapipe::GpuBuffer, kGpuBufferTag>(cc);
-          }));
-      gpu_initialized_ = true;
+  if (!use_gpu_) {
+    // The overlay goes first, as rendering to IMAGE may take over the input
+    // frame.
+    if (cc->Outputs().HasTag(kOverlayTag)) {
+      MP_RETURN_IF_ERROR(RenderOverlayToCpu(cc));
     }
-    if (cc->Inputs().HasTag(kGpuBufferTag)) {
-      MP_RETURN_IF_ERROR(
-          (CreateRenderTargetGpu<mediapipe::GpuBuffer, kGpuBufferTag>(
-              cc, image_mat)));
-    }
-#endif  // !MEDIAPIPE_DISABLE_GPU
-  } else {
     if (cc->Outputs().HasTag(kImageFrameTag)) {
-      MP_RETURN_IF_ERROR(CreateRenderTargetCpu(cc, image_mat, &target_format));
+      MP_RETURN_IF_ERROR(RenderToCpu(cc));
     }
+    return absl::OkStatus();
+  }
+
+#if !MEDIAPIPE_DISABLE_GPU
+  // Initialize render target, drawn with OpenCV.
+  std::unique_ptr<cv::Mat> image_mat;
+  if (!gpu_initialized_) {
+    MP_RETURN_IF_ERROR(
+        gpu_helper_.RunInGlContext([this, cc]() -> absl::Status {
+          return GlSetup<mediapipe::GpuBuffer, kGpuBufferTag>(cc);
+        }));
+    gpu_initialized_ = true;
+  }
+  if (cc->Inputs().HasTag(kGpuBufferTag)) {
+    MP_RETURN_IF_ERROR(
+        (CreateRenderTargetGpu<mediapipe::GpuBuffer, kGpuBufferTag>(
+            cc, image_mat)));
   }
 
   // Reset the renderer with the image_mat. No copy here.
   renderer_->AdoptImage(image_mat.get());
+  MP_RETURN_IF_ERROR(RenderAnnotations(cc));
+
+  // Overlay rendered image in OpenGL, onto a copy of input.
+  uchar* image_mat_ptr = image_mat->data;
+  MP_RETURN_IF_ERROR(
+      gpu_helper_.RunInGlContext([this, cc, image_mat_ptr]() -> absl::Status {
+        return RenderToGpu<mediapipe::GpuBuffer, kGpuBufferTag>(
+            cc, image_mat_ptr);
+      }));
+#endif  // !MEDIAPIPE_DISABLE_GPU
 
+  return absl::OkStatus();
+}
+
+absl::Status AnnotationOverlayCalculator::RenderAnnotations(
+    CalculatorContext* cc) {
   // Render streams onto render target.
   for (CollectionItemId id = cc->Inputs().BeginId(); id < cc->Inputs().EndId();
        ++id) {
@@ -332,23 +394,6 @@ absl::Status AnnotationOverlayCalculator::Process(CalculatorContext* cc) {
       }
     }
   }
-
-  if (use_gpu_) {
-#if !MEDIAPIPE_DISABLE_GPU
-    // Overlay rendered image in OpenGL, onto a copy of input.
-    uchar* image_mat_ptr = image_mat->data;
-    MP_RETURN_IF_ERROR(
-        gpu_helper_.RunInGlContext([this, cc, image_mat_ptr]() -> absl::Status {
-          return RenderToGpu<mediapipe::GpuBuffer, kGpuBufferTag>(
-              cc, image_mat_ptr);
-        }));
-#endif  // !MEDIAPIPE_DISABLE_GPU
-  } else {
-    // Copy the rendered image to output.
-    uchar* image_mat_ptr = image_mat->data;
-    MP_RETURN_IF_ERROR(RenderToCpu(cc, target_format, image_mat_ptr));
-  }
-
   return absl::OkStatus();
 }
 
@@ -365,28 +410,67 @@ absl::Status AnnotationOverlayCalculator::Close(CalculatorContext* cc) {
   return absl::OkStatus();
 }
 
-absl::Status AnnotationOverlayCalculator::RenderToCpu(
-    CalculatorContext* cc, const ImageFormat::Format& target_format,
-    uchar* data_image) {
-  auto output_frame = absl::make_unique<ImageFrame>(
-      target_format, renderer_->GetImageWidth(), renderer_->GetImageHeight());
+absl::Status AnnotationOverlayCalculator::RenderToCpu(CalculatorContext* cc) {
+  std::unique_ptr<ImageFrame> output_frame;
+  MP_RETURN_IF_ERROR(CreateRenderTargetCpu(cc, &output_frame));
 
-#if !MEDIAPIPE_DISABLE_GPU
-  output_frame->CopyPixelData(target_format, renderer_->GetImageWidth(),
-                              renderer_->GetImageHeight(), data_image,
-                              ImageFrame::kGlDefaultAlignmentBoundary);
-#else
-  output_frame->CopyPixelData(target_format, renderer_->GetImageWidth(),
-                              renderer_->GetImageHeight(), data_image,
-                              ImageFrame::kDefaultAlignmentBoundary);
-#endif  // !MEDIAPIPE_DISABLE_GPU
+  // The renderer draws straight into the output frame.
+  cv::Mat output_mat = formats::MatView(output_frame.get());
+  renderer_->AdoptImage(&output_mat);
+  MP_RETURN_IF_ERROR(RenderAnnotations(cc));
 
-  if (cc->Outputs().HasTag(kImageFrameTag)) {
-    cc->Outputs()
-        .Tag(kImageFrameTag)
-        .Add(output_frame.release(), cc->InputTimestamp());
+  cc->Outputs()
+      .Tag(kImageFrameTag)
+      .Add(output_frame.release(), cc->InputTimestamp());
+  return absl::OkStatus();
+}
+
+absl::Status AnnotationOverlayCalculator::RenderOverlayToCpu(
+    CalculatorContext* cc) {
+  int width = options_.canvas_width_px();
+  int height = options_.canvas_height_px();
+  if (image_frame_available_) {
+    const auto& input_frame =
+        cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
+    width = input_frame.Width();
+    height = input_frame.Height();
+  }
+
+  if (!overlay_layer_ || overlay_layer_->Width() != width ||
+      overlay_layer_->Height() != height) {
+    overlay_layer_ = absl::make_unique<ImageFrame>(
+        ImageFormat::SRGBA, width, height, kOutputAlignment);
+    overlay_layer_->SetToZero();
   }
+  cv::Mat layer_mat = formats::MatView(overlay_layer_.get());
+  renderer_->AdoptImage(&layer_mat);
+  MP_RETURN_IF_ERROR(RenderAnnotations(cc));
 
+  const DirtyRect& dirty = renderer_->GetDirtyRect();
+  if (dirty.IsEmpty()) {
+    return absl::OkStatus();
+  }
+  const cv::Rect bounds(dirty.left, dirty.top, dirty.right - dirty.left,
+                        dirty.bottom - dirty.top);
+  auto overlay_frame = absl::make_unique<ImageFrame>(
+      ImageFormat::SRGBA, bounds.width, bounds.height, kOutputAlignment);
+  cv::Mat overlay_mat = formats::MatView(overlay_frame.get());
+  layer_mat(bounds).copyTo(overlay_mat);
+  layer_mat(bounds).setTo(cv::Scalar::all(0));
+
+  cc->Outputs()
+      .Tag(kOverlayTag)
+      .Add(overlay_frame.release(), cc->InputTimestamp());
+  if (cc->Outputs().HasTag(kOverlayRectTag)) {
+    auto rect = absl::make_unique<Rect>();
+    rect->set_x_center(bounds.x + bounds.width / 2);
+    rect->set_y_center(bounds.y + bounds.height / 2);
+    rect->set_width(bounds.width);
+    rect->set_height(bounds.height);
+    cc->Outputs()
+        .Tag(kOverlayRectTag)
+        .Add(rect.release(), cc->InputTimestamp());
+  }
   return absl::OkStatus();
 }
 
@@ -440,48 +524,46 @@ absl::Status AnnotationOverlayCalculator::RenderToGpu(CalculatorContext* cc,
 }
 
 absl::Status AnnotationOverlayCalculator::CreateRenderTargetCpu(
-    CalculatorContext* cc, std::unique_ptr<cv::Mat>& image_mat,
-    ImageFormat::Format* target_format) {
-  if (image_frame_available_) {
-    const auto& input_frame =
-        cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
+    CalculatorContext* cc, std::unique_ptr<ImageFrame>* frame) {
+  if (!image_frame_available_) {
+    *frame = absl::make_unique<ImageFrame>(
+        ImageFormat::SRGB, options_.canvas_width_px(),
+        options_.canvas_height_px(), kOutputAlignment);
+    formats::MatView(frame->get())
+        .setTo(cv::Scalar(options_.canvas_color().r(),
+                          options_.canvas_color().g(),
+                          options_.canvas_color().b()));
+    return absl::OkStatus();
+  }
 
-    int target_mat_type;
-    switch (input_frame.Format()) {
-      case ImageFormat::SRGBA:
-        *target_format = ImageFormat::SRGBA;
-        target_mat_type = CV_8UC4;
-        break;
-      case ImageFormat::SRGB:
-        *target_format = ImageFormat::SRGB;
-        target_mat_type = CV_8UC3;
-        break;
-      case ImageFormat::GRAY8:
-        *target_format = ImageFormat::SRGB;
-        target_mat_type = CV_8UC3;
-        break;
-      default:
-        return absl::UnknownError("Unexpected image frame format.");
-        break;
+  Packet& input_packet = cc->Inputs().Tag(kImageFrameTag).Value();
+  const auto& input_frame = input_packet.Get<ImageFrame>();
+  switch (input_frame.Format()) {
+    case ImageFormat::SRGBA:
+    case ImageFormat::SRGB: {
+      // Render in place if no one else holds the input frame or its pixels.
+      if (!input_frame.IsPixelDataShared()) {
+        auto consumed_frame = input_packet.Consume<ImageFrame>();
+        if (consumed_frame.ok()) {
+          *frame = std::move(consumed_frame).value();
+        }
+      }
+      if (*frame == nullptr) {
+        *frame = absl::make_unique<ImageFrame>();
+        (*frame)->CopyFrom(input_frame, kOutputAlignment);
+      }
+      break;
     }
-
-    image_mat = absl::make_unique<cv::Mat>(
-        input_frame.Height(), input_frame.Width(), target_mat_type);
-
-    auto input_mat = formats::MatView(&input_frame);
-    if (input_frame.Format() == ImageFormat::GRAY8) {
-      cv::Mat rgb_mat;
-      cv::cvtColor(input_mat, rgb_mat, CV_GRAY2RGB);
-      rgb_mat.copyTo(*image_mat);
-    } else {
-      input_mat.copyTo(*image_mat);
+    case ImageFormat::GRAY8: {
+      *frame = absl::make_unique<ImageFrame>(
+          ImageFormat::SRGB, input_frame.Width(), input_frame.Height(),
+          kOutputAlignment);
+      cv::Mat output_mat = formats::MatView(frame->get());
+      cv::cvtColor(formats::MatView(&input_frame), output_mat, CV_GRAY2RGB);
+      break;
     }
-  } else {
-    image_mat = absl::make_unique<cv::Mat>(
-        options_.canvas_height_px(), options_.canvas_width_px(), CV_8UC3,
-        cv::Scalar(options_.canvas_color().r(), options_.canvas_color().g(),
-                   options_.canvas_color().b()));
-    *target_format = ImageFormat::SRGB;
+    default:
+      return absl::UnknownError("Unexpected image frame format.");
   }
 
   return absl::OkStatus();
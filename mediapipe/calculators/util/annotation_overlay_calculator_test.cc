@@ -0,0 +1,284 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/tool/sink.h"
+#include "mediapipe/util/render_data.pb.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+
+// Returns a frame with every channel of every pixel set to value.
+std::unique_ptr<ImageFrame> MakeFrame(ImageFormat::Format format,
+                                      uint8 value) {
+  auto frame = absl::make_unique<ImageFrame>(format, kWidth, kHeight);
+  for (int y = 0; y < kHeight; ++y) {
+    uint8* row = frame->MutablePixelData() + y * frame->WidthStep();
+    std::fill(row, row + kWidth * frame->NumberOfChannels(), value);
+  }
+  return frame;
+}
+
+// Returns render data with a red filled rectangle from (left, top) to
+// (right, bottom), in pixels.
+RenderData FilledRectangle(int left, int top, int right, int bottom) {
+  RenderData render_data;
+  auto* annotation = render_data.add_render_annotations();
+  annotation->mutable_color()->set_r(255);
+  auto* rectangle =
+      annotation->mutable_filled_rectangle()->mutable_rectangle();
+  rectangle->set_left(left);
+  rectangle->set_top(top);
+  rectangle->set_right(right);
+  rectangle->set_bottom(bottom);
+  return render_data;
+}
+
+const uint8* Pixel(const ImageFrame& frame, int x, int y) {
+  return frame.PixelData() + y * frame.WidthStep() +
+         x * frame.NumberOfChannels();
+}
+
+class AnnotationOverlayCalculatorTest : public ::testing::Test {
+ protected:
+  // Runs the calculator on one packet of input_frame per element of
+  // render_data. With shared_input, the test also holds the input frame, so
+  // that the calculator cannot take it over. With overlay, the OVERLAY and
+  // OVERLAY_RECT outputs are collected too.
+  void Run(std::unique_ptr<ImageFrame> input_frame,
+           const std::vector<RenderData>& render_data, bool shared_input,
+           bool overlay) {
+    CalculatorGraphConfig config =
+        ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+          input_stream: "image"
+          input_stream: "render_data"
+          node {
+            calculator: "AnnotationOverlayCalculator"
+            input_stream: "IMAGE:image"
+            input_stream: "render_data"
+            output_stream: "IMAGE:output"
+          }
+        )pb");
+    tool::AddVectorSink("output", &config, &output_);
+    if (overlay) {
+      config.mutable_node(0)->add_output_stream("OVERLAY:overlay");
+      config.mutable_node(0)->add_output_stream("OVERLAY_RECT:overlay_rect");
+      tool::AddVectorSink("overlay", &config, &overlay_);
+      tool::AddVectorSink("overlay_rect", &config, &overlay_rect_);
+    }
+
+    CalculatorGraph graph;
+    MP_ASSERT_OK(graph.Initialize(config));
+    MP_ASSERT_OK(graph.StartRun({}));
+    input_pixels_ = input_frame->PixelData();
+    Packet input = Adopt(input_frame.release());
+    if (shared_input) input_ = input;
+    for (size_t i = 0; i < render_data.size(); ++i) {
+      if (shared_input) {
+        MP_ASSERT_OK(
+            graph.AddPacketToInputStream("image", input_.At(Timestamp(i))));
+      } else {
+        ASSERT_EQ(render_data.size(), 1);
+        MP_ASSERT_OK(graph.AddPacketToInputStream(
+            "image", std::move(input).At(Timestamp(i))));
+      }
+      MP_ASSERT_OK(graph.AddPacketToInputStream(
+          "render_data", MakePacket<RenderData>(render_data[i])
+                             .At(Timestamp(i))));
+    }
+    MP_ASSERT_OK(graph.CloseAllInputStreams());
+    MP_ASSERT_OK(graph.WaitUntilDone());
+  }
+
+  // Address of the pixels of the input frame.
+  const uint8* input_pixels_ = nullptr;
+  // The input frame, when shared with the calculator.
+  Packet input_;
+  std::vector<Packet> output_;
+  std::vector<Packet> overlay_;
+  std::vector<Packet> overlay_rect_;
+};
+
+TEST_F(AnnotationOverlayCalculatorTest, RendersInPlaceWhenUniquelyOwned) {
+  Run(MakeFrame(ImageFormat::SRGB, 0), {FilledRectangle(10, 20, 30, 40)},
+      /*shared_input=*/false, /*overlay=*/false);
+
+  ASSERT_EQ(output_.size(), 1);
+  const auto& output = output_[0].Get<ImageFrame>();
+  EXPECT_EQ(output.PixelData(), input_pixels_);
+  EXPECT_EQ(Pixel(output, 15, 25)[0], 255);
+}
+
+TEST_F(AnnotationOverlayCalculatorTest, CopiesSharedInput) {
+  Run(MakeFrame(ImageFormat::SRGB, 0), {FilledRectangle(10, 20, 30, 40)},
+      /*shared_input=*/true, /*overlay=*/false);
+
+  ASSERT_EQ(output_.size(), 1);
+  const auto& output = output_[0].Get<ImageFrame>();
+  EXPECT_NE(output.PixelData(), input_pixels_);
+  EXPECT_EQ(Pixel(output, 15, 25)[0], 255);
+  EXPECT_EQ(Pixel(input_.Get<ImageFrame>(), 15, 25)[0], 0);
+}
+
+TEST_F(AnnotationOverlayCalculatorTest, ConvertsGray8ToSrgb) {
+  Run(MakeFrame(ImageFormat::GRAY8, 100), {FilledRectangle(10, 20, 30, 40)},
+      /*shared_input=*/false, /*overlay=*/false);
+
+  ASSERT_EQ(output_.size(), 1);
+  const auto& output = output_[0].Get<ImageFrame>();
+  ASSERT_EQ(output.Format(), ImageFormat::SRGB);
+  const uint8* background = Pixel(output, 5, 5);
+  EXPECT_EQ(background[0], 100);
+  EXPECT_EQ(background[1], 100);
+  EXPECT_EQ(background[2], 100);
+  const uint8* annotated = Pixel(output, 15, 25);
+  EXPECT_EQ(annotated[0], 255);
+  EXPECT_EQ(annotated[1], 0);
+  EXPECT_EQ(annotated[2], 0);
+}
+
+TEST_F(AnnotationOverlayCalculatorTest, RendersOpaqueAnnotationsOnSrgba) {
+  Run(MakeFrame(ImageFormat::SRGBA, 0), {FilledRectangle(10, 20, 30, 40)},
+      /*shared_input=*/false, /*overlay=*/false);
+
+  ASSERT_EQ(output_.size(), 1);
+  const auto& output = output_[0].Get<ImageFrame>();
+  ASSERT_EQ(output.Format(), ImageFormat::SRGBA);
+  EXPECT_EQ(Pixel(output, 15, 25)[0], 255);
+  EXPECT_EQ(Pixel(output, 15, 25)[3], 255);
+  EXPECT_EQ(Pixel(output, 5, 5)[3], 0);
+}
+
+// The overlay covers the annotations, and pixels rendered on a previous
+// packet do not leak into it.
+TEST_F(AnnotationOverlayCalculatorTest, CropsOverlayToAnnotations) {
+  RenderData enclosing;
+  auto* annotation = enclosing.add_render_annotations();
+  annotation->mutable_color()->set_g(255);
+  annotation->set_thickness(1);
+  auto* rectangle = annotation->mutable_rectangle();
+  rectangle->set_left(5);
+  rectangle->set_top(15);
+  rectangle->set_right(35);
+  rectangle->set_bottom(45);
+  Run(MakeFrame(ImageFormat::SRGB, 0),
+      {FilledRectangle(10, 20, 30, 40), enclosing, RenderData()},
+      /*shared_input=*/true, /*overlay=*/true);
+
+  // Nothing is rendered on the last packet.
+  ASSERT_EQ(output_.size(), 3);
+  ASSERT_EQ(overlay_.size(), 2);
+  ASSERT_EQ(overlay_rect_.size(), 2);
+  for (int i = 0; i < 2; ++i) {
+    const auto& overlay = overlay_[i].Get<ImageFrame>();
+    const auto& rect = overlay_rect_[i].Get<Rect>();
+    ASSERT_EQ(overlay.Format(), ImageFormat::SRGBA);
+    ASSERT_EQ(overlay.Width(), rect.width());
+    ASSERT_EQ(overlay.Height(), rect.height());
+    const int left = rect.x_center() - rect.width() / 2;
+    const int top = rect.y_center() - rect.height() / 2;
+    // Bounds of the annotation, which the overlay may exceed by its
+    // thickness and a pixel.
+    const int min_left = i == 0 ? 10 : 5;
+    const int min_top = i == 0 ? 20 : 15;
+    const int max_right = i == 0 ? 30 : 35;
+    const int max_bottom = i == 0 ? 40 : 45;
+    EXPECT_LE(left, min_left);
+    EXPECT_LE(top, min_top);
+    EXPECT_GE(left, min_left - 2);
+    EXPECT_GE(top, min_top - 2);
+    EXPECT_GE(left + rect.width(), max_right);
+    EXPECT_GE(top + rect.height(), max_bottom);
+    EXPECT_LE(left + rect.width(), max_right + 2);
+    EXPECT_LE(top + rect.height(), max_bottom + 2);
+
+    // The middle of the filled rectangle, transparent on the second packet.
+    const uint8* middle = Pixel(overlay, 20 - left, 30 - top);
+    EXPECT_EQ(middle[3], i == 0 ? 255 : 0);
+    if (i == 0) {
+      EXPECT_EQ(middle[0], 255);
+    }
+  }
+}
+
+// Views output by ImageCroppingCalculator share the pixels of their input,
+// which other consumers may still read, so they are never drawn on in place.
+TEST(AnnotationOverlayCalculatorGraphTest, CopiesCroppedViews) {
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+        input_stream: "image"
+        input_stream: "render_data"
+        output_stream: "output"
+        node {
+          calculator: "ImageCroppingCalculator"
+          input_stream: "IMAGE:image"
+          output_stream: "IMAGE:cropped"
+          options {
+            [mediapipe.ImageCroppingCalculatorOptions.ext] {
+              width: 40
+              height: 20
+              output_view: true
+            }
+          }
+        }
+        node {
+          calculator: "AnnotationOverlayCalculator"
+          input_stream: "IMAGE:cropped"
+          input_stream: "render_data"
+          output_stream: "IMAGE:output"
+        }
+      )pb");
+  std::vector<Packet> output;
+  tool::AddVectorSink("output", &config, &output);
+
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  const Packet input =
+      Adopt(MakeFrame(ImageFormat::SRGB, 0).release()).At(Timestamp(0));
+  MP_ASSERT_OK(graph.AddPacketToInputStream("image", input));
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "render_data",
+      MakePacket<RenderData>(FilledRectangle(0, 0, 40, 20)).At(Timestamp(0))));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(output.size(), 1);
+  const auto& output_frame = output[0].Get<ImageFrame>();
+  EXPECT_EQ(Pixel(output_frame, 10, 10)[0], 255);
+  // The crop is centered, at (12, 14).
+  const auto& input_frame = input.Get<ImageFrame>();
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      ASSERT_EQ(Pixel(input_frame, x, y)[0], 0) << x << "," << y;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,148 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/tool/simulation_clock.h"
+#include "mediapipe/framework/tool/simulation_clock_executor.h"
+
+namespace mediapipe {
+namespace {
+
+std::string LogPath(const std::string& name) {
+  return absl::StrCat(getenv("TEST_TMPDIR"), "/", name);
+}
+
+// Records frames with the given timestamps, and a camera matrix side packet.
+void RecordLog(const std::string& path, const std::vector<int64>& timestamps) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(
+      ParseTextProtoOrDie<CalculatorGraphConfig>(absl::Substitute(
+          R"(
+            input_stream: "video"
+            node {
+              calculator: "PacketLogRecorderCalculator"
+              input_stream: "video"
+              input_side_packet: "camera_matrix"
+              options {
+                [mediapipe.PacketLogRecorderCalculatorOptions.ext] {
+                  file_path: "$0"
+                }
+              }
+            }
+          )",
+          path))));
+  Matrix camera_matrix = Matrix::Identity(3, 3);
+  MP_ASSERT_OK(
+      graph.StartRun({{"camera_matrix", MakePacket<Matrix>(camera_matrix)}}));
+  for (int i = 0; i < timestamps.size(); ++i) {
+    auto frame = absl::make_unique<ImageFrame>(ImageFormat::GRAY8, 16, 16);
+    frame->SetToZero();
+    frame->MutablePixelData()[0] = i;
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "video", Adopt(frame.release()).At(Timestamp(timestamps[i]))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+CalculatorGraphConfig ReplayConfig(const std::string& path, bool paced) {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(absl::Substitute(
+      R"(
+        output_side_packet: "camera_matrix"
+        node {
+          calculator: "PacketLogReplayCalculator"
+          $2
+          output_stream: "video"
+          output_side_packet: "camera_matrix"
+          options {
+            [mediapipe.PacketLogReplayCalculatorOptions.ext] {
+              file_path: "$0"
+              pace_by_timestamps: $1
+            }
+          }
+        }
+      )",
+      path, paced ? "true" : "false",
+      paced ? "input_side_packet: \"CLOCK:clock\"" : ""));
+}
+
+TEST(PacketLogCalculatorsTest, ReplaysRecordedPackets) {
+  const std::string path = LogPath("replays_recorded_packets.mplog");
+  RecordLog(path, {0, 33333, 66666});
+
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(ReplayConfig(path, /*paced=*/false)));
+  std::vector<Timestamp> timestamps;
+  std::vector<int> pixels;
+  MP_ASSERT_OK(graph.ObserveOutputStream("video", [&](const Packet& packet) {
+    timestamps.push_back(packet.Timestamp());
+    pixels.push_back(packet.Get<ImageFrame>().PixelData()[0]);
+    return absl::OkStatus();
+  }));
+  MP_ASSERT_OK(graph.Run());
+
+  EXPECT_THAT(timestamps, testing::ElementsAre(Timestamp(0), Timestamp(33333),
+                                               Timestamp(66666)));
+  EXPECT_THAT(pixels, testing::ElementsAre(0, 1, 2));
+  auto camera_matrix = graph.GetOutputSidePacket("camera_matrix");
+  MP_ASSERT_OK(camera_matrix.status());
+  EXPECT_TRUE(camera_matrix.value().Get<Matrix>().isIdentity());
+}
+
+TEST(PacketLogCalculatorsTest, PacesReplayByTimestamps) {
+  const std::string path = LogPath("paces_replay_by_timestamps.mplog");
+  RecordLog(path, {5000000, 6000000, 9000000});
+
+  auto executor = std::make_shared<SimulationClockExecutor>(4);
+  std::shared_ptr<SimulationClock> clock = executor->GetClock();
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.SetExecutor("", executor));
+  MP_ASSERT_OK(graph.Initialize(ReplayConfig(path, /*paced=*/true)));
+  std::vector<absl::Time> output_times;
+  MP_ASSERT_OK(graph.ObserveOutputStream("video", [&](const Packet& packet) {
+    output_times.push_back(clock->TimeNow());
+    return absl::OkStatus();
+  }));
+
+  clock->ThreadStart();
+  const absl::Time start_time = clock->TimeNow();
+  MP_ASSERT_OK(graph.StartRun(
+      {{"clock", MakePacket<std::shared_ptr<Clock>>(clock)}}));
+  clock->Sleep(absl::Seconds(10));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  clock->ThreadFinish();
+
+  ASSERT_EQ(output_times.size(), 3);
+  EXPECT_EQ(output_times[0] - start_time, absl::ZeroDuration());
+  EXPECT_EQ(output_times[1] - start_time, absl::Seconds(1));
+  EXPECT_EQ(output_times[2] - start_time, absl::Seconds(4));
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,108 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "mediapipe/calculators/util/packet_log_recorder_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/packet_log.h"
+
+namespace mediapipe {
+
+// Records its input streams and input side packets to a packet log (see
+// mediapipe/util/packet_log.h), which PacketLogReplayCalculator can replay,
+// e.g. to benchmark a graph on recorded production inputs.
+//
+// Accepts any number of input streams and input side packets, with any tags,
+// holding ImageFrame, Matrix, Tensor or protocol buffer packets. Each is
+// recorded as a channel named after its stream or side packet: first the
+// input streams, then the input side packets, each ordered by tag and index.
+//
+// Example config:
+// node {
+//   calculator: "PacketLogRecorderCalculator"
+//   input_stream: "input_video"
+//   input_stream: "input_rects"
+//   input_side_packet: "camera_matrix"
+//   options {
+//     [mediapipe.PacketLogRecorderCalculatorOptions.ext] {
+//       file_path: "/tmp/inputs.mplog"
+//     }
+//   }
+// }
+class PacketLogRecorderCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    for (CollectionItemId id = cc->Inputs().BeginId();
+         id < cc->Inputs().EndId(); ++id) {
+      cc->Inputs().Get(id).SetAny();
+    }
+    for (CollectionItemId id = cc->InputSidePackets().BeginId();
+         id < cc->InputSidePackets().EndId(); ++id) {
+      cc->InputSidePackets().Get(id).SetAny();
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options = cc->Options<PacketLogRecorderCalculatorOptions>();
+    RET_CHECK(!options.file_path().empty())
+        << "PacketLogRecorderCalculator requires a file_path.";
+    std::vector<PacketLogChannel> channels;
+    for (const std::string& name : cc->Inputs().TagMap()->Names()) {
+      channels.push_back({name, /*is_side_packet=*/false});
+    }
+    for (const std::string& name : cc->InputSidePackets().TagMap()->Names()) {
+      channels.push_back({name, /*is_side_packet=*/true});
+    }
+    ASSIGN_OR_RETURN(writer_,
+                     PacketLogWriter::Create(options.file_path(), channels));
+
+    int channel = cc->Inputs().NumEntries();
+    for (CollectionItemId id = cc->InputSidePackets().BeginId();
+         id < cc->InputSidePackets().EndId(); ++id, ++channel) {
+      MP_RETURN_IF_ERROR(
+          writer_->Append(channel, cc->InputSidePackets().Get(id)));
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    int channel = 0;
+    for (CollectionItemId id = cc->Inputs().BeginId();
+         id < cc->Inputs().EndId(); ++id, ++channel) {
+      const Packet& packet = cc->Inputs().Get(id).Value();
+      if (!packet.IsEmpty()) {
+        MP_RETURN_IF_ERROR(writer_->Append(channel, packet));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Close(CalculatorContext* cc) override {
+    if (writer_ == nullptr) {
+      return absl::OkStatus();
+    }
+    return writer_->Close();
+  }
+
+ private:
+  std::unique_ptr<PacketLogWriter> writer_;
+};
+REGISTER_CALCULATOR(PacketLogRecorderCalculator);
+
+}  // namespace mediapipe
@@ -0,0 +1,161 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "mediapipe/calculators/util/packet_log_replay_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deps/clock.h"
+#include "mediapipe/framework/deps/monotonic_clock.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/tool/status_util.h"
+#include "mediapipe/util/packet_log.h"
+
+namespace mediapipe {
+
+// Outputs the packets of a packet log recorded by PacketLogRecorderCalculator
+// (see mediapipe/util/packet_log.h), e.g. to benchmark a graph on recorded
+// production inputs.
+//
+// The output streams receive the stream channels of the log, and the output
+// side packets its side packet channels, both in order: with output streams
+// ordered by tag and index, as the recorder orders its inputs, a replay node
+// can use the input stream config of the recorder node as its output stream
+// config. Replayed ImageFrames reference the memory-mapped log.
+//
+// By default, packets are output as fast as the graph consumes them. With
+// `pace_by_timestamps`, they are output when as much time has passed since
+// the first packet as their timestamps, in microseconds, are apart. Time is
+// measured on the clock passed as the optional input side packet "CLOCK" (a
+// std::shared_ptr<mediapipe::Clock>), by default a monotonic real-time clock.
+// Passing the SimulationClock of a SimulationClockExecutor makes paced replay
+// deterministic, and as fast as the graph allows.
+//
+// Example config:
+// node {
+//   calculator: "PacketLogReplayCalculator"
+//   output_stream: "input_video"
+//   output_stream: "input_rects"
+//   output_side_packet: "camera_matrix"
+//   options {
+//     [mediapipe.PacketLogReplayCalculatorOptions.ext] {
+//       file_path: "/tmp/inputs.mplog"
+//       pace_by_timestamps: true
+//     }
+//   }
+// }
+class PacketLogReplayCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    for (CollectionItemId id = cc->Outputs().BeginId();
+         id < cc->Outputs().EndId(); ++id) {
+      cc->Outputs().Get(id).SetAny();
+    }
+    for (CollectionItemId id = cc->OutputSidePackets().BeginId();
+         id < cc->OutputSidePackets().EndId(); ++id) {
+      cc->OutputSidePackets().Get(id).SetAny();
+    }
+    cc->InputSidePackets()
+        .Tag("CLOCK")
+        .Set<std::shared_ptr<mediapipe::Clock>>()
+        .Optional();
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options = cc->Options<PacketLogReplayCalculatorOptions>();
+    RET_CHECK(!options.file_path().empty())
+        << "PacketLogReplayCalculator requires a file_path.";
+    pace_by_timestamps_ = options.pace_by_timestamps();
+    if (cc->InputSidePackets().HasTag("CLOCK")) {
+      clock_ = cc->InputSidePackets()
+                   .Tag("CLOCK")
+                   .Get<std::shared_ptr<mediapipe::Clock>>();
+    } else {
+      clock_ = std::shared_ptr<mediapipe::Clock>(
+          mediapipe::MonotonicClock::CreateSynchronizedMonotonicClock());
+    }
+    ASSIGN_OR_RETURN(reader_, PacketLogReader::Open(options.file_path()));
+
+    // Map the channels of the log to output stream and side packet ids.
+    CollectionItemId next_output = cc->Outputs().BeginId();
+    CollectionItemId next_side_packet = cc->OutputSidePackets().BeginId();
+    for (const PacketLogChannel& channel : reader_->channels()) {
+      if (channel.is_side_packet) {
+        RET_CHECK(next_side_packet < cc->OutputSidePackets().EndId())
+            << "More side packets recorded than output side packets.";
+        channel_ids_.push_back(next_side_packet++);
+      } else {
+        RET_CHECK(next_output < cc->Outputs().EndId())
+            << "More streams recorded than output streams.";
+        channel_ids_.push_back(next_output++);
+      }
+    }
+    RET_CHECK(next_output == cc->Outputs().EndId() &&
+              next_side_packet == cc->OutputSidePackets().EndId())
+        << "More outputs than recorded streams and side packets.";
+
+    for (int i = 0; i < reader_->num_entries(); ++i) {
+      const int channel = reader_->entry(i).channel;
+      if (reader_->channels()[channel].is_side_packet) {
+        ASSIGN_OR_RETURN(Packet packet, reader_->ReadPacket(i));
+        cc->OutputSidePackets().Get(channel_ids_[channel]).Set(packet);
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    while (next_entry_ < reader_->num_entries() &&
+           reader_->channels()[reader_->entry(next_entry_).channel]
+               .is_side_packet) {
+      ++next_entry_;
+    }
+    if (next_entry_ == reader_->num_entries()) {
+      return tool::StatusStop();
+    }
+    const int index = next_entry_++;
+    ASSIGN_OR_RETURN(Packet packet, reader_->ReadPacket(index));
+    if (pace_by_timestamps_) {
+      if (first_timestamp_ == Timestamp::Unset()) {
+        first_timestamp_ = packet.Timestamp();
+        start_time_ = clock_->TimeNow();
+      }
+      clock_->SleepUntil(
+          start_time_ +
+          absl::Microseconds(packet.Timestamp().Value() -
+                             first_timestamp_.Value()));
+    }
+    cc->Outputs()
+        .Get(channel_ids_[reader_->entry(index).channel])
+        .AddPacket(std::move(packet));
+    return absl::OkStatus();
+  }
+
+ private:
+  std::unique_ptr<PacketLogReader> reader_;
+  // The output stream or side packet id of each channel of the log.
+  std::vector<CollectionItemId> channel_ids_;
+  int next_entry_ = 0;
+  bool pace_by_timestamps_ = false;
+  std::shared_ptr<mediapipe::Clock> clock_;
+  Timestamp first_timestamp_ = Timestamp::Unset();
+  absl::Time start_time_;
+};
+REGISTER_CALCULATOR(PacketLogReplayCalculator);
+
+}  // namespace mediapipe
@@ -0,0 +1,580 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/video/dis_flow.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/util/parallel_for_rows.h"
+
+namespace mediapipe {
+
+namespace {
+
+using Plane = DisFlow::Plane;
+
+// Weight of the smoothness term of the refinement, in intensity levels.
+constexpr float kRefinementAlpha = 20.0f;
+// Jacobi sweeps per fixed point iteration of the refinement.
+constexpr int kRefinementSweeps = 5;
+// Gradient descent stops once a step is shorter than this, in pixels.
+constexpr float kMinStep = 0.01f;
+
+// Samples p bilinearly at (x, y), clamped to its border.
+inline float Sample(const Plane& p, float x, float y) {
+  x = std::min(std::max(x, 0.0f), p.width - 1.0f);
+  y = std::min(std::max(y, 0.0f), p.height - 1.0f);
+  const int x0 = static_cast<int>(x);
+  const int y0 = static_cast<int>(y);
+  const int x1 = std::min(x0 + 1, p.width - 1);
+  const int y1 = std::min(y0 + 1, p.height - 1);
+  const float fx = x - x0;
+  const float fy = y - y0;
+  const float* row0 = p.Row(y0);
+  const float* row1 = p.Row(y1);
+  return (1 - fy) * ((1 - fx) * row0[x0] + fx * row0[x1]) +
+         fy * ((1 - fx) * row1[x0] + fx * row1[x1]);
+}
+
+// Writes the size x size block of p at (x0 + u, y0 + v) to out. All pixels of
+// the block share their bilinear weights, so blocks inside p are sampled
+// without per-pixel clamping.
+void WarpPatch(const Plane& p, int x0, int y0, int size, float u, float v,
+               float* out) {
+  const float x = x0 + u;
+  const float y = y0 + v;
+  const int ix = static_cast<int>(std::floor(x));
+  const int iy = static_cast<int>(std::floor(y));
+  if (ix < 0 || iy < 0 || ix + size >= p.width || iy + size >= p.height) {
+    for (int dy = 0; dy < size; ++dy) {
+      for (int dx = 0; dx < size; ++dx) {
+        out[dy * size + dx] = Sample(p, x + dx, y + dy);
+      }
+    }
+    return;
+  }
+  const float fx = x - ix;
+  const float fy = y - iy;
+  const float w00 = (1 - fx) * (1 - fy);
+  const float w01 = fx * (1 - fy);
+  const float w10 = (1 - fx) * fy;
+  const float w11 = fx * fy;
+  for (int dy = 0; dy < size; ++dy) {
+    const float* row0 = p.Row(iy + dy) + ix;
+    const float* row1 = p.Row(iy + dy + 1) + ix;
+    for (int dx = 0; dx < size; ++dx) {
+      out[dy * size + dx] = w00 * row0[dx] + w01 * row0[dx + 1] +
+                            w10 * row1[dx] + w11 * row1[dx + 1];
+    }
+  }
+}
+
+// Sets dst to the central difference gradients of src, one-sided at the
+// border.
+void Gradients(const Plane& src, Plane* dst_x, Plane* dst_y) {
+  const int width = src.width;
+  const int height = src.height;
+  dst_x->Resize(width, height);
+  dst_y->Resize(width, height);
+  ParallelForRows(height, width, [&](int begin, int end) {
+    for (int y = begin; y < end; ++y) {
+      const float* row = src.Row(y);
+      const float* up = src.Row(std::max(y - 1, 0));
+      const float* down = src.Row(std::min(y + 1, height - 1));
+      const float scale_y = (y == 0 || y == height - 1) ? 1.0f : 0.5f;
+      float* gx = dst_x->Row(y);
+      float* gy = dst_y->Row(y);
+      for (int x = 0; x < width; ++x) {
+        const int left = std::max(x - 1, 0);
+        const int right = std::min(x + 1, width - 1);
+        const float scale_x = (right - left == 2) ? 0.5f : 1.0f;
+        gx[x] = (right > left) ? (row[right] - row[left]) * scale_x : 0.0f;
+        gy[x] = (height > 1) ? (down[x] - up[x]) * scale_y : 0.0f;
+      }
+    }
+  });
+}
+
+// Sets dst to src, a flow field at a scale factor times smaller than dst,
+// bilinearly upsampled and scaled by factor.
+void UpsampleFlow(const Plane& src, float factor, int width, int height,
+                  Plane* dst) {
+  dst->Resize(width, height);
+  const float inv_factor = 1.0f / factor;
+  ParallelForRows(height, width, [&](int begin, int end) {
+    for (int y = begin; y < end; ++y) {
+      const float sy = (y + 0.5f) * inv_factor - 0.5f;
+      float* out = dst->Row(y);
+      for (int x = 0; x < width; ++x) {
+        const float sx = (x + 0.5f) * inv_factor - 0.5f;
+        out[x] = factor * Sample(src, sx, sy);
+      }
+    }
+  });
+}
+
+// Returns the grid position of patch i, the last patch being aligned with the
+// end of the image.
+inline int PatchPosition(int i, int stride, int patch_size, int size) {
+  return std::min(i * stride, size - patch_size);
+}
+
+}  // namespace
+
+void DisFlow::Plane::Resize(int w, int h) {
+  width = w;
+  height = h;
+  data.resize(static_cast<size_t>(w) * h);
+}
+
+DisFlowOptions DisFlowOptionsForPreset(DisFlowPreset preset) {
+  DisFlowOptions options;
+  switch (preset) {
+    case DisFlowPreset::kUltrafast:
+      options.variational_refinement_iterations = 0;
+      options.gradient_descent_iterations = 12;
+      break;
+    case DisFlowPreset::kFast:
+      break;
+    case DisFlowPreset::kMedium:
+      options.finest_scale = 1;
+      options.patch_size = 12;
+      options.gradient_descent_iterations = 25;
+      break;
+  }
+  return options;
+}
+
+DisFlow::DisFlow(const DisFlowOptions& options) : options_(options) {}
+
+void DisFlow::BuildPyramid(const ImageFrame& image, int num_levels,
+                           std::vector<Plane>* pyramid) {
+  pyramid->resize(num_levels);
+  Plane& base = (*pyramid)[0];
+  base.Resize(image.Width(), image.Height());
+  ParallelForRows(base.height, base.width, [&](int begin, int end) {
+    for (int y = begin; y < end; ++y) {
+      const uint8* src = image.PixelData() + y * image.WidthStep();
+      float* dst = base.Row(y);
+      for (int x = 0; x < base.width; ++x) dst[x] = src[x];
+    }
+  });
+  for (int level = 1; level < num_levels; ++level) {
+    const Plane& src = (*pyramid)[level - 1];
+    Plane& dst = (*pyramid)[level];
+    dst.Resize(std::max(src.width / 2, 1), std::max(src.height / 2, 1));
+    // Halves with a separable [1 3 3 1] / 8 kernel centered between source
+    // pixels 2x and 2x + 1, which aliases much less than a 2x2 box.
+    ParallelForRows(dst.height, dst.width, [&](int begin, int end) {
+      std::vector<float> column(src.width);
+      for (int y = begin; y < end; ++y) {
+        const float* rows[4];
+        for (int k = 0; k < 4; ++k) {
+          rows[k] = src.Row(std::min(std::max(2 * y - 1 + k, 0),
+                                     src.height - 1));
+        }
+        for (int x = 0; x < src.width; ++x) {
+          column[x] = 0.125f * (rows[0][x] + rows[3][x]) +
+                      0.375f * (rows[1][x] + rows[2][x]);
+        }
+        float* out = dst.Row(y);
+        for (int x = 0; x < dst.width; ++x) {
+          const int x0 = std::max(2 * x - 1, 0);
+          const int x1 = std::min(2 * x, src.width - 1);
+          const int x2 = std::min(2 * x + 1, src.width - 1);
+          const int x3 = std::min(2 * x + 2, src.width - 1);
+          out[x] = 0.125f * (column[x0] + column[x3]) +
+                   0.375f * (column[x1] + column[x2]);
+        }
+      }
+    });
+  }
+}
+
+void DisFlow::SearchPatches(const Plane& first, const Plane& second,
+                            int patch_size, int stride) {
+  const int width = first.width;
+  const int height = first.height;
+  patches_x_ = (width - patch_size + stride - 1) / stride + 1;
+  patches_y_ = (height - patch_size + stride - 1) / stride + 1;
+  const int num_patches = patches_x_ * patches_y_;
+  patch_flow_x_.resize(num_patches);
+  patch_flow_y_.resize(num_patches);
+  patch_mean_diff_.resize(num_patches);
+  const int n = patch_size * patch_size;
+  const float inv_n = 1.0f / n;
+  const bool normalize = options_.use_mean_normalization;
+  const int iterations = options_.gradient_descent_iterations;
+  const float max_displacement2 = static_cast<float>(patch_size * patch_size);
+
+  // Rows of patches are independent, since patches only propagate flow to
+  // their right neighbor.
+  ParallelForRows(
+      patches_y_, patches_x_ * n * (iterations + 1), [&](int begin, int end) {
+        std::vector<float> templ(n);
+        std::vector<float> warped(n);
+        std::vector<float> patch_gx(n);
+        std::vector<float> patch_gy(n);
+        // Returns the sum of squared, optionally mean-normalized, differences
+        // between the template and the warped patch, and sets mean_diff.
+        auto residual = [&](float* mean_diff) {
+          float mean = 0.0f;
+          for (int k = 0; k < n; ++k) {
+            warped[k] -= templ[k];
+            mean += warped[k];
+          }
+          mean *= inv_n;
+          *mean_diff = mean;
+          if (!normalize) mean = 0.0f;
+          float ssd = 0.0f;
+          for (int k = 0; k < n; ++k) {
+            warped[k] -= mean;
+            ssd += warped[k] * warped[k];
+          }
+          return ssd;
+        };
+
+        for (int j = begin; j < end; ++j) {
+          const int y0 = PatchPosition(j, stride, patch_size, height);
+          for (int i = 0; i < patches_x_; ++i) {
+            const int x0 = PatchPosition(i, stride, patch_size, width);
+            // Template, gradients and their Hessian, with the gradient means
+            // removed when intensities are mean-normalized.
+            float gx_mean = 0.0f;
+            float gy_mean = 0.0f;
+            for (int dy = 0; dy < patch_size; ++dy) {
+              const float* t = first.Row(y0 + dy) + x0;
+              const float* gx = grad_x_.Row(y0 + dy) + x0;
+              const float* gy = grad_y_.Row(y0 + dy) + x0;
+              for (int dx = 0; dx < patch_size; ++dx) {
+                const int k = dy * patch_size + dx;
+                templ[k] = t[dx];
+                patch_gx[k] = gx[dx];
+                patch_gy[k] = gy[dx];
+                gx_mean += gx[dx];
+                gy_mean += gy[dx];
+              }
+            }
+            gx_mean = normalize ? gx_mean * inv_n : 0.0f;
+            gy_mean = normalize ? gy_mean * inv_n : 0.0f;
+            float hxx = 0.0f;
+            float hxy = 0.0f;
+            float hyy = 0.0f;
+            for (int k = 0; k < n; ++k) {
+              patch_gx[k] -= gx_mean;
+              patch_gy[k] -= gy_mean;
+              hxx += patch_gx[k] * patch_gx[k];
+              hxy += patch_gx[k] * patch_gy[k];
+              hyy += patch_gy[k] * patch_gy[k];
+            }
+            // Regularizes textureless patches, which then keep their
+            // initial flow.
+            hxx += 1e-2f * n;
+            hyy += 1e-2f * n;
+            const float inv_det = 1.0f / (hxx * hyy - hxy * hxy);
+
+            // Initial flow, from the coarser scale at the patch center or
+            // from the left neighbor.
+            const int cx = x0 + patch_size / 2;
+            const int cy = y0 + patch_size / 2;
+            float u = flow_x_.Row(cy)[cx];
+            float v = flow_y_.Row(cy)[cx];
+            float mean_diff = 0.0f;
+            if (options_.use_spatial_propagation && i > 0) {
+              const int left = j * patches_x_ + i - 1;
+              const float left_u = patch_flow_x_[left];
+              const float left_v = patch_flow_y_[left];
+              WarpPatch(second, x0, y0, patch_size, u, v, warped.data());
+              const float ssd = residual(&mean_diff);
+              WarpPatch(second, x0, y0, patch_size, left_u, left_v,
+                        warped.data());
+              if (residual(&mean_diff) < ssd) {
+                u = left_u;
+                v = left_v;
+              }
+            }
+            const float initial_u = u;
+            const float initial_v = v;
+
+            // Inverse compositional steps: the Hessian of the template is
+            // fixed, and each step solves for the template displacement that
+            // matches the warped patch, which is subtracted from the flow.
+            for (int it = 0; it < iterations; ++it) {
+              WarpPatch(second, x0, y0, patch_size, u, v, warped.data());
+              residual(&mean_diff);
+              float bx = 0.0f;
+              float by = 0.0f;
+              for (int k = 0; k < n; ++k) {
+                bx += patch_gx[k] * warped[k];
+                by += patch_gy[k] * warped[k];
+              }
+              const float du = (hyy * bx - hxy * by) * inv_det;
+              const float dv = (hxx * by - hxy * bx) * inv_det;
+              u -= du;
+              v -= dv;
+              if (du * du + dv * dv < kMinStep * kMinStep) break;
+            }
+            // Patches that drift further than their size have lost track.
+            const float drift_u = u - initial_u;
+            const float drift_v = v - initial_v;
+            if (drift_u * drift_u + drift_v * drift_v > max_displacement2) {
+              u = initial_u;
+              v = initial_v;
+            }
+            WarpPatch(second, x0, y0, patch_size, u, v, warped.data());
+            residual(&mean_diff);
+
+            const int index = j * patches_x_ + i;
+            patch_flow_x_[index] = u;
+            patch_flow_y_[index] = v;
+            patch_mean_diff_[index] = normalize ? mean_diff : 0.0f;
+          }
+        }
+      });
+}
+
+void DisFlow::Densify(const Plane& first, const Plane& second, int patch_size,
+                      int stride) {
+  const int width = first.width;
+  const int height = first.height;
+  weights_.Resize(width, height);
+  // Each tile of rows accumulates the patches overlapping it.
+  ParallelForRows(height, width * 4, [&](int begin, int end) {
+    for (int y = begin; y < end; ++y) {
+      std::fill(flow_x_.Row(y), flow_x_.Row(y) + width, 0.0f);
+      std::fill(flow_y_.Row(y), flow_y_.Row(y) + width, 0.0f);
+      std::fill(weights_.Row(y), weights_.Row(y) + width, 0.0f);
+    }
+    for (int j = 0; j < patches_y_; ++j) {
+      const int y0 = PatchPosition(j, stride, patch_size, height);
+      const int row_begin = std::max(y0, begin);
+      const int row_end = std::min(y0 + patch_size, end);
+      if (row_begin >= row_end) continue;
+      for (int i = 0; i < patches_x_; ++i) {
+        const int x0 = PatchPosition(i, stride, patch_size, width);
+        const int index = j * patches_x_ + i;
+        const float u = patch_flow_x_[index];
+        const float v = patch_flow_y_[index];
+        const float mean_diff = patch_mean_diff_[index];
+        for (int y = row_begin; y < row_end; ++y) {
+          const float* t = first.Row(y);
+          float* sum_x = flow_x_.Row(y);
+          float* sum_y = flow_y_.Row(y);
+          float* sum_w = weights_.Row(y);
+          for (int x = x0; x < x0 + patch_size; ++x) {
+            const float diff = Sample(second, x + u, y + v) - t[x] - mean_diff;
+            const float weight = 1.0f / std::max(1.0f, std::abs(diff));
+            sum_x[x] += weight * u;
+            sum_y[x] += weight * v;
+            sum_w[x] += weight;
+          }
+        }
+      }
+    }
+    // Patches cover every pixel.
+    for (int y = begin; y < end; ++y) {
+      float* sum_x = flow_x_.Row(y);
+      float* sum_y = flow_y_.Row(y);
+      const float* sum_w = weights_.Row(y);
+      for (int x = 0; x < width; ++x) {
+        const float inv_weight = 1.0f / sum_w[x];
+        sum_x[x] *= inv_weight;
+        sum_y[x] *= inv_weight;
+      }
+    }
+  });
+}
+
+void DisFlow::Refine(const Plane& first, const Plane& second) {
+  const int width = first.width;
+  const int height = first.height;
+  const float alpha2 = kRefinementAlpha * kRefinementAlpha;
+  warped_.Resize(width, height);
+  for (int d = 0; d < 2; ++d) {
+    delta_x_[d].Resize(width, height);
+    delta_y_[d].Resize(width, height);
+  }
+  const int iterations = options_.variational_refinement_iterations;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    // Linearizes brightness constancy around the current flow.
+    ParallelForRows(height, width, [&](int begin, int end) {
+      for (int y = begin; y < end; ++y) {
+        const float* u = flow_x_.Row(y);
+        const float* v = flow_y_.Row(y);
+        float* out = warped_.Row(y);
+        for (int x = 0; x < width; ++x) {
+          out[x] = Sample(second, x + u[x], y + v[x]);
+        }
+        std::fill(delta_x_[0].Row(y), delta_x_[0].Row(y) + width, 0.0f);
+        std::fill(delta_y_[0].Row(y), delta_y_[0].Row(y) + width, 0.0f);
+      }
+    });
+    // Averaging the gradients of both images linearizes around the midpoint
+    // of the flow, which is not biased towards either image.
+    Gradients(warped_, &warped_grad_x_, &warped_grad_y_);
+    ParallelForRows(height, width, [&](int begin, int end) {
+      for (int y = begin; y < end; ++y) {
+        const float* gx0 = grad_x_.Row(y);
+        const float* gy0 = grad_y_.Row(y);
+        float* gx = warped_grad_x_.Row(y);
+        float* gy = warped_grad_y_.Row(y);
+        for (int x = 0; x < width; ++x) {
+          gx[x] = 0.5f * (gx[x] + gx0[x]);
+          gy[x] = 0.5f * (gy[x] + gy0[x]);
+        }
+      }
+    });
+
+    // Jacobi sweeps for the flow increment minimizing
+    // (Ix du + Iy dv + It)^2 + alpha^2 |grad (flow + delta)|^2.
+    for (int sweep = 0; sweep < kRefinementSweeps; ++sweep) {
+      const Plane& in_x = delta_x_[sweep % 2];
+      const Plane& in_y = delta_y_[sweep % 2];
+      Plane& out_x = delta_x_[(sweep + 1) % 2];
+      Plane& out_y = delta_y_[(sweep + 1) % 2];
+      ParallelForRows(height, width, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+          const int rows[2] = {std::max(y - 1, 0), std::min(y + 1, height - 1)};
+          const float* u = flow_x_.Row(y);
+          const float* v = flow_y_.Row(y);
+          const float* du = in_x.Row(y);
+          const float* dv = in_y.Row(y);
+          const float* ix = warped_grad_x_.Row(y);
+          const float* iy = warped_grad_y_.Row(y);
+          const float* i1 = warped_.Row(y);
+          const float* i0 = first.Row(y);
+          float* new_du = out_x.Row(y);
+          float* new_dv = out_y.Row(y);
+          for (int x = 0; x < width; ++x) {
+            const int left = std::max(x - 1, 0);
+            const int right = std::min(x + 1, width - 1);
+            // Mean total flow of the neighbors, relative to the flow here.
+            float mean_u = u[left] + du[left] + u[right] + du[right];
+            float mean_v = v[left] + dv[left] + v[right] + dv[right];
+            for (int r : rows) {
+              mean_u += flow_x_.Row(r)[x] + in_x.Row(r)[x];
+              mean_v += flow_y_.Row(r)[x] + in_y.Row(r)[x];
+            }
+            mean_u = 0.25f * mean_u - u[x];
+            mean_v = 0.25f * mean_v - v[x];
+            const float it = i1[x] - i0[x];
+            const float t = (ix[x] * mean_u + iy[x] * mean_v + it) /
+                            (alpha2 + ix[x] * ix[x] + iy[x] * iy[x]);
+            new_du[x] = mean_u - ix[x] * t;
+            new_dv[x] = mean_v - iy[x] * t;
+          }
+        }
+      });
+    }
+
+    const Plane& delta_x = delta_x_[kRefinementSweeps % 2];
+    const Plane& delta_y = delta_y_[kRefinementSweeps % 2];
+    ParallelForRows(height, width, [&](int begin, int end) {
+      for (int y = begin; y < end; ++y) {
+        float* u = flow_x_.Row(y);
+        float* v = flow_y_.Row(y);
+        const float* du = delta_x.Row(y);
+        const float* dv = delta_y.Row(y);
+        for (int x = 0; x < width; ++x) {
+          u[x] += du[x];
+          v[x] += dv[x];
+        }
+      }
+    });
+  }
+}
+
+absl::Status DisFlow::Compute(const ImageFrame& first,
+                              const ImageFrame& second, ImageFrame* flow) {
+  RET_CHECK_EQ(first.Format(), ImageFormat::GRAY8);
+  RET_CHECK_EQ(second.Format(), ImageFormat::GRAY8);
+  RET_CHECK_EQ(flow->Format(), ImageFormat::VEC32F2);
+  const int width = first.Width();
+  const int height = first.Height();
+  RET_CHECK(second.Width() == width && second.Height() == height &&
+            flow->Width() == width && flow->Height() == height)
+      << "Images and flow must have the same size.";
+  RET_CHECK_GT(options_.patch_size, 0);
+  RET_CHECK_GT(options_.patch_stride, 0);
+  RET_CHECK_GE(options_.finest_scale, 0);
+
+  // The finest scale keeps at least one patch, and coarser scales are added
+  // while they keep at least two patches along each side.
+  const int min_size = std::min(width, height);
+  int finest_scale = options_.finest_scale;
+  while (finest_scale > 0 &&
+         (min_size >> finest_scale) < options_.patch_size) {
+    --finest_scale;
+  }
+  int coarsest_scale = finest_scale;
+  while ((min_size >> (coarsest_scale + 1)) >= 2 * options_.patch_size) {
+    ++coarsest_scale;
+  }
+  BuildPyramid(first, coarsest_scale + 1, &first_pyramid_);
+  BuildPyramid(second, coarsest_scale + 1, &second_pyramid_);
+
+  for (int scale = coarsest_scale; scale >= finest_scale; --scale) {
+    const Plane& first_level = first_pyramid_[scale];
+    const Plane& second_level = second_pyramid_[scale];
+    const int level_width = first_level.width;
+    const int level_height = first_level.height;
+    if (scale == coarsest_scale) {
+      flow_x_.Resize(level_width, level_height);
+      flow_y_.Resize(level_width, level_height);
+      std::fill(flow_x_.data.begin(), flow_x_.data.end(), 0.0f);
+      std::fill(flow_y_.data.begin(), flow_y_.data.end(), 0.0f);
+    } else {
+      std::swap(flow_x_, coarse_flow_x_);
+      std::swap(flow_y_, coarse_flow_y_);
+      UpsampleFlow(coarse_flow_x_, 2.0f, level_width, level_height, &flow_x_);
+      UpsampleFlow(coarse_flow_y_, 2.0f, level_width, level_height, &flow_y_);
+    }
+    const int patch_size =
+        std::min({options_.patch_size, level_width, level_height});
+    const int stride = std::min(options_.patch_stride, patch_size);
+    Gradients(first_level, &grad_x_, &grad_y_);
+    SearchPatches(first_level, second_level, patch_size, stride);
+    Densify(first_level, second_level, patch_size, stride);
+    if (options_.variational_refinement_iterations > 0) {
+      Refine(first_level, second_level);
+    }
+  }
+
+  // Upsamples the flow of the finest scale into flow.
+  const float factor = static_cast<float>(1 << finest_scale);
+  if (finest_scale > 0) {
+    std::swap(flow_x_, coarse_flow_x_);
+    std::swap(flow_y_, coarse_flow_y_);
+    UpsampleFlow(coarse_flow_x_, factor, width, height, &flow_x_);
+    UpsampleFlow(coarse_flow_y_, factor, width, height, &flow_y_);
+  }
+  ParallelForRows(height, width, [&](int begin, int end) {
+    for (int y = begin; y < end; ++y) {
+      const float* u = flow_x_.Row(y);
+      const float* v = flow_y_.Row(y);
+      float* out = reinterpret_cast<float*>(flow->MutablePixelData() +
+                                            y * flow->WidthStep());
+      for (int x = 0; x < width; ++x) {
+        out[2 * x] = u[x];
+        out[2 * x + 1] = v[x];
+      }
+    }
+  });
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe
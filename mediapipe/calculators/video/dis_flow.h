@@ -0,0 +1,126 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Dense optical flow by DIS (Dense Inverse Search, Kroeger et al. 2016), the
+// engine of DisOpticalFlowCalculator.
+//
+// Flow is computed coarse-to-fine on image pyramids. At each scale, square
+// patches on a regular grid of the first image are aligned to the second
+// image by inverse compositional gradient descent, starting from the flow of
+// the coarser scale or, with spatial propagation, from the flow of their left
+// neighbor if it matches better. The patch flows are then densified into a
+// per-pixel flow, each pixel averaging the patches covering it weighted by
+// how well they match it, and optionally refined by a few fixed point
+// iterations of a Horn-Schunck energy. Flow is computed down to a finest
+// scale and bilinearly upsampled from there.
+//
+// Every pass runs on tiles of rows (or of patch rows) in parallel via
+// ParallelForRows. Pyramids, flow fields and other per-scale buffers are kept
+// between calls and reused for frames of the same size.
+#ifndef MEDIAPIPE_CALCULATORS_VIDEO_DIS_FLOW_H_
+#define MEDIAPIPE_CALCULATORS_VIDEO_DIS_FLOW_H_
+
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+struct DisFlowOptions {
+  // Finest pyramid level the flow is computed at (0 = full resolution).
+  int finest_scale = 2;
+  // Size of the square patches, in pixels.
+  int patch_size = 8;
+  // Stride between neighboring patches, at most patch_size.
+  int patch_stride = 4;
+  // Gradient descent iterations per patch.
+  int gradient_descent_iterations = 16;
+  // Fixed point iterations of variational refinement per scale, zero
+  // disables refinement.
+  int variational_refinement_iterations = 5;
+  // Initializes each patch with the flow of its left neighbor if that
+  // matches better than the flow of the coarser scale.
+  bool use_spatial_propagation = true;
+  // Matches patches after subtracting their mean intensity, which makes
+  // matching robust to illumination changes.
+  bool use_mean_normalization = true;
+};
+
+// Parameters of the presets of OpenCV's DISOpticalFlow, ordered from fastest
+// to most accurate.
+enum class DisFlowPreset { kUltrafast, kFast, kMedium };
+DisFlowOptions DisFlowOptionsForPreset(DisFlowPreset preset);
+
+class DisFlow {
+ public:
+  explicit DisFlow(const DisFlowOptions& options);
+
+  // Computes the flow from first to second, both GRAY8 of the same size,
+  // into flow, a VEC32F2 frame of that size holding (dx, dy) per pixel.
+  // Not thread-safe: use one DisFlow per thread.
+  absl::Status Compute(const ImageFrame& first, const ImageFrame& second,
+                       ImageFrame* flow);
+
+  // A single-channel float image.
+  struct Plane {
+    int width = 0;
+    int height = 0;
+    std::vector<float> data;
+
+    void Resize(int w, int h);
+    float* Row(int y) { return data.data() + static_cast<size_t>(y) * width; }
+    const float* Row(int y) const {
+      return data.data() + static_cast<size_t>(y) * width;
+    }
+  };
+
+ private:
+  void BuildPyramid(const ImageFrame& image, int num_levels,
+                    std::vector<Plane>* pyramid);
+  void SearchPatches(const Plane& first, const Plane& second, int patch_size,
+                     int stride);
+  void Densify(const Plane& first, const Plane& second, int patch_size,
+               int stride);
+  void Refine(const Plane& first, const Plane& second);
+
+  const DisFlowOptions options_;
+  std::vector<Plane> first_pyramid_;
+  std::vector<Plane> second_pyramid_;
+  // Gradients of the first image at the current scale.
+  Plane grad_x_;
+  Plane grad_y_;
+  // Dense flow at the current scale, and at the previous, coarser one.
+  Plane flow_x_;
+  Plane flow_y_;
+  Plane coarse_flow_x_;
+  Plane coarse_flow_y_;
+  // Per patch flow and mean intensity difference, in grid order.
+  std::vector<float> patch_flow_x_;
+  std::vector<float> patch_flow_y_;
+  std::vector<float> patch_mean_diff_;
+  int patches_x_ = 0;
+  int patches_y_ = 0;
+  // Densification weights, and refinement buffers.
+  Plane weights_;
+  Plane warped_;
+  Plane warped_grad_x_;
+  Plane warped_grad_y_;
+  Plane delta_x_[2];
+  Plane delta_y_[2];
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_VIDEO_DIS_FLOW_H_
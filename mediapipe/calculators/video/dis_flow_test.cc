@@ -0,0 +1,250 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/video/dis_flow.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// A smooth random texture, sampled at arbitrary positions.
+class Texture {
+ public:
+  Texture(int width, int height) : width_(width), height_(height) {
+    values_.resize(width * height);
+    uint32 state = 12345;
+    for (float& value : values_) {
+      state = state * 1664525u + 1013904223u;
+      value = (state >> 8) * (255.0f / (1 << 24));
+    }
+    // Box blurs, five times along each axis.
+    std::vector<float> tmp(values_.size());
+    for (int pass = 0; pass < 5; ++pass) {
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          float sum = 0.0f;
+          for (int d = -2; d <= 2; ++d) sum += At(x + d, y);
+          tmp[y * width + x] = sum / 5;
+        }
+      }
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          float sum = 0.0f;
+          for (int d = -2; d <= 2; ++d) {
+            sum += tmp[std::min(std::max(y + d, 0), height - 1) * width + x];
+          }
+          values_[y * width + x] = sum / 5;
+        }
+      }
+    }
+    // Stretches the contrast back to the full range.
+    const auto range = std::minmax_element(values_.begin(), values_.end());
+    const float low = *range.first;
+    const float scale = 255.0f / (*range.second - low);
+    for (float& value : values_) value = (value - low) * scale;
+  }
+
+  float Sample(float x, float y) const {
+    const int x0 = static_cast<int>(std::floor(x));
+    const int y0 = static_cast<int>(std::floor(y));
+    const float fx = x - x0;
+    const float fy = y - y0;
+    return (1 - fy) * ((1 - fx) * At(x0, y0) + fx * At(x0 + 1, y0)) +
+           fy * ((1 - fx) * At(x0, y0 + 1) + fx * At(x0 + 1, y0 + 1));
+  }
+
+ private:
+  float At(int x, int y) const {
+    x = std::min(std::max(x, 0), width_ - 1);
+    y = std::min(std::max(y, 0), height_ - 1);
+    return values_[y * width_ + x];
+  }
+
+  int width_;
+  int height_;
+  std::vector<float> values_;
+};
+
+// Renders texture, displaced by (dx, dy) where moving(x, y) is true, offset
+// by brightness.
+template <typename MovingFn>
+ImageFrame Render(const Texture& texture, int width, int height, float dx,
+                  float dy, MovingFn moving, float brightness = 0.0f) {
+  ImageFrame frame(ImageFormat::GRAY8, width, height);
+  for (int y = 0; y < height; ++y) {
+    uint8* row = frame.MutablePixelData() + y * frame.WidthStep();
+    for (int x = 0; x < width; ++x) {
+      const bool move = moving(x, y);
+      // The second frame shows at (x, y) the content at (x - dx, y - dy).
+      const float value = texture.Sample(x + 20 - (move ? dx : 0.0f),
+                                         y + 20 - (move ? dy : 0.0f)) +
+                          brightness;
+      row[x] = static_cast<uint8>(std::min(std::max(value, 0.0f), 255.0f) +
+                                  0.5f);
+    }
+  }
+  return frame;
+}
+
+bool Everywhere(int x, int y) { return true; }
+
+// Mean flow over the rectangle [x0, x1) x [y0, y1).
+void MeanFlow(const ImageFrame& flow, int x0, int y0, int x1, int y1,
+              float* mean_dx, float* mean_dy) {
+  double sum_dx = 0.0;
+  double sum_dy = 0.0;
+  for (int y = y0; y < y1; ++y) {
+    const float* row =
+        reinterpret_cast<const float*>(flow.PixelData() + y * flow.WidthStep());
+    for (int x = x0; x < x1; ++x) {
+      sum_dx += row[2 * x];
+      sum_dy += row[2 * x + 1];
+    }
+  }
+  const int count = (x1 - x0) * (y1 - y0);
+  *mean_dx = sum_dx / count;
+  *mean_dy = sum_dy / count;
+}
+
+class DisFlowPresetTest : public ::testing::TestWithParam<DisFlowPreset> {};
+
+TEST_P(DisFlowPresetTest, RecoversTranslation) {
+  constexpr int kWidth = 320;
+  constexpr int kHeight = 240;
+  const Texture texture(kWidth + 40, kHeight + 40);
+  const ImageFrame first =
+      Render(texture, kWidth, kHeight, 0.0f, 0.0f, Everywhere);
+  const ImageFrame second =
+      Render(texture, kWidth, kHeight, 5.3f, -3.6f, Everywhere);
+  ImageFrame flow(ImageFormat::VEC32F2, kWidth, kHeight);
+  DisFlow dis(DisFlowOptionsForPreset(GetParam()));
+  MP_ASSERT_OK(dis.Compute(first, second, &flow));
+
+  float mean_dx, mean_dy;
+  MeanFlow(flow, 16, 16, kWidth - 16, kHeight - 16, &mean_dx, &mean_dy);
+  // Flow is computed at a quarter resolution by most presets, where bilinear
+  // interpolation of the pyramid biases it by a few hundredths of a pixel.
+  EXPECT_NEAR(mean_dx, 5.3f, 0.3f);
+  EXPECT_NEAR(mean_dy, -3.6f, 0.3f);
+
+  // Backward flow is the opposite, and the reused buffers do not leak state
+  // from the previous call.
+  MP_ASSERT_OK(dis.Compute(second, first, &flow));
+  MeanFlow(flow, 16, 16, kWidth - 16, kHeight - 16, &mean_dx, &mean_dy);
+  EXPECT_NEAR(mean_dx, -5.3f, 0.3f);
+  EXPECT_NEAR(mean_dy, 3.6f, 0.3f);
+}
+
+INSTANTIATE_TEST_SUITE_P(Presets, DisFlowPresetTest,
+                         ::testing::Values(DisFlowPreset::kUltrafast,
+                                           DisFlowPreset::kFast,
+                                           DisFlowPreset::kMedium));
+
+TEST(DisFlowTest, SeparatesMotions) {
+  constexpr int kWidth = 256;
+  constexpr int kHeight = 192;
+  const Texture texture(kWidth + 40, kHeight + 40);
+  auto left_half = [](int x, int y) { return x < kWidth / 2; };
+  const ImageFrame first =
+      Render(texture, kWidth, kHeight, 0.0f, 0.0f, left_half);
+  const ImageFrame second =
+      Render(texture, kWidth, kHeight, 4.0f, 2.0f, left_half);
+  ImageFrame flow(ImageFormat::VEC32F2, kWidth, kHeight);
+  DisFlow dis(DisFlowOptionsForPreset(DisFlowPreset::kFast));
+  MP_ASSERT_OK(dis.Compute(first, second, &flow));
+
+  float mean_dx, mean_dy;
+  MeanFlow(flow, 16, 16, kWidth / 2 - 24, kHeight - 16, &mean_dx, &mean_dy);
+  EXPECT_NEAR(mean_dx, 4.0f, 0.3f);
+  EXPECT_NEAR(mean_dy, 2.0f, 0.3f);
+  MeanFlow(flow, kWidth / 2 + 24, 16, kWidth - 16, kHeight - 16, &mean_dx,
+           &mean_dy);
+  EXPECT_NEAR(mean_dx, 0.0f, 0.3f);
+  EXPECT_NEAR(mean_dy, 0.0f, 0.3f);
+}
+
+TEST(DisFlowTest, MeanNormalizationHandlesBrightnessChange) {
+  constexpr int kWidth = 256;
+  constexpr int kHeight = 192;
+  const Texture texture(kWidth + 40, kHeight + 40);
+  const ImageFrame first =
+      Render(texture, kWidth, kHeight, 0.0f, 0.0f, Everywhere);
+  const ImageFrame second = Render(texture, kWidth, kHeight, -2.5f, 1.5f,
+                                   Everywhere, /*brightness=*/-30.0f);
+  ImageFrame flow(ImageFormat::VEC32F2, kWidth, kHeight);
+  DisFlowOptions options = DisFlowOptionsForPreset(DisFlowPreset::kUltrafast);
+  DisFlow dis(options);
+  MP_ASSERT_OK(dis.Compute(first, second, &flow));
+
+  float mean_dx, mean_dy;
+  MeanFlow(flow, 16, 16, kWidth - 16, kHeight - 16, &mean_dx, &mean_dy);
+  EXPECT_NEAR(mean_dx, -2.5f, 0.3f);
+  EXPECT_NEAR(mean_dy, 1.5f, 0.3f);
+}
+
+TEST(DisFlowTest, HandlesImagesSmallerThanPatches) {
+  const Texture texture(46, 45);
+  const ImageFrame first = Render(texture, 6, 5, 0.0f, 0.0f, Everywhere);
+  const ImageFrame second = Render(texture, 6, 5, 0.5f, 0.0f, Everywhere);
+  ImageFrame flow(ImageFormat::VEC32F2, 6, 5);
+  DisFlow dis(DisFlowOptionsForPreset(DisFlowPreset::kMedium));
+  MP_ASSERT_OK(dis.Compute(first, second, &flow));
+}
+
+TEST(DisFlowTest, RejectsMismatchedInputs) {
+  ImageFrame first(ImageFormat::GRAY8, 64, 48);
+  ImageFrame second(ImageFormat::GRAY8, 64, 48);
+  ImageFrame flow(ImageFormat::VEC32F2, 64, 48);
+  DisFlow dis(DisFlowOptionsForPreset(DisFlowPreset::kFast));
+  ImageFrame small(ImageFormat::GRAY8, 32, 48);
+  EXPECT_FALSE(dis.Compute(first, small, &flow).ok());
+  ImageFrame color(ImageFormat::SRGB, 64, 48);
+  EXPECT_FALSE(dis.Compute(first, color, &flow).ok());
+  ImageFrame flow_1(ImageFormat::VEC32F1, 64, 48);
+  EXPECT_FALSE(dis.Compute(first, second, &flow_1).ok());
+}
+
+// Args: width, height, preset.
+void BM_DisFlow(benchmark::State& state) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  const Texture texture(width + 40, height + 40);
+  const ImageFrame first =
+      Render(texture, width, height, 0.0f, 0.0f, Everywhere);
+  const ImageFrame second =
+      Render(texture, width, height, 3.0f, 2.0f, Everywhere);
+  ImageFrame flow(ImageFormat::VEC32F2, width, height);
+  DisFlow dis(DisFlowOptionsForPreset(
+      static_cast<DisFlowPreset>(state.range(2))));
+  for (auto _ : state) {
+    dis.Compute(first, second, &flow).IgnoreError();
+  }
+  state.SetItemsProcessed(state.iterations() * width * height);
+}
+BENCHMARK(BM_DisFlow)
+    ->Args({640, 480, 0})
+    ->Args({640, 480, 1})
+    ->Args({640, 480, 2})
+    ->Args({1280, 720, 1});
+
+}  // namespace
+}  // namespace mediapipe
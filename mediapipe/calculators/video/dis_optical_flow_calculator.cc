@@ -0,0 +1,266 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <list>
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/calculators/video/dis_flow.h"
+#include "mediapipe/calculators/video/dis_optical_flow_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/motion/optical_flow_field.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+namespace {
+
+// Checks that img1 and img2 have the same dimensions.
+bool ImageSizesMatch(const ImageFrame& img1, const ImageFrame& img2) {
+  return (img1.Width() == img2.Width()) && (img1.Height() == img2.Height());
+}
+
+// Returns image as a GRAY8 frame, converting it if it is SRGB or SRGBA.
+absl::StatusOr<std::shared_ptr<const ImageFrame>> ConvertToGrayscale(
+    const Packet& packet) {
+  const ImageFrame& image = packet.Get<ImageFrame>();
+  int conversion_code;
+  switch (image.Format()) {
+    case ImageFormat::GRAY8:
+      return SharedPtrWithPacket<ImageFrame>(packet);
+    case ImageFormat::SRGB:
+      conversion_code = cv::COLOR_RGB2GRAY;
+      break;
+    case ImageFormat::SRGBA:
+      conversion_code = cv::COLOR_RGBA2GRAY;
+      break;
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported image format ", image.Format(),
+                       ". Only SRGB, SRGBA and GRAY8 are supported."));
+  }
+  auto gray = std::make_shared<ImageFrame>(ImageFormat::GRAY8, image.Width(),
+                                           image.Height());
+  cv::Mat gray_mat = formats::MatView(gray.get());
+  cv::cvtColor(formats::MatView(&image), gray_mat, conversion_code);
+  return gray;
+}
+
+DisFlowOptions ToDisFlowOptions(
+    const DisOpticalFlowCalculatorOptions& options) {
+  DisFlowPreset preset = DisFlowPreset::kFast;
+  switch (options.preset()) {
+    case DisOpticalFlowCalculatorOptions::ULTRAFAST:
+      preset = DisFlowPreset::kUltrafast;
+      break;
+    case DisOpticalFlowCalculatorOptions::FAST:
+      preset = DisFlowPreset::kFast;
+      break;
+    case DisOpticalFlowCalculatorOptions::MEDIUM:
+      preset = DisFlowPreset::kMedium;
+      break;
+  }
+  DisFlowOptions dis_options = DisFlowOptionsForPreset(preset);
+  if (options.has_finest_scale()) {
+    dis_options.finest_scale = options.finest_scale();
+  }
+  if (options.has_patch_size()) {
+    dis_options.patch_size = options.patch_size();
+  }
+  if (options.has_patch_stride()) {
+    dis_options.patch_stride = options.patch_stride();
+  }
+  if (options.has_gradient_descent_iterations()) {
+    dis_options.gradient_descent_iterations =
+        options.gradient_descent_iterations();
+  }
+  if (options.has_variational_refinement_iterations()) {
+    dis_options.variational_refinement_iterations =
+        options.variational_refinement_iterations();
+  }
+  if (options.has_use_spatial_propagation()) {
+    dis_options.use_spatial_propagation = options.use_spatial_propagation();
+  }
+  if (options.has_use_mean_normalization()) {
+    dis_options.use_mean_normalization = options.use_mean_normalization();
+  }
+  return dis_options;
+}
+
+}  // namespace
+
+// Computes dense optical flow between a pair of image frames with DIS (Dense
+// Inverse Search, see dis_flow.h): patches on a coarse-to-fine pyramid are
+// aligned via inverse compositional search, densified and optionally refined
+// variationally. Per frame pair this is one to two orders of magnitude faster
+// than Tvl1OpticalFlowCalculator, which it is meant to replace; inputs and
+// outputs are identical. The speed / quality trade-off is selected via the
+// preset in DisOpticalFlowCalculatorOptions.
+//
+// Each flow field is computed in tiles of rows processed in parallel. In
+// addition, if "max_in_flight" is set to any value greater than 1, multiple
+// frame pairs are processed in parallel on the graph's executor. The output
+// packets will be automatically ordered by timestamp before they are passed
+// along to downstream calculators.
+//
+// Inputs:
+//   FIRST_FRAME: An ImageFrame in SRGB, SRGBA or GRAY8 format.
+//   SECOND_FRAME: An ImageFrame in SRGB, SRGBA or GRAY8 format.
+// Outputs:
+//   FORWARD_FLOW: The OpticalFlowField from the first frame to the second
+//                 frame, output at the input timestamp.
+//   BACKWARD_FLOW: The OpticalFlowField from the second frame to the first
+//                  frame, output at the input timestamp.
+// Example config:
+//   node {
+//     calculator: "DisOpticalFlowCalculator"
+//     input_stream: "FIRST_FRAME:first_frames"
+//     input_stream: "SECOND_FRAME:second_frames"
+//     output_stream: "FORWARD_FLOW:forward_flow"
+//     output_stream: "BACKWARD_FLOW:backward_flow"
+//     max_in_flight: 4
+//     options {
+//       [mediapipe.DisOpticalFlowCalculatorOptions.ext] {
+//         preset: ULTRAFAST
+//       }
+//     }
+//   }
+//   num_threads: 4
+class DisOpticalFlowCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc);
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+
+ private:
+  absl::Status CalculateOpticalFlow(const ImageFrame& first,
+                                    const ImageFrame& second,
+                                    OpticalFlowField* flow);
+  DisFlowOptions dis_options_;
+  bool forward_requested_ = false;
+  bool backward_requested_ = false;
+  // Stores the idle DisFlow objects, which are not thread-safe and keep per
+  // image size buffers that are reused across calls.
+  std::list<std::unique_ptr<DisFlow>> dis_computers_ ABSL_GUARDED_BY(mutex_);
+  absl::Mutex mutex_;
+};
+
+absl::Status DisOpticalFlowCalculator::GetContract(CalculatorContract* cc) {
+  if (!cc->Inputs().HasTag("FIRST_FRAME") ||
+      !cc->Inputs().HasTag("SECOND_FRAME")) {
+    return absl::InvalidArgumentError(
+        "Missing required input streams. Both FIRST_FRAME and SECOND_FRAME "
+        "must be specified.");
+  }
+  cc->Inputs().Tag("FIRST_FRAME").Set<ImageFrame>();
+  cc->Inputs().Tag("SECOND_FRAME").Set<ImageFrame>();
+  if (cc->Outputs().HasTag("FORWARD_FLOW")) {
+    cc->Outputs().Tag("FORWARD_FLOW").Set<OpticalFlowField>();
+  }
+  if (cc->Outputs().HasTag("BACKWARD_FLOW")) {
+    cc->Outputs().Tag("BACKWARD_FLOW").Set<OpticalFlowField>();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status DisOpticalFlowCalculator::Open(CalculatorContext* cc) {
+  const auto& options = cc->Options<DisOpticalFlowCalculatorOptions>();
+  dis_options_ = ToDisFlowOptions(options);
+  RET_CHECK_GT(dis_options_.patch_size, 0);
+  RET_CHECK_GT(dis_options_.patch_stride, 0);
+  RET_CHECK_GE(dis_options_.finest_scale, 0);
+  {
+    absl::MutexLock lock(&mutex_);
+    dis_computers_.push_back(absl::make_unique<DisFlow>(dis_options_));
+  }
+  forward_requested_ = cc->Outputs().HasTag("FORWARD_FLOW");
+  backward_requested_ = cc->Outputs().HasTag("BACKWARD_FLOW");
+  return absl::OkStatus();
+}
+
+absl::Status DisOpticalFlowCalculator::Process(CalculatorContext* cc) {
+  const Packet& first_packet = cc->Inputs().Tag("FIRST_FRAME").Value();
+  const Packet& second_packet = cc->Inputs().Tag("SECOND_FRAME").Value();
+  if (!ImageSizesMatch(first_packet.Get<ImageFrame>(),
+                       second_packet.Get<ImageFrame>())) {
+    return tool::StatusInvalid("Images are different sizes.");
+  }
+  // Converted once, shared by forward and backward flow.
+  ASSIGN_OR_RETURN(const std::shared_ptr<const ImageFrame> first,
+                   ConvertToGrayscale(first_packet));
+  ASSIGN_OR_RETURN(const std::shared_ptr<const ImageFrame> second,
+                   ConvertToGrayscale(second_packet));
+
+  if (forward_requested_) {
+    auto forward_optical_flow_field = absl::make_unique<OpticalFlowField>();
+    MP_RETURN_IF_ERROR(CalculateOpticalFlow(
+        *first, *second, forward_optical_flow_field.get()));
+    cc->Outputs()
+        .Tag("FORWARD_FLOW")
+        .Add(forward_optical_flow_field.release(), cc->InputTimestamp());
+  }
+  if (backward_requested_) {
+    auto backward_optical_flow_field = absl::make_unique<OpticalFlowField>();
+    MP_RETURN_IF_ERROR(CalculateOpticalFlow(
+        *second, *first, backward_optical_flow_field.get()));
+    cc->Outputs()
+        .Tag("BACKWARD_FLOW")
+        .Add(backward_optical_flow_field.release(), cc->InputTimestamp());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status DisOpticalFlowCalculator::CalculateOpticalFlow(
+    const ImageFrame& first, const ImageFrame& second,
+    OpticalFlowField* flow) {
+  CHECK(flow);
+  // Tries getting an idle DisFlow object from the cache. If not, creates a
+  // new one.
+  std::unique_ptr<DisFlow> dis_computer;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!dis_computers_.empty()) {
+      dis_computer = std::move(dis_computers_.front());
+      dis_computers_.pop_front();
+    }
+  }
+  if (!dis_computer) {
+    dis_computer = absl::make_unique<DisFlow>(dis_options_);
+  }
+
+  // The flow is written straight into the field, viewed as a VEC32F2 frame.
+  flow->Allocate(first.Width(), first.Height());
+  cv::Mat& flow_data = flow->mutable_flow_data();
+  ImageFrame flow_frame(ImageFormat::VEC32F2, flow_data.cols, flow_data.rows,
+                        flow_data.step, flow_data.data,
+                        ImageFrame::PixelDataDeleter::kNone);
+  const absl::Status status =
+      dis_computer->Compute(first, second, &flow_frame);
+  // Inserts the idle DisFlow object back to the cache for reuse.
+  {
+    absl::MutexLock lock(&mutex_);
+    dis_computers_.push_back(std::move(dis_computer));
+  }
+  return status;
+}
+
+REGISTER_CALCULATOR(DisOpticalFlowCalculator);
+
+}  // namespace mediapipe
@@ -0,0 +1,195 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/substitute.h"
+#include "mediapipe/calculators/video/dis_optical_flow_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/motion/optical_flow_field.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr int kShiftX = 2;
+constexpr int kShiftY = 3;
+
+// Returns a pair of SRGB or SRGBA frames cropped from the test image, where
+// the second frame's content is displaced by (kShiftX, kShiftY) w.r.t. the
+// first frame, i.e. the forward flow is (kShiftX, kShiftY).
+std::pair<Packet, Packet> MakeFramePair(ImageFormat::Format format) {
+  cv::Mat image = cv::imread(file::JoinPath(
+      "./", "/mediapipe/calculators/video/testdata/lenna.png"));
+  CHECK(!image.empty());
+  cv::cvtColor(image, image,
+               format == ImageFormat::SRGBA ? cv::COLOR_BGR2RGBA
+                                            : cv::COLOR_BGR2RGB);
+  const int width = image.cols - 2 * kShiftX;
+  const int height = image.rows - 2 * kShiftY;
+
+  auto make_frame = [&image, format, width, height](int x, int y) {
+    Packet packet = MakePacket<ImageFrame>(format, width, height);
+    cv::Mat mat = formats::MatView(&packet.Get<ImageFrame>());
+    image(cv::Rect(x, y, width, height)).copyTo(mat);
+    return packet;
+  };
+  return {make_frame(kShiftX, kShiftY), make_frame(0, 0)};
+}
+
+CalculatorGraphConfig::Node MakeNodeConfig(const std::string& preset,
+                                           int max_in_flight) {
+  return ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+      absl::Substitute(R"(
+    calculator: "DisOpticalFlowCalculator"
+    input_stream: "FIRST_FRAME:first_frames"
+    input_stream: "SECOND_FRAME:second_frames"
+    output_stream: "FORWARD_FLOW:forward_flow"
+    output_stream: "BACKWARD_FLOW:backward_flow"
+    max_in_flight: $1
+    options {
+      [mediapipe.DisOpticalFlowCalculatorOptions.ext] { preset: $0 }
+    }
+  )",
+                       preset, max_in_flight));
+}
+
+void AddInputPackets(int num_packets, CalculatorRunner* runner,
+                     ImageFormat::Format format = ImageFormat::SRGB) {
+  const std::pair<Packet, Packet> frames = MakeFramePair(format);
+  for (int i = 0; i < num_packets; ++i) {
+    runner->MutableInputs()->Tag("FIRST_FRAME").packets.push_back(
+        frames.first.At(Timestamp(i)));
+    runner->MutableInputs()->Tag("SECOND_FRAME").packets.push_back(
+        frames.second.At(Timestamp(i)));
+  }
+}
+
+// Returns mean flow over the interior, excluding the border where the
+// displaced content is not visible in both frames.
+cv::Scalar MeanInteriorFlow(const OpticalFlowField& flow) {
+  const cv::Mat& flow_data = flow.flow_data();
+  const int border = 16;
+  return cv::mean(flow_data(cv::Rect(border, border,
+                                     flow_data.cols - 2 * border,
+                                     flow_data.rows - 2 * border)));
+}
+
+void RunTest(const std::string& preset, int num_input_packets,
+             int max_in_flight,
+             ImageFormat::Format format = ImageFormat::SRGB) {
+  CalculatorRunner runner(MakeNodeConfig(preset, max_in_flight));
+  AddInputPackets(num_input_packets, &runner, format);
+  MP_ASSERT_OK(runner.Run());
+
+  const std::vector<Packet>& forward_packets =
+      runner.Outputs().Tag("FORWARD_FLOW").packets;
+  ASSERT_EQ(num_input_packets, forward_packets.size());
+  for (int i = 0; i < forward_packets.size(); ++i) {
+    const cv::Scalar average =
+        MeanInteriorFlow(forward_packets[i].Get<OpticalFlowField>());
+    EXPECT_NEAR(average[0], kShiftX, 0.5) << "Actual mean_dx = " << average[0];
+    EXPECT_NEAR(average[1], kShiftY, 0.5) << "Actual mean_dy = " << average[1];
+    EXPECT_EQ(i, forward_packets[i].Timestamp().Value());
+  }
+
+  const std::vector<Packet>& backward_packets =
+      runner.Outputs().Tag("BACKWARD_FLOW").packets;
+  ASSERT_EQ(num_input_packets, backward_packets.size());
+  for (int i = 0; i < backward_packets.size(); ++i) {
+    const cv::Scalar average =
+        MeanInteriorFlow(backward_packets[i].Get<OpticalFlowField>());
+    EXPECT_NEAR(average[0], -kShiftX, 0.5)
+        << "Actual mean_dx = " << average[0];
+    EXPECT_NEAR(average[1], -kShiftY, 0.5)
+        << "Actual mean_dy = " << average[1];
+    EXPECT_EQ(i, backward_packets[i].Timestamp().Value());
+  }
+}
+
+TEST(DisOpticalFlowCalculatorTest, UltrafastPreset) {
+  RunTest("ULTRAFAST", /*num_input_packets=*/2, /*max_in_flight=*/1);
+}
+
+TEST(DisOpticalFlowCalculatorTest, FastPreset) {
+  RunTest("FAST", /*num_input_packets=*/2, /*max_in_flight=*/1);
+}
+
+TEST(DisOpticalFlowCalculatorTest, MediumPreset) {
+  RunTest("MEDIUM", /*num_input_packets=*/2, /*max_in_flight=*/1);
+}
+
+TEST(DisOpticalFlowCalculatorTest, ParallelExecution) {
+  RunTest("FAST", /*num_input_packets=*/20, /*max_in_flight=*/10);
+}
+
+TEST(DisOpticalFlowCalculatorTest, SrgbaInput) {
+  RunTest("FAST", /*num_input_packets=*/2, /*max_in_flight=*/1,
+          ImageFormat::SRGBA);
+}
+
+TEST(DisOpticalFlowCalculatorTest, FailsOnUnsupportedFormat) {
+  CalculatorRunner runner(MakeNodeConfig("FAST", /*max_in_flight=*/1));
+  const Packet frame = MakePacket<ImageFrame>(ImageFormat::VEC32F1, 64, 48);
+  runner.MutableInputs()->Tag("FIRST_FRAME").packets.push_back(
+      frame.At(Timestamp(0)));
+  runner.MutableInputs()->Tag("SECOND_FRAME").packets.push_back(
+      frame.At(Timestamp(0)));
+  const absl::Status status = runner.Run();
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(),
+              testing::HasSubstr("Unsupported image format"));
+}
+
+void BM_OpticalFlow(benchmark::State& state,
+                    const CalculatorGraphConfig::Node& node_config) {
+  constexpr int kNumFrames = 8;
+  for (auto _ : state) {
+    CalculatorRunner runner(node_config);
+    AddInputPackets(kNumFrames, &runner);
+    MEDIAPIPE_CHECK_OK(runner.Run());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+}
+
+void BM_DisOpticalFlow(benchmark::State& state) {
+  const char* kPresets[] = {"ULTRAFAST", "FAST", "MEDIUM"};
+  BM_OpticalFlow(state, MakeNodeConfig(kPresets[state.range(0)],
+                                       /*max_in_flight=*/1));
+}
+BENCHMARK(BM_DisOpticalFlow)->Arg(0)->Arg(1)->Arg(2);
+
+// Baseline for comparison.
+void BM_Tvl1OpticalFlow(benchmark::State& state) {
+  CalculatorGraphConfig::Node node_config = MakeNodeConfig("FAST", 1);
+  node_config.set_calculator("Tvl1OpticalFlowCalculator");
+  node_config.clear_options();
+  BM_OpticalFlow(state, node_config);
+}
+BENCHMARK(BM_Tvl1OpticalFlow);
+
+}  // namespace
+}  // namespace mediapipe
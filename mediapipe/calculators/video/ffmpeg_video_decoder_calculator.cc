@@ -0,0 +1,501 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>  // required by avutil.h
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "libyuv/convert_argb.h"
+#include "libyuv/convert_from.h"
+#include "libyuv/video_common.h"
+#include "mediapipe/calculators/video/ffmpeg_video_decoder_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deps/cleanup.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+#include "mediapipe/framework/formats/image_frame_pool_service.h"
+#include "mediapipe/framework/formats/video_stream_header.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/framework/tool/status_util.h"
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/avutil.h"
+#include "libavutil/pixdesc.h"
+}
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kInputFilePathTag[] = "INPUT_FILE_PATH";
+constexpr char kVideoTag[] = "VIDEO";
+constexpr char kYuvVideoTag[] = "YUV_VIDEO";
+constexpr char kVideoPrestreamTag[] = "VIDEO_PRESTREAM";
+
+constexpr AVRational kMicrosecondsTimeBase = {1, 1000000};
+
+std::string AvErrorToString(int error) {
+  char buf[AV_ERROR_MAX_STRING_SIZE];
+  if (av_strerror(error, buf, sizeof(buf)) == 0) {
+    return absl::StrCat("AVERROR(", error, ") - ", buf);
+  }
+  return absl::StrCat("Unknown AVERROR number ", error);
+}
+
+YUVImage::ColorMatrixCoefficients GetColorMatrixCoefficients(
+    AVColorSpace color_space) {
+  switch (color_space) {
+    case AVCOL_SPC_RGB:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_RGB;
+    case AVCOL_SPC_BT709:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_BT709;
+    case AVCOL_SPC_FCC:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_FCC;
+    case AVCOL_SPC_BT470BG:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_BT470BG;
+    case AVCOL_SPC_SMPTE170M:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_SMPTE170M;
+    case AVCOL_SPC_SMPTE240M:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_SMPTE240M;
+    case AVCOL_SPC_BT2020_NCL:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_BT2020_NCL;
+    case AVCOL_SPC_BT2020_CL:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_BT2020_CL;
+    default:
+      return YUVImage::COLOR_MATRIX_COEFFICIENTS_UNSPECIFIED;
+  }
+}
+
+}  // namespace
+
+// Decodes the video stream of a media file with FFmpeg. Unlike
+// OpenCvVideoDecoderCalculator, decoding and color conversion run ahead of the
+// graph on a background thread, and the codec itself decodes with frame and
+// slice threads, so that decoding overlaps the processing of earlier frames.
+// Decoded frames are buffered in a queue of at most `max_queued_frames`.
+//
+// Frames are output either as SRGB ImageFrames on "VIDEO", converted from YUV
+// with libyuv's SIMD kernels, or as I420 YUVImages on "YUV_VIDEO", which
+// reference the decoder's frame buffers without any copy or conversion.
+// ImageFrames are drawn from kImageFramePoolService if the graph provides it.
+// Only 4:2:0 8-bit streams are supported.
+//
+// Output timestamps are the presentation times of the frames in microseconds,
+// relative to the start of the stream. Frames that do not advance the
+// timestamp are dropped. With `start_time_us`, the decoder seeks to the
+// keyframe preceding that time and decodes, but does not output, the frames
+// up to it, so that output starts exactly at the requested frame. Seeking
+// happens once, when the calculator is opened: to decode another range of the
+// file, run the graph again with other options. With `keyframes_only`,
+// non-key packets are skipped entirely.
+//
+// Output Streams:
+//   VIDEO: Output video frames (ImageFrame), or
+//   YUV_VIDEO: Output video frames (YUVImage).
+//   VIDEO_PRESTREAM:
+//       Optional video header information output at
+//       Timestamp::PreStream() for the corresponding stream.
+// Input Side Packets:
+//   INPUT_FILE_PATH: The input file path.
+//
+// Example config:
+// node {
+//   calculator: "FfmpegVideoDecoderCalculator"
+//   input_side_packet: "INPUT_FILE_PATH:input_file_path"
+//   output_stream: "VIDEO:video_frames"
+//   output_stream: "VIDEO_PRESTREAM:video_header"
+//   options {
+//     [mediapipe.FfmpegVideoDecoderCalculatorOptions.ext] {
+//       start_time_us: 10000000
+//       max_queued_frames: 16
+//     }
+//   }
+// }
+class FfmpegVideoDecoderCalculator : public CalculatorBase {
+ public:
+  ~FfmpegVideoDecoderCalculator() override { Shutdown(); }
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->InputSidePackets().Tag(kInputFilePathTag).Set<std::string>();
+    RET_CHECK(cc->Outputs().HasTag(kVideoTag) !=
+              cc->Outputs().HasTag(kYuvVideoTag))
+        << "Exactly one of VIDEO and YUV_VIDEO must be specified.";
+    if (cc->Outputs().HasTag(kVideoTag)) {
+      cc->Outputs().Tag(kVideoTag).Set<ImageFrame>();
+    } else {
+      cc->Outputs().Tag(kYuvVideoTag).Set<YUVImage>();
+    }
+    if (cc->Outputs().HasTag(kVideoPrestreamTag)) {
+      cc->Outputs().Tag(kVideoPrestreamTag).Set<VideoHeader>();
+    }
+    cc->UseService(kImageFramePoolService).Optional();
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    const auto& options = cc->Options<FfmpegVideoDecoderCalculatorOptions>();
+    RET_CHECK_GT(options.max_queued_frames(), 0);
+    max_queued_frames_ = options.max_queued_frames();
+    start_time_us_ = options.start_time_us();
+    end_time_us_ = options.end_time_us();
+    keyframes_only_ = options.keyframes_only();
+    output_yuv_ = cc->Outputs().HasTag(kYuvVideoTag);
+    auto frame_pool_service = cc->Service(kImageFramePoolService);
+    if (frame_pool_service.IsAvailable()) {
+      frame_pool_ = &frame_pool_service.GetObject();
+    }
+
+    const std::string& input_file_path =
+        cc->InputSidePackets().Tag(kInputFilePathTag).Get<std::string>();
+    int error = avformat_open_input(&format_ctx_, input_file_path.c_str(),
+                                    nullptr, nullptr);
+    if (error < 0) {
+      return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "Fail to open video file at " << input_file_path << ": "
+             << AvErrorToString(error);
+    }
+    error = avformat_find_stream_info(format_ctx_, nullptr);
+    if (error < 0) {
+      return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "Fail to read stream info of " << input_file_path << ": "
+             << AvErrorToString(error);
+    }
+    stream_index_ = av_find_best_stream(format_ctx_, AVMEDIA_TYPE_VIDEO, -1,
+                                        -1, nullptr, 0);
+    if (stream_index_ < 0) {
+      return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "No video stream in " << input_file_path;
+    }
+    stream_ = format_ctx_->streams[stream_index_];
+    start_pts_ =
+        stream_->start_time == AV_NOPTS_VALUE ? 0 : stream_->start_time;
+
+    const AVCodec* codec = avcodec_find_decoder(stream_->codecpar->codec_id);
+    if (!codec) {
+      return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "No decoder for the video codec of " << input_file_path;
+    }
+    codec_ctx_ = avcodec_alloc_context3(codec);
+    RET_CHECK(codec_ctx_);
+    RET_CHECK_GE(avcodec_parameters_to_context(codec_ctx_, stream_->codecpar),
+                 0);
+    codec_ctx_->thread_count = options.num_decoder_threads();
+    codec_ctx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    if (keyframes_only_) {
+      codec_ctx_->skip_frame = AVDISCARD_NONKEY;
+    }
+    error = avcodec_open2(codec_ctx_, codec, nullptr);
+    if (error < 0) {
+      return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+             << "avcodec_open2() failed: " << AvErrorToString(error);
+    }
+    if (codec_ctx_->pix_fmt != AV_PIX_FMT_YUV420P &&
+        codec_ctx_->pix_fmt != AV_PIX_FMT_YUVJ420P) {
+      return mediapipe::UnimplementedErrorBuilder(MEDIAPIPE_LOC)
+             << "Unsupported pixel format "
+             << av_get_pix_fmt_name(codec_ctx_->pix_fmt) << " in "
+             << input_file_path;
+    }
+
+    if (start_time_us_ > 0) {
+      const int64 target_pts =
+          start_pts_ +
+          av_rescale_q(start_time_us_, kMicrosecondsTimeBase,
+                       stream_->time_base);
+      error = av_seek_frame(format_ctx_, stream_index_, target_pts,
+                            AVSEEK_FLAG_BACKWARD);
+      if (error < 0) {
+        return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+               << "Fail to seek to " << start_time_us_ << "us in "
+               << input_file_path << ": " << AvErrorToString(error);
+      }
+    }
+
+    if (cc->Outputs().HasTag(kVideoPrestreamTag)) {
+      auto header = absl::make_unique<VideoHeader>();
+      header->format = output_yuv_ ? ImageFormat::YCBCR420P : ImageFormat::SRGB;
+      header->width = codec_ctx_->width;
+      header->height = codec_ctx_->height;
+      header->frame_rate =
+          av_q2d(av_guess_frame_rate(format_ctx_, stream_, nullptr));
+      if (format_ctx_->duration != AV_NOPTS_VALUE) {
+        header->duration =
+            static_cast<float>(format_ctx_->duration) / AV_TIME_BASE;
+      }
+      cc->Outputs()
+          .Tag(kVideoPrestreamTag)
+          .Add(header.release(), Timestamp::PreStream());
+      cc->Outputs().Tag(kVideoPrestreamTag).Close();
+    }
+
+    decoder_thread_ = absl::make_unique<ThreadPool>("ffmpeg_video_decoder", 1);
+    decoder_thread_->StartWorkers();
+    decoder_thread_->Schedule([this] {
+      absl::Status status = DecodeFrames();
+      absl::MutexLock lock(&mutex_);
+      decoder_status_ = status;
+      decoder_done_ = true;
+    });
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    Packet frame;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          this, &FfmpegVideoDecoderCalculator::HasFrameOrIsDone));
+      if (frames_.empty()) {
+        if (!decoder_status_.ok()) {
+          return decoder_status_;
+        }
+        return tool::StatusStop();
+      }
+      frame = std::move(frames_.front());
+      frames_.pop_front();
+    }
+    cc->Outputs()
+        .Tag(output_yuv_ ? kYuvVideoTag : kVideoTag)
+        .AddPacket(std::move(frame));
+    return absl::OkStatus();
+  }
+
+  absl::Status Close(CalculatorContext* cc) override {
+    Shutdown();
+    return absl::OkStatus();
+  }
+
+ private:
+  bool HasFrameOrIsDone() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !frames_.empty() || decoder_done_;
+  }
+
+  bool CanQueueFrame() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return frames_.size() < static_cast<size_t>(max_queued_frames_) ||
+           cancelled_;
+  }
+
+  // Stops the decoder thread and releases the FFmpeg contexts.
+  void Shutdown() {
+    {
+      absl::MutexLock lock(&mutex_);
+      cancelled_ = true;
+    }
+    // Joins the decoder thread.
+    decoder_thread_.reset();
+    if (codec_ctx_) {
+      avcodec_free_context(&codec_ctx_);
+    }
+    if (format_ctx_) {
+      avformat_close_input(&format_ctx_);
+    }
+  }
+
+  // Runs on the decoder thread: demuxes and decodes the video stream, and
+  // queues the converted frames until the end of the stream, end_time_us_, or
+  // cancellation.
+  absl::Status DecodeFrames() {
+    AVPacket* av_packet = av_packet_alloc();
+    AVFrame* av_frame = av_frame_alloc();
+    auto cleanup = MakeCleanup([&av_packet, &av_frame] {
+      av_packet_free(&av_packet);
+      av_frame_free(&av_frame);
+    });
+    RET_CHECK(av_packet && av_frame);
+
+    bool done = false;
+    while (!done) {
+      const int error = av_read_frame(format_ctx_, av_packet);
+      if (error == AVERROR_EOF) {
+        // Drain the frames buffered by the codec.
+        avcodec_send_packet(codec_ctx_, nullptr);
+        return ReceiveFrames(av_frame, /*flushing=*/true, &done);
+      }
+      if (error < 0) {
+        return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+               << "Fail to read packet: " << AvErrorToString(error);
+      }
+      if (av_packet->stream_index != stream_index_ ||
+          (keyframes_only_ && !(av_packet->flags & AV_PKT_FLAG_KEY))) {
+        av_packet_unref(av_packet);
+        continue;
+      }
+      int send_error = avcodec_send_packet(codec_ctx_, av_packet);
+      // The codec takes no more input until the frames it holds are read.
+      while (send_error == AVERROR(EAGAIN) && !done) {
+        MP_RETURN_IF_ERROR(ReceiveFrames(av_frame, /*flushing=*/false, &done));
+        send_error = avcodec_send_packet(codec_ctx_, av_packet);
+      }
+      av_packet_unref(av_packet);
+      if (done) {
+        break;
+      }
+      if (send_error == AVERROR_INVALIDDATA) {
+        LOG(WARNING) << "Skipping corrupt video packet: "
+                     << AvErrorToString(send_error);
+      } else if (send_error < 0) {
+        return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+               << "Fail to send packet: " << AvErrorToString(send_error);
+      }
+      MP_RETURN_IF_ERROR(ReceiveFrames(av_frame, /*flushing=*/false, &done));
+    }
+    return absl::OkStatus();
+  }
+
+  // Queues the frames the codec has decoded so far, or, when flushing, all
+  // remaining ones. Sets done once no more frames are to be output.
+  absl::Status ReceiveFrames(AVFrame* av_frame, bool flushing, bool* done) {
+    while (true) {
+      const int error = avcodec_receive_frame(codec_ctx_, av_frame);
+      if (error == AVERROR_EOF || (error == AVERROR(EAGAIN) && flushing)) {
+        *done = true;
+        return absl::OkStatus();
+      }
+      if (error == AVERROR(EAGAIN)) {
+        return absl::OkStatus();
+      }
+      if (error < 0) {
+        return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+               << "Fail to decode frame: " << AvErrorToString(error);
+      }
+      absl::Status status = QueueFrame(av_frame, done);
+      av_frame_unref(av_frame);
+      MP_RETURN_IF_ERROR(status);
+      if (*done) {
+        return absl::OkStatus();
+      }
+    }
+  }
+
+  // Converts av_frame and queues it for output, waiting while the queue is
+  // full. Sets done once no more frames are to be output.
+  absl::Status QueueFrame(AVFrame* av_frame, bool* done) {
+    int64 pts = av_frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) {
+      pts = av_frame->pts;
+    }
+    if (pts == AV_NOPTS_VALUE) {
+      LOG(WARNING) << "Dropping video frame without timestamp.";
+      return absl::OkStatus();
+    }
+    const int64 time_us =
+        av_rescale_q(pts - start_pts_, stream_->time_base,
+                     kMicrosecondsTimeBase);
+    if (time_us < start_time_us_) {
+      // Decoded only to reach the frame sought to.
+      return absl::OkStatus();
+    }
+    if (end_time_us_ > 0 && time_us >= end_time_us_) {
+      *done = true;
+      return absl::OkStatus();
+    }
+    const Timestamp timestamp(time_us);
+    // If the timestamp of the current frame is not greater than the one of the
+    // previous frame, the new frame will be discarded.
+    if (prev_timestamp_ != Timestamp::Unset() && timestamp <= prev_timestamp_) {
+      return absl::OkStatus();
+    }
+    prev_timestamp_ = timestamp;
+
+    RET_CHECK(av_frame->format == AV_PIX_FMT_YUV420P ||
+              av_frame->format == AV_PIX_FMT_YUVJ420P)
+        << "Unsupported pixel format "
+        << av_get_pix_fmt_name(static_cast<AVPixelFormat>(av_frame->format));
+    Packet frame;
+    if (output_yuv_) {
+      // Keep a reference to the decoder's buffers for as long as the
+      // YUVImage lives.
+      AVFrame* frame_ref = av_frame_clone(av_frame);
+      RET_CHECK(frame_ref);
+      auto yuv_image = absl::make_unique<YUVImage>();
+      yuv_image->Initialize(
+          libyuv::FOURCC_I420,
+          [frame_ref]() mutable { av_frame_free(&frame_ref); },
+          frame_ref->data[0], frame_ref->linesize[0],  //
+          frame_ref->data[1], frame_ref->linesize[1],  //
+          frame_ref->data[2], frame_ref->linesize[2],  //
+          frame_ref->width, frame_ref->height);
+      yuv_image->set_matrix_coefficients(
+          GetColorMatrixCoefficients(av_frame->colorspace));
+      yuv_image->set_full_range(av_frame->format == AV_PIX_FMT_YUVJ420P ||
+                                av_frame->color_range == AVCOL_RANGE_JPEG);
+      frame = Adopt(yuv_image.release()).At(timestamp);
+    } else {
+      std::unique_ptr<ImageFrame> image_frame = AcquireImageFrame(
+          frame_pool_, ImageFormat::SRGB, av_frame->width, av_frame->height);
+      // libyuv's RAW is R, G, B in memory, i.e. SRGB. Streams that do not
+      // specify their color space are assumed to be BT.601.
+      const auto convert = av_frame->colorspace == AVCOL_SPC_BT709
+                               ? libyuv::H420ToRAW
+                               : libyuv::I420ToRAW;
+      const int rv =
+          convert(av_frame->data[0], av_frame->linesize[0],  //
+                  av_frame->data[1], av_frame->linesize[1],  //
+                  av_frame->data[2], av_frame->linesize[2],  //
+                  image_frame->MutablePixelData(), image_frame->WidthStep(),
+                  av_frame->width, av_frame->height);
+      RET_CHECK_EQ(rv, 0) << "Fail to convert video frame to SRGB.";
+      frame = Adopt(image_frame.release()).At(timestamp);
+    }
+
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(
+        absl::Condition(this, &FfmpegVideoDecoderCalculator::CanQueueFrame));
+    if (cancelled_) {
+      *done = true;
+      return absl::OkStatus();
+    }
+    frames_.push_back(std::move(frame));
+    return absl::OkStatus();
+  }
+
+  int max_queued_frames_ = 0;
+  int64 start_time_us_ = 0;
+  int64 end_time_us_ = 0;
+  bool keyframes_only_ = false;
+  bool output_yuv_ = false;
+  // Output ImageFrames are drawn from this pool if set.
+  ImageFrameBufferPool* frame_pool_ = nullptr;
+
+  AVFormatContext* format_ctx_ = nullptr;
+  AVCodecContext* codec_ctx_ = nullptr;
+  AVStream* stream_ = nullptr;
+  int stream_index_ = -1;
+  // Presentation timestamp of the start of the stream, in stream time base.
+  int64 start_pts_ = 0;
+  // Only accessed by the decoder thread.
+  Timestamp prev_timestamp_ = Timestamp::Unset();
+
+  std::unique_ptr<ThreadPool> decoder_thread_;
+  absl::Mutex mutex_;
+  // Decoded frames awaiting output.
+  std::deque<Packet> frames_ ABSL_GUARDED_BY(mutex_);
+  bool decoder_done_ ABSL_GUARDED_BY(mutex_) = false;
+  absl::Status decoder_status_ ABSL_GUARDED_BY(mutex_);
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+REGISTER_CALCULATOR(FfmpegVideoDecoderCalculator);
+}  // namespace mediapipe
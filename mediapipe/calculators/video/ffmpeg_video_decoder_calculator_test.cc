@@ -0,0 +1,108 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/video_stream_header.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kTestVideoPath[] =
+    "/mediapipe/calculators/video/testdata/format_MP4_AVC720P_AAC.video";
+
+CalculatorRunner::StreamContents RunDecoder(const std::string& output_tag,
+                                            const std::string& options) {
+  CalculatorGraphConfig::Node node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::StrCat(
+          R"pb(
+            calculator: "FfmpegVideoDecoderCalculator"
+            input_side_packet: "INPUT_FILE_PATH:input_file_path"
+            output_stream: ")pb",
+          output_tag, R"pb(:video"
+            output_stream: "VIDEO_PRESTREAM:video_prestream"
+            options {
+              [mediapipe.FfmpegVideoDecoderCalculatorOptions.ext] {)pb",
+          options, "}}"));
+  CalculatorRunner runner(node_config);
+  runner.MutableSidePackets()->Tag("INPUT_FILE_PATH") =
+      MakePacket<std::string>(file::JoinPath("./", kTestVideoPath));
+  MP_EXPECT_OK(runner.Run());
+
+  EXPECT_EQ(runner.Outputs().Tag("VIDEO_PRESTREAM").packets.size(), 1);
+  const VideoHeader& header =
+      runner.Outputs().Tag("VIDEO_PRESTREAM").packets[0].Get<VideoHeader>();
+  EXPECT_EQ(1280, header.width);
+  EXPECT_EQ(640, header.height);
+  EXPECT_FLOAT_EQ(30.0f, header.frame_rate);
+  return runner.Outputs().Tag(output_tag);
+}
+
+TEST(FfmpegVideoDecoderCalculatorTest, DecodesToSrgb) {
+  const auto& output = RunDecoder("VIDEO", "max_queued_frames: 4");
+  ASSERT_EQ(180, output.packets.size());
+  for (int i = 0; i < output.packets.size(); ++i) {
+    EXPECT_NEAR(output.packets[i].Timestamp().Value(), i * 1000000 / 30, 1000);
+    cv::Mat output_mat =
+        formats::MatView(&output.packets[i].Get<ImageFrame>());
+    EXPECT_EQ(1280, output_mat.size().width);
+    EXPECT_EQ(640, output_mat.size().height);
+    EXPECT_EQ(3, output_mat.channels());
+    cv::Scalar s = cv::mean(output_mat);
+    for (int c = 0; c < 3; ++c) {
+      EXPECT_GT(s[c], 0);
+      EXPECT_LT(s[c], 255);
+    }
+  }
+}
+
+TEST(FfmpegVideoDecoderCalculatorTest, DecodesToYuv) {
+  const auto& output = RunDecoder("YUV_VIDEO", "");
+  ASSERT_EQ(180, output.packets.size());
+  for (const Packet& packet : output.packets) {
+    const YUVImage& yuv_image = packet.Get<YUVImage>();
+    EXPECT_EQ(libyuv::FOURCC_I420, yuv_image.fourcc());
+    EXPECT_EQ(1280, yuv_image.width());
+    EXPECT_EQ(640, yuv_image.height());
+    EXPECT_GE(yuv_image.stride(0), 1280);
+  }
+}
+
+TEST(FfmpegVideoDecoderCalculatorTest, StartsAtRequestedFrame) {
+  const auto& output =
+      RunDecoder("VIDEO", "start_time_us: 2000000 end_time_us: 3000000");
+  ASSERT_EQ(30, output.packets.size());
+  EXPECT_NEAR(output.packets.front().Timestamp().Value(), 2000000, 1000);
+  EXPECT_NEAR(output.packets.back().Timestamp().Value(), 2966667, 1000);
+}
+
+TEST(FfmpegVideoDecoderCalculatorTest, DecodesKeyframesOnly) {
+  const auto& output = RunDecoder("YUV_VIDEO", "keyframes_only: true");
+  ASSERT_GE(output.packets.size(), 1);
+  EXPECT_LT(output.packets.size(), 180);
+  EXPECT_EQ(output.packets[0].Timestamp(), Timestamp(0));
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -20,6 +20,7 @@
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "mediapipe/calculators/video/motion_analysis_calculator.pb.h"
+#include "mediapipe/calculators/video/tracking_mat_pool_service.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
@@ -31,6 +32,7 @@
 #include "mediapipe/util/tracking/camera_motion.h"
 #include "mediapipe/util/tracking/camera_motion.pb.h"
 #include "mediapipe/util/tracking/frame_selection.pb.h"
+#include "mediapipe/util/tracking/mat_pool.h"
 #include "mediapipe/util/tracking/motion_analysis.h"
 #include "mediapipe/util/tracking/motion_estimation.h"
 #include "mediapipe/util/tracking/motion_models.h"
@@ -185,6 +187,12 @@ class MotionAnalysisCalculator : public CalculatorBase {
   std::unique_ptr<MotionAnalysis> motion_analysis_;
 
   std::unique_ptr<MixtureRowWeights> row_weights_;
+
+  // Pool for image buffers, either from kTrackingMatPoolService or
+  // MatPool::Default(). Not owned.
+  MatPool* mat_pool_ = nullptr;
+  // Pool stats at Open, to export per calculator stats on Close.
+  MatPool::Stats initial_mat_pool_stats_;
 };
 
 REGISTER_CALCULATOR(MotionAnalysisCalculator);
@@ -245,10 +253,17 @@ absl::Status MotionAnalysisCalculator::GetContract(CalculatorContract* cc) {
     cc->InputSidePackets().Tag(kOptionsTag).Set<CalculatorOptions>();
   }
 
+  cc->UseService(kTrackingMatPoolService).Optional();
+
   return absl::OkStatus();
 }
 
 absl::Status MotionAnalysisCalculator::Open(CalculatorContext* cc) {
+  auto mat_pool_service = cc->Service(kTrackingMatPoolService);
+  mat_pool_ = mat_pool_service.IsAvailable() ? &mat_pool_service.GetObject()
+                                             : MatPool::Default();
+  initial_mat_pool_stats_ = mat_pool_->GetStats();
+
   options_ =
       tool::RetrieveOptions(cc->Options<MotionAnalysisCalculatorOptions>(),
                             cc->InputSidePackets(), kOptionsTag);
@@ -445,8 +460,8 @@ absl::Status MotionAnalysisCalculator::Process(CalculatorContext* cc) {
 
   if (motion_analysis_ == nullptr) {
     // We do not need MotionAnalysis when using just metadata.
-    motion_analysis_.reset(new MotionAnalysis(options_.analysis_options(),
-                                              frame_width_, frame_height_));
+    motion_analysis_.reset(new MotionAnalysis(
+        options_.analysis_options(), frame_width_, frame_height_, mat_pool_));
   }
 
   std::unique_ptr<FrameSelectionResult> frame_selection_result;
@@ -587,6 +602,20 @@ absl::Status MotionAnalysisCalculator::Close(CalculatorContext* cc) {
                  << meta_motions_.size();
     }
   }
+
+  // Export buffer pool usage. Note that the pool might be shared with other
+  // calculators, in which case their allocations are included.
+  const MatPool::Stats mat_pool_stats = mat_pool_->GetStats();
+  cc->GetCounter("MatPoolAllocations")
+      ->IncrementBy(mat_pool_stats.num_allocations -
+                    initial_mat_pool_stats_.num_allocations);
+  cc->GetCounter("MatPoolReuses")
+      ->IncrementBy(mat_pool_stats.num_reuses -
+                    initial_mat_pool_stats_.num_reuses);
+  cc->GetCounter("MatPoolEvictions")
+      ->IncrementBy(mat_pool_stats.num_evictions -
+                    initial_mat_pool_stats_.num_evictions);
+  VLOG(1) << "MatPool stats: " << mat_pool_stats.ToString();
   return absl::OkStatus();
 }
 
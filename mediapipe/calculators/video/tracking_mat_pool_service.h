@@ -0,0 +1,32 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_VIDEO_TRACKING_MAT_POOL_SERVICE_H_
+#define MEDIAPIPE_CALCULATORS_VIDEO_TRACKING_MAT_POOL_SERVICE_H_
+
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/util/tracking/mat_pool.h"
+
+namespace mediapipe {
+
+// Optional service providing the MatPool that tracking calculators
+// (e.g. MotionAnalysisCalculator) of a graph allocate their image buffers
+// from. Set a MatPool with a memory budget via
+// CalculatorGraph::SetServiceObject to bound memory per graph. If unset,
+// MatPool::Default() is used.
+extern const GraphService<MatPool> kTrackingMatPoolService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_VIDEO_TRACKING_MAT_POOL_SERVICE_H_
@@ -15,8 +15,8 @@
 #ifndef MEDIAPIPE_FRAMEWORK_CALCULATOR_CONTEXT_H_
 #define MEDIAPIPE_FRAMEWORK_CALCULATOR_CONTEXT_H_
 
+#include <deque>
 #include <memory>
-#include <queue>
 #include <string>
 #include <utility>
 
@@ -85,6 +85,19 @@ class CalculatorContext {
                                      : input_timestamps_.front();
   }
 
+  // Returns the number of input timestamps delivered to the current Process()
+  // call. This is 1 unless the calculator processes input batches (see
+  // CalculatorContract::SetProcessInputBatches), in which case Inputs() hold
+  // the packets of InputBatchSize() consecutive input timestamps.
+  int InputBatchSize() const { return input_batch_size_; }
+
+  // Returns the input timestamp at batch_index within the current input
+  // batch. InputBatchTimestamp(0) is InputTimestamp().
+  Timestamp InputBatchTimestamp(int batch_index) const {
+    CHECK_LT(batch_index, input_batch_size_);
+    return input_timestamps_[batch_index];
+  }
+
   // Returns a reference to the input side packet set.
   const PacketSet& InputSidePackets() const;
   // Returns a reference to the output side packet collection.
@@ -127,16 +140,18 @@ class CalculatorContext {
 
   // Adds a new input timestamp by the friend class CalculatorContextManager.
   void PushInputTimestamp(Timestamp input_timestamp) {
-    input_timestamps_.push(input_timestamp);
+    input_timestamps_.push_back(input_timestamp);
   }
 
   void PopInputTimestamp() {
     CHECK(!input_timestamps_.empty());
-    input_timestamps_.pop();
+    input_timestamps_.pop_front();
   }
 
   void SetGraphStatus(const absl::Status& status) { graph_status_ = status; }
 
+  void SetInputBatchSize(int batch_size) { input_batch_size_ = batch_size; }
+
   // Interface for the friend class Calculator.
   const InputStreamSet& InputStreams() const;
   const OutputStreamSet& OutputStreams() const;
@@ -153,7 +168,10 @@ class CalculatorContext {
   mutable std::unique_ptr<InputStreamSet> input_streams_;
   mutable std::unique_ptr<OutputStreamSet> output_streams_;
   // The queue of timestamp values to Process() in this calculator context.
-  std::queue<Timestamp> input_timestamps_;
+  std::deque<Timestamp> input_timestamps_;
+
+  // The number of input timestamps delivered to the current Process() call.
+  int input_batch_size_ = 1;
 
   // The status of the graph run. Only used when Close() is called.
   absl::Status graph_status_;
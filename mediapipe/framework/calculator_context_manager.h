@@ -90,6 +90,11 @@ class CalculatorContextManager {
     return calculator_context.NumberOfTimestamps();
   }
 
+  Timestamp InputTimestampInContext(const CalculatorContext& calculator_context,
+                                    int index) const {
+    return calculator_context.input_timestamps_[index];
+  }
+
   bool ContextHasInputTimestamp(
       const CalculatorContext& calculator_context) const {
     return calculator_context.HasInputTimestamp();
@@ -112,6 +117,12 @@ class CalculatorContextManager {
     calculator_context->SetGraphStatus(status);
   }
 
+  void SetInputBatchSizeInContext(CalculatorContext* calculator_context,
+                                  int batch_size) {
+    CHECK(calculator_context);
+    calculator_context->SetInputBatchSize(batch_size);
+  }
+
  private:
   CalculatorState* calculator_state_;
   std::shared_ptr<tool::TagMap> input_tag_map_;
@@ -123,6 +123,17 @@ class CalculatorContract {
   }
   bool GetProcessTimestampBounds() const { return process_timestamps_; }
 
+  // When true, a single Process call receives all the input sets the input
+  // stream handler has batched (see BatchInputStreamHandler), rather than
+  // one Process call per input set. Process then reads the packets of each
+  // input timestamp through CalculatorContext::InputBatchSize(),
+  // CalculatorContext::InputBatchTimestamp() and InputStreamShard::Value(int),
+  // and adds output packets at their respective timestamps.
+  void SetProcessInputBatches(bool process_input_batches) {
+    process_input_batches_ = process_input_batches;
+  }
+  bool GetProcessInputBatches() const { return process_input_batches_; }
+
   // Specifies the maximum difference between input and output timestamps.
   // When specified, the mediapipe framework automatically computes output
   // timestamp bounds based on input timestamps.  The special value
@@ -174,6 +185,7 @@ class CalculatorContract {
   std::string node_name_;
   std::map<std::string, GraphServiceRequest> service_requests_;
   bool process_timestamps_ = false;
+  bool process_input_batches_ = false;
   TimestampDiff timestamp_offset_ = TimestampDiff::Unset();
 };
 
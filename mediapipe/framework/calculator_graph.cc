@@ -32,6 +32,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_base.h"
 #include "mediapipe/framework/counter_factory.h"
@@ -268,6 +269,19 @@ absl::Status CalculatorGraph::InitializeProfiler() {
   return absl::OkStatus();
 }
 
+void CalculatorGraph::InitializeSchedulingOptions() {
+  const CalculatorGraphConfig& config = validated_graph_->Config();
+  const GraphSchedulingConfig& scheduling = config.scheduling();
+  TaskQueueSchedulingOptions options;
+  options.name = scheduling.name().empty() ? config.type() : scheduling.name();
+  options.priority = scheduling.priority();
+  if (scheduling.weight() > 0) {
+    options.weight = scheduling.weight();
+  }
+  options.latency_budget = absl::Microseconds(scheduling.latency_budget_us());
+  scheduler_.SetSchedulingOptions(options);
+}
+
 absl::Status CalculatorGraph::InitializeExecutors() {
   // If the ExecutorConfig for the default executor leaves the executor type
   // unspecified, default_executor_options points to the
@@ -372,6 +386,7 @@ absl::Status CalculatorGraph::Initialize(
       << "validated_graph is not initialized.";
   validated_graph_ = std::move(validated_graph);
 
+  InitializeSchedulingOptions();
   MP_RETURN_IF_ERROR(InitializeExecutors());
   MP_RETURN_IF_ERROR(InitializePacketGeneratorGraph(side_packets));
   MP_RETURN_IF_ERROR(InitializeStreams());
@@ -398,6 +413,14 @@ absl::Status CalculatorGraph::Initialize(
   return Initialize(std::move(validated_graph), side_packets);
 }
 
+absl::Status CalculatorGraph::Initialize(
+    const CompiledGraphConfig& compiled_config,
+    const std::map<std::string, Packet>& side_packets) {
+  auto validated_graph = absl::make_unique<ValidatedGraphConfig>();
+  MP_RETURN_IF_ERROR(validated_graph->Initialize(compiled_config));
+  return Initialize(std::move(validated_graph), side_packets);
+}
+
 absl::Status CalculatorGraph::Initialize(
     const std::vector<CalculatorGraphConfig>& input_configs,
     const std::vector<CalculatorGraphTemplate>& input_templates,
@@ -806,43 +829,7 @@ absl::Status CalculatorGraph::AddPacketToInputStreamInternal(
       stream_name);
   int node_id = mediapipe::FindOrDie(graph_input_stream_node_ids_, stream_name);
   CHECK_GE(node_id, validated_graph_->CalculatorInfos().size());
-  {
-    absl::MutexLock lock(&full_input_streams_mutex_);
-    if (full_input_streams_.empty()) {
-      return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
-             << "CalculatorGraph::AddPacketToInputStream() is called before "
-                "StartRun()";
-    }
-    if (graph_input_stream_add_mode_ ==
-        GraphInputStreamAddMode::ADD_IF_NOT_FULL) {
-      if (has_error_) {
-        absl::Status error_status;
-        GetCombinedErrors("Graph has errors: ", &error_status);
-        return error_status;
-      }
-      // Return with StatusUnavailable if this stream is being throttled.
-      if (!full_input_streams_[node_id].empty()) {
-        return mediapipe::UnavailableErrorBuilder(MEDIAPIPE_LOC)
-               << "Graph is throttled.";
-      }
-    } else if (graph_input_stream_add_mode_ ==
-               GraphInputStreamAddMode::WAIT_TILL_NOT_FULL) {
-      // Wait until this stream is not being throttled.
-      // TODO: instead of checking has_error_, we could just check
-      // if the graph is done. That could also be indicated by returning an
-      // error from WaitUntilGraphInputStreamUnthrottled.
-      while (!has_error_ && !full_input_streams_[node_id].empty()) {
-        // TODO: allow waiting for a specific stream?
-        scheduler_.WaitUntilGraphInputStreamUnthrottled(
-            &full_input_streams_mutex_);
-      }
-      if (has_error_) {
-        absl::Status error_status;
-        GetCombinedErrors("Graph has errors: ", &error_status);
-        return error_status;
-      }
-    }
-  }
+  MP_RETURN_IF_ERROR(WaitForGraphInputStreamCapacity(node_id));
 
   // Adding profiling info for a new packet entering the graph.
   const std::string* stream_id = &(*stream)->GetManager()->Name();
@@ -874,6 +861,91 @@ absl::Status CalculatorGraph::AddPacketToInputStreamInternal(
   return absl::OkStatus();
 }
 
+absl::Status CalculatorGraph::AddPacketsToInputStream(
+    const std::string& stream_name, std::vector<Packet> packets) {
+  std::unique_ptr<GraphInputStream>* stream =
+      mediapipe::FindOrNull(graph_input_streams_, stream_name);
+  RET_CHECK(stream).SetNoLogging() << absl::Substitute(
+      "AddPacketsToInputStream called on input stream \"$0\" which is not a "
+      "graph input stream.",
+      stream_name);
+  int node_id = mediapipe::FindOrDie(graph_input_stream_node_ids_, stream_name);
+  CHECK_GE(node_id, validated_graph_->CalculatorInfos().size());
+  const std::string* stream_id = &(*stream)->GetManager()->Name();
+
+  // Bound the number of packets added past the max queue size to one batch.
+  size_t batch_size = packets.size();
+  if (graph_input_stream_add_mode_ ==
+      GraphInputStreamAddMode::WAIT_TILL_NOT_FULL) {
+    const int max_queue_size = mediapipe::FindWithDefault(
+        graph_input_stream_max_queue_size_, stream_name, max_queue_size_);
+    if (max_queue_size > 0) {
+      batch_size = max_queue_size;
+    }
+  }
+  for (size_t begin = 0; begin < packets.size(); begin += batch_size) {
+    MP_RETURN_IF_ERROR(WaitForGraphInputStreamCapacity(node_id));
+    const size_t end = std::min(packets.size(), begin + batch_size);
+    for (size_t i = begin; i < end; ++i) {
+      profiler_->LogEvent(TraceEvent(TraceEvent::PROCESS)
+                              .set_is_finish(true)
+                              .set_input_ts(packets[i].Timestamp())
+                              .set_stream_id(stream_id)
+                              .set_packet_ts(packets[i].Timestamp())
+                              .set_packet_data_id(&packets[i]));
+      (*stream)->AddPacket(std::move(packets[i]));
+    }
+    if (has_error_) {
+      absl::Status error_status;
+      GetCombinedErrors("Graph has errors: ", &error_status);
+      return error_status;
+    }
+    (*stream)->PropagateUpdatesToMirrors();
+    VLOG(2) << end - begin << " packets added directly to: " << stream_name;
+    scheduler_.AddedPacketToGraphInputStream();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CalculatorGraph::WaitForGraphInputStreamCapacity(int node_id) {
+  absl::MutexLock lock(&full_input_streams_mutex_);
+  if (full_input_streams_.empty()) {
+    return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
+           << "CalculatorGraph::AddPacketToInputStream() is called before "
+              "StartRun()";
+  }
+  if (graph_input_stream_add_mode_ ==
+      GraphInputStreamAddMode::ADD_IF_NOT_FULL) {
+    if (has_error_) {
+      absl::Status error_status;
+      GetCombinedErrors("Graph has errors: ", &error_status);
+      return error_status;
+    }
+    // Return with StatusUnavailable if this stream is being throttled.
+    if (!full_input_streams_[node_id].empty()) {
+      return mediapipe::UnavailableErrorBuilder(MEDIAPIPE_LOC)
+             << "Graph is throttled.";
+    }
+  } else if (graph_input_stream_add_mode_ ==
+             GraphInputStreamAddMode::WAIT_TILL_NOT_FULL) {
+    // Wait until this stream is not being throttled.
+    // TODO: instead of checking has_error_, we could just check
+    // if the graph is done. That could also be indicated by returning an
+    // error from WaitUntilGraphInputStreamUnthrottled.
+    while (!has_error_ && !full_input_streams_[node_id].empty()) {
+      // TODO: allow waiting for a specific stream?
+      scheduler_.WaitUntilGraphInputStreamUnthrottled(
+          &full_input_streams_mutex_);
+    }
+    if (has_error_) {
+      absl::Status error_status;
+      GetCombinedErrors("Graph has errors: ", &error_status);
+      return error_status;
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::Status CalculatorGraph::SetInputStreamMaxQueueSize(
     const std::string& stream_name, int max_queue_size) {
   // graph_input_streams_ has not been filled in yet, so we'll check this when
@@ -34,6 +34,7 @@
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_base.h"
 #include "mediapipe/framework/calculator_node.h"
+#include "mediapipe/framework/compiled_graph_config.pb.h"
 #include "mediapipe/framework/counter_factory.h"
 #include "mediapipe/framework/executor.h"
 #include "mediapipe/framework/graph_output_stream.h"
@@ -146,6 +147,13 @@ class CalculatorGraph {
       const std::string& graph_type = "",
       const Subgraph::SubgraphOptions* options = nullptr);
 
+  // Initializes the graph from a config precompiled by
+  // ValidatedGraphConfig::Compile(), e.g. using tool/compile_graph.cc. This
+  // skips subgraph expansion, topological sorting and stream type
+  // validation, and fails if the config is stale.
+  absl::Status Initialize(const CompiledGraphConfig& compiled_config,
+                          const std::map<std::string, Packet>& side_packets);
+
   // Returns the canonicalized CalculatorGraphConfig for this graph.
   const CalculatorGraphConfig& Config() const {
     return validated_graph_->Config();
@@ -255,6 +263,21 @@ class CalculatorGraph {
   absl::Status AddPacketToInputStream(const std::string& stream_name,
                                       Packet&& packet);
 
+  // Adds packets, in increasing timestamp order, to a graph input stream.
+  // Equivalent to calling AddPacketToInputStream for each packet, but the
+  // graph is locked, checked for throttling and notified once per batch of
+  // packets rather than once per packet. Moving the packets in avoids
+  // copying them.
+  //
+  // In the ADD_IF_NOT_FULL mode, the packets are added all at once, or not
+  // at all with StatusUnavailable if the stream is throttled. In the
+  // WAIT_TILL_NOT_FULL mode, the packets are added in batches of at most the
+  // stream's max queue size, waiting until the stream is not throttled
+  // before each batch. If an error is returned, the packets preceding the
+  // failing batch have been added.
+  absl::Status AddPacketsToInputStream(const std::string& stream_name,
+                                       std::vector<Packet> packets);
+
   // Sets the queue size of a graph input stream, overriding the graph default.
   absl::Status SetInputStreamMaxQueueSize(const std::string& stream_name,
                                           int max_queue_size);
@@ -454,6 +477,12 @@ class CalculatorGraph {
   absl::Status AddPacketToInputStreamInternal(const std::string& stream_name,
                                               T&& packet);
 
+  // Applies graph_input_stream_add_mode_ before packets are added to the
+  // graph input stream feeding node_id: waits until the stream is not
+  // throttled, or returns StatusUnavailable if it is in the ADD_IF_NOT_FULL
+  // mode.
+  absl::Status WaitForGraphInputStreamCapacity(int node_id);
+
   // Sets the executor that will run the nodes assigned to the executor
   // named |name|.  If |name| is empty, this sets the default executor.
   // Does not check that the graph is uninitialized and |name| is not a
@@ -480,6 +509,7 @@ class CalculatorGraph {
   static bool IsReservedExecutorName(const std::string& name);
 
   // Helper functions for Initialize().
+  void InitializeSchedulingOptions();
   absl::Status InitializeExecutors();
   absl::Status InitializePacketGeneratorGraph(
       const std::map<std::string, Packet>& side_packets);
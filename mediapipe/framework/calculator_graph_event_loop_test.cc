@@ -22,6 +22,7 @@
 #include "absl/time/time.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_graph.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/core_proto_inc.h"
 #include "mediapipe/framework/port/gmock.h"
@@ -625,5 +626,188 @@ TEST_F(CalculatorGraphEventLoopTest, UnthrottleSources) {
   EXPECT_LE(loop_count, 2);
 }
 
+// Verify that AddPacketsToInputStream adds all packets in the
+// WAIT_TILL_NOT_FULL mode, even beyond max_queue_size, and that
+// OutputStreamPoller::NextBatch returns them in order and in batches of at
+// most the requested size.
+TEST_F(CalculatorGraphEventLoopTest, AddPacketsAndPollBatches) {
+  CalculatorGraphConfig graph_config;
+  ASSERT_TRUE(proto_ns::TextFormat::ParseFromString(
+      R"(
+          node {
+            calculator: "PassThroughCalculator"
+            input_stream: "input_numbers"
+            output_stream: "output_numbers"
+          }
+          input_stream: "input_numbers"
+          output_stream: "output_numbers"
+          num_threads: 2
+          max_queue_size: 10
+      )",
+      &graph_config));
+  constexpr int kNumInputPackets = 100;
+  constexpr int kMaxBatchSize = 16;
+
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(graph_config));
+  auto poller_status = graph.AddOutputStreamPoller("output_numbers");
+  MP_ASSERT_OK(poller_status.status());
+  mediapipe::OutputStreamPoller& poller = poller_status.value();
+  poller.SetMaxQueueSize(-1);
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  std::vector<Packet> input_packets;
+  for (int i = 0; i < kNumInputPackets; ++i) {
+    input_packets.push_back(MakePacket<int>(i).At(Timestamp(i)));
+  }
+  MP_ASSERT_OK(
+      graph.AddPacketsToInputStream("input_numbers", std::move(input_packets)));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+
+  std::vector<int> values;
+  std::vector<Packet> batch;
+  while (poller.NextBatch(kMaxBatchSize, &batch)) {
+    EXPECT_FALSE(batch.empty());
+    EXPECT_LE(batch.size(), kMaxBatchSize);
+    for (const Packet& packet : batch) {
+      EXPECT_EQ(packet.Timestamp(), Timestamp(packet.Get<int>()));
+      values.push_back(packet.Get<int>());
+    }
+  }
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(kNumInputPackets, values.size());
+  for (int i = 0; i < kNumInputPackets; ++i) {
+    EXPECT_EQ(i, values[i]);
+  }
+}
+
+// Verify that AddPacketsToInputStream adds all packets or none in the
+// ADD_IF_NOT_FULL mode.
+TEST_F(CalculatorGraphEventLoopTest, TryToAddPacketsToInputStream) {
+  CalculatorGraphConfig graph_config;
+  ASSERT_TRUE(proto_ns::TextFormat::ParseFromString(
+      R"(
+          node {
+            calculator: "BlockingPassThroughCalculator"
+            input_stream: "input_numbers"
+            output_stream: "output_numbers"
+            input_side_packet: "blocking_mutex"
+          }
+          node {
+            calculator: "CallbackCalculator"
+            input_stream: "output_numbers"
+            input_side_packet: "CALLBACK:callback"
+          }
+          input_stream: "input_numbers"
+          num_threads: 2
+          max_queue_size: 1
+      )",
+      &graph_config));
+
+  absl::Mutex* mutex = new absl::Mutex();
+  Packet mutex_side_packet = AdoptAsUniquePtr(mutex);
+
+  CalculatorGraph graph(graph_config);
+  graph.SetGraphInputStreamAddMode(
+      CalculatorGraph::GraphInputStreamAddMode::ADD_IF_NOT_FULL);
+  MP_ASSERT_OK(graph.StartRun(
+      {{"callback", MakePacket<std::function<void(const Packet&)>>(std::bind(
+                        &CalculatorGraphEventLoopTest::AddThreadSafeVectorSink,
+                        this, std::placeholders::_1))},
+       {"blocking_mutex", mutex_side_packet}}));
+
+  // Lock the mutex so that the BlockingPassThroughCalculator cannot read any of
+  // these packets.
+  mutex->Lock();
+  std::vector<Packet> input_packets;
+  for (int i = 0; i < 5; ++i) {
+    input_packets.push_back(Adopt(new int(i)).At(Timestamp(i)));
+  }
+  // The stream is not throttled yet, so all 5 packets are added, filling the
+  // queue beyond max_queue_size.
+  MP_EXPECT_OK(
+      graph.AddPacketsToInputStream("input_numbers", std::move(input_packets)));
+  input_packets.clear();
+  for (int i = 5; i < 10; ++i) {
+    input_packets.push_back(Adopt(new int(i)).At(Timestamp(i)));
+  }
+  absl::Status status =
+      graph.AddPacketsToInputStream("input_numbers", std::move(input_packets));
+  mutex->Unlock();
+  EXPECT_EQ(status.code(), absl::StatusCode::kUnavailable);
+
+  MP_ASSERT_OK(graph.CloseInputStream("input_numbers"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  absl::ReaderMutexLock lock(&output_packets_mutex_);
+  EXPECT_EQ(5, output_packets_.size());
+}
+
+// Passes 1024 packets per iteration through a graph, adding them in batches
+// of state.range(0) packets and polling them in batches of state.range(1)
+// packets. Batches of 1 use the single-packet APIs.
+void BM_AddAndPollPackets(benchmark::State& state) {
+  CalculatorGraphConfig graph_config;
+  ASSERT_TRUE(proto_ns::TextFormat::ParseFromString(
+      R"(
+          node {
+            calculator: "PassThroughCalculator"
+            input_stream: "input_numbers"
+            output_stream: "output_numbers"
+          }
+          input_stream: "input_numbers"
+          output_stream: "output_numbers"
+      )",
+      &graph_config));
+  constexpr int kNumPackets = 1024;
+  const int add_batch_size = state.range(0);
+  const int poll_batch_size = state.range(1);
+
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(graph_config));
+  auto poller_status = graph.AddOutputStreamPoller("output_numbers");
+  MP_ASSERT_OK(poller_status.status());
+  mediapipe::OutputStreamPoller& poller = poller_status.value();
+  poller.SetMaxQueueSize(-1);
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  int64 timestamp = 0;
+  Packet packet;
+  std::vector<Packet> packets;
+  for (auto _ : state) {
+    for (int i = 0; i < kNumPackets; i += add_batch_size) {
+      if (add_batch_size == 1) {
+        MP_ASSERT_OK(graph.AddPacketToInputStream(
+            "input_numbers", MakePacket<int>(i).At(Timestamp(timestamp++))));
+        continue;
+      }
+      packets.clear();
+      for (int j = 0; j < add_batch_size; ++j) {
+        packets.push_back(MakePacket<int>(i + j).At(Timestamp(timestamp++)));
+      }
+      MP_ASSERT_OK(
+          graph.AddPacketsToInputStream("input_numbers", std::move(packets)));
+    }
+    for (int num_polled = 0; num_polled < kNumPackets;) {
+      if (poll_batch_size == 1) {
+        ASSERT_TRUE(poller.Next(&packet));
+        ++num_polled;
+      } else {
+        ASSERT_TRUE(poller.NextBatch(poll_batch_size, &packets));
+        num_polled += packets.size();
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPackets);
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+BENCHMARK(BM_AddAndPollPackets)
+    ->Args({1, 1})
+    ->Args({64, 1})
+    ->Args({1, 64})
+    ->Args({64, 64});
+
 }  // namespace
 }  // namespace mediapipe
@@ -21,6 +21,7 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <string>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -32,6 +33,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -969,6 +971,52 @@ class PthreadSelfSourceCalculator : public CalculatorBase {
 };
 REGISTER_CALCULATOR(PthreadSelfSourceCalculator);
 
+// Records the thread and input timestamp of every Process() call, including
+// the calls for timestamp bound increases. Forwards even ints and drops odd
+// ones, leaving only the timestamp bound to downstream nodes.
+class ThreadRecorderCalculator : public CalculatorBase {
+ public:
+  struct Invocation {
+    std::string node;
+    Timestamp timestamp;
+    bool has_packet;
+    pthread_t thread;
+  };
+
+  static absl::Mutex mutex;
+  static std::vector<Invocation>* invocations;
+
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<int>();
+    cc->Outputs().Index(0).Set<int>();
+    cc->SetProcessTimestampBounds(true);
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) final {
+    cc->SetOffset(TimestampDiff(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) final {
+    const Packet& packet = cc->Inputs().Index(0).Value();
+    {
+      absl::MutexLock lock(&mutex);
+      invocations->push_back({cc->NodeName(), cc->InputTimestamp(),
+                              !packet.IsEmpty(), pthread_self()});
+    }
+    if (!packet.IsEmpty() && packet.Get<int>() % 2 == 0) {
+      cc->Outputs().Index(0).AddPacket(packet);
+    }
+    return absl::OkStatus();
+  }
+};
+absl::Mutex ThreadRecorderCalculator::mutex(absl::kConstInit);
+std::vector<ThreadRecorderCalculator::Invocation>*
+    ThreadRecorderCalculator::invocations =
+        new std::vector<ThreadRecorderCalculator::Invocation>();
+REGISTER_CALCULATOR(ThreadRecorderCalculator);
+
 // A source calculator for testing the Calculator::InputTimestamp() method.
 // It outputs five int packets with timestamps 0, 1, 2, 3, 4.
 class CheckInputTimestampSourceCalculator : public CalculatorBase {
@@ -4356,5 +4404,82 @@ TEST(CalculatorGraph, GraphInputStreamWithTag) {
   ASSERT_EQ(5, packet_dump.size());
 }
 
+// Runs a linear chain with and without fuse_linear_chains. Packets and
+// timestamp bounds reach the end of the chain either way. When fused, the
+// downstream nodes run on the thread of the head of the chain.
+TEST(CalculatorGraph, FusedLinearChain) {
+  for (bool fuse : {false, true}) {
+    CalculatorGraphConfig config =
+        mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+          input_stream: "in"
+          num_threads: 4
+          node {
+            name: "a"
+            calculator: "ThreadRecorderCalculator"
+            input_stream: "in"
+            output_stream: "a"
+          }
+          node {
+            name: "b"
+            calculator: "ThreadRecorderCalculator"
+            input_stream: "a"
+            output_stream: "b"
+          }
+          node {
+            name: "c"
+            calculator: "ThreadRecorderCalculator"
+            input_stream: "b"
+            output_stream: "c"
+          }
+        )pb");
+    config.set_fuse_linear_chains(fuse);
+    std::vector<Packet> output;
+    tool::AddVectorSink("c", &config, &output);
+    ThreadRecorderCalculator::invocations->clear();
+
+    CalculatorGraph graph;
+    MP_ASSERT_OK(graph.Initialize(config));
+    MP_ASSERT_OK(graph.StartRun({}));
+    constexpr int kNumPackets = 20;
+    for (int i = 0; i < kNumPackets; ++i) {
+      MP_ASSERT_OK(graph.AddPacketToInputStream(
+          "in", MakePacket<int>(i).At(Timestamp(i))));
+      // Lets every bound increase reach the end of the chain on its own.
+      MP_ASSERT_OK(graph.WaitUntilIdle());
+    }
+    MP_ASSERT_OK(graph.CloseAllInputStreams());
+    MP_ASSERT_OK(graph.WaitUntilDone());
+
+    ASSERT_EQ(kNumPackets / 2, output.size()) << "fuse: " << fuse;
+    for (int i = 0; i < kNumPackets / 2; ++i) {
+      EXPECT_EQ(2 * i, output[i].Get<int>());
+      EXPECT_EQ(Timestamp(2 * i), output[i].Timestamp());
+    }
+    // Nodes b and c are invoked at each timestamp, with a packet for even
+    // timestamps and for the timestamp bound only for odd ones.
+    std::map<std::string, std::vector<ThreadRecorderCalculator::Invocation>>
+        by_node;
+    for (const auto& invocation : *ThreadRecorderCalculator::invocations) {
+      by_node[invocation.node].push_back(invocation);
+    }
+    for (const std::string node : {"a", "b", "c"}) {
+      ASSERT_EQ(kNumPackets, by_node[node].size()) << node;
+      for (int i = 0; i < kNumPackets; ++i) {
+        EXPECT_EQ(Timestamp(i), by_node[node][i].timestamp) << node;
+        EXPECT_EQ(node == "a" || i % 2 == 0, by_node[node][i].has_packet)
+            << node << " at " << i;
+      }
+    }
+    if (fuse) {
+      for (int i = 0; i < kNumPackets; ++i) {
+        EXPECT_TRUE(pthread_equal(by_node["a"][i].thread,
+                                  by_node["b"][i].thread));
+        EXPECT_TRUE(pthread_equal(by_node["a"][i].thread,
+                                  by_node["c"][i].thread));
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -144,6 +144,7 @@ absl::Status CalculatorNode::Initialize(
       validated_graph_->CalculatorInfos()[node_id_];
   const CalculatorContract& contract = node_type_info.Contract();
 
+  fused_with_upstream_ = node_type_info.FusedWithUpstream();
   uses_gpu_ =
       node_type_info.InputSidePacketTypes().HasTag(kGpuSharedTagName) ||
       ContainsKey(node_type_info.Contract().ServiceRequests(), kGpuService.key);
@@ -200,6 +201,7 @@ absl::Status CalculatorNode::Initialize(
   }
   input_stream_handler_->SetProcessTimestampBounds(
       contract.GetProcessTimestampBounds());
+  process_input_batches_ = contract.GetProcessInputBatches();
 
   return InitializeInputStreams(input_stream_managers, output_stream_managers);
 }
@@ -850,6 +852,22 @@ absl::Status CalculatorNode::ProcessNode(
     RET_CHECK(num_invocations <= 1 || max_in_flight_ <= 1)
         << "num_invocations:" << num_invocations
         << ", max_in_flight_:" << max_in_flight_;
+    if (process_input_batches_) {
+      // A trailing Timestamp::Done() is handled by the loop below.
+      int batch_size = 0;
+      while (batch_size < num_invocations &&
+             calculator_context_manager_.InputTimestampInContext(
+                 *calculator_context, batch_size).IsAllowedInStream()) {
+        ++batch_size;
+      }
+      if (batch_size > 1) {
+        result = ProcessInputBatch(calculator_context, batch_size);
+        if (!result.ok()) {
+          return result;
+        }
+        num_invocations -= batch_size;
+      }
+    }
     for (int i = 0; i < num_invocations; ++i) {
       const Timestamp input_timestamp = calculator_context->InputTimestamp();
       // The node is ready for Process().
@@ -910,6 +928,46 @@ absl::Status CalculatorNode::ProcessNode(
   }
 }
 
+absl::Status CalculatorNode::ProcessInputBatch(
+    CalculatorContext* calculator_context, int batch_size) {
+  OutputStreamShardSet* const outputs = &calculator_context->Outputs();
+  const Timestamp first_timestamp = calculator_context->InputTimestamp();
+  const Timestamp last_timestamp =
+      calculator_context_manager_.InputTimestampInContext(*calculator_context,
+                                                          batch_size - 1);
+  output_stream_handler_->PrepareOutputs(first_timestamp, outputs);
+
+  VLOG(2) << "Calling Calculator::Process() for node: " << DebugName()
+          << " timestamps: " << first_timestamp << " to " << last_timestamp;
+  absl::Status result;
+  if (OutputsAreConstant(calculator_context)) {
+    // Do nothing.
+    result = absl::OkStatus();
+  } else {
+    calculator_context_manager_.SetInputBatchSizeInContext(calculator_context,
+                                                           batch_size);
+    {
+      MEDIAPIPE_PROFILING(PROCESS, calculator_context);
+      LegacyCalculatorSupport::Scoped<CalculatorContext> s(calculator_context);
+      result = calculator_->Process(calculator_context);
+    }
+    calculator_context_manager_.SetInputBatchSizeInContext(calculator_context,
+                                                           1);
+  }
+
+  for (int i = 0; i < batch_size; ++i) {
+    input_stream_handler_->ClearCurrentInputs(calculator_context);
+  }
+  if (!result.ok() && result != tool::StatusStop()) {
+    return mediapipe::StatusBuilder(result, MEDIAPIPE_LOC).SetPrepend()
+           << absl::Substitute("Calculator::Process() for node \"$0\" failed: ",
+                               DebugName());
+  }
+  // Output packets of all input timestamps are propagated together.
+  output_stream_handler_->PostProcess(last_timestamp);
+  return result;
+}
+
 void CalculatorNode::SetQueueSizeCallbacks(
     InputStreamManager::QueueSizeCallback becomes_full_callback,
     InputStreamManager::QueueSizeCallback becomes_not_full_callback) {
@@ -161,6 +161,10 @@ class CalculatorNode {
 
   int source_layer() const { return source_layer_; }
 
+  // Returns true if the node runs right after its upstream node on the same
+  // thread, see CalculatorGraphConfig::fuse_linear_chains.
+  bool IsFusedWithUpstream() const { return fused_with_upstream_; }
+
   // Checks if the node can be scheduled; if so, increases current_in_flight_
   // and returns true; otherwise, returns false.
   // If true is returned, the scheduler must commit to executing the node, and
@@ -234,6 +238,11 @@ class CalculatorNode {
   }
 
  private:
+  // Calls Process() once for the first batch_size input timestamps of
+  // calculator_context, for calculators that process input batches.
+  absl::Status ProcessInputBatch(CalculatorContext* calculator_context,
+                                 int batch_size);
+
   // Sets up the output side packets from the master flat array.
   absl::Status InitializeOutputSidePackets(
       const PacketTypeSet& output_side_packet_types,
@@ -307,6 +316,10 @@ class CalculatorNode {
 
   // The max number of invocations that can be scheduled in parallel.
   int max_in_flight_ = 1;
+  // True if the calculator processes all batched input sets in one Process()
+  // call, see CalculatorContract::SetProcessInputBatches.
+  bool process_input_batches_ = false;
+  bool fused_with_upstream_ = false;
   // The following two variables are used for the concurrency control of node
   // scheduling.
   //
@@ -18,6 +18,12 @@ namespace mediapipe {
 
 TaskQueue::~TaskQueue() {}
 
+const TaskQueueSchedulingOptions& TaskQueue::SchedulingOptions() const {
+  static const TaskQueueSchedulingOptions* default_options =
+      new TaskQueueSchedulingOptions();
+  return *default_options;
+}
+
 Executor::~Executor() {}
 
 }  // namespace mediapipe
@@ -18,6 +18,9 @@
 #define MEDIAPIPE_FRAMEWORK_EXECUTOR_H_
 
 #include <functional>
+#include <string>
+
+#include "absl/time/time.h"
 
 // TODO: Move protos in another CL after the C++ code migration.
 #include "mediapipe/framework/deps/registration.h"
@@ -26,6 +29,20 @@
 
 namespace mediapipe {
 
+// Parameters of a TaskQueue for executors that order the tasks of several
+// task queues, e.g. of graphs sharing an executor. See PriorityExecutor.
+struct TaskQueueSchedulingOptions {
+  // The name under which the executor reports statistics for the queue.
+  std::string name;
+  // Tasks of queues with a higher priority run first.
+  int priority = 0;
+  // The relative share of executor time among queues of equal priority.
+  double weight = 1.0;
+  // If positive, tasks are due this long after they became ready, and run
+  // earliest deadline first.
+  absl::Duration latency_budget = absl::ZeroDuration();
+};
+
 // Abstract base class for the task queue.
 // NOTE: The task queue orders the ready tasks by their priorities. This
 // enables the executor to run ready tasks in priority order.
@@ -37,6 +54,10 @@ class TaskQueue {
   // executor. This method should be called exactly as many times as AddTask
   // was called on the executor.
   virtual void RunNextTask() = 0;
+
+  // Returns the scheduling parameters of this queue. Must not change while
+  // the queue has tasks added to an executor.
+  virtual const TaskQueueSchedulingOptions& SchedulingOptions() const;
 };
 
 // Abstract base class for the Executor.
@@ -84,11 +84,13 @@ ImageFrame& ImageFrame::operator=(ImageFrame&& move_from) {
   width_ = move_from.width_;
   height_ = move_from.height_;
   width_step_ = move_from.width_step_;
+  pixel_data_shared_ = move_from.pixel_data_shared_;
 
   move_from.format_ = ImageFormat::UNKNOWN;
   move_from.width_ = 0;
   move_from.height_ = 0;
   move_from.width_step_ = 0;
+  move_from.pixel_data_shared_ = false;
   return *this;
 }
 
@@ -99,6 +101,7 @@ void ImageFrame::Reset(ImageFormat::Format format, int width, int height,
   height_ = height;
   CHECK_NE(ImageFormat::UNKNOWN, format_);
   CHECK(IsValidAlignmentNumber(alignment_boundary));
+  pixel_data_shared_ = false;
   width_step_ = width * NumberOfChannels() * ByteDepth();
   if (alignment_boundary == 1) {
     pixel_data_ = {new uint8[height * width_step_],
@@ -127,9 +130,11 @@ void ImageFrame::AdoptPixelData(ImageFormat::Format format, int width,
   CHECK_GE(width_step_, width * NumberOfChannels() * ByteDepth());
 
   pixel_data_ = {pixel_data, deleter};
+  pixel_data_shared_ = false;
 }
 
 std::unique_ptr<uint8[], ImageFrame::Deleter> ImageFrame::Release() {
+  pixel_data_shared_ = false;
   return std::move(pixel_data_);
 }
 
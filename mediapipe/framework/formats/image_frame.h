@@ -175,6 +175,14 @@ class ImageFrame {
   // Get a const pointer to the underlying image data.
   const uint8* PixelData() const { return pixel_data_.get(); }
 
+  // Marks the pixel data as shared with other frames, e.g. for a view into
+  // the pixels of another frame. Such a frame must not be modified, even when
+  // a single packet holds it.
+  void MarkPixelDataShared() { pixel_data_shared_ = true; }
+  // Returns true if MarkPixelDataShared() was called since the pixel data
+  // was last allocated or adopted.
+  bool IsPixelDataShared() const { return pixel_data_shared_; }
+
   // Returns the total size of the pixel data.
   int PixelDataSize() const { return Height() * WidthStep(); }
   // Returns the total size the pixel data would take if it was stored
@@ -250,6 +258,8 @@ class ImageFrame {
   int width_step_;
 
   std::unique_ptr<uint8[], Deleter> pixel_data_;
+  // See MarkPixelDataShared().
+  bool pixel_data_shared_ = false;
 };
 
 }  // namespace mediapipe
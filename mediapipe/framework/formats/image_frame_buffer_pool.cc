@@ -0,0 +1,187 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Row stride of a frame, same computation as ImageFrame::Reset.
+int WidthStep(ImageFormat::Format format, int width,
+              uint32 alignment_boundary) {
+  const int width_step = width *
+                         ImageFrame::NumberOfChannelsForFormat(format) *
+                         ImageFrame::ByteDepthForFormat(format);
+  if (alignment_boundary <= 1) {
+    return width_step;
+  }
+  return ((width_step - 1) | (alignment_boundary - 1)) + 1;
+}
+
+uint8* AllocateBuffer(size_t size, uint32 alignment_boundary) {
+  return reinterpret_cast<uint8*>(aligned_malloc(
+      size, std::max<uint32>(alignment_boundary,
+                             ImageFrame::kDefaultAlignmentBoundary)));
+}
+
+}  // namespace
+
+constexpr int64 ImageFrameBufferPool::kDefaultMaxPooledBytes;
+
+std::string ImageFrameBufferPool::Stats::ToString() const {
+  return absl::StrCat("allocations: ", num_allocations,
+                      " reuses: ", num_reuses, " evictions: ", num_evictions,
+                      " in use: ", bytes_in_use, " pooled: ", bytes_pooled);
+}
+
+size_t ImageFrameBufferPool::BufferSpecHash::operator()(
+    const BufferSpec& spec) const {
+  size_t hash = std::hash<int>()(spec.width);
+  hash = hash * 31 + std::hash<int>()(spec.height);
+  hash = hash * 31 + std::hash<int>()(static_cast<int>(spec.format));
+  return hash * 31 + std::hash<uint32>()(spec.alignment_boundary);
+}
+
+std::shared_ptr<ImageFrameBufferPool> ImageFrameBufferPool::Create(
+    int64 max_pooled_bytes) {
+  return std::shared_ptr<ImageFrameBufferPool>(
+      new ImageFrameBufferPool(max_pooled_bytes));
+}
+
+ImageFrameBufferPool::ImageFrameBufferPool(int64 max_pooled_bytes)
+    : max_pooled_bytes_(max_pooled_bytes) {}
+
+ImageFrameBufferPool::~ImageFrameBufferPool() { Trim(); }
+
+std::unique_ptr<ImageFrame> ImageFrameBufferPool::GetFrame(
+    ImageFormat::Format format, int width, int height,
+    uint32 alignment_boundary) {
+  CHECK_NE(ImageFormat::UNKNOWN, format);
+  CHECK_GT(alignment_boundary, 0);
+  CHECK_EQ(0, alignment_boundary & (alignment_boundary - 1))
+      << "Alignment must be a power of 2.";
+  const BufferSpec spec{format, width, height, alignment_boundary};
+  const int width_step = WidthStep(format, width, alignment_boundary);
+  const size_t size = static_cast<size_t>(width_step) * height;
+
+  uint8* data = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    stats_.bytes_in_use += size;
+    auto free_list = free_lists_.find(spec);
+    if (free_list != free_lists_.end() && !free_list->second.empty()) {
+      // Most recently returned buffer is most likely still cached.
+      auto buffer = free_list->second.back();
+      free_list->second.pop_back();
+      data = buffer->data;
+      available_.erase(buffer);
+      stats_.bytes_pooled -= size;
+      ++stats_.num_reuses;
+    } else {
+      ++stats_.num_allocations;
+    }
+  }
+
+  if (data == nullptr) {
+    data = AllocateBuffer(size, alignment_boundary);
+    CHECK(data != nullptr) << "Failed to allocate " << size << " bytes.";
+  }
+
+  std::weak_ptr<ImageFrameBufferPool> weak_pool(shared_from_this());
+  return std::make_unique<ImageFrame>(
+      format, width, height, width_step, data,
+      [weak_pool, spec, size](uint8* pixel_data) {
+        auto pool = weak_pool.lock();
+        if (pool) {
+          pool->Return(spec, pixel_data, size);
+        } else {
+          aligned_free(pixel_data);
+        }
+      });
+}
+
+void ImageFrameBufferPool::Return(const BufferSpec& spec, uint8* data,
+                                  size_t size) {
+  std::vector<uint8*> evicted;
+  {
+    absl::MutexLock lock(&mutex_);
+    stats_.bytes_in_use -= size;
+    stats_.bytes_pooled += size;
+    free_lists_[spec].push_back(
+        available_.insert(available_.end(), PooledBuffer{spec, data, size}));
+    if (max_pooled_bytes_ > 0) {
+      EvictUntil(max_pooled_bytes_, &evicted);
+      stats_.num_evictions += evicted.size();
+    }
+  }
+  // Free without holding the lock.
+  for (uint8* buffer : evicted) {
+    aligned_free(buffer);
+  }
+}
+
+void ImageFrameBufferPool::EvictUntil(int64 max_bytes,
+                                      std::vector<uint8*>* evicted) {
+  while (stats_.bytes_pooled > max_bytes && !available_.empty()) {
+    const PooledBuffer& oldest = available_.front();
+    // The oldest buffer overall is also the oldest of its spec.
+    auto free_list = free_lists_.find(oldest.spec);
+    DCHECK(free_list != free_lists_.end());
+    free_list->second.erase(free_list->second.begin());
+    if (free_list->second.empty()) {
+      free_lists_.erase(free_list);
+    }
+    stats_.bytes_pooled -= oldest.size;
+    evicted->push_back(oldest.data);
+    available_.pop_front();
+  }
+}
+
+ImageFrameBufferPool::Stats ImageFrameBufferPool::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void ImageFrameBufferPool::Trim() {
+  std::vector<uint8*> evicted;
+  {
+    absl::MutexLock lock(&mutex_);
+    EvictUntil(0, &evicted);
+  }
+  for (uint8* buffer : evicted) {
+    aligned_free(buffer);
+  }
+}
+
+std::unique_ptr<ImageFrame> AcquireImageFrame(ImageFrameBufferPool* pool,
+                                              ImageFormat::Format format,
+                                              int width, int height,
+                                              uint32 alignment_boundary) {
+  if (pool != nullptr) {
+    return pool->GetFrame(format, width, height, alignment_boundary);
+  }
+  return std::make_unique<ImageFrame>(format, width, height,
+                                      alignment_boundary);
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,148 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Pool of ImageFrame pixel buffers of arbitrary format and size, used by CPU
+// image calculators to avoid allocating every output frame anew.
+//
+// Frames returned by GetFrame own their pixel data via a deleter that hands
+// the buffer back to the pool, once the frame (usually the Packet adopting
+// it) is destroyed. Pooled frames are therefore output like any other frame:
+//
+//   std::unique_ptr<ImageFrame> output_frame =
+//       pool->GetFrame(ImageFormat::SRGB, width, height);
+//   ...
+//   cc->Outputs().Index(0).Add(output_frame.release(), cc->InputTimestamp());
+//
+// Unused buffers are kept in free lists keyed by format, size and alignment,
+// up to a byte budget beyond which the least recently returned buffers are
+// freed. Pools are thread-safe; buffers may outlive their pool, in which case
+// they are freed on release.
+//
+// Graphs share a pool via kImageFramePoolService, see
+// image_frame_pool_service.h.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_BUFFER_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_BUFFER_POOL_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+class ImageFrameBufferPool
+    : public std::enable_shared_from_this<ImageFrameBufferPool> {
+ public:
+  struct Stats {
+    // Number of buffers allocated from the system.
+    int64 num_allocations = 0;
+    // Number of frames served from previously released buffers.
+    int64 num_reuses = 0;
+    // Number of released buffers freed because of the budget.
+    int64 num_evictions = 0;
+    // Bytes referenced by frames handed out by this pool.
+    int64 bytes_in_use = 0;
+    // Bytes held in free lists, awaiting reuse.
+    int64 bytes_pooled = 0;
+
+    std::string ToString() const;
+  };
+
+  // About eight unused 4K RGBA frames.
+  static constexpr int64 kDefaultMaxPooledBytes = 256 << 20;
+
+  // Unused buffers are retained up to max_pooled_bytes (pass zero for no
+  // limit). Created as shared_ptr, so that frames can refer to their pool
+  // weakly.
+  static std::shared_ptr<ImageFrameBufferPool> Create(
+      int64 max_pooled_bytes = kDefaultMaxPooledBytes);
+
+  ~ImageFrameBufferPool();
+  ImageFrameBufferPool(const ImageFrameBufferPool&) = delete;
+  ImageFrameBufferPool& operator=(const ImageFrameBufferPool&) = delete;
+
+  // Returns a frame of specified format and size, with rows aligned to
+  // alignment_boundary (same semantics as ImageFrame's constructor). Pixel
+  // data is not initialized.
+  std::unique_ptr<ImageFrame> GetFrame(
+      ImageFormat::Format format, int width, int height,
+      uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+  Stats GetStats() const;
+
+  // Frees all currently unused buffers.
+  void Trim();
+
+ private:
+  struct BufferSpec {
+    ImageFormat::Format format;
+    int width;
+    int height;
+    uint32 alignment_boundary;
+
+    bool operator==(const BufferSpec& other) const {
+      return format == other.format && width == other.width &&
+             height == other.height &&
+             alignment_boundary == other.alignment_boundary;
+    }
+  };
+
+  struct BufferSpecHash {
+    size_t operator()(const BufferSpec& spec) const;
+  };
+
+  struct PooledBuffer {
+    BufferSpec spec;
+    uint8* data;
+    size_t size;
+  };
+
+  explicit ImageFrameBufferPool(int64 max_pooled_bytes);
+
+  // Returns buffer to its free list, evicting buffers over budget.
+  void Return(const BufferSpec& spec, uint8* data, size_t size);
+
+  // Removes least recently returned buffers from free lists until at most
+  // max_bytes are pooled, appending them to evicted.
+  void EvictUntil(int64 max_bytes, std::vector<uint8*>* evicted)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int64 max_pooled_bytes_;
+
+  mutable absl::Mutex mutex_;
+  // Unused buffers, least recently returned first.
+  std::list<PooledBuffer> available_ ABSL_GUARDED_BY(mutex_);
+  // Unused buffers per spec, least recently returned first.
+  std::unordered_map<BufferSpec, std::vector<std::list<PooledBuffer>::iterator>,
+                     BufferSpecHash>
+      free_lists_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns a frame drawn from pool, or a newly allocated frame if pool is
+// null.
+std::unique_ptr<ImageFrame> AcquireImageFrame(
+    ImageFrameBufferPool* pool, ImageFormat::Format format, int width,
+    int height,
+    uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_BUFFER_POOL_H_
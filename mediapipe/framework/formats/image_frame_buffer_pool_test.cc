@@ -0,0 +1,108 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+
+#include <memory>
+
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(ImageFrameBufferPoolTest, ReusesReleasedBuffers) {
+  auto pool = ImageFrameBufferPool::Create();
+  const uint8* pixel_data;
+  {
+    std::unique_ptr<ImageFrame> frame =
+        pool->GetFrame(ImageFormat::SRGB, 301, 200);
+    EXPECT_EQ(ImageFormat::SRGB, frame->Format());
+    EXPECT_EQ(301, frame->Width());
+    EXPECT_EQ(200, frame->Height());
+    // Rows are aligned like those of a newly allocated frame.
+    EXPECT_EQ(ImageFrame(ImageFormat::SRGB, 301, 200).WidthStep(),
+              frame->WidthStep());
+    EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+    pixel_data = frame->PixelData();
+    EXPECT_EQ(frame->WidthStep() * 200, pool->GetStats().bytes_in_use);
+  }
+  EXPECT_EQ(0, pool->GetStats().bytes_in_use);
+
+  // Different spec is allocated anew.
+  std::unique_ptr<ImageFrame> other =
+      pool->GetFrame(ImageFormat::GRAY8, 301, 200);
+  EXPECT_EQ(2, pool->GetStats().num_allocations);
+
+  std::unique_ptr<ImageFrame> frame =
+      pool->GetFrame(ImageFormat::SRGB, 301, 200);
+  EXPECT_EQ(pixel_data, frame->PixelData());
+  EXPECT_EQ(1, pool->GetStats().num_reuses);
+  EXPECT_EQ(0, pool->GetStats().bytes_pooled);
+}
+
+TEST(ImageFrameBufferPoolTest, ReturnsBufferWhenLastPacketIsReleased) {
+  auto pool = ImageFrameBufferPool::Create();
+  Packet packet = Adopt(pool->GetFrame(ImageFormat::SRGBA, 64, 48).release());
+  Packet copy = packet;
+  packet = Packet();
+  EXPECT_EQ(0, pool->GetStats().bytes_pooled);
+  copy = Packet();
+  EXPECT_EQ(64 * 48 * 4, pool->GetStats().bytes_pooled);
+  EXPECT_EQ(0, pool->GetStats().bytes_in_use);
+}
+
+TEST(ImageFrameBufferPoolTest, EvictsLeastRecentlyReturned) {
+  const int64 frame_bytes = 100 * 100;
+  auto pool = ImageFrameBufferPool::Create(2 * frame_bytes);
+  {
+    auto frame_1 = pool->GetFrame(ImageFormat::GRAY8, 100, 100, 1);
+    auto frame_2 = pool->GetFrame(ImageFormat::GRAY8, 50, 200, 1);
+    auto frame_3 = pool->GetFrame(ImageFormat::GRAY8, 200, 50, 1);
+    frame_1.reset();
+    frame_2.reset();
+    frame_3.reset();
+  }
+  ImageFrameBufferPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(1, stats.num_evictions);
+  EXPECT_EQ(2 * frame_bytes, stats.bytes_pooled);
+
+  // First returned frame was evicted.
+  auto frame = pool->GetFrame(ImageFormat::GRAY8, 100, 100, 1);
+  EXPECT_EQ(4, pool->GetStats().num_allocations);
+  frame = pool->GetFrame(ImageFormat::GRAY8, 50, 200, 1);
+  EXPECT_EQ(1, pool->GetStats().num_reuses);
+
+  pool->Trim();
+  EXPECT_EQ(0, pool->GetStats().bytes_pooled);
+}
+
+TEST(ImageFrameBufferPoolTest, FramesOutlivePool) {
+  auto pool = ImageFrameBufferPool::Create();
+  std::unique_ptr<ImageFrame> frame =
+      pool->GetFrame(ImageFormat::VEC32F1, 16, 16);
+  pool.reset();
+  frame->SetToZero();
+  frame.reset();
+}
+
+TEST(ImageFrameBufferPoolTest, AcquireWithoutPool) {
+  std::unique_ptr<ImageFrame> frame =
+      AcquireImageFrame(nullptr, ImageFormat::SRGB, 10, 20);
+  EXPECT_EQ(10, frame->Width());
+  EXPECT_EQ(20, frame->Height());
+}
+
+}  // namespace
+}  // namespace mediapipe
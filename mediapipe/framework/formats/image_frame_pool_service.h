@@ -0,0 +1,35 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_POOL_SERVICE_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_POOL_SERVICE_H_
+
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+#include "mediapipe/framework/graph_service.h"
+
+namespace mediapipe {
+
+// Optional service providing the pool CPU image calculators of a graph
+// allocate their output ImageFrames from, the CPU counterpart of the
+// GpuBuffer pool in kGpuService. Calculators request it via
+//   cc->UseService(kImageFramePoolService).Optional();
+// and fall back to plain allocation if it is not set, see
+// AcquireImageFrame. Enable pooling (and bound its memory) with
+//   graph.SetServiceObject(kImageFramePoolService,
+//                          ImageFrameBufferPool::Create(max_pooled_bytes));
+extern const GraphService<ImageFrameBufferPool> kImageFramePoolService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_POOL_SERVICE_H_
@@ -0,0 +1,126 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_pyramid.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Rounds averages of 8 and 16-bit pixels to the nearest integer.
+template <typename T>
+T Average(float sum, float scale) {
+  return std::is_floating_point<T>::value ? static_cast<T>(sum * scale)
+                                          : static_cast<T>(sum * scale + 0.5f);
+}
+
+// Averages 2x2 blocks of pixels of src into dst, which is half as large,
+// rounded up. The last column and row of odd sized images are averaged with
+// themselves.
+template <typename T>
+void HalveImage(const ImageFrame& src, ImageFrame* dst) {
+  const int channels = src.NumberOfChannels();
+  // Number of output pixels with a full 2x2 block in each row.
+  const int full_width = src.Width() / 2;
+  for (int y = 0; y < dst->Height(); ++y) {
+    const int y1 = std::min(2 * y + 1, src.Height() - 1);
+    const T* row0 = reinterpret_cast<const T*>(src.PixelData() +
+                                               2 * y * src.WidthStep());
+    const T* row1 =
+        reinterpret_cast<const T*>(src.PixelData() + y1 * src.WidthStep());
+    T* out =
+        reinterpret_cast<T*>(dst->MutablePixelData() + y * dst->WidthStep());
+    for (int x = 0; x < full_width; ++x) {
+      const T* a = row0 + 2 * x * channels;
+      const T* b = row1 + 2 * x * channels;
+      for (int c = 0; c < channels; ++c) {
+        out[x * channels + c] = Average<T>(
+            static_cast<float>(a[c]) + a[channels + c] + b[c] + b[channels + c],
+            0.25f);
+      }
+    }
+    if (full_width < dst->Width()) {
+      const T* a = row0 + 2 * full_width * channels;
+      const T* b = row1 + 2 * full_width * channels;
+      for (int c = 0; c < channels; ++c) {
+        out[full_width * channels + c] =
+            Average<T>(static_cast<float>(a[c]) + b[c], 0.5f);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+ImagePyramid::ImagePyramid(std::shared_ptr<const ImageFrame> frame,
+                           int max_levels,
+                           std::weak_ptr<ImageFrameBufferPool> pool)
+    : pool_(std::move(pool)), frame_(std::move(frame)) {
+  CHECK(frame_);
+  int width = frame_->Width();
+  int height = frame_->Height();
+  sizes_.emplace_back(width, height);
+  while (static_cast<int>(sizes_.size()) < max_levels && width > 1 &&
+         height > 1) {
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+    sizes_.emplace_back(width, height);
+  }
+  levels_.resize(sizes_.size());
+  computed_ = absl::make_unique<absl::once_flag[]>(sizes_.size());
+}
+
+const ImageFrame& ImagePyramid::Level(int level) const {
+  CHECK_GE(level, 0);
+  CHECK_LT(level, NumLevels());
+  if (level == 0) return *frame_;
+  absl::call_once(computed_[level], [this, level]() {
+    const ImageFrame& src = Level(level - 1);
+    const std::shared_ptr<ImageFrameBufferPool> pool = pool_.lock();
+    auto dst = AcquireImageFrame(pool.get(), src.Format(), Width(level),
+                                 Height(level));
+    switch (src.ByteDepth()) {
+      case 1:
+        HalveImage<uint8>(src, dst.get());
+        break;
+      case 2:
+        HalveImage<uint16>(src, dst.get());
+        break;
+      default:
+        HalveImage<float>(src, dst.get());
+        break;
+    }
+    levels_[level] = std::move(dst);
+  });
+  return *levels_[level];
+}
+
+int ImagePyramid::LevelForSize(int width, int height) const {
+  int level = 0;
+  while (level + 1 < NumLevels() && Width(level + 1) >= width &&
+         Height(level + 1) >= height) {
+    ++level;
+  }
+  return level;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,85 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// An ImageFrame together with successively halved copies of it, which are
+// computed on first access.
+//
+// Calculators that each need a downscaled copy of the same frame, such as the
+// input of a model and the coarse levels of a tracker, can share the levels of
+// one pyramid instead of each resizing the frame on their own:
+// ImagePyramidCalculator publishes the pyramid of each frame, and consumers
+// ask it for the level that suits them. Each level is computed once, by the
+// first consumer that needs it, and levels may be accessed from several
+// threads at once.
+//
+//   const ImagePyramid& pyramid = cc->Inputs().Tag("PYRAMID").Get<...>();
+//   const ImageFrame& frame = pyramid.Level(pyramid.LevelForSize(256, 256));
+//
+// Level 0 is the frame itself. Level i + 1 has half the width and height of
+// level i, rounded up, and each of its pixels is the average of a 2x2 block of
+// pixels of level i.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_PYRAMID_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_PYRAMID_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/call_once.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_buffer_pool.h"
+
+namespace mediapipe {
+
+class ImagePyramid {
+ public:
+  // Creates the pyramid of frame, with up to max_levels levels: levels stop
+  // at the first one that is a single pixel wide or high. Levels are drawn
+  // from pool while it exists, and returned to it with the pyramid. The pool
+  // is only referred to weakly, as pyramids may outlive the graph owning it:
+  // levels computed once it is gone are allocated anew.
+  ImagePyramid(std::shared_ptr<const ImageFrame> frame, int max_levels,
+               std::weak_ptr<ImageFrameBufferPool> pool = {});
+
+  ImagePyramid(const ImagePyramid&) = delete;
+  ImagePyramid& operator=(const ImagePyramid&) = delete;
+
+  int NumLevels() const { return static_cast<int>(sizes_.size()); }
+
+  // The size of a level is known without computing it.
+  int Width(int level) const { return sizes_[level].first; }
+  int Height(int level) const { return sizes_[level].second; }
+
+  // Returns the given level, computing it, and the levels it is computed
+  // from, if no caller has yet.
+  const ImageFrame& Level(int level) const;
+
+  // Returns the smallest level that is at least width x height, which is the
+  // cheapest one to scale to that size without losing detail, or level 0 if
+  // no level is as large.
+  int LevelForSize(int width, int height) const;
+
+ private:
+  std::vector<std::pair<int, int>> sizes_;
+  const std::weak_ptr<ImageFrameBufferPool> pool_;
+  const std::shared_ptr<const ImageFrame> frame_;
+  // Levels 1 and up, each computed under its once flag.
+  mutable std::vector<std::unique_ptr<ImageFrame>> levels_;
+  mutable std::unique_ptr<absl::once_flag[]> computed_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_PYRAMID_H_
@@ -0,0 +1,153 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_pyramid.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace {
+
+std::shared_ptr<const ImageFrame> MakeGrayFrame(
+    int width, int height, const std::vector<uint8>& pixels) {
+  auto frame = std::make_shared<ImageFrame>(ImageFormat::GRAY8, width, height);
+  for (int y = 0; y < height; ++y) {
+    std::copy(pixels.begin() + y * width, pixels.begin() + (y + 1) * width,
+              frame->MutablePixelData() + y * frame->WidthStep());
+  }
+  return frame;
+}
+
+uint8 Pixel(const ImageFrame& frame, int x, int y) {
+  return frame.PixelData()[y * frame.WidthStep() + x];
+}
+
+TEST(ImagePyramidTest, HalvesSizesUntilSinglePixelRowOrColumn) {
+  ImagePyramid pyramid(std::make_shared<ImageFrame>(ImageFormat::SRGB, 11, 6),
+                       /*max_levels=*/10);
+  ASSERT_EQ(4, pyramid.NumLevels());
+  EXPECT_EQ(11, pyramid.Width(0));
+  EXPECT_EQ(6, pyramid.Height(0));
+  EXPECT_EQ(6, pyramid.Width(1));
+  EXPECT_EQ(3, pyramid.Height(1));
+  EXPECT_EQ(3, pyramid.Width(2));
+  EXPECT_EQ(2, pyramid.Height(2));
+  EXPECT_EQ(2, pyramid.Width(3));
+  EXPECT_EQ(1, pyramid.Height(3));
+
+  ImagePyramid limited(std::make_shared<ImageFrame>(ImageFormat::SRGB, 64, 64),
+                       /*max_levels=*/3);
+  EXPECT_EQ(3, limited.NumLevels());
+}
+
+TEST(ImagePyramidTest, AveragesBlocksOfPixels) {
+  // clang-format off
+  auto frame = MakeGrayFrame(5, 3, {
+      0,  2,  10, 20, 7,
+      4,  6,  30, 40, 9,
+      100, 50, 1,  2,  255,
+  });
+  // clang-format on
+  ImagePyramid pyramid(frame, /*max_levels=*/3);
+  // Level 0 is the frame itself.
+  EXPECT_EQ(frame.get(), &pyramid.Level(0));
+
+  const ImageFrame& level1 = pyramid.Level(1);
+  EXPECT_EQ(ImageFormat::GRAY8, level1.Format());
+  ASSERT_EQ(3, level1.Width());
+  ASSERT_EQ(2, level1.Height());
+  EXPECT_EQ(3, Pixel(level1, 0, 0));
+  EXPECT_EQ(25, Pixel(level1, 1, 0));
+  EXPECT_EQ(8, Pixel(level1, 2, 0));
+  EXPECT_EQ(75, Pixel(level1, 0, 1));
+  EXPECT_EQ(2, Pixel(level1, 1, 1));
+  EXPECT_EQ(255, Pixel(level1, 2, 1));
+
+  const ImageFrame& level2 = pyramid.Level(2);
+  ASSERT_EQ(2, level2.Width());
+  ASSERT_EQ(1, level2.Height());
+  EXPECT_EQ(26, Pixel(level2, 0, 0));
+  EXPECT_EQ(132, Pixel(level2, 1, 0));
+}
+
+TEST(ImagePyramidTest, AveragesFloatChannels) {
+  auto frame = std::make_shared<ImageFrame>(ImageFormat::VEC32F1, 2, 2);
+  for (int y = 0; y < 2; ++y) {
+    float* row = reinterpret_cast<float*>(frame->MutablePixelData() +
+                                          y * frame->WidthStep());
+    row[0] = 0.1f * y;
+    row[1] = 0.3f;
+  }
+  ImagePyramid pyramid(frame, /*max_levels=*/2);
+  EXPECT_FLOAT_EQ(
+      0.175f, reinterpret_cast<const float*>(pyramid.Level(1).PixelData())[0]);
+}
+
+TEST(ImagePyramidTest, SelectsSmallestLevelLargerThanSize) {
+  ImagePyramid pyramid(
+      std::make_shared<ImageFrame>(ImageFormat::SRGB, 1920, 1080),
+      /*max_levels=*/5);
+  EXPECT_EQ(0, pyramid.LevelForSize(1920, 1080));
+  EXPECT_EQ(0, pyramid.LevelForSize(1000, 100));
+  EXPECT_EQ(1, pyramid.LevelForSize(960, 540));
+  EXPECT_EQ(2, pyramid.LevelForSize(256, 256));
+  EXPECT_EQ(4, pyramid.LevelForSize(1, 1));
+  EXPECT_EQ(0, pyramid.LevelForSize(4000, 10));
+}
+
+TEST(ImagePyramidTest, ComputesEachLevelOnceAcrossThreads) {
+  auto pool = ImageFrameBufferPool::Create();
+  auto pyramid = absl::make_unique<ImagePyramid>(
+      std::make_shared<ImageFrame>(ImageFormat::SRGBA, 640, 480),
+      /*max_levels=*/4, pool);
+  std::vector<const ImageFrame*> levels(16);
+  {
+    ThreadPool threads("image_pyramid_test", 4);
+    threads.StartWorkers();
+    for (int i = 0; i < levels.size(); ++i) {
+      threads.Schedule([&pyramid, &levels, i] {
+        levels[i] = &pyramid->Level(3 - i % 3);
+      });
+    }
+  }
+  for (int i = 0; i < levels.size(); ++i) {
+    EXPECT_EQ(levels[i % 3], levels[i]);
+  }
+  // Levels 1 to 3, drawn from the pool and returned to it with the pyramid.
+  EXPECT_EQ(3, pool->GetStats().num_allocations);
+  pyramid.reset();
+  EXPECT_EQ(0, pool->GetStats().bytes_in_use);
+}
+
+TEST(ImagePyramidTest, OutlivesItsPool) {
+  auto pool = ImageFrameBufferPool::Create();
+  ImagePyramid pyramid(
+      std::make_shared<ImageFrame>(ImageFormat::GRAY8, 64, 64),
+      /*max_levels=*/3, pool);
+  const ImageFrame& level1 = pyramid.Level(1);
+  EXPECT_EQ(1, pool->GetStats().num_allocations);
+  // As when the graph providing the pool is destroyed before the packets it
+  // output: level 1 is freed with the pyramid, level 2 is allocated anew.
+  pool.reset();
+  EXPECT_EQ(32, level1.Width());
+  EXPECT_EQ(16, pyramid.Level(2).Width());
+}
+
+}  // namespace
+}  // namespace mediapipe
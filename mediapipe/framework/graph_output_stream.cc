@@ -173,15 +173,13 @@ void OutputStreamPollerImpl::NotifyError() {
   mutex_.Unlock();
 }
 
-bool OutputStreamPollerImpl::Next(Packet* packet) {
-  CHECK(packet);
+bool OutputStreamPollerImpl::WaitForPacket(Timestamp* min_timestamp) {
   bool empty_queue = true;
-  Timestamp min_timestamp = Timestamp::Unset();
   mutex_.Lock();
   while (true) {
-    min_timestamp = input_stream_->MinTimestampOrBound(&empty_queue);
+    *min_timestamp = input_stream_->MinTimestampOrBound(&empty_queue);
     if (graph_has_error_ || !empty_queue ||
-        min_timestamp == Timestamp::Done()) {
+        *min_timestamp == Timestamp::Done()) {
       break;
     } else {
       handler_condvar_.Wait(&mutex_);
@@ -192,7 +190,13 @@ bool OutputStreamPollerImpl::Next(Packet* packet) {
     return false;
   }
   mutex_.Unlock();
-  if (min_timestamp == Timestamp::Done()) {
+  return *min_timestamp != Timestamp::Done();
+}
+
+bool OutputStreamPollerImpl::Next(Packet* packet) {
+  CHECK(packet);
+  Timestamp min_timestamp;
+  if (!WaitForPacket(&min_timestamp)) {
     return false;
   }
   int num_packets_dropped = 0;
@@ -205,5 +209,19 @@ bool OutputStreamPollerImpl::Next(Packet* packet) {
   return true;
 }
 
+bool OutputStreamPollerImpl::NextBatch(int max_packets,
+                                       std::vector<Packet>* packets) {
+  CHECK(packets);
+  CHECK_GT(max_packets, 0);
+  packets->clear();
+  Timestamp min_timestamp;
+  if (!WaitForPacket(&min_timestamp)) {
+    return false;
+  }
+  bool stream_is_done = false;
+  input_stream_->PopPackets(max_packets, packets, &stream_is_done);
+  return true;
+}
+
 }  // namespace internal
 }  // namespace mediapipe
@@ -166,7 +166,18 @@ class OutputStreamPollerImpl : public GraphOutputStream {
   // done).  Returns true if successful.
   ABSL_MUST_USE_RESULT bool Next(Packet* packet);
 
+  // Replaces the contents of packets with up to max_packets available
+  // packets (block until one is available or the stream is done).  Returns
+  // true if successful.
+  ABSL_MUST_USE_RESULT bool NextBatch(int max_packets,
+                                      std::vector<Packet>* packets);
+
  private:
+  // Blocks until a packet is available, the stream is done or the graph has
+  // an error.  Returns true if a packet is available, and sets min_timestamp
+  // to its timestamp.
+  bool WaitForPacket(Timestamp* min_timestamp);
+
   absl::Mutex mutex_;
   absl::CondVar handler_condvar_ ABSL_GUARDED_BY(mutex_);
   bool graph_has_error_ ABSL_GUARDED_BY(mutex_);
@@ -0,0 +1,216 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/graph_pool.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_join.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/timestamp.h"
+#include "mediapipe/framework/tool/validate_name.h"
+#include "mediapipe/framework/validated_graph_config.h"
+
+namespace mediapipe {
+
+struct GraphPool::Instance {
+  // Null until started, and after a failed request.
+  std::unique_ptr<CalculatorGraph> graph;
+  // Timestamp of the next request.
+  int64 next_timestamp = 0;
+
+  // Written by output stream observers, which run on graph threads.
+  absl::Mutex mutex;
+  Timestamp request_timestamp ABSL_GUARDED_BY(mutex);
+  std::map<std::string, Packet> outputs ABSL_GUARDED_BY(mutex);
+};
+
+absl::StatusOr<std::unique_ptr<GraphPool>> GraphPool::Create(
+    const CalculatorGraphConfig& config, const Options& options) {
+  RET_CHECK_GT(options.num_graphs, 0);
+  auto pool = absl::WrapUnique(new GraphPool(options));
+  // Validate once, so that graphs are initialized without expanding
+  // subgraphs and validating types again.
+  ValidatedGraphConfig validated_graph;
+  MP_RETURN_IF_ERROR(validated_graph.Initialize(config));
+  pool->compiled_config_ = validated_graph.Compile();
+  for (const std::string& stream : config.input_stream()) {
+    std::string tag, name;
+    MP_RETURN_IF_ERROR(tool::ParseTagAndName(stream, &tag, &name));
+    pool->input_stream_names_.insert(name);
+  }
+  for (const std::string& stream : config.output_stream()) {
+    std::string tag, name;
+    MP_RETURN_IF_ERROR(tool::ParseTagAndName(stream, &tag, &name));
+    pool->output_stream_names_.push_back(name);
+  }
+
+  for (int i = 0; i < options.num_graphs; ++i) {
+    pool->instances_.push_back(absl::make_unique<Instance>());
+    Instance* instance = pool->instances_.back().get();
+    {
+      absl::MutexLock lock(&pool->mutex_);
+      pool->idle_instances_.push_back(instance);
+    }
+    MP_RETURN_IF_ERROR(pool->StartInstance(instance));
+  }
+  return pool;
+}
+
+GraphPool::GraphPool(const Options& options) : options_(options) {}
+
+GraphPool::~GraphPool() {
+  absl::Status status = Close();
+  if (!status.ok()) {
+    LOG(ERROR) << "GraphPool: " << status;
+  }
+}
+
+absl::Status GraphPool::StartInstance(Instance* instance) {
+  auto graph = absl::make_unique<CalculatorGraph>();
+  if (options_.configure_graph) {
+    MP_RETURN_IF_ERROR(options_.configure_graph(graph.get()));
+  }
+  MP_RETURN_IF_ERROR(graph->Initialize(compiled_config_, {}));
+  if (options_.setup_graph) {
+    MP_RETURN_IF_ERROR(options_.setup_graph(graph.get()));
+  }
+  for (const std::string& stream : output_stream_names_) {
+    MP_RETURN_IF_ERROR(graph->ObserveOutputStream(
+        stream, [instance, stream](const Packet& packet) {
+          absl::MutexLock lock(&instance->mutex);
+          if (packet.Timestamp() == instance->request_timestamp) {
+            instance->outputs[stream] = packet;
+          }
+          return absl::OkStatus();
+        }));
+  }
+  MP_RETURN_IF_ERROR(graph->StartRun(options_.side_packets));
+  // Calculators are opened asynchronously; wait for them, so that models are
+  // loaded before the graph serves its first request.
+  MP_RETURN_IF_ERROR(graph->WaitUntilIdle());
+  instance->graph = std::move(graph);
+  // Timestamps restart with the graph.
+  instance->next_timestamp = 0;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::map<std::string, Packet>> GraphPool::Process(
+    const std::map<std::string, Packet>& inputs) {
+  for (const auto& input : inputs) {
+    RET_CHECK(input_stream_names_.count(input.first))
+        << "\"" << input.first << "\" is not a graph input stream.";
+  }
+  RET_CHECK_EQ(inputs.size(), input_stream_names_.size())
+      << "Every request must provide all graph input streams: "
+      << absl::StrJoin(input_stream_names_, ", ");
+
+  Instance* instance = AcquireInstance();
+  if (instance == nullptr) {
+    return absl::FailedPreconditionError("GraphPool is closed.");
+  }
+  auto outputs = ProcessOnInstance(instance, inputs);
+  ReleaseInstance(instance);
+  return outputs;
+}
+
+absl::StatusOr<std::map<std::string, Packet>> GraphPool::ProcessOnInstance(
+    Instance* instance, const std::map<std::string, Packet>& inputs) {
+  if (instance->graph == nullptr) {
+    MP_RETURN_IF_ERROR(StartInstance(instance));
+  }
+  CalculatorGraph* graph = instance->graph.get();
+  const Timestamp timestamp(instance->next_timestamp++);
+  {
+    absl::MutexLock lock(&instance->mutex);
+    instance->request_timestamp = timestamp;
+    instance->outputs.clear();
+  }
+
+  absl::Status status;
+  for (const auto& input : inputs) {
+    status = graph->AddPacketToInputStream(input.first,
+                                           input.second.At(timestamp));
+    if (!status.ok()) {
+      break;
+    }
+  }
+  if (status.ok()) {
+    status = graph->WaitUntilIdle();
+  }
+  if (!status.ok()) {
+    // The graph may hold partial state of this request; restart it lazily.
+    graph->Cancel();
+    graph->WaitUntilDone().IgnoreError();
+    instance->graph.reset();
+    return status;
+  }
+
+  absl::MutexLock lock(&instance->mutex);
+  instance->request_timestamp = Timestamp::Unset();
+  return std::move(instance->outputs);
+}
+
+GraphPool::Instance* GraphPool::AcquireInstance() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &GraphPool::CanAcquireInstance));
+  if (closed_) {
+    return nullptr;
+  }
+  Instance* instance = idle_instances_.back();
+  idle_instances_.pop_back();
+  return instance;
+}
+
+bool GraphPool::CanAcquireInstance() const {
+  return closed_ || !idle_instances_.empty();
+}
+
+bool GraphPool::AllInstancesIdle() const {
+  return idle_instances_.size() == instances_.size();
+}
+
+void GraphPool::ReleaseInstance(Instance* instance) {
+  absl::MutexLock lock(&mutex_);
+  // Most recently used graphs first, as their data is most likely cached.
+  idle_instances_.push_back(instance);
+}
+
+absl::Status GraphPool::Close() {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (closed_) {
+      return absl::OkStatus();
+    }
+    closed_ = true;
+    mutex_.Await(absl::Condition(this, &GraphPool::AllInstancesIdle));
+  }
+
+  absl::Status status;
+  for (const auto& instance : instances_) {
+    if (instance->graph == nullptr) {
+      continue;
+    }
+    status.Update(instance->graph->CloseAllInputStreams());
+    status.Update(instance->graph->WaitUntilDone());
+    instance->graph.reset();
+  }
+  return status;
+}
+
+}  // namespace mediapipe
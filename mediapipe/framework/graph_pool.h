@@ -0,0 +1,131 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines GraphPool, which serves request/response style workloads (e.g. one
+// image in, one set of detections out) with a set of warm, running graphs.
+//
+// Running a graph per request (Initialize, StartRun, WaitUntilDone) validates
+// the config and opens all calculators, including loading models, every
+// time. Instead, the config is validated once, each graph in the pool is
+// initialized from the resulting CompiledGraphConfig and started once, and
+// a request is a single timestamp: its packets are added to the graph input
+// streams at the graph's next timestamp, the graph is run until idle, and the
+// packets emitted on the graph output streams at that timestamp form the
+// response. Calculator state that must not leak across requests therefore
+// has to be keyed by timestamp, as it is for streaming use.
+//
+// Example:
+//   GraphPool::Options options;
+//   options.num_graphs = 4;
+//   ASSIGN_OR_RETURN(std::unique_ptr<GraphPool> pool,
+//                    GraphPool::Create(config, options));
+//   ...
+//   // From any thread:
+//   ASSIGN_OR_RETURN(auto outputs,
+//                    pool->Process({{"input_image", MakePacket<...>(...)}}));
+//   const auto& detections = outputs["detections"].Get<...>();
+//
+// Graphs must not contain source nodes, and every request must provide a
+// packet for each graph input stream. A graph that fails a request is torn
+// down and restarted for the next request it serves.
+
+#ifndef MEDIAPIPE_FRAMEWORK_GRAPH_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_GRAPH_POOL_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/calculator_graph.h"
+#include "mediapipe/framework/compiled_graph_config.pb.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+class GraphPool {
+ public:
+  struct Options {
+    // Number of graphs, i.e. the maximum number of concurrent requests.
+    int num_graphs = 1;
+    // Input side packets passed to every graph, e.g. model paths.
+    std::map<std::string, Packet> side_packets;
+    // If set, called on every graph before Initialize(), e.g. to set
+    // executors, which cannot be changed once the graph is initialized.
+    std::function<absl::Status(CalculatorGraph*)> configure_graph;
+    // If set, called on every graph after Initialize() and before StartRun(),
+    // e.g. to set service objects.
+    std::function<absl::Status(CalculatorGraph*)> setup_graph;
+  };
+
+  // Initializes and starts options.num_graphs graphs from config.
+  static absl::StatusOr<std::unique_ptr<GraphPool>> Create(
+      const CalculatorGraphConfig& config, const Options& options);
+
+  // Closes the pool, logging any errors.
+  ~GraphPool();
+  GraphPool(const GraphPool&) = delete;
+  GraphPool& operator=(const GraphPool&) = delete;
+
+  // Runs a request on an idle graph, blocking until one is available.
+  // inputs maps each graph input stream name to a packet; packet timestamps
+  // are ignored. Returns the packets emitted for this request keyed by graph
+  // output stream name. Streams that emitted nothing are omitted.
+  absl::StatusOr<std::map<std::string, Packet>> Process(
+      const std::map<std::string, Packet>& inputs);
+
+  // Waits for running requests, then closes and finishes all graphs.
+  // Requests still waiting for a graph, and later ones, fail.
+  absl::Status Close();
+
+ private:
+  struct Instance;
+
+  explicit GraphPool(const Options& options);
+
+  // Creates, initializes and starts the graph of instance.
+  absl::Status StartInstance(Instance* instance);
+
+  // Runs a request on instance, restarting its graph first if needed.
+  absl::StatusOr<std::map<std::string, Packet>> ProcessOnInstance(
+      Instance* instance, const std::map<std::string, Packet>& inputs);
+
+  // Returns an idle instance, or nullptr if the pool is closed.
+  Instance* AcquireInstance();
+  void ReleaseInstance(Instance* instance);
+
+  bool CanAcquireInstance() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool AllInstancesIdle() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const Options options_;
+  CompiledGraphConfig compiled_config_;
+  std::set<std::string> input_stream_names_;
+  std::vector<std::string> output_stream_names_;
+  std::vector<std::unique_ptr<Instance>> instances_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<Instance*> idle_instances_ ABSL_GUARDED_BY(mutex_);
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_GRAPH_POOL_H_
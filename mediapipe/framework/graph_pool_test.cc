@@ -0,0 +1,197 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/graph_pool.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/executor.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/thread_pool_executor.h"
+
+namespace mediapipe {
+namespace {
+
+std::atomic<int> num_opens(0);
+
+// Adds the side packet "offset" to its input, counting calls to Open. Fails
+// on negative input.
+class AddOffsetCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<int>();
+    cc->Outputs().Index(0).Set<int>();
+    cc->InputSidePackets().Tag("OFFSET").Set<int>();
+    return absl::OkStatus();
+  }
+
+  absl::Status Open(CalculatorContext* cc) override {
+    ++num_opens;
+    offset_ = cc->InputSidePackets().Tag("OFFSET").Get<int>();
+    cc->SetOffset(TimestampDiff(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    const int value = cc->Inputs().Index(0).Get<int>();
+    RET_CHECK_GE(value, 0);
+    cc->Outputs().Index(0).AddPacket(
+        MakePacket<int>(value + offset_).At(cc->InputTimestamp()));
+    return absl::OkStatus();
+  }
+
+ private:
+  int offset_ = 0;
+};
+REGISTER_CALCULATOR(AddOffsetCalculator);
+
+std::atomic<int> num_scheduled_tasks(0);
+
+// Runs tasks on a single thread, counting them.
+class CountingExecutor : public Executor {
+ public:
+  void Schedule(std::function<void()> task) override {
+    ++num_scheduled_tasks;
+    thread_pool_.Schedule(std::move(task));
+  }
+
+ private:
+  ThreadPoolExecutor thread_pool_{1};
+};
+
+class GraphPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    num_opens = 0;
+    config_ = ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+      input_stream: "in"
+      output_stream: "out"
+      input_side_packet: "offset"
+      node {
+        calculator: "AddOffsetCalculator"
+        input_stream: "in"
+        output_stream: "out"
+        input_side_packet: "OFFSET:offset"
+      }
+    )");
+    options_.side_packets["offset"] = MakePacket<int>(100);
+  }
+
+  CalculatorGraphConfig config_;
+  GraphPool::Options options_;
+};
+
+TEST_F(GraphPoolTest, ProcessesRequestsWithoutReopening) {
+  options_.num_graphs = 2;
+  auto pool_or = GraphPool::Create(config_, options_);
+  MP_ASSERT_OK(pool_or.status());
+  std::unique_ptr<GraphPool> pool = std::move(pool_or).value();
+  EXPECT_EQ(2, num_opens);
+
+  for (int i = 0; i < 10; ++i) {
+    auto outputs = pool->Process({{"in", MakePacket<int>(i)}});
+    MP_ASSERT_OK(outputs.status());
+    ASSERT_EQ(1, outputs.value().count("out"));
+    EXPECT_EQ(100 + i, outputs.value().at("out").Get<int>());
+  }
+  EXPECT_EQ(2, num_opens);
+  MP_EXPECT_OK(pool->Close());
+}
+
+TEST_F(GraphPoolTest, ProcessesConcurrentRequests) {
+  options_.num_graphs = 3;
+  auto pool_or = GraphPool::Create(config_, options_);
+  MP_ASSERT_OK(pool_or.status());
+  std::unique_ptr<GraphPool> pool = std::move(pool_or).value();
+
+  std::atomic<int> num_correct(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&pool, &num_correct, t]() {
+      for (int i = 0; i < 20; ++i) {
+        const int value = t * 1000 + i;
+        auto outputs = pool->Process({{"in", MakePacket<int>(value)}});
+        if (outputs.ok() && outputs.value().count("out") &&
+            outputs.value().at("out").Get<int>() == value + 100) {
+          ++num_correct;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(8 * 20, num_correct);
+  EXPECT_EQ(3, num_opens);
+}
+
+TEST_F(GraphPoolTest, RunsGraphsOnConfiguredExecutor) {
+  num_scheduled_tasks = 0;
+  options_.num_graphs = 2;
+  options_.configure_graph = [](CalculatorGraph* graph) {
+    return graph->SetExecutor("", std::make_shared<CountingExecutor>());
+  };
+  auto pool_or = GraphPool::Create(config_, options_);
+  MP_ASSERT_OK(pool_or.status());
+  std::unique_ptr<GraphPool> pool = std::move(pool_or).value();
+
+  const int num_tasks_after_start = num_scheduled_tasks;
+  EXPECT_GT(num_tasks_after_start, 0);
+  auto outputs = pool->Process({{"in", MakePacket<int>(1)}});
+  MP_ASSERT_OK(outputs.status());
+  EXPECT_EQ(101, outputs.value().at("out").Get<int>());
+  EXPECT_GT(num_scheduled_tasks, num_tasks_after_start);
+  MP_EXPECT_OK(pool->Close());
+}
+
+TEST_F(GraphPoolTest, RestartsGraphAfterFailedRequest) {
+  auto pool_or = GraphPool::Create(config_, options_);
+  MP_ASSERT_OK(pool_or.status());
+  std::unique_ptr<GraphPool> pool = std::move(pool_or).value();
+
+  EXPECT_FALSE(pool->Process({{"in", MakePacket<int>(-1)}}).ok());
+  auto outputs = pool->Process({{"in", MakePacket<int>(1)}});
+  MP_ASSERT_OK(outputs.status());
+  EXPECT_EQ(101, outputs.value().at("out").Get<int>());
+  EXPECT_EQ(2, num_opens);
+}
+
+TEST_F(GraphPoolTest, RejectsInvalidInputs) {
+  auto pool_or = GraphPool::Create(config_, options_);
+  MP_ASSERT_OK(pool_or.status());
+  std::unique_ptr<GraphPool> pool = std::move(pool_or).value();
+
+  EXPECT_FALSE(pool->Process({}).ok());
+  EXPECT_FALSE(pool->Process({{"unknown", MakePacket<int>(1)}}).ok());
+  MP_EXPECT_OK(pool->Process({{"in", MakePacket<int>(1)}}).status());
+}
+
+TEST_F(GraphPoolTest, FailsAfterClose) {
+  auto pool_or = GraphPool::Create(config_, options_);
+  MP_ASSERT_OK(pool_or.status());
+  std::unique_ptr<GraphPool> pool = std::move(pool_or).value();
+  MP_ASSERT_OK(pool->Close());
+  EXPECT_FALSE(pool->Process({{"in", MakePacket<int>(1)}}).ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
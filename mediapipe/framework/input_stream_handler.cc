@@ -169,6 +169,13 @@ bool InputStreamHandler::ScheduleInvocations(int max_allowance,
         *input_bound =
             calculator_context_manager_->GetDefaultCalculatorContext()
                 ->InputTimestamp();
+        // A batch scheduled by this call already holds the input sets of the
+        // default context, which must not be scheduled a second time.
+        if (schedule_partial_batches_ && invocations_scheduled == 0) {
+          schedule_callback_(
+              calculator_context_manager_->GetDefaultCalculatorContext());
+          ++invocations_scheduled;
+        }
       } else {
         *input_bound = min_stream_timestamp;
       }
@@ -238,6 +238,14 @@ class InputStreamHandler {
   // Batching cannot be combined with late_preparation_ behavior.
   void SetBatchSize(int batch_size);
 
+  // When true, an incomplete batch of input sets is scheduled as soon as no
+  // further input set is ready, rather than when batch_size input sets have
+  // been collected. Batches then hold between 1 and batch_size input sets,
+  // depending on how many are queued when the node is scheduled.
+  void SetSchedulePartialBatches(bool schedule_partial_batches) {
+    schedule_partial_batches_ = schedule_partial_batches;
+  }
+
   // Subclasses can enable late preparation; however it cannot be used along
   // with batching.
   void SetLatePreparation(bool late_preparation);
@@ -301,6 +309,10 @@ class InputStreamHandler {
   // CalculatorNode is scheduled.
   int batch_size_ = 1;
 
+  // When true, incomplete batches are scheduled without waiting for more
+  // input sets.
+  bool schedule_partial_batches_ = false;
+
   // When true, any increase in timestamp bound invokes Calculator::Process.
   bool process_timestamps_ = false;
 
@@ -329,6 +329,38 @@ Packet InputStreamManager::PopQueueHead(bool* stream_is_done) {
   return packet;
 }
 
+void InputStreamManager::PopPackets(int max_packets,
+                                    std::vector<Packet>* packets,
+                                    bool* stream_is_done) {
+  CHECK(enable_timestamps_);
+  *stream_is_done = false;
+  bool queue_became_non_full = false;
+  {
+    absl::MutexLock stream_lock(&stream_mutex_);
+    bool was_queue_full =
+        (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
+    for (int i = 0; i < max_packets && !queue_.empty(); ++i) {
+      const Timestamp timestamp = queue_.front().Timestamp();
+      CHECK_LE(last_select_timestamp_, timestamp);
+      last_select_timestamp_ = timestamp;
+      if (next_timestamp_bound_ <= timestamp) {
+        next_timestamp_bound_ = timestamp.NextAllowedInStream();
+      }
+      packets->push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+
+    VLOG(3) << "Input stream removed packets:" << name_
+            << " Size:" << queue_.size();
+    queue_became_non_full = (was_queue_full && queue_.size() < max_queue_size_);
+    *stream_is_done = IsDone();
+  }
+  if (queue_became_non_full) {
+    VLOG(3) << "Queue became non-full: " << Name();
+    becomes_not_full_callback_(this, &last_reported_stream_full_);
+  }
+}
+
 int InputStreamManager::QueueSize() const {
   absl::MutexLock lock(&stream_mutex_);
   return static_cast<int>(queue_.size());
@@ -19,6 +19,7 @@
 #include <functional>
 #include <list>
 #include <string>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
@@ -140,6 +141,14 @@ class InputStreamManager {
   // Timestamp::Done() after the pop.
   Packet PopQueueHead(bool* stream_is_done) ABSL_LOCKS_EXCLUDED(stream_mutex_);
 
+  // Pops up to max_packets packets from the head of the queue and appends
+  // them to packets, advancing time to the timestamp of the last one.  Same
+  // as calling PopPacketAtTimestamp() with the timestamp of each queued
+  // packet, but locks the stream once.  Sets "stream_is_done" if the next
+  // timestamp bound reaches Timestamp::Done() after the pop.
+  void PopPackets(int max_packets, std::vector<Packet>* packets,
+                  bool* stream_is_done) ABSL_LOCKS_EXCLUDED(stream_mutex_);
+
   // Returns the number of packets in the queue.
   int QueueSize() const ABSL_LOCKS_EXCLUDED(stream_mutex_);
 
@@ -16,6 +16,7 @@
 #define MEDIAPIPE_FRAMEWORK_OUTPUT_STREAM_POLLER_H_
 
 #include <memory>
+#include <vector>
 
 #include "mediapipe/framework/graph_output_stream.h"
 
@@ -48,6 +49,20 @@ class OutputStreamPoller {
     return poller->Next(packet);
   }
 
+  // Gets up to max_packets packets at once, replacing the contents of
+  // packets (block until at least one is available or the stream is done).
+  // Returns true if successful. Draining the available packets in one call
+  // avoids waking the caller for every packet.
+  ABSL_MUST_USE_RESULT bool NextBatch(int max_packets,
+                                      std::vector<Packet>* packets) {
+    auto poller = internal_poller_impl_.lock();
+    if (!poller) {
+      packets->clear();
+      return false;
+    }
+    return poller->NextBatch(max_packets, packets);
+  }
+
   void SetMaxQueueSize(int queue_size) {
     auto poller = internal_poller_impl_.lock();
     CHECK(poller) << "OutputStreamPollerImpl is already destroyed.";
@@ -0,0 +1,155 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/priority_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
+
+namespace mediapipe {
+
+// static
+absl::StatusOr<Executor*> PriorityExecutor::Create(
+    const MediaPipeOptions& extendable_options) {
+  auto& options =
+      extendable_options.GetExtension(ThreadPoolExecutorOptions::ext);
+  if (!options.has_num_threads()) {
+    return absl::InvalidArgumentError(
+        "num_threads is not specified in ThreadPoolExecutorOptions.");
+  }
+  if (options.num_threads() <= 0) {
+    return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "The num_threads field in ThreadPoolExecutorOptions should be "
+              "positive but is "
+           << options.num_threads();
+  }
+  return new PriorityExecutor(options.num_threads());
+}
+
+PriorityExecutor::PriorityExecutor(int num_threads)
+    : thread_pool_("mediapipe_priority", num_threads) {
+  thread_pool_.StartWorkers();
+}
+
+PriorityExecutor::~PriorityExecutor() {
+  VLOG(2) << "Terminating priority executor.";
+}
+
+void PriorityExecutor::Schedule(std::function<void()> task) {
+  thread_pool_.Schedule(std::move(task));
+}
+
+void PriorityExecutor::AddTask(TaskQueue* task_queue) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto inserted = queues_.emplace(task_queue, QueueState());
+    if (inserted.second) {
+      inserted.first->second.virtual_time = global_virtual_time_;
+    }
+    inserted.first->second.ready_times.push_back(absl::Now());
+  }
+  // Each closure runs a task of whichever queue is most urgent by then, so
+  // the number of closures always matches the number of ready tasks.
+  thread_pool_.Schedule([this] { RunNextTask(); });
+}
+
+bool PriorityExecutor::RunsBefore(
+    const std::pair<TaskQueue* const, QueueState>& a,
+    const std::pair<TaskQueue* const, QueueState>& b) const {
+  const TaskQueueSchedulingOptions& options_a = a.first->SchedulingOptions();
+  const TaskQueueSchedulingOptions& options_b = b.first->SchedulingOptions();
+  if (options_a.priority != options_b.priority) {
+    return options_a.priority > options_b.priority;
+  }
+  const bool has_budget_a = options_a.latency_budget > absl::ZeroDuration();
+  const bool has_budget_b = options_b.latency_budget > absl::ZeroDuration();
+  if (has_budget_a != has_budget_b) {
+    return has_budget_a;
+  }
+  if (has_budget_a) {
+    return a.second.ready_times.front() + options_a.latency_budget <
+           b.second.ready_times.front() + options_b.latency_budget;
+  }
+  return a.second.virtual_time < b.second.virtual_time;
+}
+
+TaskQueue* PriorityExecutor::SelectQueue() {
+  auto selected = queues_.end();
+  for (auto it = queues_.begin(); it != queues_.end(); ++it) {
+    if (it->second.ready_times.empty()) continue;
+    if (selected == queues_.end() || RunsBefore(*it, *selected)) {
+      selected = it;
+    }
+  }
+  CHECK(selected != queues_.end());
+  return selected->first;
+}
+
+void PriorityExecutor::RunNextTask() {
+  TaskQueue* task_queue;
+  TaskQueueSchedulingOptions options;
+  absl::Time ready_time;
+  absl::Time start_time;
+  {
+    absl::MutexLock lock(&mutex_);
+    task_queue = SelectQueue();
+    // The queue may be destroyed as soon as its last task has run.
+    options = task_queue->SchedulingOptions();
+    QueueState& state = queues_[task_queue];
+    ready_time = state.ready_times.front();
+    state.ready_times.pop_front();
+    ++state.num_running;
+    global_virtual_time_ = std::max(global_virtual_time_, state.virtual_time);
+    start_time = absl::Now();
+  }
+
+  task_queue->RunNextTask();
+
+  const absl::Time end_time = absl::Now();
+  const absl::Duration run_time = end_time - start_time;
+  const absl::Duration wait_time = start_time - ready_time;
+  absl::MutexLock lock(&mutex_);
+  auto it = queues_.find(task_queue);
+  CHECK(it != queues_.end());
+  QueueState& state = it->second;
+  state.virtual_time += absl::ToDoubleSeconds(run_time) / options.weight;
+  if (--state.num_running == 0 && state.ready_times.empty()) {
+    queues_.erase(it);
+  }
+
+  QueueStats& stats = stats_[options.name];
+  ++stats.num_tasks;
+  stats.total_wait_time += wait_time;
+  stats.max_wait_time = std::max(stats.max_wait_time, wait_time);
+  stats.total_run_time += run_time;
+  if (options.latency_budget > absl::ZeroDuration() &&
+      end_time > ready_time + options.latency_budget) {
+    ++stats.num_missed_deadlines;
+  }
+}
+
+std::map<std::string, PriorityExecutor::QueueStats>
+PriorityExecutor::GetQueueStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+REGISTER_EXECUTOR(PriorityExecutor);
+
+}  // namespace mediapipe
@@ -0,0 +1,124 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines PriorityExecutor, an executor for several graphs sharing a thread
+// pool that orders ready tasks across graphs.
+//
+// ThreadPoolExecutor runs tasks of all graphs first come, first served, so a
+// bursty or expensive graph delays every other graph using the executor.
+// PriorityExecutor instead keeps track of the ready tasks of each task queue
+// (i.e. each graph, see GraphSchedulingConfig in calculator.proto) and, when a
+// thread becomes free, runs a task of the queue that:
+//   1. has the highest priority;
+//   2. then, among queues with a latency budget, has the earliest deadline,
+//      i.e. time the task became ready plus latency budget;
+//   3. then, among the other queues, has received the least executor time
+//      relative to its weight (weighted fair sharing).
+// Deadlines are based on readiness rather than on packet timestamps, since
+// timestamps of different graphs are not comparable. Within a graph with a
+// latency budget, nodes run in order of input timestamp.
+//
+// Example:
+//   auto executor = std::make_shared<PriorityExecutor>(/*num_threads=*/4);
+//   // Before initializing the graphs:
+//   MP_RETURN_IF_ERROR(graph_a.SetExecutor("", executor));
+//   MP_RETURN_IF_ERROR(graph_b.SetExecutor("", executor));
+//   ...
+//   for (const auto& stats : executor->GetQueueStats()) { ... }
+
+#ifndef MEDIAPIPE_FRAMEWORK_PRIORITY_EXECUTOR_H_
+#define MEDIAPIPE_FRAMEWORK_PRIORITY_EXECUTOR_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/executor.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+
+class PriorityExecutor : public Executor {
+ public:
+  // Statistics of the tasks run for the queues of a name.
+  struct QueueStats {
+    int64 num_tasks = 0;
+    // Time between a task becoming ready and starting to run.
+    absl::Duration total_wait_time;
+    absl::Duration max_wait_time;
+    absl::Duration total_run_time;
+    // Number of tasks of queues with a latency budget that finished after
+    // their deadline.
+    int64 num_missed_deadlines = 0;
+  };
+
+  // Creates an executor with the number of threads specified in
+  // ThreadPoolExecutorOptions.
+  static absl::StatusOr<Executor*> Create(
+      const MediaPipeOptions& extendable_options);
+
+  explicit PriorityExecutor(int num_threads);
+  ~PriorityExecutor() override;
+
+  void AddTask(TaskQueue* task_queue) override;
+  // Runs task ahead of all task queues.
+  void Schedule(std::function<void()> task) override;
+
+  // Returns the statistics of all task queues run so far, keyed by the name
+  // in their TaskQueueSchedulingOptions.
+  std::map<std::string, QueueStats> GetQueueStats() const;
+
+ private:
+  struct QueueState {
+    // Times at which the tasks added for the queue became ready.
+    std::deque<absl::Time> ready_times;
+    int num_running = 0;
+    // Executor time received, divided by weight.
+    double virtual_time = 0;
+  };
+
+  // Runs the next task of the queue selected by SelectQueue.
+  void RunNextTask();
+
+  // Returns the queue to run a task of next. There must be a ready task.
+  TaskQueue* SelectQueue() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns true if a task of queue a should run before a task of queue b.
+  bool RunsBefore(const std::pair<TaskQueue* const, QueueState>& a,
+                  const std::pair<TaskQueue* const, QueueState>& b) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  // Queues with ready or running tasks.
+  std::map<TaskQueue*, QueueState> queues_ ABSL_GUARDED_BY(mutex_);
+  // Virtual time of the queue that ran last. Queues becoming active start
+  // from it, so that they do not catch up on time they were idle.
+  double global_virtual_time_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::map<std::string, QueueStats> stats_ ABSL_GUARDED_BY(mutex_);
+
+  // Declared last, so that workers are joined before the members they use
+  // are destroyed.
+  mediapipe::ThreadPool thread_pool_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PRIORITY_EXECUTOR_H_
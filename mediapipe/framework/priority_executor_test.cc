@@ -0,0 +1,172 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/priority_executor.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Records the names of the queues whose tasks ran, in order.
+class RunLog {
+ public:
+  void Add(const std::string& name) {
+    absl::MutexLock lock(&mutex_);
+    names_.push_back(name);
+  }
+  std::vector<std::string> Names() {
+    absl::MutexLock lock(&mutex_);
+    return names_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::string> names_;
+};
+
+class FakeTaskQueue : public TaskQueue {
+ public:
+  FakeTaskQueue(const TaskQueueSchedulingOptions& options, RunLog* log)
+      : options_(options), log_(log) {}
+
+  void RunNextTask() override { log_->Add(options_.name); }
+  const TaskQueueSchedulingOptions& SchedulingOptions() const override {
+    return options_;
+  }
+
+ private:
+  const TaskQueueSchedulingOptions options_;
+  RunLog* log_;
+};
+
+TaskQueueSchedulingOptions MakeOptions(const std::string& name, int priority,
+                                       absl::Duration latency_budget) {
+  TaskQueueSchedulingOptions options;
+  options.name = name;
+  options.priority = priority;
+  options.latency_budget = latency_budget;
+  return options;
+}
+
+// Runs tasks on a single thread, holding the thread until the tasks of all
+// queues are added, so that the executor chooses among all of them.
+class PriorityExecutorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    executor_ = absl::make_unique<PriorityExecutor>(/*num_threads=*/1);
+    executor_->Schedule([this] { release_.WaitForNotification(); });
+  }
+
+  std::vector<std::string> RunAll() {
+    release_.Notify();
+    executor_.reset();
+    return log_.Names();
+  }
+
+  RunLog log_;
+  absl::Notification release_;
+  std::unique_ptr<PriorityExecutor> executor_;
+};
+
+TEST_F(PriorityExecutorTest, RunsHigherPriorityFirst) {
+  FakeTaskQueue low(MakeOptions("low", 0, absl::ZeroDuration()), &log_);
+  FakeTaskQueue high(MakeOptions("high", 1, absl::ZeroDuration()), &log_);
+  executor_->AddTask(&low);
+  executor_->AddTask(&low);
+  executor_->AddTask(&high);
+  executor_->AddTask(&high);
+  EXPECT_THAT(RunAll(), testing::ElementsAre("high", "high", "low", "low"));
+}
+
+TEST_F(PriorityExecutorTest, RunsEarliestDeadlineFirst) {
+  FakeTaskQueue relaxed(MakeOptions("relaxed", 0, absl::Seconds(10)), &log_);
+  FakeTaskQueue urgent(MakeOptions("urgent", 0, absl::Milliseconds(1)),
+                       &log_);
+  FakeTaskQueue no_budget(MakeOptions("no_budget", 0, absl::ZeroDuration()),
+                          &log_);
+  executor_->AddTask(&no_budget);
+  executor_->AddTask(&relaxed);
+  executor_->AddTask(&urgent);
+  EXPECT_THAT(RunAll(),
+              testing::ElementsAre("urgent", "relaxed", "no_budget"));
+}
+
+TEST_F(PriorityExecutorTest, ReportsQueueStats) {
+  FakeTaskQueue queue(MakeOptions("queue", 0, absl::ZeroDuration()), &log_);
+  executor_->AddTask(&queue);
+  executor_->AddTask(&queue);
+  absl::SleepFor(absl::Milliseconds(10));
+  release_.Notify();
+  auto stats = executor_->GetQueueStats();
+  while (stats["queue"].num_tasks < 2) {
+    absl::SleepFor(absl::Milliseconds(1));
+    stats = executor_->GetQueueStats();
+  }
+
+  ASSERT_EQ(1, stats.count("queue"));
+  EXPECT_EQ(2, stats["queue"].num_tasks);
+  EXPECT_GE(stats["queue"].max_wait_time, absl::Milliseconds(10));
+  EXPECT_EQ(0, stats["queue"].num_missed_deadlines);
+}
+
+TEST(PriorityExecutorGraphTest, RunsGraphsWithSchedulingConfig) {
+  auto executor = std::make_shared<PriorityExecutor>(/*num_threads=*/2);
+  std::vector<std::unique_ptr<CalculatorGraph>> graphs;
+  for (const std::string name : {"interactive", "batch"}) {
+    CalculatorGraphConfig config =
+        ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+          input_stream: "in"
+          node {
+            calculator: "PassThroughCalculator"
+            input_stream: "in"
+            output_stream: "out"
+          }
+        )");
+    config.mutable_scheduling()->set_name(name);
+    config.mutable_scheduling()->set_priority(name == "interactive" ? 1 : 0);
+    auto graph = absl::make_unique<CalculatorGraph>();
+    MP_ASSERT_OK(graph->SetExecutor("", executor));
+    MP_ASSERT_OK(graph->Initialize(config));
+    MP_ASSERT_OK(graph->StartRun({}));
+    graphs.push_back(std::move(graph));
+  }
+  for (int i = 0; i < 10; ++i) {
+    for (auto& graph : graphs) {
+      MP_ASSERT_OK(graph->AddPacketToInputStream(
+          "in", MakePacket<int>(i).At(Timestamp(i))));
+    }
+  }
+  for (auto& graph : graphs) {
+    MP_ASSERT_OK(graph->CloseAllInputStreams());
+    MP_ASSERT_OK(graph->WaitUntilDone());
+  }
+
+  auto stats = executor->GetQueueStats();
+  EXPECT_GE(stats["interactive"].num_tasks, 10);
+  EXPECT_GE(stats["batch"].num_tasks, 10);
+}
+
+}  // namespace
+}  // namespace mediapipe
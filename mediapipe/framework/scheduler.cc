@@ -98,10 +98,22 @@ absl::Status Scheduler::SetNonDefaultExecutor(const std::string& name,
   queue->SetIdleCallback(std::bind(&Scheduler::QueueIdleStateChanged, this,
                                    std::placeholders::_1));
   queue->SetExecutor(executor);
+  queue->SetSchedulingOptions(scheduling_options_);
   scheduler_queues_.push_back(queue);
   return absl::OkStatus();
 }
 
+void Scheduler::SetSchedulingOptions(
+    const TaskQueueSchedulingOptions& options) {
+  CHECK_EQ(state_, STATE_NOT_STARTED) << "SetSchedulingOptions must not be "
+                                         "called after the scheduler has "
+                                         "started";
+  scheduling_options_ = options;
+  for (SchedulerQueue* queue : scheduler_queues_) {
+    queue->SetSchedulingOptions(options);
+  }
+}
+
 void Scheduler::SetQueuesRunning(bool running) {
   for (auto queue : scheduler_queues_) {
     queue->SetRunning(running);
@@ -59,6 +59,10 @@ class Scheduler {
   absl::Status SetNonDefaultExecutor(const std::string& name,
                                      Executor* executor);
 
+  // Sets the scheduling options of all queues, including queues of executors
+  // set later. Must be called before the scheduler is started.
+  void SetSchedulingOptions(const TaskQueueSchedulingOptions& options);
+
   // Resets the data members at the beginning of each graph run.
   void Reset();
 
@@ -254,6 +258,9 @@ class Scheduler {
   // Non-default scheduler queues, keyed by their executor names.
   std::map<std::string, std::unique_ptr<SchedulerQueue>> non_default_queues_;
 
+  // Scheduling options of all queues.
+  TaskQueueSchedulingOptions scheduling_options_;
+
   // Holds pointers to all queues used by the scheduler, for convenience.
   std::vector<SchedulerQueue*> scheduler_queues_;
 
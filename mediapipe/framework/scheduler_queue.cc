@@ -17,6 +17,7 @@
 #include <memory>
 #include <queue>
 #include <utility>
+#include <vector>
 
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/calculator_node.h"
@@ -34,7 +35,21 @@
 namespace mediapipe {
 namespace internal {
 
-SchedulerQueue::Item::Item(CalculatorNode* node, CalculatorContext* cc)
+namespace {
+
+// The task being run by SchedulerQueue::RunNextTask on the current thread.
+struct RunningTask {
+  SchedulerQueue* queue;
+  // Fused nodes scheduled during the task, in scheduling order.
+  std::vector<SchedulerQueue::Item> fused_items;
+};
+
+thread_local RunningTask* current_task = nullptr;
+
+}  // namespace
+
+SchedulerQueue::Item::Item(CalculatorNode* node, CalculatorContext* cc,
+                           bool order_by_timestamp)
     : node_(node), cc_(cc) {
   CHECK(node);
   CHECK(cc);
@@ -43,6 +58,8 @@ SchedulerQueue::Item::Item(CalculatorNode* node, CalculatorContext* cc)
   if (is_source_) {
     layer_ = node->source_layer();
     source_process_order_ = node->SourceProcessOrder(cc).Value();
+  } else if (order_by_timestamp) {
+    input_timestamp_ = cc->InputTimestamp().Value();
   }
 }
 
@@ -81,6 +98,11 @@ bool SchedulerQueue::Item::operator<(const SchedulerQueue::Item& that) const {
   } else {
     // Non-sources run before sources.
     if (that.is_source_) return false;
+    // Newer input timestamps run after older ones. Timestamps are only set
+    // if the queue orders by timestamp.
+    if (input_timestamp_ != that.input_timestamp_) {
+      return input_timestamp_ > that.input_timestamp_;
+    }
     // For non-sources, higher ids run before lower ids.
     return id_ < that.id_;
   }
@@ -95,6 +117,11 @@ void SchedulerQueue::Reset() {
 
 void SchedulerQueue::SetExecutor(Executor* executor) { executor_ = executor; }
 
+void SchedulerQueue::SetSchedulingOptions(
+    const TaskQueueSchedulingOptions& options) {
+  scheduling_options_ = options;
+}
+
 bool SchedulerQueue::IsIdle() {
   VLOG(3) << "Scheduler queue empty: " << queue_.empty()
           << ", # of pending tasks: " << num_pending_tasks_;
@@ -120,7 +147,12 @@ void SchedulerQueue::AddNode(CalculatorNode* node, CalculatorContext* cc) {
     CHECK(node->IsSource()) << node->DebugName();
     return;
   }
-  AddItemToQueue(Item(node, cc));
+  Item item(node, cc,
+            scheduling_options_.latency_budget > absl::ZeroDuration());
+  if (node->IsFusedWithUpstream() && TryToRunAfterCurrentTask(item)) {
+    return;
+  }
+  AddItemToQueue(std::move(item));
 }
 
 void SchedulerQueue::AddNodeForOpen(CalculatorNode* node) {
@@ -130,6 +162,22 @@ void SchedulerQueue::AddNodeForOpen(CalculatorNode* node) {
   AddItemToQueue(Item(node));
 }
 
+bool SchedulerQueue::TryToRunAfterCurrentTask(const Item& item) {
+  if (current_task == nullptr || current_task->queue != this) {
+    return false;
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    // A paused queue does not run tasks.
+    if (running_count_ <= 0) {
+      return false;
+    }
+  }
+  VLOG(4) << item.Node()->DebugName() << " runs after the current task.";
+  current_task->fused_items.push_back(item);
+  return true;
+}
+
 void SchedulerQueue::AddItemToQueue(Item&& item) {
   const CalculatorNode* node = item.Node();
   bool was_idle;
@@ -209,6 +257,9 @@ void SchedulerQueue::RunNextTask() {
   // want to rely on executors setting up an autorelease pool for us (e.g.
   // an executor creating standard pthread will not, by default), so we
   // do it here to ensure all executors are covered.
+  RunningTask task{this};
+  RunningTask* const enclosing_task = current_task;
+  current_task = &task;
   AUTORELEASEPOOL {
     if (is_open_node) {
       DCHECK(!calculator_context);
@@ -216,7 +267,15 @@ void SchedulerQueue::RunNextTask() {
     } else {
       RunCalculatorNode(node, calculator_context);
     }
+    // Fused nodes may in turn schedule fused nodes, which are appended.
+    // The task holds its pending count until they have run, so the queue
+    // does not become idle in between.
+    for (size_t i = 0; i < task.fused_items.size(); ++i) {
+      const Item item = task.fused_items[i];
+      RunCalculatorNode(item.Node(), item.Context());
+    }
   }
+  current_task = enclosing_task;
 
   bool is_idle;
   {
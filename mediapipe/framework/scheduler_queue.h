@@ -45,7 +45,10 @@ class SchedulerQueue : public TaskQueue {
   // Item in the queue. Wraps a node pointer and helps with priority sorting.
   class Item {
    public:
-    Item(CalculatorNode* node, CalculatorContext* cc);
+    // If order_by_timestamp is true, non-source items are ordered by the
+    // input timestamp of cc before node id.
+    Item(CalculatorNode* node, CalculatorContext* cc,
+         bool order_by_timestamp = false);
     // A null CalculatorContext indicates the task should run OpenNode().
     Item(CalculatorNode* node);
 
@@ -63,11 +66,13 @@ class SchedulerQueue : public TaskQueue {
     //   Calculator::SourceProcessOrder (smaller values run first), then by
     //   node id: smaller ids run first, since they come earlier in the config.
     // - Non-sources are sorted by node id: larger ids run first, because they
-    //   are closer to the leaves.
+    //   are closer to the leaves. Items ordered by timestamp are first sorted
+    //   by input timestamp: older timestamps run first.
     bool operator<(const Item& that) const;
 
    private:
     int64 source_process_order_ = 0;
+    int64 input_timestamp_ = Timestamp::Unset().Value();
     CalculatorNode* node_;
     CalculatorContext* cc_;
     int id_ = 0;
@@ -82,6 +87,11 @@ class SchedulerQueue : public TaskQueue {
   // scheduler is started.
   void SetExecutor(Executor* executor);
 
+  // Sets the options reported to the executor through SchedulingOptions().
+  // A positive latency budget also orders non-source nodes by input
+  // timestamp. Must be called before the scheduler is started.
+  void SetSchedulingOptions(const TaskQueueSchedulingOptions& options);
+
   // Sets the idle callback. It is called exactly once whenever the queue goes
   // from idle to active, or vice versa.
   // Note: if the queue is accessed by multiple threads, it is possible for
@@ -101,6 +111,9 @@ class SchedulerQueue : public TaskQueue {
 
   // Implements the TaskQueue interface.
   void RunNextTask() override;
+  const TaskQueueSchedulingOptions& SchedulingOptions() const override {
+    return scheduling_options_;
+  }
 
   // NOTE: After calling SetRunning(true), the caller must call
   // SubmitWaitingTasksToExecutor since tasks may have been added while the
@@ -130,6 +143,11 @@ class SchedulerQueue : public TaskQueue {
   // Adds an Item to queue_.
   void AddItemToQueue(Item&& item);
 
+  // If called from a task of this queue, and node is fused with its upstream
+  // node, records the item to run right after the task on the same thread and
+  // returns true. Otherwise returns false.
+  bool TryToRunAfterCurrentTask(const Item& item) ABSL_LOCKS_EXCLUDED(mutex_);
+
   void CleanupAfterRun() ABSL_LOCKS_EXCLUDED(mutex_);
 
  private:
@@ -147,6 +165,8 @@ class SchedulerQueue : public TaskQueue {
 
   Executor* executor_ = nullptr;
 
+  TaskQueueSchedulingOptions scheduling_options_;
+
   IdleCallback idle_callback_;
 
   // The net number of times SetRunning(true) has been called.
@@ -0,0 +1,70 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "mediapipe/framework/stream_handler/batch_input_stream_handler.pb.h"
+#include "mediapipe/framework/stream_handler/default_input_stream_handler.h"
+
+namespace mediapipe {
+
+// Input stream handler that delivers all queued input timestamps, up to
+// max_batch_size, to a single node invocation. It synchronizes input streams
+// like DefaultInputStreamHandler. Unlike DefaultInputStreamHandler's
+// batch_size option, it never waits for a batch to fill: while the node keeps
+// up, every invocation receives one timestamp; when it falls behind, the next
+// invocation drains the backlog, paying the scheduling overhead once.
+//
+// By default, Process() is still called once per timestamp within a batch.
+// Calculators that call CalculatorContract::SetProcessInputBatches(true)
+// instead receive the whole batch in a single Process() call, e.g. to run
+// inference on it at once.
+//
+// Example config:
+//
+// node {
+//   calculator: "InferenceCalculator"
+//   input_stream: "TENSORS:input_tensors"
+//   output_stream: "TENSORS:output_tensors"
+//   input_stream_handler {
+//     input_stream_handler: "BatchInputStreamHandler"
+//     options {
+//       [mediapipe.BatchInputStreamHandlerOptions.ext] {
+//         max_batch_size: 4
+//       }
+//     }
+//   }
+// }
+//
+// Batching cannot be combined with max_in_flight > 1: parallel nodes receive
+// one timestamp per invocation, as with DefaultInputStreamHandler.
+class BatchInputStreamHandler : public DefaultInputStreamHandler {
+ public:
+  BatchInputStreamHandler() = delete;
+  BatchInputStreamHandler(std::shared_ptr<tool::TagMap> tag_map,
+                          CalculatorContextManager* cc_manager,
+                          const MediaPipeOptions& options,
+                          bool calculator_run_in_parallel)
+      : DefaultInputStreamHandler(std::move(tag_map), cc_manager, options,
+                                  calculator_run_in_parallel) {
+    if (calculator_run_in_parallel) return;
+    SetBatchSize(options.GetExtension(BatchInputStreamHandlerOptions::ext)
+                     .max_batch_size());
+    SetSchedulePartialBatches(true);
+  }
+};
+
+REGISTER_INPUT_STREAM_HANDLER(BatchInputStreamHandler);
+
+}  // namespace mediapipe
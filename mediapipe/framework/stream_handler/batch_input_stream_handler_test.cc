@@ -0,0 +1,173 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+
+namespace {
+
+absl::Mutex batch_sizes_mutex(absl::kConstInit);
+std::vector<int>* batch_sizes = new std::vector<int>();
+
+// Passes the packets of its first input stream through, recording the size of
+// every input batch. The second input stream only gates the first one, and
+// its output stream stays empty.
+class BatchRecorderCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).Set<int>();
+    cc->Inputs().Index(1).SetAny();
+    cc->Outputs().Index(0).Set<int>();
+    cc->Outputs().Index(1).SetAny();
+    cc->SetProcessInputBatches(true);
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    {
+      absl::MutexLock lock(&batch_sizes_mutex);
+      batch_sizes->push_back(cc->InputBatchSize());
+    }
+    for (int i = 0; i < cc->InputBatchSize(); ++i) {
+      const Packet& packet = cc->Inputs().Index(0).Value(i);
+      if (!packet.IsEmpty()) {
+        cc->Outputs().Index(0).AddPacket(
+            packet.At(cc->InputBatchTimestamp(i)));
+      }
+    }
+    return absl::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(BatchRecorderCalculator);
+
+class BatchInputStreamHandlerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { batch_sizes->clear(); }
+
+  // Returns a graph running calculator on "input" and "gate" with
+  // BatchInputStreamHandler.
+  CalculatorGraphConfig MakeConfig(const std::string& calculator) {
+    CalculatorGraphConfig config =
+        mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"pb(
+          input_stream: "input"
+          input_stream: "gate"
+          node {
+            input_stream: "input"
+            input_stream: "gate"
+            output_stream: "output"
+            output_stream: "gate_output"
+            input_stream_handler {
+              input_stream_handler: "BatchInputStreamHandler"
+              options: {
+                [mediapipe.BatchInputStreamHandlerOptions.ext]: {
+                  max_batch_size: 4
+                }
+              }
+            }
+          })pb");
+    config.mutable_node(0)->set_calculator(calculator);
+    tool::AddVectorSink("output", &config, &output_);
+    return config;
+  }
+
+  // Queues packets at timestamps 1 to 5 behind the gate, then opens it.
+  void RunBacklog(CalculatorGraph* graph) {
+    for (int i = 1; i <= 5; ++i) {
+      MP_ASSERT_OK(graph->AddPacketToInputStream(
+          "input", MakePacket<int>(i).At(Timestamp(i))));
+    }
+    MP_ASSERT_OK(graph->WaitUntilIdle());
+    EXPECT_TRUE(output_.empty());
+    MP_ASSERT_OK(graph->AddPacketToInputStream(
+        "gate", MakePacket<int>(0).At(Timestamp(5))));
+    MP_ASSERT_OK(graph->WaitUntilIdle());
+  }
+
+  std::vector<int> OutputValues() {
+    std::vector<int> values;
+    for (const Packet& packet : output_) {
+      EXPECT_EQ(packet.Get<int>(), packet.Timestamp().Value());
+      values.push_back(packet.Get<int>());
+    }
+    return values;
+  }
+
+  std::vector<Packet> output_;
+};
+
+TEST_F(BatchInputStreamHandlerTest, DeliversBacklogInBatches) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(MakeConfig("BatchRecorderCalculator")));
+  MP_ASSERT_OK(graph.StartRun({}));
+  RunBacklog(&graph);
+  EXPECT_THAT(*batch_sizes, testing::ElementsAre(4, 1));
+  EXPECT_THAT(OutputValues(), testing::ElementsAre(1, 2, 3, 4, 5));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+TEST_F(BatchInputStreamHandlerTest, DoesNotWaitForFullBatches) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(MakeConfig("BatchRecorderCalculator")));
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 1; i <= 3; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", MakePacket<int>(i).At(Timestamp(i))));
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "gate", MakePacket<int>(0).At(Timestamp(i))));
+    MP_ASSERT_OK(graph.WaitUntilIdle());
+    EXPECT_EQ(i, output_.size());
+  }
+  EXPECT_THAT(*batch_sizes, testing::ElementsAre(1, 1, 1));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+TEST_F(BatchInputStreamHandlerTest, CallsProcessPerTimestampWithoutOptIn) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(MakeConfig("PassThroughCalculator")));
+  MP_ASSERT_OK(graph.StartRun({}));
+  RunBacklog(&graph);
+  EXPECT_THAT(OutputValues(), testing::ElementsAre(1, 2, 3, 4, 5));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+// Parallel invocations each take a single timestamp, and no timestamp is
+// delivered twice.
+TEST_F(BatchInputStreamHandlerTest, DeliversSingleTimestampsWithMaxInFlight) {
+  CalculatorGraphConfig config = MakeConfig("BatchRecorderCalculator");
+  config.mutable_node(0)->set_max_in_flight(2);
+  config.set_num_threads(4);
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  RunBacklog(&graph);
+  EXPECT_THAT(*batch_sizes, testing::ElementsAre(1, 1, 1, 1, 1));
+  EXPECT_THAT(OutputValues(), testing::ElementsAre(1, 2, 3, 4, 5));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,87 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A command line utility to compile a CalculatorGraphConfig text proto into a
+// binary CompiledGraphConfig, which CalculatorGraph can initialize from
+// without expanding subgraphs, sorting nodes or validating stream types.
+//
+// The binary must link all calculators and subgraphs used by the graph, see
+// mediapipe_compiled_graph() in mediapipe_graph.bzl.
+
+#include <stdlib.h>
+
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/compiled_graph_config.pb.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/validated_graph_config.h"
+
+ABSL_FLAG(std::string, proto_source, "",
+          "The source file containing CalculatorGraphConfig protobuf text.");
+ABSL_FLAG(std::string, proto_output, "",
+          "An output file in binary CompiledGraphConfig form.");
+
+#define EXIT_IF_ERROR(status) \
+  if (!status.ok()) {         \
+    LOG(ERROR) << status;     \
+    return EXIT_FAILURE;      \
+  }
+
+namespace mediapipe {
+
+absl::Status CompileGraph(const std::string& proto_source,
+                          const std::string& proto_output) {
+  std::string graph_text;
+  MP_RETURN_IF_ERROR(file::GetContents(proto_source, &graph_text));
+  CalculatorGraphConfig config;
+  RET_CHECK(ParseTextProto(graph_text, &config))
+      << "could not parse text proto: " << proto_source;
+
+  ValidatedGraphConfig validated_graph;
+  MP_RETURN_IF_ERROR(validated_graph.Initialize(config));
+  std::string compiled_graph;
+  RET_CHECK(validated_graph.Compile().SerializeToString(&compiled_graph))
+      << "could not serialize compiled graph: " << proto_source;
+  return file::SetContents(proto_output, compiled_graph);
+}
+
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+
+  // Validate command line options.
+  absl::Status status;
+  if (absl::GetFlag(FLAGS_proto_source).empty()) {
+    status.Update(
+        absl::InvalidArgumentError("--proto_source must be specified"));
+  }
+  if (absl::GetFlag(FLAGS_proto_output).empty()) {
+    status.Update(
+        absl::InvalidArgumentError("--proto_output must be specified"));
+  }
+  EXIT_IF_ERROR(status);
+  EXIT_IF_ERROR(mediapipe::CompileGraph(absl::GetFlag(FLAGS_proto_source),
+                                        absl::GetFlag(FLAGS_proto_output)));
+  return EXIT_SUCCESS;
+}
@@ -3,6 +3,9 @@
 mediapipe_binary_graph() converts a graph from text format to serialized binary
 format.
 
+mediapipe_compiled_graph() additionally expands and validates the graph, see
+tool/compile_graph.cc.
+
 Example:
   mediapipe_binary_graph(
     name = "make_graph_binarypb",
@@ -61,6 +64,42 @@ def mediapipe_binary_graph(name, graph = None, output_name = None, deps = [], te
         testonly = testonly,
     )
 
+def mediapipe_compiled_graph(name, graph = None, output_name = None, deps = [], testonly = False, **kwargs):
+    """Compiles a graph from text format to a binary CompiledGraphConfig.
+
+    The compiled graph has its subgraphs expanded and nodes sorted, and can be
+    loaded with CalculatorGraph::Initialize(const CompiledGraphConfig&, ...).
+    deps must include all calculators and subgraphs used by the graph, and
+    the graph must be recompiled whenever their contracts change.
+    """
+
+    if not graph:
+        fail("No input graph file specified.")
+
+    if not output_name:
+        fail("Must specify the output_name.")
+
+    native.cc_binary(
+        name = name + "_compile_graph",
+        visibility = ["//visibility:private"],
+        deps = [clean_dep("//mediapipe/framework/tool:compile_graph")] + deps,
+        tags = ["manual"],
+        testonly = testonly,
+    )
+
+    native.genrule(
+        name = name,
+        srcs = [graph],
+        outs = [output_name],
+        cmd = (
+            "$(location " + name + "_compile_graph" + ") " +
+            ("--proto_source=$(location %s) " % graph) +
+            ("--proto_output=\"$@\" ")
+        ),
+        tools = [name + "_compile_graph"],
+        testonly = testonly,
+    )
+
 def data_as_c_string(
         name,
         srcs,
@@ -47,6 +47,8 @@
 
 namespace mediapipe {
 
+constexpr int ValidatedGraphConfig::kCompiledGraphVersion;
+
 namespace {
 
 // Create a debug std::string name for a set of edge.  An edge can be either
@@ -360,26 +362,7 @@ absl::Status ValidatedGraphConfig::Initialize(
                                             service_manager, &config_));
 
   // Initialize the basic node information.
-  MP_RETURN_IF_ERROR(InitializeGeneratorInfo());
-  MP_RETURN_IF_ERROR(InitializeCalculatorInfo());
-  MP_RETURN_IF_ERROR(InitializeStatusHandlerInfo());
-
-  sorted_nodes_.reserve(generators_.size() + calculators_.size());
-  // Initialize sorted_nodes_ to list generators before calculators.
-  for (int index = 0; index < generators_.size(); ++index) {
-    NodeTypeInfo* node_type_info = &generators_[index];
-    RET_CHECK(node_type_info->Node().type ==
-              NodeTypeInfo::NodeType::PACKET_GENERATOR);
-    RET_CHECK_EQ(node_type_info->Node().index, index);
-    sorted_nodes_.push_back(node_type_info);
-  }
-  for (int index = 0; index < calculators_.size(); ++index) {
-    NodeTypeInfo* node_type_info = &calculators_[index];
-    RET_CHECK(node_type_info->Node().type ==
-              NodeTypeInfo::NodeType::CALCULATOR);
-    RET_CHECK_EQ(node_type_info->Node().index, index);
-    sorted_nodes_.push_back(node_type_info);
-  }
+  MP_RETURN_IF_ERROR(InitializeNodeInfos());
 
   // Initialize the side packet information.
   bool need_sorting = false;
@@ -409,6 +392,9 @@ absl::Status ValidatedGraphConfig::Initialize(
   // created.
   MP_RETURN_IF_ERROR(FillUpstreamFieldForBackEdges());
 
+  // Fingerprint the contracts as declared, before Any types are resolved.
+  contract_fingerprint_ = ContractFingerprint();
+
   // Set Any types based on what they connect to.
   MP_RETURN_IF_ERROR(ResolveAnyTypes(&input_streams_, &output_streams_));
   MP_RETURN_IF_ERROR(
@@ -421,6 +407,7 @@ absl::Status ValidatedGraphConfig::Initialize(
   MP_RETURN_IF_ERROR(ComputeSourceDependence());
 
   MP_RETURN_IF_ERROR(ValidateExecutors());
+  ComputeFusedNodes();
 
 #if !defined(MEDIAPIPE_MOBILE)
   VLOG(1) << "ValidatedGraphConfig produced canonical config:\n"
@@ -458,6 +445,133 @@ absl::Status ValidatedGraphConfig::Initialize(
   return Initialize(graph_type, arguments, &graph_registry, service_manager);
 }
 
+absl::Status ValidatedGraphConfig::Initialize(
+    const CompiledGraphConfig& compiled_config) {
+  RET_CHECK(!initialized_)
+      << "ValidatedGraphConfig can be initialized only once.";
+  if (compiled_config.version() != kCompiledGraphVersion) {
+    return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
+           << "Compiled graph has version " << compiled_config.version()
+           << ", expected " << kCompiledGraphVersion
+           << ". The graph must be recompiled.";
+  }
+  config_ = compiled_config.config();
+
+  MP_RETURN_IF_ERROR(InitializeNodeInfos());
+  // The compiled config is sorted, so a single pass suffices (and any
+  // unsorted input is reported as an error).
+  MP_RETURN_IF_ERROR(InitializeSidePacketInfo(nullptr));
+  MP_RETURN_IF_ERROR(InitializeStreamInfo(nullptr));
+  MP_RETURN_IF_ERROR(FillUpstreamFieldForBackEdges());
+
+  // The stream and side packet types were validated at compile time, which
+  // holds for as long as the contracts and the edges are unchanged.
+  contract_fingerprint_ = ContractFingerprint();
+  if (contract_fingerprint_ != compiled_config.contract_fingerprint()) {
+    return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
+           << "Calculator contracts or graph edges differ from the ones the "
+              "graph was compiled against. The graph must be recompiled.";
+  }
+  MP_RETURN_IF_ERROR(ResolveAnyTypes(&input_streams_, &output_streams_));
+  MP_RETURN_IF_ERROR(
+      ResolveAnyTypes(&input_side_packets_, &output_side_packets_));
+
+  MP_RETURN_IF_ERROR(ComputeSourceDependence());
+  MP_RETURN_IF_ERROR(ValidateExecutors());
+  ComputeFusedNodes();
+  initialized_ = true;
+  return absl::OkStatus();
+}
+
+CompiledGraphConfig ValidatedGraphConfig::Compile() const {
+  CHECK(initialized_) << "ValidatedGraphConfig is not initialized.";
+  CompiledGraphConfig compiled_config;
+  compiled_config.set_version(kCompiledGraphVersion);
+  *compiled_config.mutable_config() = config_;
+  compiled_config.set_contract_fingerprint(contract_fingerprint_);
+  return compiled_config;
+}
+
+uint64 ValidatedGraphConfig::ContractFingerprint() const {
+  // FNV-1a, which unlike std::hash is stable across binaries.
+  uint64 fingerprint = 14695981039346656037ULL;
+  auto add = [&fingerprint](const std::string& data) {
+    for (char c : data) {
+      fingerprint ^= static_cast<uint8>(c);
+      fingerprint *= 1099511628211ULL;
+    }
+    // Separator, so that concatenations of different strings differ.
+    fingerprint ^= 0xff;
+    fingerprint *= 1099511628211ULL;
+  };
+  auto add_types = [&add](const PacketTypeSet& types) {
+    add(absl::StrCat(types.NumEntries()));
+    for (CollectionItemId id = types.BeginId(); id < types.EndId(); ++id) {
+      add(types.Get(id).DebugTypeName());
+    }
+  };
+  // The edges, which together with the types determine the outcome of
+  // ValidateSidePacketTypes and ValidateStreamTypes.
+  auto add_names = [&add](const auto& names) {
+    add(absl::StrCat(names.size()));
+    for (const auto& name : names) {
+      add(name);
+    }
+  };
+  auto add_node = [&](const NodeTypeInfo& node_type_info) {
+    add(NodeTypeInfo::NodeTypeToString(node_type_info.Node().type));
+    add_types(node_type_info.InputStreamTypes());
+    add_types(node_type_info.OutputStreamTypes());
+    add_types(node_type_info.InputSidePacketTypes());
+    add_types(node_type_info.OutputSidePacketTypes());
+  };
+  for (const NodeTypeInfo& node_type_info : generators_) {
+    add_node(node_type_info);
+    const auto& generator =
+        config_.packet_generator(node_type_info.Node().index);
+    add_names(generator.input_side_packet());
+    add_names(generator.output_side_packet());
+  }
+  for (const NodeTypeInfo& node_type_info : calculators_) {
+    add_node(node_type_info);
+    const auto& node = config_.node(node_type_info.Node().index);
+    add_names(node.input_stream());
+    add_names(node.output_stream());
+    add_names(node.input_side_packet());
+    add_names(node.output_side_packet());
+  }
+  for (const NodeTypeInfo& node_type_info : status_handlers_) {
+    add_node(node_type_info);
+    const auto& handler = config_.status_handler(node_type_info.Node().index);
+    add_names(handler.input_side_packet());
+  }
+  return fingerprint;
+}
+
+absl::Status ValidatedGraphConfig::InitializeNodeInfos() {
+  MP_RETURN_IF_ERROR(InitializeGeneratorInfo());
+  MP_RETURN_IF_ERROR(InitializeCalculatorInfo());
+  MP_RETURN_IF_ERROR(InitializeStatusHandlerInfo());
+
+  sorted_nodes_.reserve(generators_.size() + calculators_.size());
+  // Initialize sorted_nodes_ to list generators before calculators.
+  for (int index = 0; index < generators_.size(); ++index) {
+    NodeTypeInfo* node_type_info = &generators_[index];
+    RET_CHECK(node_type_info->Node().type ==
+              NodeTypeInfo::NodeType::PACKET_GENERATOR);
+    RET_CHECK_EQ(node_type_info->Node().index, index);
+    sorted_nodes_.push_back(node_type_info);
+  }
+  for (int index = 0; index < calculators_.size(); ++index) {
+    NodeTypeInfo* node_type_info = &calculators_[index];
+    RET_CHECK(node_type_info->Node().type ==
+              NodeTypeInfo::NodeType::CALCULATOR);
+    RET_CHECK_EQ(node_type_info->Node().index, index);
+    sorted_nodes_.push_back(node_type_info);
+  }
+  return absl::OkStatus();
+}
+
 absl::Status ValidatedGraphConfig::InitializeCalculatorInfo() {
   std::vector<absl::Status> statuses;
   calculators_.reserve(config_.node_size());
@@ -961,6 +1075,55 @@ absl::Status ValidatedGraphConfig::ValidateExecutors() {
   return absl::OkStatus();
 }
 
+void ValidatedGraphConfig::ComputeFusedNodes() {
+  if (!config_.fuse_linear_chains()) {
+    return;
+  }
+  // A node is only fused with the default input stream handler, which
+  // delivers each timestamp once it is settled.
+  auto uses_default_handler = [](const InputStreamHandlerConfig& handler) {
+    return !handler.has_input_stream_handler() ||
+           (handler.input_stream_handler() == "DefaultInputStreamHandler" &&
+            !handler.has_options());
+  };
+  if (!uses_default_handler(config_.input_stream_handler())) {
+    return;
+  }
+  std::vector<int> num_consumers(output_streams_.size(), 0);
+  for (const EdgeInfo& input_stream : input_streams_) {
+    if (input_stream.upstream >= 0) {
+      ++num_consumers[input_stream.upstream];
+    }
+  }
+  for (NodeTypeInfo& node_type_info : calculators_) {
+    const int node_index = node_type_info.Node().index;
+    const CalculatorGraphConfig::Node& node_config = config_.node(node_index);
+    if (node_type_info.InputStreamTypes().NumEntries() != 1 ||
+        node_config.max_in_flight() > 1 ||
+        !uses_default_handler(node_config.input_stream_handler()) ||
+        !node_type_info.GetInputStreamHandler().empty()) {
+      continue;
+    }
+    const EdgeInfo& input_stream =
+        input_streams_[node_type_info.InputStreamBaseIndex()];
+    if (input_stream.back_edge || input_stream.upstream < 0 ||
+        num_consumers[input_stream.upstream] != 1) {
+      continue;
+    }
+    const NodeTypeInfo::NodeRef& upstream_node =
+        output_streams_[input_stream.upstream].parent_node;
+    if (upstream_node.type != NodeTypeInfo::NodeType::CALCULATOR) {
+      continue;
+    }
+    const NodeTypeInfo& upstream_info = calculators_[upstream_node.index];
+    if (upstream_info.OutputStreamTypes().NumEntries() == 1 &&
+        config_.node(upstream_node.index).executor() ==
+            node_config.executor()) {
+      node_type_info.SetFusedWithUpstream(true);
+    }
+  }
+}
+
 // static
 bool ValidatedGraphConfig::IsReservedExecutorName(const std::string& name) {
   return name == "default" || name == "gpu" || absl::StartsWith(name, "__");
@@ -21,9 +21,11 @@
 #include "absl/container/flat_hash_set.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_contract.h"
+#include "mediapipe/framework/compiled_graph_config.pb.h"
 #include "mediapipe/framework/graph_service_manager.h"
 #include "mediapipe/framework/packet_generator.pb.h"
 #include "mediapipe/framework/packet_type.h"
+#include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/map_util.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_builder.h"
@@ -148,6 +150,11 @@ class NodeTypeInfo {
     return contract_.GetInputStreamHandlerOptions();
   }
 
+  // Returns true if this calculator runs right after its upstream node, see
+  // CalculatorGraphConfig::fuse_linear_chains.
+  bool FusedWithUpstream() const { return fused_with_upstream_; }
+  void SetFusedWithUpstream(bool fused) { fused_with_upstream_ = fused; }
+
  private:
   // This object owns the PacketType objects (which are referenced by
   // ValidatedGraphConfig::EdgeInfo objects).
@@ -171,6 +178,8 @@ class NodeTypeInfo {
 
   // The set of sources which affect this node.
   absl::flat_hash_set<int> ancestor_sources_;
+
+  bool fused_with_upstream_ = false;
 };
 
 // Information for either the input or output side of an edge.  An edge
@@ -192,6 +201,12 @@ struct EdgeInfo {
 // This class is used to validate and canonicalize a CalculatorGraphConfig.
 class ValidatedGraphConfig {
  public:
+  // Version of the CompiledGraphConfig produced by Compile(). Must be
+  // incremented whenever the canonicalization performed by Initialize() or
+  // the contract fingerprint changes, so that stale compiled configs are
+  // rejected.
+  static constexpr int kCompiledGraphVersion = 2;
+
   // Initializes the ValidatedGraphConfig.  This function must be called
   // before any other functions.  Subgraphs are specified through the
   // global graph registry or an optional local graph registry.
@@ -221,6 +236,17 @@ class ValidatedGraphConfig {
       const Subgraph::SubgraphOptions* arguments = nullptr,
       const GraphServiceManager* service_manager = nullptr);
 
+  // Initializes the ValidatedGraphConfig from the output of Compile(),
+  // possibly in another process. Subgraph expansion, topological sorting and
+  // stream type validation are skipped, as they were performed at compile
+  // time. Fails if the version does not match, or if the contracts of the
+  // linked calculators differ from the ones the config was compiled against.
+  absl::Status Initialize(const CompiledGraphConfig& compiled_config);
+
+  // Returns the canonical config together with a fingerprint of the node
+  // contracts, for fast initialization later on. Must be initialized.
+  CompiledGraphConfig Compile() const;
+
   // Returns true if the ValidatedGraphConfig has been initialized.
   bool Initialized() const { return initialized_; }
 
@@ -300,6 +326,9 @@ class ValidatedGraphConfig {
   }
 
  private:
+  // Initialize the information for all nodes, and sorted_nodes_ in config
+  // order.
+  absl::Status InitializeNodeInfos();
   // Initialize the PacketGenerator information.
   absl::Status InitializeGeneratorInfo();
   // Initialize the Calculator information.
@@ -392,7 +421,17 @@ class ValidatedGraphConfig {
   // in an ExecutorConfig.
   absl::Status ValidateExecutors();
 
+  // Marks the calculators that are fused with their upstream node, if
+  // config_.fuse_linear_chains() is set.
+  void ComputeFusedNodes();
+
+  // Returns a fingerprint of the packet types declared by all node
+  // contracts and of the streams and side packets connecting the nodes, in
+  // config order.
+  uint64 ContractFingerprint() const;
+
   bool initialized_ = false;
+  uint64 contract_fingerprint_ = 0;
 
   CalculatorGraphConfig config_;
 
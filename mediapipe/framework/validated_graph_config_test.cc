@@ -1,6 +1,7 @@
 #include "mediapipe/framework/validated_graph_config.h"
 
 #include <string_view>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/strings/ascii.h"
@@ -9,6 +10,7 @@
 #include "mediapipe/framework/api2/port.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/compiled_graph_config.pb.h"
 #include "mediapipe/framework/deps/message_matchers.h"
 #include "mediapipe/framework/graph_service.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -162,4 +164,126 @@ TEST(ValidatedGraphConfigTest, InitializeSubgraphWithServiceCalculatorB) {
   }
 }
 
+// Config whose nodes must be sorted, and which uses a subgraph.
+CalculatorGraphConfig UnsortedConfigWithSubgraph() {
+  CalculatorGraphConfig graph;
+  graph.add_input_stream("a");
+  auto* second = graph.add_node();
+  second->set_calculator("CalculatorB");
+  second->add_input_stream("NN:b");
+  second->add_output_stream("NN:c");
+  auto* first = graph.add_node();
+  first->set_calculator("CalculatorA");
+  first->add_input_stream("NN:a");
+  first->add_output_stream("NN:b");
+  graph.add_node()->set_calculator("AlwaysCalculatorASubgraph");
+  return graph;
+}
+
+TEST(ValidatedGraphConfigTest, InitializeCompiled) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedConfigWithSubgraph()));
+  const CompiledGraphConfig compiled = config.Compile();
+  EXPECT_EQ(ValidatedGraphConfig::kCompiledGraphVersion, compiled.version());
+
+  // Round trip through the serialized form, as when loading a file.
+  CompiledGraphConfig loaded;
+  ASSERT_TRUE(loaded.ParseFromString(compiled.SerializeAsString()));
+  ValidatedGraphConfig compiled_config;
+  MP_ASSERT_OK(compiled_config.Initialize(loaded));
+  ASSERT_TRUE(compiled_config.Initialized());
+  EXPECT_THAT(compiled_config.Config(), EqualsProto(config.Config()));
+  EXPECT_EQ(config.InputStreamInfos().size(),
+            compiled_config.InputStreamInfos().size());
+  EXPECT_EQ(config.OutputStreamInfos().size(),
+            compiled_config.OutputStreamInfos().size());
+  EXPECT_EQ(config.OutputStreamIndex("c"),
+            compiled_config.OutputStreamIndex("c"));
+  EXPECT_THAT(compiled_config.Compile(), EqualsProto(compiled));
+}
+
+TEST(ValidatedGraphConfigTest, InitializeCompiledRejectsStaleConfig) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedConfigWithSubgraph()));
+
+  CompiledGraphConfig other_version = config.Compile();
+  other_version.set_version(ValidatedGraphConfig::kCompiledGraphVersion + 1);
+  EXPECT_EQ(ValidatedGraphConfig().Initialize(other_version).code(),
+            absl::StatusCode::kFailedPrecondition);
+
+  CompiledGraphConfig other_contracts = config.Compile();
+  other_contracts.set_contract_fingerprint(
+      other_contracts.contract_fingerprint() + 1);
+  EXPECT_EQ(ValidatedGraphConfig().Initialize(other_contracts).code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+// Types are not validated again on load, so a compiled config whose edges
+// were edited must be rejected.
+TEST(ValidatedGraphConfigTest, InitializeCompiledRejectsEditedEdges) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedConfigWithSubgraph()));
+  CompiledGraphConfig edited = config.Compile();
+  // Feeds CalculatorB from the graph input stream rather than CalculatorA.
+  ASSERT_EQ(edited.config().node(1).input_stream(0), "NN:b");
+  edited.mutable_config()->mutable_node(1)->set_input_stream(0, "NN:a");
+  absl::Status status = ValidatedGraphConfig().Initialize(edited);
+  EXPECT_EQ(status.code(), absl::StatusCode::kFailedPrecondition);
+  EXPECT_THAT(status.message(), testing::HasSubstr("graph edges differ"));
+}
+
+TEST(ValidatedGraphConfigTest, InitializeCompiledRejectsUnsortedConfig) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(UnsortedConfigWithSubgraph()));
+  CompiledGraphConfig compiled = config.Compile();
+  // Moves CalculatorB, which reads the output of CalculatorA, first.
+  compiled.mutable_config()->mutable_node()->SwapElements(0, 1);
+  absl::Status status = ValidatedGraphConfig().Initialize(compiled);
+  EXPECT_EQ(status.code(), absl::StatusCode::kUnknown);
+  EXPECT_THAT(status.message(),
+              testing::HasSubstr("Input Stream \"b\" for node with sorted "
+                                 "index 0 does not have a corresponding "
+                                 "output stream"));
+}
+
+// Config with the chain "a" -> A -> B -> C, where C's output feeds D and E.
+CalculatorGraphConfig ChainConfig() {
+  CalculatorGraphConfig graph;
+  graph.add_input_stream("a");
+  auto add_node = [&graph](const std::string& input,
+                           const std::string& output) {
+    auto* node = graph.add_node();
+    node->set_calculator("CalculatorA");
+    node->add_input_stream(absl::StrCat("NN:", input));
+    node->add_output_stream(absl::StrCat("NN:", output));
+  };
+  add_node("a", "b");
+  add_node("b", "c");
+  add_node("c", "d");
+  add_node("d", "e");
+  add_node("d", "f");
+  return graph;
+}
+
+TEST(ValidatedGraphConfigTest, FusesLinearChains) {
+  CalculatorGraphConfig graph = ChainConfig();
+  graph.set_fuse_linear_chains(true);
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(graph));
+  std::vector<bool> fused;
+  for (const NodeTypeInfo& node_type_info : config.CalculatorInfos()) {
+    fused.push_back(node_type_info.FusedWithUpstream());
+  }
+  // The first node reads a graph input stream, and the last two share theirs.
+  EXPECT_THAT(fused, testing::ElementsAre(false, true, true, false, false));
+}
+
+TEST(ValidatedGraphConfigTest, FusesNothingByDefault) {
+  ValidatedGraphConfig config;
+  MP_ASSERT_OK(config.Initialize(ChainConfig()));
+  for (const NodeTypeInfo& node_type_info : config.CalculatorInfos()) {
+    EXPECT_FALSE(node_type_info.FusedWithUpstream());
+  }
+}
+
 }  // namespace mediapipe
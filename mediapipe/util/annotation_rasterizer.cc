@@ -0,0 +1,303 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/annotation_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Tolerance for pixel centers lying exactly on the edge of a stroke.
+constexpr float kEdgeEpsilon = 1e-4f;
+
+struct PreparedStroke;
+
+using SpanFunction = void (*)(const PreparedStroke& stroke, int y, int begin,
+                              int end, uint8* row);
+
+// A stroke in the form used by the row loop.
+struct PreparedStroke {
+  // Start point and start-to-end vector of the segment.
+  float x0;
+  float y0;
+  float dx;
+  float dy;
+  // 1 / |(dx, dy)|^2, or 0 for points.
+  float inv_length2;
+  float radius;
+  // Distance from the segment up to which pixel centers are touched.
+  float reach;
+  // Distance from the segment up to which pixels are fully covered with
+  // antialiasing, negative if there are none.
+  float inner_reach;
+  // Unit normal of the segment, and 1 / dy or 0 if dy is 0.
+  float normal_x;
+  float normal_y;
+  float inv_dy;
+  float color0[3];
+  float color_delta[3];
+  // color0 rounded, with an opaque alpha, for solid strokes.
+  uint8 solid_color[4];
+  // Pixel bounds, inclusive and clipped to the image.
+  int left;
+  int top;
+  int right;
+  int bottom;
+  SpanFunction draw_span;
+  // If set, draws the fully covered part of spans.
+  SpanFunction fill_span;
+};
+
+// Widens [*left, *right] to cover the points of row y within reach of
+// (cx, cy).
+void AddDiscSpan(float cx, float cy, float reach, float y, float* left,
+                 float* right) {
+  const float h = reach * reach - (y - cy) * (y - cy);
+  if (h < 0.0f) return;
+  const float half_width = std::sqrt(h);
+  *left = std::min(*left, cx - half_width);
+  *right = std::max(*right, cx + half_width);
+}
+
+// Widens [*left, *right] to cover the point of row y on the side of the
+// stroke offset by (nx, ny) from its segment, if any.
+void AddSideSpan(const PreparedStroke& s, float nx, float ny, float y,
+                 float* left, float* right) {
+  const float t = (y - s.y0 - ny) * s.inv_dy;
+  if (t < 0.0f || t > 1.0f) return;
+  const float x = s.x0 + nx + t * s.dx;
+  *left = std::min(*left, x);
+  *right = std::max(*right, x);
+}
+
+// Computes the span of row y within distance reach of the segment of the
+// stroke. The region is convex, so the span is the hull of the spans of its
+// end discs and of the rectangle around the segment. The ends of the
+// rectangle lie within the discs, so only its sides need to be intersected
+// with the row.
+bool StrokeSpan(const PreparedStroke& s, float reach, int y, float* left,
+                float* right) {
+  const float row = static_cast<float>(y);
+  *left = std::numeric_limits<float>::max();
+  *right = std::numeric_limits<float>::lowest();
+  AddDiscSpan(s.x0, s.y0, reach, row, left, right);
+  AddDiscSpan(s.x0 + s.dx, s.y0 + s.dy, reach, row, left, right);
+  if (s.dy != 0.0f) {
+    AddSideSpan(s, reach * s.normal_x, reach * s.normal_y, row, left, right);
+    AddSideSpan(s, -reach * s.normal_x, -reach * s.normal_y, row, left,
+                right);
+  } else if (std::abs(row - s.y0) <= reach) {
+    *left = std::min(*left, std::min(s.x0, s.x0 + s.dx));
+    *right = std::max(*right, std::max(s.x0, s.x0 + s.dx));
+  }
+  return *left <= *right;
+}
+
+// Fills pixels [begin, end) of a row with the color of a solid stroke.
+template <int kChannels>
+void FillSpan(const PreparedStroke& s, int y, int begin, int end, uint8* row) {
+  uint8* pixel = row + begin * kChannels;
+  for (int x = begin; x < end; ++x, pixel += kChannels) {
+    for (int c = 0; c < kChannels; ++c) pixel[c] = s.solid_color[c];
+  }
+}
+
+// Draws pixels [begin, end) of row y of the stroke. Without antialiasing,
+// all pixels of the span are inside the stroke; with it, they are weighted by
+// their coverage of the stroke, estimated from their distance to its edge.
+template <int kChannels, bool kAntialiased, bool kGradient>
+void DrawSpan(const PreparedStroke& s, int y, int begin, int end,
+              uint8* row) {
+  const float py = y - s.y0;
+  for (int x = begin; x < end; ++x) {
+    uint8* pixel = row + x * kChannels;
+    float t = 0.0f;
+    float coverage = 1.0f;
+    if (kGradient || kAntialiased) {
+      const float px = x - s.x0;
+      t = std::min(std::max((px * s.dx + py * s.dy) * s.inv_length2, 0.0f),
+                   1.0f);
+    }
+    if (kAntialiased) {
+      const float ex = x - s.x0 - t * s.dx;
+      const float ey = py - t * s.dy;
+      const float distance = std::sqrt(ex * ex + ey * ey);
+      coverage = std::min(std::max(s.radius + 0.5f - distance, 0.0f), 1.0f);
+    }
+    float color[3];
+    for (int c = 0; c < 3; ++c) {
+      color[c] = kGradient ? s.color0[c] + t * s.color_delta[c] : s.color0[c];
+    }
+    if (!kAntialiased) {
+      for (int c = 0; c < 3; ++c) {
+        pixel[c] = static_cast<uint8>(color[c] + 0.5f);
+      }
+      if (kChannels == 4) pixel[3] = 255;
+    } else if (kChannels == 3) {
+      for (int c = 0; c < 3; ++c) {
+        pixel[c] = static_cast<uint8>(
+            pixel[c] + (color[c] - pixel[c]) * coverage + 0.5f);
+      }
+    } else {
+      // Straight alpha "over" compositing of the stroke, with alpha equal to
+      // its coverage, onto the pixel.
+      const float below = pixel[3] * (1.0f / 255.0f) * (1.0f - coverage);
+      const float alpha = coverage + below;
+      const float inv_alpha = 1.0f / std::max(alpha, 1e-6f);
+      for (int c = 0; c < 3; ++c) {
+        pixel[c] = static_cast<uint8>(
+            (color[c] * coverage + pixel[c] * below) * inv_alpha + 0.5f);
+      }
+      pixel[3] = static_cast<uint8>(alpha * 255.0f + 0.5f);
+    }
+  }
+}
+
+template <int kChannels>
+SpanFunction SelectSpanFunction(bool antialiased, bool gradient) {
+  if (antialiased) {
+    return gradient ? &DrawSpan<kChannels, true, true>
+                    : &DrawSpan<kChannels, true, false>;
+  }
+  return gradient ? &DrawSpan<kChannels, false, true> : &FillSpan<kChannels>;
+}
+
+// Returns ceil(value) (or floor(value)) clamped to [low, high].
+int CeilClamped(float value, int low, int high) {
+  return static_cast<int>(std::min(
+      std::max(std::ceil(value), static_cast<float>(low)),
+      static_cast<float>(high)));
+}
+int FloorClamped(float value, int low, int high) {
+  return static_cast<int>(std::min(
+      std::max(std::floor(value), static_cast<float>(low)),
+      static_cast<float>(high)));
+}
+
+}  // namespace
+
+void RasterizeStrokes(const std::vector<AnnotationStroke>& strokes,
+                      bool antialiased, uint8* pixels, int width, int height,
+                      int width_step, int channels, DirtyRect* dirty) {
+  CHECK(channels == 3 || channels == 4) << "Unsupported channels " << channels;
+  if (width <= 0 || height <= 0) return;
+
+  // Strokes in drawing order, leaving out those outside the image.
+  std::vector<PreparedStroke> prepared;
+  prepared.reserve(strokes.size());
+  for (const AnnotationStroke& stroke : strokes) {
+    PreparedStroke s;
+    s.x0 = stroke.x0;
+    s.y0 = stroke.y0;
+    s.dx = stroke.x1 - stroke.x0;
+    s.dy = stroke.y1 - stroke.y0;
+    const float length2 = s.dx * s.dx + s.dy * s.dy;
+    s.inv_length2 = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+    s.radius = std::max(stroke.radius, 0.0f);
+    s.reach = (antialiased ? s.radius + 0.5f : s.radius) + kEdgeEpsilon;
+    s.inner_reach = s.radius - 0.5f - kEdgeEpsilon;
+    const float inv_length = std::sqrt(s.inv_length2);
+    s.normal_x = -s.dy * inv_length;
+    s.normal_y = s.dx * inv_length;
+    s.inv_dy = s.dy != 0.0f ? 1.0f / s.dy : 0.0f;
+    bool gradient = false;
+    for (int c = 0; c < 3; ++c) {
+      s.color0[c] = stroke.color0[c];
+      s.color_delta[c] =
+          static_cast<float>(stroke.color1[c]) - stroke.color0[c];
+      s.solid_color[c] = stroke.color0[c];
+      gradient = gradient || stroke.color0[c] != stroke.color1[c];
+    }
+    s.solid_color[3] = 255;
+    // Clamping one pixel beyond the image keeps strokes entirely outside of
+    // it empty.
+    s.left = CeilClamped(std::min(stroke.x0, stroke.x1) - s.reach, 0, width);
+    s.right = FloorClamped(std::max(stroke.x0, stroke.x1) + s.reach, -1,
+                           width - 1);
+    s.top = CeilClamped(std::min(stroke.y0, stroke.y1) - s.reach, 0, height);
+    s.bottom = FloorClamped(std::max(stroke.y0, stroke.y1) + s.reach, -1,
+                            height - 1);
+    if (s.left > s.right || s.top > s.bottom) continue;
+    s.draw_span = channels == 3
+                      ? SelectSpanFunction<3>(antialiased, gradient)
+                      : SelectSpanFunction<4>(antialiased, gradient);
+    // Solid antialiased strokes only need per pixel coverage near their
+    // edges.
+    s.fill_span = nullptr;
+    if (antialiased && !gradient && s.inner_reach > 0.0f) {
+      s.fill_span = channels == 3 ? &FillSpan<3> : &FillSpan<4>;
+    }
+    prepared.push_back(s);
+    if (dirty) {
+      dirty->Union({s.left, s.top, s.right + 1, s.bottom + 1});
+    }
+  }
+  if (prepared.empty()) return;
+
+  // Sweep rows from top to bottom, keeping the strokes that cover the current
+  // row in drawing order.
+  std::vector<const PreparedStroke*> by_top(prepared.size());
+  for (int i = 0; i < prepared.size(); ++i) by_top[i] = &prepared[i];
+  std::stable_sort(by_top.begin(), by_top.end(),
+                   [](const PreparedStroke* a, const PreparedStroke* b) {
+                     return a->top < b->top;
+                   });
+  std::vector<const PreparedStroke*> active;
+  int next = 0;
+  int bottom = 0;
+  for (const PreparedStroke& s : prepared) bottom = std::max(bottom, s.bottom);
+  for (int y = by_top.front()->top; y <= bottom; ++y) {
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [y](const PreparedStroke* s) {
+                                  return s->bottom < y;
+                                }),
+                 active.end());
+    bool added = false;
+    while (next < by_top.size() && by_top[next]->top == y) {
+      active.push_back(by_top[next++]);
+      added = true;
+    }
+    // Pointers into prepared are ordered like the strokes.
+    if (added) std::sort(active.begin(), active.end());
+
+    uint8* row = pixels + y * width_step;
+    for (const PreparedStroke* s : active) {
+      float left;
+      float right;
+      if (!StrokeSpan(*s, s->reach, y, &left, &right)) continue;
+      const int begin = CeilClamped(left, s->left, s->right + 1);
+      const int end = FloorClamped(right, s->left - 1, s->right) + 1;
+      if (begin >= end) continue;
+      if (s->fill_span && StrokeSpan(*s, s->inner_reach, y, &left, &right)) {
+        const int inner_begin = CeilClamped(left, begin, end);
+        const int inner_end =
+            std::max(FloorClamped(right, begin - 1, end - 1) + 1, inner_begin);
+        s->draw_span(*s, y, begin, inner_begin, row);
+        s->fill_span(*s, y, inner_begin, inner_end, row);
+        s->draw_span(*s, y, inner_end, end, row);
+      } else {
+        s->draw_span(*s, y, begin, end, row);
+      }
+    }
+  }
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,83 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Span rasterizer for the point and line annotations drawn by
+// AnnotationRenderer.
+//
+// Points, lines and gradient lines are all strokes: a segment widened by a
+// radius, with round caps. A batch of strokes is rasterized row by row, so
+// that each image row is visited once while it is in cache, and each stroke
+// covers a row with a single span computed analytically instead of going
+// through per-pixel or per-primitive drawing calls.
+#ifndef MEDIAPIPE_UTIL_ANNOTATION_RASTERIZER_H_
+#define MEDIAPIPE_UTIL_ANNOTATION_RASTERIZER_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// A segment from (x0, y0) to (x1, y1), in pixel coordinates, drawn with the
+// given radius around it. A point is a stroke with both ends at its center.
+// The color is interpolated from color0 at (x0, y0) to color1 at (x1, y1);
+// both are the same for solid strokes.
+struct AnnotationStroke {
+  float x0 = 0.0f;
+  float y0 = 0.0f;
+  float x1 = 0.0f;
+  float y1 = 0.0f;
+  float radius = 0.0f;
+  uint8 color0[3] = {0, 0, 0};
+  uint8 color1[3] = {0, 0, 0};
+};
+
+// Pixel rectangle [left, right) x [top, bottom).
+struct DirtyRect {
+  int left = 0;
+  int top = 0;
+  int right = 0;
+  int bottom = 0;
+
+  bool IsEmpty() const { return right <= left || bottom <= top; }
+
+  // Grows this rectangle to also cover other.
+  void Union(const DirtyRect& other) {
+    if (other.IsEmpty()) return;
+    if (IsEmpty()) {
+      *this = other;
+      return;
+    }
+    left = std::min(left, other.left);
+    top = std::min(top, other.top);
+    right = std::max(right, other.right);
+    bottom = std::max(bottom, other.bottom);
+  }
+};
+
+// Draws strokes, in order, on an 8-bit RGB (channels = 3) or RGBA
+// (channels = 4) image of width x height pixels with width_step bytes per
+// row. Pixels whose center lies within a stroke are set to its color. With
+// antialiased, edge pixels are blended with the image by their coverage; on
+// RGBA images the stroke is composited over the image, so that strokes drawn
+// on a transparent layer get straight alpha. Strokes are clipped to the
+// image. If dirty is not null, it is grown to cover all modified pixels.
+void RasterizeStrokes(const std::vector<AnnotationStroke>& strokes,
+                      bool antialiased, uint8* pixels, int width, int height,
+                      int width_step, int channels, DirtyRect* dirty);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_ANNOTATION_RASTERIZER_H_
@@ -0,0 +1,207 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/annotation_rasterizer.h"
+
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace {
+
+// A tightly packed 8-bit image.
+struct TestImage {
+  TestImage(int width, int height, int channels)
+      : width(width),
+        height(height),
+        channels(channels),
+        pixels(width * height * channels, 0) {}
+
+  const uint8* At(int x, int y) const {
+    return &pixels[(y * width + x) * channels];
+  }
+
+  void Rasterize(const std::vector<AnnotationStroke>& strokes,
+                 bool antialiased, DirtyRect* dirty = nullptr) {
+    RasterizeStrokes(strokes, antialiased, pixels.data(), width, height,
+                     width * channels, channels, dirty);
+  }
+
+  int width;
+  int height;
+  int channels;
+  std::vector<uint8> pixels;
+};
+
+AnnotationStroke MakeStroke(float x0, float y0, float x1, float y1,
+                            float radius, uint8 r, uint8 g, uint8 b) {
+  AnnotationStroke stroke;
+  stroke.x0 = x0;
+  stroke.y0 = y0;
+  stroke.x1 = x1;
+  stroke.y1 = y1;
+  stroke.radius = radius;
+  stroke.color0[0] = stroke.color1[0] = r;
+  stroke.color0[1] = stroke.color1[1] = g;
+  stroke.color0[2] = stroke.color1[2] = b;
+  return stroke;
+}
+
+// Distance from (x, y) to the segment of the stroke.
+float DistanceToStroke(const AnnotationStroke& s, float x, float y) {
+  const float dx = s.x1 - s.x0;
+  const float dy = s.y1 - s.y0;
+  const float length2 = dx * dx + dy * dy;
+  float t = length2 > 0 ? ((x - s.x0) * dx + (y - s.y0) * dy) / length2 : 0;
+  t = std::min(std::max(t, 0.0f), 1.0f);
+  return std::hypot(x - s.x0 - t * dx, y - s.y0 - t * dy);
+}
+
+TEST(AnnotationRasterizerTest, FillsPixelsInsideStrokes) {
+  const std::vector<AnnotationStroke> strokes = {
+      MakeStroke(10, 10, 10, 10, 4, 255, 0, 0),
+      MakeStroke(3, 25, 36, 17, 2.5f, 0, 255, 0),
+  };
+  TestImage image(40, 32, 3);
+  image.Rasterize(strokes, /*antialiased=*/false);
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      const uint8* pixel = image.At(x, y);
+      const float d0 = DistanceToStroke(strokes[0], x, y);
+      const float d1 = DistanceToStroke(strokes[1], x, y);
+      // Pixels too close to the edge to call are skipped.
+      if (std::abs(d0 - 4) < 1e-3f || std::abs(d1 - 2.5f) < 1e-3f) continue;
+      if (d1 < 2.5f) {
+        EXPECT_EQ(pixel[1], 255) << x << "," << y;
+      } else if (d0 < 4) {
+        EXPECT_EQ(pixel[0], 255) << x << "," << y;
+      } else {
+        EXPECT_EQ(pixel[0] + pixel[1] + pixel[2], 0) << x << "," << y;
+      }
+    }
+  }
+}
+
+TEST(AnnotationRasterizerTest, DrawsStrokesInOrder) {
+  TestImage image(16, 16, 3);
+  image.Rasterize({MakeStroke(8, 8, 8, 8, 3, 255, 0, 0),
+                   MakeStroke(2, 8, 14, 8, 1, 0, 0, 255)},
+                  /*antialiased=*/false);
+  EXPECT_EQ(image.At(8, 8)[0], 0);
+  EXPECT_EQ(image.At(8, 8)[2], 255);
+  EXPECT_EQ(image.At(8, 10)[0], 255);
+}
+
+TEST(AnnotationRasterizerTest, InterpolatesGradientColors) {
+  AnnotationStroke stroke = MakeStroke(0, 2, 20, 2, 1, 0, 0, 0);
+  stroke.color1[0] = 200;
+  TestImage image(21, 5, 3);
+  image.Rasterize({stroke}, /*antialiased=*/false);
+  EXPECT_EQ(image.At(0, 2)[0], 0);
+  EXPECT_EQ(image.At(10, 2)[0], 100);
+  EXPECT_EQ(image.At(20, 2)[0], 200);
+}
+
+TEST(AnnotationRasterizerTest, ClipsStrokesAndTracksDirtyRect) {
+  TestImage image(20, 10, 4);
+  DirtyRect dirty;
+  image.Rasterize({MakeStroke(-50, -50, -40, -40, 2, 255, 255, 255)},
+                  /*antialiased=*/true, &dirty);
+  EXPECT_TRUE(dirty.IsEmpty());
+
+  image.Rasterize({MakeStroke(15, 5, 40, 5, 1, 255, 255, 255)},
+                  /*antialiased=*/false, &dirty);
+  EXPECT_EQ(dirty.left, 14);
+  EXPECT_EQ(dirty.top, 4);
+  EXPECT_EQ(dirty.right, 20);
+  EXPECT_EQ(dirty.bottom, 7);
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      const bool inside = x >= dirty.left && x < dirty.right &&
+                          y >= dirty.top && y < dirty.bottom;
+      if (!inside) EXPECT_EQ(image.At(x, y)[3], 0) << x << "," << y;
+    }
+  }
+  EXPECT_EQ(image.At(19, 5)[3], 255);
+}
+
+TEST(AnnotationRasterizerTest, AntialiasesEdges) {
+  TestImage image(32, 32, 3);
+  image.Rasterize({MakeStroke(16, 16, 16, 16, 6, 255, 255, 255)},
+                  /*antialiased=*/true);
+  EXPECT_EQ(image.At(16, 16)[0], 255);
+  EXPECT_EQ(image.At(16, 21)[0], 255);
+  // A pixel whose center is half a pixel outside of the disc.
+  EXPECT_EQ(image.At(16, 22)[0], 128);
+  EXPECT_EQ(image.At(16, 23)[0], 0);
+}
+
+TEST(AnnotationRasterizerTest, CompositesOverTransparentLayer) {
+  TestImage image(32, 32, 4);
+  image.Rasterize({MakeStroke(16, 16, 16, 16, 6, 40, 80, 120)},
+                  /*antialiased=*/true);
+  const uint8* edge = image.At(16, 22);
+  EXPECT_EQ(edge[0], 40);
+  EXPECT_EQ(edge[1], 80);
+  EXPECT_EQ(edge[2], 120);
+  EXPECT_EQ(edge[3], 128);
+  EXPECT_EQ(image.At(16, 16)[3], 255);
+  EXPECT_EQ(image.At(16, 23)[3], 0);
+}
+
+// Strokes of a pose skeleton: 33 landmarks and 35 connections.
+std::vector<AnnotationStroke> MakeSkeleton(int width, int height) {
+  std::vector<AnnotationStroke> strokes;
+  const float radius = height / 270.0f;
+  std::vector<float> xs;
+  std::vector<float> ys;
+  for (int i = 0; i < 33; ++i) {
+    xs.push_back(width * (0.5f + 0.3f * std::sin(1.7f * i)));
+    ys.push_back(height * (0.5f + 0.4f * std::cos(0.9f * i)));
+  }
+  for (int i = 0; i < 35; ++i) {
+    const int a = i % 33;
+    const int b = (i * 7 + 3) % 33;
+    strokes.push_back(
+        MakeStroke(xs[a], ys[a], xs[b], ys[b], radius, 0, 255, 0));
+  }
+  for (int i = 0; i < 33; ++i) {
+    strokes.push_back(
+        MakeStroke(xs[i], ys[i], xs[i], ys[i], 2 * radius, 255, 0, 0));
+  }
+  return strokes;
+}
+
+// Args: width, height, antialiased.
+void BM_RasterizeSkeleton(benchmark::State& state) {
+  TestImage image(state.range(0), state.range(1), 3);
+  const std::vector<AnnotationStroke> strokes =
+      MakeSkeleton(image.width, image.height);
+  for (auto _ : state) {
+    image.Rasterize(strokes, state.range(2));
+  }
+  state.SetItemsProcessed(state.iterations() * strokes.size());
+}
+BENCHMARK(BM_RasterizeSkeleton)
+    ->Args({1280, 720, 0})
+    ->Args({1280, 720, 1})
+    ->Args({1920, 1080, 0})
+    ->Args({1920, 1080, 1});
+
+}  // namespace
+}  // namespace mediapipe
@@ -62,8 +62,16 @@ bool NormalizedtoPixelCoordinates(double normalized_x, double normalized_y,
   return true;
 }
 
+// The alpha component is used by RGBA images only, where annotations are
+// opaque.
 cv::Scalar MediapipeColorToOpenCVColor(const Color& color) {
-  return cv::Scalar(color.r(), color.g(), color.b());
+  return cv::Scalar(color.r(), color.g(), color.b(), 255);
+}
+
+void SetStrokeColor(const Color& color, uint8 stroke_color[3]) {
+  stroke_color[0] = color.r();
+  stroke_color[1] = color.g();
+  stroke_color[2] = color.b();
 }
 
 cv::RotatedRect RectangleToOpenCVRotatedRect(int left, int top, int right,
@@ -73,22 +81,19 @@ cv::RotatedRect RectangleToOpenCVRotatedRect(int left, int top, int right,
       cv::Size2f(right - left, bottom - top), rotation / M_PI * 180.f);
 }
 
-void cv_line2(cv::Mat& img, const cv::Point& start, const cv::Point& end,
-              const cv::Scalar& color1, const cv::Scalar& color2,
-              int thickness) {
-  cv::LineIterator iter(img, start, end, /*cv::LINE_4=*/4);
-  for (int i = 0; i < iter.count; i++, iter++) {
-    const double alpha = static_cast<double>(i) / iter.count;
-    const cv::Scalar new_color(color1 * (1.0 - alpha) + color2 * alpha);
-    const cv::Rect rect(iter.pos(), cv::Size(thickness, thickness));
-    cv::rectangle(img, rect, new_color, /*cv::FILLED=*/-1, /*cv::LINE_4=*/4);
-  }
+bool IsStroke(const RenderAnnotation& annotation) {
+  return annotation.data_case() == RenderAnnotation::kPoint ||
+         annotation.data_case() == RenderAnnotation::kLine ||
+         annotation.data_case() == RenderAnnotation::kGradientLine;
 }
 
 }  // namespace
 
 void AnnotationRenderer::RenderDataOnImage(const RenderData& render_data) {
   for (const auto& annotation : render_data.render_annotations()) {
+    // Points and lines are queued until another type of annotation needs to
+    // be drawn over them.
+    if (!IsStroke(annotation)) FlushStrokes();
     if (annotation.data_case() == RenderAnnotation::kRectangle) {
       DrawRectangle(annotation);
     } else if (annotation.data_case() == RenderAnnotation::kRoundedRectangle) {
@@ -116,6 +121,7 @@ void AnnotationRenderer::RenderDataOnImage(const RenderData& render_data) {
       LOG(FATAL) << "Unknown annotation type: " << annotation.data_case();
     }
   }
+  FlushStrokes();
 }
 
 void AnnotationRenderer::AdoptImage(cv::Mat* input_image) {
@@ -124,6 +130,8 @@ void AnnotationRenderer::AdoptImage(cv::Mat* input_image) {
 
   // No pixel data copy here, only headers are copied.
   mat_image_ = *input_image;
+  pending_strokes_.clear();
+  dirty_rect_ = DirtyRect();
 }
 
 int AnnotationRenderer::GetImageWidth() const { return mat_image_.cols; }
@@ -133,10 +141,50 @@ void AnnotationRenderer::SetFlipTextVertically(bool flip) {
   flip_text_vertically_ = flip;
 }
 
+void AnnotationRenderer::SetAntialiasing(bool antialiasing) {
+  antialiasing_ = antialiasing;
+}
+
 void AnnotationRenderer::SetScaleFactor(float scale_factor) {
   if (scale_factor > 0.0f) scale_factor_ = std::min(scale_factor, 1.0f);
 }
 
+void AnnotationRenderer::FlushStrokes() {
+  if (pending_strokes_.empty()) return;
+  if (mat_image_.depth() == CV_8U &&
+      (mat_image_.channels() == 3 || mat_image_.channels() == 4)) {
+    RasterizeStrokes(pending_strokes_, antialiasing_, mat_image_.data,
+                     mat_image_.cols, mat_image_.rows, mat_image_.step[0],
+                     mat_image_.channels(), &dirty_rect_);
+  } else {
+    // Other image types are drawn with OpenCV, using the start color of
+    // gradient lines. A zero length line with a thickness of twice the radius
+    // is a filled circle.
+    for (const AnnotationStroke& stroke : pending_strokes_) {
+      const cv::Point start(static_cast<int>(round(stroke.x0)),
+                            static_cast<int>(round(stroke.y0)));
+      const cv::Point end(static_cast<int>(round(stroke.x1)),
+                          static_cast<int>(round(stroke.y1)));
+      const cv::Scalar color(stroke.color0[0], stroke.color0[1],
+                             stroke.color0[2], 255);
+      const int thickness = ClampThickness(round(2 * stroke.radius));
+      cv::line(mat_image_, start, end, color, thickness);
+      MarkDirty(start.x, start.y, end.x, end.y, thickness);
+    }
+  }
+  pending_strokes_.clear();
+}
+
+void AnnotationRenderer::MarkDirty(int x0, int y0, int x1, int y1,
+                                   int margin) {
+  DirtyRect rect;
+  rect.left = std::max(std::min(x0, x1) - margin, 0);
+  rect.top = std::max(std::min(y0, y1) - margin, 0);
+  rect.right = std::min(std::max(x0, x1) + margin + 1, mat_image_.cols);
+  rect.bottom = std::min(std::max(y0, y1) + margin + 1, mat_image_.rows);
+  dirty_rect_.Union(rect);
+}
+
 void AnnotationRenderer::DrawRectangle(const RenderAnnotation& annotation) {
   int left = -1;
   int top = -1;
@@ -170,9 +218,12 @@ void AnnotationRenderer::DrawRectangle(const RenderAnnotation& annotation) {
       cv::line(mat_image_, vertices[i], vertices[(i + 1) % kNumVertices], color,
                thickness);
     }
+    const cv::Rect bounds = rect.boundingRect();
+    MarkDirty(bounds.x, bounds.y, bounds.br().x, bounds.br().y, thickness);
   } else {
     cv::Rect rect(left, top, right - left, bottom - top);
     cv::rectangle(mat_image_, rect, color, thickness);
+    MarkDirty(left, top, right, bottom, thickness);
   }
 }
 
@@ -210,9 +261,12 @@ void AnnotationRenderer::DrawFilledRectangle(
       vertices[i] = vertices2f[i];
     }
     cv::fillConvexPoly(mat_image_, vertices, kNumVertices, color);
+    const cv::Rect bounds = rect.boundingRect();
+    MarkDirty(bounds.x, bounds.y, bounds.br().x, bounds.br().y, 0);
   } else {
     cv::Rect rect(left, top, right - left, bottom - top);
     cv::rectangle(mat_image_, rect, color, -1);
+    MarkDirty(left, top, right, bottom, 0);
   }
 }
 
@@ -246,6 +300,7 @@ void AnnotationRenderer::DrawRoundedRectangle(
   DrawRoundedRectangle(mat_image_, cv::Point(left, top),
                        cv::Point(right, bottom), color, thickness, line_type,
                        corner_radius);
+  MarkDirty(left, top, right, bottom, thickness);
 }
 
 void AnnotationRenderer::DrawFilledRoundedRectangle(
@@ -277,6 +332,7 @@ void AnnotationRenderer::DrawFilledRoundedRectangle(
   DrawRoundedRectangle(mat_image_, cv::Point(left, top),
                        cv::Point(right, bottom), color, -1, line_type,
                        corner_radius);
+  MarkDirty(left, top, right, bottom, 1);
 }
 
 void AnnotationRenderer::DrawRoundedRectangle(cv::Mat src, cv::Point top_left,
@@ -349,6 +405,11 @@ void AnnotationRenderer::DrawOval(const RenderAnnotation& annotation) {
   const int thickness =
       ClampThickness(round(annotation.thickness() * scale_factor_));
   cv::ellipse(mat_image_, center, size, rotation, 0, 360, color, thickness);
+  const cv::Rect bounds =
+      RectangleToOpenCVRotatedRect(left, top, right, bottom,
+                                   enclosing_rectangle.rotation())
+          .boundingRect();
+  MarkDirty(bounds.x, bounds.y, bounds.br().x, bounds.br().y, thickness);
 }
 
 void AnnotationRenderer::DrawFilledOval(const RenderAnnotation& annotation) {
@@ -377,6 +438,11 @@ void AnnotationRenderer::DrawFilledOval(const RenderAnnotation& annotation) {
   const double rotation = enclosing_rectangle.rotation() / M_PI * 180.f;
   const cv::Scalar color = MediapipeColorToOpenCVColor(annotation.color());
   cv::ellipse(mat_image_, center, size, rotation, 0, 360, color, -1);
+  const cv::Rect bounds =
+      RectangleToOpenCVRotatedRect(left, top, right, bottom,
+                                   enclosing_rectangle.rotation())
+          .boundingRect();
+  MarkDirty(bounds.x, bounds.y, bounds.br().x, bounds.br().y, 1);
 }
 
 void AnnotationRenderer::DrawArrow(const RenderAnnotation& annotation) {
@@ -427,6 +493,9 @@ void AnnotationRenderer::DrawArrow(const RenderAnnotation& annotation) {
                                  static_cast<int>(round(arrowtip_right[1])));
   cv::line(mat_image_, arrowtip_left_start, arrow_end, color, thickness);
   cv::line(mat_image_, arrowtip_right_start, arrow_end, color, thickness);
+  MarkDirty(x_start, y_start, x_end, y_end, thickness);
+  MarkDirty(arrowtip_left_start.x, arrowtip_left_start.y,
+            arrowtip_right_start.x, arrowtip_right_start.y, thickness);
 }
 
 void AnnotationRenderer::DrawPoint(const RenderAnnotation& annotation) {
@@ -441,11 +510,14 @@ void AnnotationRenderer::DrawPoint(const RenderAnnotation& annotation) {
     y = static_cast<int>(point.y() * scale_factor_);
   }
 
-  cv::Point point_to_draw(x, y);
-  const cv::Scalar color = MediapipeColorToOpenCVColor(annotation.color());
-  const int thickness =
-      ClampThickness(round(annotation.thickness() * scale_factor_));
-  cv::circle(mat_image_, point_to_draw, thickness, color, -1);
+  // Points are filled circles with the thickness as radius.
+  AnnotationStroke stroke;
+  stroke.x0 = stroke.x1 = x;
+  stroke.y0 = stroke.y1 = y;
+  stroke.radius = ClampThickness(round(annotation.thickness() * scale_factor_));
+  SetStrokeColor(annotation.color(), stroke.color0);
+  SetStrokeColor(annotation.color(), stroke.color1);
+  pending_strokes_.push_back(stroke);
 }
 
 void AnnotationRenderer::DrawLine(const RenderAnnotation& annotation) {
@@ -468,12 +540,16 @@ void AnnotationRenderer::DrawLine(const RenderAnnotation& annotation) {
     y_end = static_cast<int>(line.y_end() * scale_factor_);
   }
 
-  cv::Point start(x_start, y_start);
-  cv::Point end(x_end, y_end);
-  const cv::Scalar color = MediapipeColorToOpenCVColor(annotation.color());
-  const int thickness =
-      ClampThickness(round(annotation.thickness() * scale_factor_));
-  cv::line(mat_image_, start, end, color, thickness);
+  AnnotationStroke stroke;
+  stroke.x0 = x_start;
+  stroke.y0 = y_start;
+  stroke.x1 = x_end;
+  stroke.y1 = y_end;
+  stroke.radius =
+      ClampThickness(round(annotation.thickness() * scale_factor_)) / 2.0f;
+  SetStrokeColor(annotation.color(), stroke.color0);
+  SetStrokeColor(annotation.color(), stroke.color1);
+  pending_strokes_.push_back(stroke);
 }
 
 void AnnotationRenderer::DrawGradientLine(const RenderAnnotation& annotation) {
@@ -496,13 +572,16 @@ void AnnotationRenderer::DrawGradientLine(const RenderAnnotation& annotation) {
     y_end = static_cast<int>(line.y_end() * scale_factor_);
   }
 
-  const cv::Point start(x_start, y_start);
-  const cv::Point end(x_end, y_end);
-  const int thickness =
-      ClampThickness(round(annotation.thickness() * scale_factor_));
-  const cv::Scalar color1 = MediapipeColorToOpenCVColor(line.color1());
-  const cv::Scalar color2 = MediapipeColorToOpenCVColor(line.color2());
-  cv_line2(mat_image_, start, end, color1, color2, thickness);
+  AnnotationStroke stroke;
+  stroke.x0 = x_start;
+  stroke.y0 = y_start;
+  stroke.x1 = x_end;
+  stroke.y1 = y_end;
+  stroke.radius =
+      ClampThickness(round(annotation.thickness() * scale_factor_)) / 2.0f;
+  SetStrokeColor(line.color1(), stroke.color0);
+  SetStrokeColor(line.color2(), stroke.color1);
+  pending_strokes_.push_back(stroke);
 }
 
 void AnnotationRenderer::DrawText(const RenderAnnotation& annotation) {
@@ -543,6 +622,10 @@ void AnnotationRenderer::DrawText(const RenderAnnotation& annotation) {
   cv::putText(mat_image_, text.display_text(), origin, font_face, font_scale,
               color, thickness, /*lineType=*/8,
               /*bottomLeftOrigin=*/flip_text_vertically_);
+  // Flipped text extends below the origin instead of above it.
+  const int extent = text_size.height + text_baseline;
+  MarkDirty(origin.x, origin.y - extent, origin.x + text_size.width,
+            origin.y + extent, thickness);
 }
 
 double AnnotationRenderer::ComputeFontScale(int font_face, int font_size,
@@ -16,9 +16,11 @@
 #define MEDIAPIPE_UTIL_ANNOTATION_RENDERER_H_
 
 #include <string>
+#include <vector>
 
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/util/annotation_rasterizer.h"
 #include "mediapipe/util/render_data.pb.h"
 
 namespace mediapipe {
@@ -54,13 +56,19 @@ class AnnotationRenderer {
         image_height_(mat_image.rows),
         mat_image_(mat_image.clone()) {}
 
-  // Renders the image with the input render data.
+  // Renders the image with the input render data. Consecutive points and
+  // lines are batched and drawn together by the span rasterizer of
+  // annotation_rasterizer.h when the image is 8-bit RGB or RGBA.
   void RenderDataOnImage(const RenderData& render_data);
 
   // Resets the renderer with a new image. Does not own input_image. input_image
   // must not be modified by caller during rendering.
   void AdoptImage(cv::Mat* input_image);
 
+  // Returns the bounding box of the pixels modified since the last call to
+  // AdoptImage(), clipped to the image.
+  const DirtyRect& GetDirtyRect() const { return dirty_rect_; }
+
   // Gets image dimensions.
   int GetImageWidth() const;
   int GetImageHeight() const;
@@ -71,6 +79,11 @@ class AnnotationRenderer {
   // corner.
   void SetFlipTextVertically(bool flip);
 
+  // Sets whether points and lines are drawn with antialiased edges. This is
+  // default to false. Leave it unset when the rendered pixels are compared
+  // against a key color, as in the GPU path of AnnotationOverlayCalculator.
+  void SetAntialiasing(bool antialiasing);
+
   // For GPU rendering optimization in AnnotationOverlayCalculator.
   // Scale all incoming coordinates,sizes,thickness,etc. by this amount.
   // Should be in the range (0-1].
@@ -94,15 +107,24 @@ class AnnotationRenderer {
   // Draws an arrow on the image as described in the annotation.
   void DrawArrow(const RenderAnnotation& annotation);
 
-  // Draws a point on the image as described in the annotation.
+  // Queues a point, as described in the annotation, for FlushStrokes().
   void DrawPoint(const RenderAnnotation& annotation);
 
-  // Draws a line segment on the image as described in the annotation.
+  // Queues a line segment, as described in the annotation, for
+  // FlushStrokes().
   void DrawLine(const RenderAnnotation& annotation);
 
-  // Draws a 2-tone line segment on the image as described in the annotation.
+  // Queues a 2-tone line segment, as described in the annotation, for
+  // FlushStrokes().
   void DrawGradientLine(const RenderAnnotation& annotation);
 
+  // Draws the queued points and lines on the image.
+  void FlushStrokes();
+
+  // Grows the dirty rectangle to cover the box from (x0, y0) to (x1, y1),
+  // widened by margin pixels on every side.
+  void MarkDirty(int x0, int y0, int x1, int y1, int margin);
+
   // Draws a text on the image as described in the annotation.
   void DrawText(const RenderAnnotation& annotation);
 
@@ -135,6 +157,15 @@ class AnnotationRenderer {
   // See SetFlipTextVertically(bool).
   bool flip_text_vertically_ = false;
 
+  // See SetAntialiasing(bool).
+  bool antialiasing_ = false;
+
+  // Points and lines waiting to be drawn, in order.
+  std::vector<AnnotationStroke> pending_strokes_;
+
+  // See GetDirtyRect().
+  DirtyRect dirty_rect_;
+
   // See SetScaleFactor(float)
   float scale_factor_ = 1.0;
 };
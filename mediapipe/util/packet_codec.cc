@@ -0,0 +1,251 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/packet_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr uint32 kPayloadMagic = 0x4d505043;  // "MPPC"
+constexpr int kMaxDims = 8;
+
+enum PayloadType : uint32 {
+  kImageFramePayload = 1,
+  kMatrixPayload = 2,
+  kTensorPayload = 3,
+  kProtoPayload = 4,
+};
+
+// Precedes every encoded payload. The proto type name, if any, directly
+// follows the header; the data starts at data_offset.
+struct PayloadHeader {
+  uint32 magic;
+  uint32 type;
+  // ImageFormat::Format for images, Tensor::ElementType for tensors.
+  int32 format;
+  // Width, height and width step of images, rows and columns of matrices,
+  // dimensions of tensors.
+  int32 num_dims;
+  int32 dims[kMaxDims];
+  uint32 type_name_size;
+  uint64 data_offset;
+  uint64 data_size;
+};
+
+// Returns the product of dims, or -1 if any dimension is negative or the
+// product overflows an int, as Tensor::Shape::num_elements would.
+int64 NumElements(const int32* dims, int num_dims) {
+  int64 num_elements = 1;
+  for (int i = 0; i < num_dims; ++i) {
+    if (dims[i] < 0) return -1;
+    num_elements *= dims[i];
+    if (num_elements > std::numeric_limits<int>::max()) return -1;
+  }
+  return num_elements;
+}
+
+size_t AlignedOffset(size_t offset) {
+  return (offset + kPacketPayloadAlignment - 1) &
+         ~(kPacketPayloadAlignment - 1);
+}
+
+// Describes the payload of packet, and returns in bytes and type_name what
+// EncodePacketPayload has to copy after the header.
+absl::Status DescribePayload(const Packet& packet, PayloadHeader* header,
+                             const uint8** bytes, std::string* type_name,
+                             std::string* serialized) {
+  std::memset(header, 0, sizeof(*header));
+  header->magic = kPayloadMagic;
+  if (packet.ValidateAsType<ImageFrame>().ok()) {
+    const ImageFrame& frame = packet.Get<ImageFrame>();
+    header->type = kImageFramePayload;
+    header->format = frame.Format();
+    header->num_dims = 3;
+    header->dims[0] = frame.Width();
+    header->dims[1] = frame.Height();
+    header->dims[2] = frame.WidthStep();
+    header->data_size = frame.PixelDataSize();
+    *bytes = frame.PixelData();
+  } else if (packet.ValidateAsType<Matrix>().ok()) {
+    const Matrix& matrix = packet.Get<Matrix>();
+    header->type = kMatrixPayload;
+    header->num_dims = 2;
+    header->dims[0] = matrix.rows();
+    header->dims[1] = matrix.cols();
+    header->data_size = matrix.size() * sizeof(float);
+    *bytes = reinterpret_cast<const uint8*>(matrix.data());
+  } else if (packet.ValidateAsType<Tensor>().ok()) {
+    const Tensor& tensor = packet.Get<Tensor>();
+    const std::vector<int>& dims = tensor.shape().dims;
+    RET_CHECK_LE(dims.size(), static_cast<size_t>(kMaxDims))
+        << "Tensors of rank above " << kMaxDims << " are not supported.";
+    header->type = kTensorPayload;
+    header->format = static_cast<int32>(tensor.element_type());
+    header->num_dims = dims.size();
+    std::copy(dims.begin(), dims.end(), header->dims);
+    header->data_size = tensor.bytes();
+    // Tensor views hold a lock, so the caller reads the tensor itself.
+    *bytes = nullptr;
+  } else if (packet.ValidateAsProtoMessageLite().ok()) {
+    const proto_ns::MessageLite& message = packet.GetProtoMessageLite();
+    RET_CHECK(message.IsInitialized())
+        << "Cannot encode " << message.InitializationErrorString();
+    *type_name = message.GetTypeName();
+    RET_CHECK(message.SerializeToString(serialized));
+    header->type = kProtoPayload;
+    header->type_name_size = type_name->size();
+    header->data_size = serialized->size();
+    *bytes = reinterpret_cast<const uint8*>(serialized->data());
+  } else {
+    return mediapipe::UnimplementedErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot encode packets of type " << packet.DebugTypeName();
+  }
+  header->data_offset =
+      AlignedOffset(sizeof(PayloadHeader) + header->type_name_size);
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<size_t> EncodedPacketPayloadSize(const Packet& packet) {
+  PayloadHeader header;
+  const uint8* bytes;
+  std::string type_name, serialized;
+  MP_RETURN_IF_ERROR(
+      DescribePayload(packet, &header, &bytes, &type_name, &serialized));
+  return header.data_offset + header.data_size;
+}
+
+absl::Status EncodePacketPayload(const Packet& packet, uint8* data,
+                                 size_t size) {
+  PayloadHeader header;
+  const uint8* bytes;
+  std::string type_name, serialized;
+  MP_RETURN_IF_ERROR(
+      DescribePayload(packet, &header, &bytes, &type_name, &serialized));
+  RET_CHECK_GE(size, header.data_offset + header.data_size)
+      << "Buffer too small for packet of type " << packet.DebugTypeName();
+  std::memcpy(data, &header, sizeof(header));
+  std::memcpy(data + sizeof(header), type_name.data(), type_name.size());
+  if (header.type == kTensorPayload) {
+    auto view = packet.Get<Tensor>().GetCpuReadView();
+    std::memcpy(data + header.data_offset, view.buffer<uint8>(),
+                header.data_size);
+  } else {
+    std::memcpy(data + header.data_offset, bytes, header.data_size);
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Packet> DecodePacketPayload(
+    const uint8* data, size_t size, std::shared_ptr<const void> data_owner) {
+  PayloadHeader header;
+  RET_CHECK_GE(size, sizeof(header)) << "Truncated packet payload.";
+  std::memcpy(&header, data, sizeof(header));
+  RET_CHECK_EQ(header.magic, kPayloadMagic) << "Not a packet payload.";
+  RET_CHECK(header.num_dims >= 0 && header.num_dims <= kMaxDims);
+  // Written so that corrupt offsets and sizes cannot overflow.
+  RET_CHECK(header.data_offset >= sizeof(header) + header.type_name_size &&
+            header.data_offset <= size &&
+            header.data_size <= size - header.data_offset)
+      << "Truncated packet payload.";
+  const uint8* bytes = data + header.data_offset;
+
+  switch (header.type) {
+    case kImageFramePayload: {
+      RET_CHECK_EQ(header.num_dims, 3);
+      const auto format = static_cast<ImageFormat::Format>(header.format);
+      const int width = header.dims[0];
+      const int height = header.dims[1];
+      const int width_step = header.dims[2];
+      RET_CHECK(ImageFormat::Format_IsValid(format) &&
+                format != ImageFormat::UNKNOWN)
+          << "Unknown image format " << header.format;
+      RET_CHECK(width >= 0 && height >= 0 &&
+                width_step >= static_cast<int64>(width) *
+                                  ImageFrame::ByteDepthForFormat(format) *
+                                  ImageFrame::NumberOfChannelsForFormat(format))
+          << "Invalid image size " << width << "x" << height << ", step "
+          << width_step;
+      RET_CHECK_EQ(header.data_size, static_cast<uint64>(width_step) * height);
+      if (data_owner) {
+        // The deleter owns data_owner, and drops it with the frame.
+        return Adopt(new ImageFrame(
+            format, width, height, width_step, const_cast<uint8*>(bytes),
+            [data_owner](uint8*) {}));
+      }
+      auto frame = absl::make_unique<ImageFrame>();
+      frame->CopyPixelData(format, width, height, width_step, bytes,
+                           ImageFrame::kDefaultAlignmentBoundary);
+      return Adopt(frame.release());
+    }
+    case kMatrixPayload: {
+      RET_CHECK_EQ(header.num_dims, 2);
+      const int64 num_elements = NumElements(header.dims, 2);
+      RET_CHECK_GE(num_elements, 0) << "Invalid matrix size " << header.dims[0]
+                                    << "x" << header.dims[1];
+      RET_CHECK_EQ(header.data_size, num_elements * sizeof(float));
+      auto matrix = absl::make_unique<Matrix>(header.dims[0], header.dims[1]);
+      std::memcpy(matrix->data(), bytes, header.data_size);
+      return Adopt(matrix.release());
+    }
+    case kTensorPayload: {
+      const auto element_type = static_cast<Tensor::ElementType>(header.format);
+      RET_CHECK(element_type == Tensor::ElementType::kFloat16 ||
+                element_type == Tensor::ElementType::kFloat32)
+          << "Unknown tensor element type " << header.format;
+      const int64 num_elements = NumElements(header.dims, header.num_dims);
+      RET_CHECK_GE(num_elements, 0) << "Invalid tensor shape.";
+      const std::vector<int> dims(header.dims,
+                                  header.dims + header.num_dims);
+      auto tensor =
+          absl::make_unique<Tensor>(element_type, Tensor::Shape(dims));
+      RET_CHECK_EQ(header.data_size, tensor->bytes());
+      {
+        auto view = tensor->GetCpuWriteView();
+        std::memcpy(view.buffer<uint8>(), bytes, header.data_size);
+      }
+      return Adopt(tensor.release());
+    }
+    case kProtoPayload: {
+      const std::string type_name(
+          reinterpret_cast<const char*>(data + sizeof(header)),
+          header.type_name_size);
+      return packet_internal::PacketFromDynamicProto(
+          type_name, std::string(reinterpret_cast<const char*>(bytes),
+                                 header.data_size));
+    }
+    default:
+      return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "Unknown packet payload type " << header.type;
+  }
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,75 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Flat encoding of packet payloads into caller-provided memory, such as
+// shared memory or a memory-mapped file, so that they can be read back in
+// another process without parsing.
+//
+// ImageFrame, Matrix and Tensor payloads are stored as their raw pixel or
+// element buffers, preceded by a small header describing their layout.
+// Protocol buffer messages are stored as their type name and serialized
+// bytes; to be decoded, the message type must be linked into the decoding
+// binary. Other types are not supported.
+//
+// The encoding uses the native byte order and is meant for processes on the
+// same machine.
+//
+// Example:
+//   ASSIGN_OR_RETURN(size_t size, EncodedPacketPayloadSize(packet));
+//   // Allocate size bytes aligned to kPacketPayloadAlignment at buffer.
+//   MP_RETURN_IF_ERROR(EncodePacketPayload(packet, buffer, size));
+//   ...
+//   ASSIGN_OR_RETURN(Packet decoded,
+//                    DecodePacketPayload(buffer, size, buffer_owner));
+
+#ifndef MEDIAPIPE_UTIL_PACKET_CODEC_H_
+#define MEDIAPIPE_UTIL_PACKET_CODEC_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+// Encoded payloads must start at addresses aligned to this many bytes, so
+// that decoded pixel and element buffers are aligned as well.
+constexpr size_t kPacketPayloadAlignment = 64;
+
+// Returns the size in bytes of the encoded payload of packet, or an error
+// if the type of the payload is not supported.
+absl::StatusOr<size_t> EncodedPacketPayloadSize(const Packet& packet);
+
+// Encodes the payload of packet to data, which must hold size bytes, at
+// least EncodedPacketPayloadSize(packet). The timestamp is not encoded.
+absl::Status EncodePacketPayload(const Packet& packet, uint8* data,
+                                 size_t size);
+
+// Decodes a payload encoded by EncodePacketPayload into a packet without a
+// timestamp.
+//
+// If data_owner is not null, the pixel data of a decoded ImageFrame is not
+// copied but references data, and the packet keeps data_owner alive until
+// the ImageFrame is destroyed. The memory at data must then stay unchanged
+// until data_owner is released. Otherwise, and for other types, the payload
+// is copied.
+absl::StatusOr<Packet> DecodePacketPayload(
+    const uint8* data, size_t size, std::shared_ptr<const void> data_owner);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_PACKET_CODEC_H_
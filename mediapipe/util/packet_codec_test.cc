@@ -0,0 +1,219 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/packet_codec.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/rect.pb.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+// Encodes packet into a new buffer aligned to kPacketPayloadAlignment.
+std::shared_ptr<uint8> Encode(const Packet& packet, size_t* size) {
+  auto size_or = EncodedPacketPayloadSize(packet);
+  MP_EXPECT_OK(size_or.status());
+  *size = size_or.value();
+  std::shared_ptr<uint8> buffer(
+      static_cast<uint8*>(std::aligned_alloc(
+          kPacketPayloadAlignment,
+          (*size + kPacketPayloadAlignment - 1) &
+              ~(kPacketPayloadAlignment - 1))),
+      std::free);
+  MP_EXPECT_OK(EncodePacketPayload(packet, buffer.get(), *size));
+  return buffer;
+}
+
+TEST(PacketCodecTest, ImageFrameReferencesBuffer) {
+  auto frame = absl::make_unique<ImageFrame>(ImageFormat::SRGB, 5, 3);
+  for (int i = 0; i < frame->PixelDataSize(); ++i) {
+    frame->MutablePixelData()[i] = i;
+  }
+  Packet packet = Adopt(frame.release());
+  size_t size;
+  std::shared_ptr<uint8> buffer = Encode(packet, &size);
+
+  auto decoded_or = DecodePacketPayload(buffer.get(), size, buffer);
+  MP_ASSERT_OK(decoded_or.status());
+  const ImageFrame& expected = packet.Get<ImageFrame>();
+  const ImageFrame& decoded = decoded_or.value().Get<ImageFrame>();
+  EXPECT_EQ(decoded.Format(), ImageFormat::SRGB);
+  EXPECT_EQ(decoded.Width(), 5);
+  EXPECT_EQ(decoded.Height(), 3);
+  EXPECT_EQ(decoded.WidthStep(), expected.WidthStep());
+  EXPECT_EQ(0, std::memcmp(decoded.PixelData(), expected.PixelData(),
+                           expected.PixelDataSize()));
+  // The frame references the buffer, and keeps it alive.
+  EXPECT_GE(decoded.PixelData(), buffer.get());
+  EXPECT_LT(decoded.PixelData(), buffer.get() + size);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(decoded.PixelData()) %
+                   kPacketPayloadAlignment);
+  EXPECT_EQ(buffer.use_count(), 2);
+  decoded_or = Packet();
+  EXPECT_EQ(buffer.use_count(), 1);
+}
+
+TEST(PacketCodecTest, ImageFrameIsCopiedWithoutOwner) {
+  Packet packet = MakePacket<ImageFrame>(ImageFormat::GRAY8, 4, 4);
+  size_t size;
+  std::shared_ptr<uint8> buffer = Encode(packet, &size);
+
+  auto decoded_or = DecodePacketPayload(buffer.get(), size, nullptr);
+  MP_ASSERT_OK(decoded_or.status());
+  const ImageFrame& decoded = decoded_or.value().Get<ImageFrame>();
+  EXPECT_EQ(decoded.Width(), 4);
+  EXPECT_TRUE(decoded.PixelData() < buffer.get() ||
+              decoded.PixelData() >= buffer.get() + size);
+}
+
+TEST(PacketCodecTest, Matrix) {
+  Matrix matrix(2, 3);
+  matrix << 1, 2, 3, 4, 5, 6;
+  size_t size;
+  std::shared_ptr<uint8> buffer = Encode(MakePacket<Matrix>(matrix), &size);
+
+  auto decoded_or = DecodePacketPayload(buffer.get(), size, buffer);
+  MP_ASSERT_OK(decoded_or.status());
+  EXPECT_EQ(decoded_or.value().Get<Matrix>(), matrix);
+}
+
+TEST(PacketCodecTest, Tensor) {
+  auto tensor = absl::make_unique<Tensor>(Tensor::ElementType::kFloat32,
+                                          Tensor::Shape{2, 4});
+  {
+    auto view = tensor->GetCpuWriteView();
+    for (int i = 0; i < 8; ++i) view.buffer<float>()[i] = i * 0.5f;
+  }
+  size_t size;
+  std::shared_ptr<uint8> buffer = Encode(Adopt(tensor.release()), &size);
+
+  auto decoded_or = DecodePacketPayload(buffer.get(), size, buffer);
+  MP_ASSERT_OK(decoded_or.status());
+  const Tensor& decoded = decoded_or.value().Get<Tensor>();
+  EXPECT_EQ(decoded.element_type(), Tensor::ElementType::kFloat32);
+  EXPECT_THAT(decoded.shape().dims, testing::ElementsAre(2, 4));
+  auto view = decoded.GetCpuReadView();
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(view.buffer<float>()[i], i * 0.5f);
+  }
+}
+
+TEST(PacketCodecTest, Proto) {
+  NormalizedRect rect;
+  rect.set_x_center(0.25f);
+  rect.set_y_center(0.75f);
+  rect.set_width(0.5f);
+  rect.set_height(0.125f);
+  size_t size;
+  std::shared_ptr<uint8> buffer =
+      Encode(MakePacket<NormalizedRect>(rect), &size);
+
+  auto decoded_or = DecodePacketPayload(buffer.get(), size, buffer);
+  MP_ASSERT_OK(decoded_or.status());
+  const NormalizedRect& decoded = decoded_or.value().Get<NormalizedRect>();
+  EXPECT_EQ(decoded.x_center(), 0.25f);
+  EXPECT_EQ(decoded.y_center(), 0.75f);
+  EXPECT_EQ(decoded.width(), 0.5f);
+  EXPECT_EQ(decoded.height(), 0.125f);
+}
+
+TEST(PacketCodecTest, RejectsUnsupportedTypes) {
+  EXPECT_FALSE(EncodedPacketPayloadSize(MakePacket<int>(1)).ok());
+  // Missing required fields.
+  EXPECT_FALSE(EncodedPacketPayloadSize(MakePacket<NormalizedRect>()).ok());
+}
+
+TEST(PacketCodecTest, RejectsTruncatedPayloads) {
+  size_t size;
+  std::shared_ptr<uint8> buffer =
+      Encode(MakePacket<ImageFrame>(ImageFormat::GRAY8, 4, 4), &size);
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), size - 1, nullptr).ok());
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), 8, nullptr).ok());
+}
+
+// Byte offsets of fields of the payload header, see packet_codec.cc.
+constexpr int kFormatOffset = 8;
+constexpr int kDimsOffset = 16;
+constexpr int kDataOffsetOffset = 56;
+constexpr int kDataSizeOffset = 64;
+
+template <typename T>
+void Overwrite(uint8* buffer, int offset, T value) {
+  std::memcpy(buffer + offset, &value, sizeof(value));
+}
+
+TEST(PacketCodecTest, RejectsOverflowingDataRange) {
+  size_t size;
+  std::shared_ptr<uint8> buffer =
+      Encode(MakePacket<ImageFrame>(ImageFormat::GRAY8, 4, 4), &size);
+  uint64 data_offset, data_size;
+  std::memcpy(&data_offset, buffer.get() + kDataOffsetOffset,
+              sizeof(data_offset));
+  std::memcpy(&data_size, buffer.get() + kDataSizeOffset, sizeof(data_size));
+  // data_offset + data_size wraps around to less than size.
+  Overwrite<uint64>(buffer.get(), kDataSizeOffset, ~uint64{0} - 8);
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), size, nullptr).ok());
+  Overwrite<uint64>(buffer.get(), kDataSizeOffset, data_size);
+  Overwrite<uint64>(buffer.get(), kDataOffsetOffset, ~uint64{0} - 8);
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), size, nullptr).ok());
+  Overwrite<uint64>(buffer.get(), kDataOffsetOffset, data_offset);
+  MP_EXPECT_OK(DecodePacketPayload(buffer.get(), size, nullptr).status());
+}
+
+TEST(PacketCodecTest, RejectsInvalidImageFrames) {
+  size_t size;
+  std::shared_ptr<uint8> buffer =
+      Encode(MakePacket<ImageFrame>(ImageFormat::GRAY8, 16, 4), &size);
+  Overwrite<int32>(buffer.get(), kFormatOffset, 1000);
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), size, nullptr).ok());
+  // A width step too small for rows of 16 RGB pixels.
+  Overwrite<int32>(buffer.get(), kFormatOffset, ImageFormat::SRGB);
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), size, nullptr).ok());
+}
+
+TEST(PacketCodecTest, RejectsNegativeMatrixDimensions) {
+  size_t size;
+  std::shared_ptr<uint8> buffer =
+      Encode(MakePacket<Matrix>(Matrix::Zero(2, 2)), &size);
+  // -2 x -2 matches the data size of 2 x 2 elements.
+  Overwrite<int32>(buffer.get(), kDimsOffset, -2);
+  Overwrite<int32>(buffer.get(), kDimsOffset + 4, -2);
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), size, nullptr).ok());
+}
+
+TEST(PacketCodecTest, RejectsUnknownTensorElementTypes) {
+  auto tensor = absl::make_unique<Tensor>(Tensor::ElementType::kFloat32,
+                                          Tensor::Shape{4});
+  tensor->GetCpuWriteView();
+  size_t size;
+  std::shared_ptr<uint8> buffer = Encode(Adopt(tensor.release()), &size);
+  Overwrite<int32>(buffer.get(), kFormatOffset, 7);
+  EXPECT_FALSE(DecodePacketPayload(buffer.get(), size, nullptr).ok());
+  Overwrite<int32>(buffer.get(), kFormatOffset,
+                   static_cast<int32>(Tensor::ElementType::kFloat32));
+  MP_EXPECT_OK(DecodePacketPayload(buffer.get(), size, nullptr).status());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,297 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/packet_log.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/util/packet_codec.h"
+
+namespace mediapipe {
+
+namespace {
+
+// The file starts with a FileHeader, followed by a ChannelHeader and the name
+// of each channel. Each packet is then stored as an EntryHeader followed by
+// its encoded payload, both padded to kPacketPayloadAlignment. Close appends
+// the index entries and a Footer.
+constexpr char kFileMagic[8] = {'M', 'P', 'P', 'K', 'T', 'L', 'O', 'G'};
+constexpr char kFooterMagic[8] = {'M', 'P', 'P', 'K', 'T', 'I', 'D', 'X'};
+constexpr uint32 kEntryMagic = 0x4d50454e;  // "MPEN"
+constexpr uint32 kVersion = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32 version;
+  uint32 num_channels;
+};
+
+struct ChannelHeader {
+  uint32 is_side_packet;
+  uint32 name_size;
+};
+
+struct EntryHeader {
+  uint32 magic;
+  uint32 channel;
+  int64 timestamp;
+  uint64 payload_size;
+};
+
+struct Footer {
+  uint64 index_offset;
+  uint64 num_entries;
+  char magic[8];
+};
+
+uint64 AlignUp(uint64 offset) {
+  return (offset + kPacketPayloadAlignment - 1) &
+         ~static_cast<uint64>(kPacketPayloadAlignment - 1);
+}
+
+// Returns the encoded payload offset of the entry at offset.
+uint64 PayloadOffset(uint64 entry_offset) {
+  return AlignUp(entry_offset + sizeof(EntryHeader));
+}
+
+}  // namespace
+
+// static
+absl::StatusOr<std::unique_ptr<PacketLogWriter>> PacketLogWriter::Create(
+    const std::string& path, const std::vector<PacketLogChannel>& channels) {
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot create " << path << ": " << std::strerror(errno);
+  }
+  auto writer = absl::WrapUnique(new PacketLogWriter(file, channels.size()));
+  absl::MutexLock lock(&writer->mutex_);
+  FileHeader header;
+  std::memcpy(header.magic, kFileMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.num_channels = channels.size();
+  MP_RETURN_IF_ERROR(writer->Write(&header, sizeof(header)));
+  for (const PacketLogChannel& channel : channels) {
+    ChannelHeader channel_header;
+    channel_header.is_side_packet = channel.is_side_packet;
+    channel_header.name_size = channel.name.size();
+    MP_RETURN_IF_ERROR(
+        writer->Write(&channel_header, sizeof(channel_header)));
+    MP_RETURN_IF_ERROR(writer->Write(channel.name.data(), channel.name.size()));
+  }
+  MP_RETURN_IF_ERROR(writer->Pad());
+  return writer;
+}
+
+PacketLogWriter::PacketLogWriter(std::FILE* file, int num_channels)
+    : file_(file), num_channels_(num_channels) {}
+
+PacketLogWriter::~PacketLogWriter() {
+  absl::Status status = Close();
+  if (!status.ok()) {
+    LOG(ERROR) << "PacketLogWriter: " << status;
+  }
+}
+
+absl::Status PacketLogWriter::Write(const void* data, size_t size) {
+  RET_CHECK(file_ != nullptr) << "The packet log is closed.";
+  if (size > 0 && std::fwrite(data, size, 1, file_) != 1) {
+    return mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot write packet log: " << std::strerror(errno);
+  }
+  offset_ += size;
+  return absl::OkStatus();
+}
+
+absl::Status PacketLogWriter::Pad() {
+  static const uint8 kZeros[kPacketPayloadAlignment] = {};
+  return Write(kZeros, AlignUp(offset_) - offset_);
+}
+
+absl::Status PacketLogWriter::Append(int channel, const Packet& packet) {
+  RET_CHECK(channel >= 0 && channel < num_channels_)
+      << "Invalid packet log channel " << channel;
+  ASSIGN_OR_RETURN(size_t size, EncodedPacketPayloadSize(packet));
+  absl::MutexLock lock(&mutex_);
+  buffer_.resize(size);
+  MP_RETURN_IF_ERROR(EncodePacketPayload(packet, buffer_.data(), size));
+
+  packet_log_internal::IndexEntry index_entry;
+  index_entry.offset = offset_;
+  index_entry.timestamp = packet.Timestamp().Value();
+  index_entry.channel = channel;
+  index_entry.reserved = 0;
+  EntryHeader header;
+  header.magic = kEntryMagic;
+  header.channel = channel;
+  header.timestamp = index_entry.timestamp;
+  header.payload_size = size;
+  MP_RETURN_IF_ERROR(Write(&header, sizeof(header)));
+  MP_RETURN_IF_ERROR(Pad());
+  MP_RETURN_IF_ERROR(Write(buffer_.data(), size));
+  MP_RETURN_IF_ERROR(Pad());
+  index_.push_back(index_entry);
+  return absl::OkStatus();
+}
+
+absl::Status PacketLogWriter::Close() {
+  absl::MutexLock lock(&mutex_);
+  if (file_ == nullptr) {
+    return absl::OkStatus();
+  }
+  Footer footer;
+  footer.index_offset = offset_;
+  footer.num_entries = index_.size();
+  std::memcpy(footer.magic, kFooterMagic, sizeof(footer.magic));
+  absl::Status status =
+      Write(index_.data(), index_.size() * sizeof(index_[0]));
+  if (status.ok()) {
+    status = Write(&footer, sizeof(footer));
+  }
+  if (std::fclose(file_) != 0 && status.ok()) {
+    status = mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+             << "Cannot close packet log: " << std::strerror(errno);
+  }
+  file_ = nullptr;
+  return status;
+}
+
+// static
+absl::StatusOr<std::unique_ptr<PacketLogReader>> PacketLogReader::Open(
+    const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return mediapipe::NotFoundErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot open " << path << ": " << std::strerror(errno);
+  }
+  struct stat info;
+  void* base = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    base = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  RET_CHECK(base != MAP_FAILED) << "Cannot map " << path;
+
+  auto reader = absl::WrapUnique(new PacketLogReader());
+  const uint64 size = info.st_size;
+  reader->size_ = size;
+  reader->data_ = std::shared_ptr<const uint8>(
+      static_cast<const uint8*>(base),
+      [size](const uint8* data) { munmap(const_cast<uint8*>(data), size); });
+  const uint8* data = reader->data_.get();
+
+  FileHeader header;
+  RET_CHECK_GE(size, sizeof(header)) << path << " is not a packet log.";
+  std::memcpy(&header, data, sizeof(header));
+  RET_CHECK(std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) == 0)
+      << path << " is not a packet log.";
+  RET_CHECK_EQ(header.version, kVersion)
+      << "Unsupported packet log version in " << path;
+  uint64 offset = sizeof(header);
+  for (uint32 i = 0; i < header.num_channels; ++i) {
+    ChannelHeader channel_header;
+    RET_CHECK_LE(offset + sizeof(channel_header), size);
+    std::memcpy(&channel_header, data + offset, sizeof(channel_header));
+    offset += sizeof(channel_header);
+    RET_CHECK_LE(offset + channel_header.name_size, size);
+    PacketLogChannel channel;
+    channel.name.assign(reinterpret_cast<const char*>(data + offset),
+                        channel_header.name_size);
+    channel.is_side_packet = channel_header.is_side_packet != 0;
+    reader->channels_.push_back(std::move(channel));
+    offset += channel_header.name_size;
+  }
+  offset = AlignUp(offset);
+
+  Footer footer;
+  if (size >= offset + sizeof(footer)) {
+    std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+  }
+  if (size < offset + sizeof(footer) ||
+      std::memcmp(footer.magic, kFooterMagic, sizeof(kFooterMagic)) != 0 ||
+      footer.index_offset +
+              footer.num_entries * sizeof(packet_log_internal::IndexEntry) !=
+          size - sizeof(footer)) {
+    LOG(WARNING) << path << " was not closed; scanning its packets.";
+    reader->ScanEntries(offset);
+    return reader;
+  }
+
+  reader->entries_.reserve(footer.num_entries);
+  for (uint64 i = 0; i < footer.num_entries; ++i) {
+    packet_log_internal::IndexEntry index_entry;
+    std::memcpy(&index_entry,
+                data + footer.index_offset + i * sizeof(index_entry),
+                sizeof(index_entry));
+    EntryHeader entry_header;
+    RET_CHECK_LE(index_entry.offset + sizeof(entry_header),
+                 footer.index_offset);
+    std::memcpy(&entry_header, data + index_entry.offset,
+                sizeof(entry_header));
+    Entry entry;
+    entry.channel = index_entry.channel;
+    entry.timestamp = Timestamp::CreateNoErrorChecking(index_entry.timestamp);
+    entry.offset = PayloadOffset(index_entry.offset);
+    entry.size = entry_header.payload_size;
+    RET_CHECK(entry_header.magic == kEntryMagic &&
+              index_entry.channel < reader->channels_.size() &&
+              entry.offset + entry.size <= footer.index_offset)
+        << "Corrupt packet log index in " << path;
+    reader->entries_.push_back(entry);
+  }
+  return reader;
+}
+
+void PacketLogReader::ScanEntries(uint64 offset) {
+  const uint8* data = data_.get();
+  while (offset + sizeof(EntryHeader) <= size_) {
+    EntryHeader header;
+    std::memcpy(&header, data + offset, sizeof(header));
+    Entry entry;
+    entry.channel = header.channel;
+    entry.timestamp = Timestamp::CreateNoErrorChecking(header.timestamp);
+    entry.offset = PayloadOffset(offset);
+    entry.size = header.payload_size;
+    if (header.magic != kEntryMagic || header.channel >= channels_.size() ||
+        entry.offset + entry.size > size_) {
+      // The rest was not completely written.
+      break;
+    }
+    entries_.push_back(entry);
+    offset = AlignUp(entry.offset + entry.size);
+  }
+}
+
+absl::StatusOr<Packet> PacketLogReader::ReadPacket(int index) const {
+  RET_CHECK(index >= 0 && index < num_entries());
+  const Entry& entry = entries_[index];
+  ASSIGN_OR_RETURN(
+      Packet packet,
+      DecodePacketPayload(data_.get() + entry.offset, entry.size, data_));
+  return packet.At(entry.timestamp);
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,148 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// An append-only log of packets of several named channels, i.e. streams or
+// side packets, used to record the inputs of a graph and replay them later.
+//
+// Packet payloads are stored with EncodePacketPayload (see packet_codec.h),
+// each aligned to kPacketPayloadAlignment in the file. When the writer is
+// closed, an index of all packets is appended. The reader maps the file into
+// memory, so that replayed ImageFrames reference the mapped pixel data
+// without copies. A log whose writer did not close, e.g. after a crash, can
+// still be read up to its last complete packet.
+//
+// Example:
+//   ASSIGN_OR_RETURN(auto writer, PacketLogWriter::Create(
+//                        path, {{"input_video", /*is_side_packet=*/false}}));
+//   MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+//       "input_video",
+//       [&writer](const Packet& p) { return writer->Append(0, p); }));
+//   ...
+//   MP_RETURN_IF_ERROR(writer->Close());
+//
+//   ASSIGN_OR_RETURN(auto reader, PacketLogReader::Open(path));
+//   for (int i = 0; i < reader->num_entries(); ++i) {
+//     ASSIGN_OR_RETURN(Packet packet, reader->ReadPacket(i));
+//   }
+
+#ifndef MEDIAPIPE_UTIL_PACKET_LOG_H_
+#define MEDIAPIPE_UTIL_PACKET_LOG_H_
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+
+namespace packet_log_internal {
+
+// Written to the index of the log for each packet.
+struct IndexEntry {
+  // Offset of the entry header in the file.
+  uint64 offset;
+  int64 timestamp;
+  uint32 channel;
+  uint32 reserved;
+};
+
+}  // namespace packet_log_internal
+
+struct PacketLogChannel {
+  std::string name;
+  // Whether the channel holds a single side packet rather than a stream.
+  bool is_side_packet = false;
+};
+
+class PacketLogWriter {
+ public:
+  // Creates or truncates the log at path.
+  static absl::StatusOr<std::unique_ptr<PacketLogWriter>> Create(
+      const std::string& path, const std::vector<PacketLogChannel>& channels);
+
+  // Closes the log if Close was not called, logging any error.
+  ~PacketLogWriter();
+
+  // Appends packet to the given channel, with its timestamp. Thread-safe.
+  absl::Status Append(int channel, const Packet& packet);
+
+  // Writes the index and closes the file.
+  absl::Status Close();
+
+ private:
+  PacketLogWriter(std::FILE* file, int num_channels);
+
+  absl::Status Write(const void* data, size_t size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Writes zeros up to the next multiple of kPacketPayloadAlignment.
+  absl::Status Pad() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  absl::Mutex mutex_;
+  std::FILE* file_ ABSL_GUARDED_BY(mutex_);
+  const int num_channels_;
+  uint64 offset_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<packet_log_internal::IndexEntry> index_ ABSL_GUARDED_BY(mutex_);
+  // Reused for encoding payloads.
+  std::vector<uint8> buffer_ ABSL_GUARDED_BY(mutex_);
+};
+
+class PacketLogReader {
+ public:
+  struct Entry {
+    int channel;
+    // Unset for side packets.
+    Timestamp timestamp;
+    // Offset of the encoded payload in the file.
+    uint64 offset;
+    uint64 size;
+  };
+
+  // Maps the log at path into memory, and reads its index.
+  static absl::StatusOr<std::unique_ptr<PacketLogReader>> Open(
+      const std::string& path);
+
+  const std::vector<PacketLogChannel>& channels() const { return channels_; }
+
+  // Packets in the order they were appended.
+  int num_entries() const { return entries_.size(); }
+  const Entry& entry(int index) const { return entries_[index]; }
+
+  // Decodes the packet of the given entry, at its timestamp. ImageFrames
+  // reference the mapped file, which stays mapped while they exist.
+  absl::StatusOr<Packet> ReadPacket(int index) const;
+
+ private:
+  PacketLogReader() = default;
+
+  // Rebuilds the index of a log whose writer did not close.
+  void ScanEntries(uint64 offset);
+
+  // The mapped file; destroying the last reference unmaps it.
+  std::shared_ptr<const uint8> data_;
+  uint64 size_ = 0;
+  std::vector<PacketLogChannel> channels_;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_PACKET_LOG_H_
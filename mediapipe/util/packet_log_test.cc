@@ -0,0 +1,116 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/packet_log.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+std::string LogPath(const std::string& name) {
+  return absl::StrCat(getenv("TEST_TMPDIR"), "/", name);
+}
+
+// Writes a log with a matrix side packet and two frames.
+void WriteLog(const std::string& path) {
+  auto writer_or = PacketLogWriter::Create(
+      path, {{"video", false}, {"calibration", true}});
+  MP_ASSERT_OK(writer_or.status());
+  auto& writer = writer_or.value();
+  Matrix matrix(2, 2);
+  matrix << 1, 2, 3, 4;
+  MP_ASSERT_OK(writer->Append(1, MakePacket<Matrix>(matrix)));
+  for (int i = 0; i < 2; ++i) {
+    auto frame = absl::make_unique<ImageFrame>(ImageFormat::GRAY8, 100, 10);
+    frame->SetToZero();
+    frame->MutablePixelData()[0] = i + 1;
+    MP_ASSERT_OK(
+        writer->Append(0, Adopt(frame.release()).At(Timestamp(1000 * i))));
+  }
+  MP_ASSERT_OK(writer->Close());
+}
+
+TEST(PacketLogTest, ReadsPacketsBack) {
+  const std::string path = LogPath("reads_packets_back.log");
+  WriteLog(path);
+
+  auto reader_or = PacketLogReader::Open(path);
+  MP_ASSERT_OK(reader_or.status());
+  const auto& reader = reader_or.value();
+  ASSERT_EQ(reader->channels().size(), 2);
+  EXPECT_EQ(reader->channels()[0].name, "video");
+  EXPECT_FALSE(reader->channels()[0].is_side_packet);
+  EXPECT_EQ(reader->channels()[1].name, "calibration");
+  EXPECT_TRUE(reader->channels()[1].is_side_packet);
+  ASSERT_EQ(reader->num_entries(), 3);
+
+  EXPECT_EQ(reader->entry(0).channel, 1);
+  EXPECT_EQ(reader->entry(0).timestamp, Timestamp::Unset());
+  auto matrix_or = reader->ReadPacket(0);
+  MP_ASSERT_OK(matrix_or.status());
+  EXPECT_EQ(matrix_or.value().Get<Matrix>()(1, 0), 3);
+
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(reader->entry(i + 1).channel, 0);
+    auto packet_or = reader->ReadPacket(i + 1);
+    MP_ASSERT_OK(packet_or.status());
+    EXPECT_EQ(packet_or.value().Timestamp(), Timestamp(1000 * i));
+    const ImageFrame& frame = packet_or.value().Get<ImageFrame>();
+    EXPECT_EQ(frame.Width(), 100);
+    EXPECT_EQ(frame.PixelData()[0], i + 1);
+  }
+}
+
+TEST(PacketLogTest, ReadsUnclosedLog) {
+  const std::string path = LogPath("reads_unclosed_log.log");
+  WriteLog(path);
+  // Drop the footer, and then also part of the last frame.
+  auto reader_or = PacketLogReader::Open(path);
+  MP_ASSERT_OK(reader_or.status());
+  const uint64 last_frame_end =
+      reader_or.value()->entry(2).offset + reader_or.value()->entry(2).size;
+  reader_or = absl::UnknownError("");
+
+  ASSERT_EQ(0, truncate(path.c_str(), last_frame_end + 16));
+  reader_or = PacketLogReader::Open(path);
+  MP_ASSERT_OK(reader_or.status());
+  EXPECT_EQ(reader_or.value()->num_entries(), 3);
+
+  ASSERT_EQ(0, truncate(path.c_str(), last_frame_end - 1));
+  reader_or = PacketLogReader::Open(path);
+  MP_ASSERT_OK(reader_or.status());
+  EXPECT_EQ(reader_or.value()->num_entries(), 2);
+}
+
+TEST(PacketLogTest, RejectsOtherFiles) {
+  const std::string path = LogPath("rejects_other_files.log");
+  MP_ASSERT_OK(file::SetContents(path, "not a packet log"));
+  EXPECT_FALSE(PacketLogReader::Open(path).ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,76 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/parallel_for_rows.h"
+
+#include <algorithm>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/util/cpu_util.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Below this many pixels per tile, scheduling costs more than it saves.
+constexpr int64 kMinPixelsPerTile = 128 * 1024;
+
+// Returns the pool shared by all callers, or null on single core machines.
+ThreadPool* GetThreadPool() {
+  static ThreadPool* pool = []() -> ThreadPool* {
+    const int num_threads = NumCPUCores() - 1;
+    if (num_threads < 1) return nullptr;
+    auto* pool = new ThreadPool("parallel_for_rows", num_threads);
+    pool->StartWorkers();
+    return pool;
+  }();
+  return pool;
+}
+
+}  // namespace
+
+void ParallelForRows(int num_rows, int row_width,
+                     const std::function<void(int, int)>& fn) {
+  ThreadPool* pool = GetThreadPool();
+  int num_tiles = 1;
+  if (pool) {
+    const int64 num_pixels = static_cast<int64>(num_rows) * row_width;
+    num_tiles = static_cast<int>(std::min<int64>(
+        {pool->num_threads() + 1, num_pixels / kMinPixelsPerTile,
+         static_cast<int64>(num_rows)}));
+  }
+  if (num_tiles <= 1) {
+    fn(0, num_rows);
+    return;
+  }
+  const auto tile_begin = [&](int tile) {
+    return static_cast<int>(static_cast<int64>(tile) * num_rows / num_tiles);
+  };
+  // The calling thread takes the first tile.
+  absl::BlockingCounter pending(num_tiles - 1);
+  for (int tile = 1; tile < num_tiles; ++tile) {
+    const int begin = tile_begin(tile);
+    const int end = tile_begin(tile + 1);
+    pool->Schedule([&fn, &pending, begin, end] {
+      fn(begin, end);
+      pending.DecrementCount();
+    });
+  }
+  fn(0, tile_begin(1));
+  pending.Wait();
+}
+
+}  // namespace mediapipe
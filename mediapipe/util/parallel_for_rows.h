@@ -0,0 +1,34 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Splits per-row image kernels into tiles of rows that run in parallel on a
+// process-wide thread pool, once frames are large enough to amortize the
+// scheduling.
+
+#ifndef MEDIAPIPE_UTIL_PARALLEL_FOR_ROWS_H_
+#define MEDIAPIPE_UTIL_PARALLEL_FOR_ROWS_H_
+
+#include <functional>
+
+namespace mediapipe {
+
+// Calls fn(begin, end) on disjoint row ranges covering [0, num_rows), in
+// parallel when there are enough pixels (num_rows * row_width) to be worth
+// it. Returns once all ranges are processed.
+void ParallelForRows(int num_rows, int row_width,
+                     const std::function<void(int, int)>& fn);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_PARALLEL_FOR_ROWS_H_
@@ -0,0 +1,46 @@
+// Copyright 2021 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/parallel_for_rows.h"
+
+#include <atomic>
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+void ExpectEachRowVisitedOnce(int num_rows, int row_width) {
+  std::vector<std::atomic<int>> visits(num_rows);
+  for (auto& v : visits) v = 0;
+  ParallelForRows(num_rows, row_width, [&](int begin, int end) {
+    for (int row = begin; row < end; ++row) ++visits[row];
+  });
+  for (int row = 0; row < num_rows; ++row) {
+    EXPECT_EQ(visits[row], 1) << row;
+  }
+}
+
+TEST(ParallelForRowsTest, CoversAllRowsOnce) {
+  ExpectEachRowVisitedOnce(1080, 1920);
+}
+
+TEST(ParallelForRowsTest, CoversSmallFramesOnce) {
+  ExpectEachRowVisitedOnce(3, 8);
+  ExpectEachRowVisitedOnce(0, 8);
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -14,6 +14,9 @@
 
 #include "mediapipe/util/tracking/box_detector.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 #include "absl/memory/memory.h"
@@ -23,6 +26,7 @@
 #include "mediapipe/util/tracking/box_detector.pb.h"
 #include "mediapipe/util/tracking/box_tracker.h"
 #include "mediapipe/util/tracking/measure_time.h"
+#include "mediapipe/util/tracking/parallel_invoker.h"
 
 namespace mediapipe {
 
@@ -76,6 +80,24 @@ cv::Mat GetDescriptorsWithIndices(const cv::Mat &frame_descriptors,
   return mat;
 }
 
+// Squared L2 distance between two descriptors of `dims` elements.
+inline float SquaredL2Distance(const float *a, const float *b, int dims) {
+  float sum = 0.0f;
+  for (int d = 0; d < dims; ++d) {
+    const float diff = a[d] - b[d];
+    sum += diff * diff;
+  }
+  return sum;
+}
+
+// Best match of a frame descriptor within one of the queried boxes.
+struct DescriptorMatch {
+  int query_idx;
+  int box_slot;
+  int feature_idx;
+  float distance;
+};
+
 }  // namespace
 
 // Using OpenCV brute force matcher along with cross validate match to conduct
@@ -92,10 +114,57 @@ class BoxDetectorOpencvBfImpl : public BoxDetectorInterface {
   cv::BFMatcher bf_matcher_;
 };
 
+// Approximate nearest neighbor search over the descriptors of all boxes via
+// an inverted file index: indexed descriptors are clustered via k-means and
+// each frame descriptor is only compared against the members of its closest
+// clusters (see BoxDetectorOptions::InvertedFileSettings). All boxes are
+// matched in a single pass over the frame descriptors.
+// Instead of an exact cross check, only the closest frame descriptor is kept
+// for each indexed descriptor.
+class BoxDetectorInvertedFileImpl : public BoxDetectorInterface {
+ public:
+  explicit BoxDetectorInvertedFileImpl(const BoxDetectorOptions &options);
+
+ private:
+  // Location of an indexed descriptor in feature_descriptors_.
+  struct IndexEntry {
+    int box_idx;
+    int feature_idx;
+  };
+
+  std::vector<FeatureCorrespondence> MatchFeatureDescriptors(
+      const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+      int box_idx) override;
+
+  std::vector<std::vector<FeatureCorrespondence>>
+  MatchFeatureDescriptorsForBoxes(const std::vector<Vector2_f> &features,
+                                  const cv::Mat &descriptors,
+                                  const std::vector<int> &box_indices) override;
+
+  void OnFeaturesAddedToIndex(int box_idx, int begin, int end) override;
+  void OnBoxRemovedFromIndex(int box_idx) override;
+
+  // Returns indices of the `num_clusters` clusters closest to `descriptor`.
+  void ClosestClusters(const float *descriptor, int num_clusters,
+                       std::vector<int> *cluster_indices) const;
+
+  // Re-clusters all indexed descriptors.
+  void BuildClusters();
+
+  // Cluster centers, one per row. Empty until the index is large enough,
+  // in which case clusters_ holds a single cluster searched exhaustively.
+  cv::Mat centers_;
+  std::vector<std::vector<IndexEntry>> clusters_;
+  int num_indexed_ = 0;
+  int num_indexed_at_clustering_ = 0;
+};
+
 std::unique_ptr<BoxDetectorInterface> BoxDetectorInterface::Create(
     const BoxDetectorOptions &options) {
   if (options.index_type() == BoxDetectorOptions::OPENCV_BF) {
     return absl::make_unique<BoxDetectorOpencvBfImpl>(options);
+  } else if (options.index_type() == BoxDetectorOptions::INVERTED_FILE) {
+    return absl::make_unique<BoxDetectorInvertedFileImpl>(options);
   } else {
     LOG(FATAL) << "index type undefined.";
   }
@@ -153,21 +222,28 @@ void BoxDetectorInterface::DetectAndAddBoxFromFeatures(
     }
   }
 
+  std::vector<int> boxes_to_detect;
   for (int idx = 0; idx < size_before_add; ++idx) {
     if ((options_.has_detect_every_n_frame() > 0 &&
          cnt_detect_called_ % options_.detect_every_n_frame() == 0) ||
         !tracked[idx] ||
         (options_.detect_out_of_fov() && has_been_out_of_fov_[idx])) {
-      TimedBoxProtoList det = DetectBox(features, descriptors, idx);
-      if (det.box_size() > 0) {
-        det.mutable_box(0)->set_time_msec(timestamp_msec);
+      boxes_to_detect.push_back(idx);
+    }
+  }
 
-        // Convert the result box to normalized space.
-        ScaleBox(1.0f / scale_x, 1.0f / scale_y, det.mutable_box(0));
-        *detected_boxes->add_box() = det.box(0);
+  std::vector<TimedBoxProtoList> detections =
+      DetectBoxes(features, descriptors, boxes_to_detect);
+  for (int k = 0; k < boxes_to_detect.size(); ++k) {
+    TimedBoxProtoList &det = detections[k];
+    if (det.box_size() > 0) {
+      det.mutable_box(0)->set_time_msec(timestamp_msec);
 
-        has_been_out_of_fov_[idx] = false;
-      }
+      // Convert the result box to normalized space.
+      ScaleBox(1.0f / scale_x, 1.0f / scale_y, det.mutable_box(0));
+      *detected_boxes->add_box() = det.box(0);
+
+      has_been_out_of_fov_[boxes_to_detect[k]] = false;
     }
   }
 
@@ -324,6 +400,50 @@ TimedBoxProtoList BoxDetectorInterface::DetectBox(
       MatchFeatureDescriptors(features, descriptors, box_idx), box_idx);
 }
 
+std::vector<TimedBoxProtoList> BoxDetectorInterface::DetectBoxes(
+    const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+    const std::vector<int> &box_indices) {
+  const std::vector<std::vector<FeatureCorrespondence>> matches =
+      MatchFeatureDescriptorsForBoxes(features, descriptors, box_indices);
+  CHECK_EQ(box_indices.size(), matches.size());
+
+  // Boxes with too few correspondences return immediately, i.e. the cost is
+  // dominated by the candidates passing on to RANSAC.
+  std::vector<TimedBoxProtoList> detections(box_indices.size());
+  if (box_indices.empty()) {
+    return detections;
+  }
+  ParallelFor(0, box_indices.size(), 1,
+              [this, &matches, &box_indices,
+               &detections](const BlockedRange &range) {
+                for (int k = range.begin(); k < range.end(); ++k) {
+                  detections[k] = FindBoxesFromFeatureCorrespondence(
+                      matches[k], box_indices[k]);
+                }
+              });
+  return detections;
+}
+
+std::vector<std::vector<FeatureCorrespondence>>
+BoxDetectorInterface::MatchFeatureDescriptorsForBoxes(
+    const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+    const std::vector<int> &box_indices) {
+  std::vector<std::vector<FeatureCorrespondence>> correspondences(
+      box_indices.size());
+  if (box_indices.empty()) {
+    return correspondences;
+  }
+  ParallelFor(0, box_indices.size(), 1,
+              [this, &features, &descriptors, &box_indices,
+               &correspondences](const BlockedRange &range) {
+                for (int k = range.begin(); k < range.end(); ++k) {
+                  correspondences[k] = MatchFeatureDescriptors(
+                      features, descriptors, box_indices[k]);
+                }
+              });
+  return correspondences;
+}
+
 TimedBoxProtoList BoxDetectorInterface::FindBoxesFromFeatureCorrespondence(
     const std::vector<FeatureCorrespondence> &matches, int box_idx) {
   int max_corr = -1;
@@ -578,6 +698,7 @@ void BoxDetectorInterface::AddBoxFeaturesToIndex(
 
     cv::Mat box_descriptors =
         GetDescriptorsWithIndices(descriptors, insider_idx);
+    const int first_feature_idx = feature_descriptors_[box_idx].rows;
     if (feature_descriptors_[box_idx].rows == 0) {
       feature_descriptors_[box_idx] = box_descriptors;
     } else {
@@ -619,6 +740,9 @@ void BoxDetectorInterface::AddBoxFeaturesToIndex(
     for (int j = 0; j < insider_idx.size(); ++j) {
       feature_to_frame_[box_idx].push_back(frame_id);
     }
+
+    OnFeaturesAddedToIndex(box_idx, first_feature_idx,
+                           feature_descriptors_[box_idx].rows);
   }
 }
 
@@ -640,6 +764,7 @@ void BoxDetectorInterface::CancelBoxDetection(int box_id) {
     for (int j = erase_idx; j < box_idx_to_id_.size(); ++j) {
       box_id_to_idx_[box_idx_to_id_[j]] = j;
     }
+    OnBoxRemovedFromIndex(erase_idx);
   }
 }
 
@@ -746,4 +871,249 @@ BoxDetectorOpencvBfImpl::MatchFeatureDescriptors(
   return correspondence_result;
 }
 
+BoxDetectorInvertedFileImpl::BoxDetectorInvertedFileImpl(
+    const BoxDetectorOptions &options)
+    : BoxDetectorInterface(options) {}
+
+std::vector<FeatureCorrespondence>
+BoxDetectorInvertedFileImpl::MatchFeatureDescriptors(
+    const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+    int box_idx) {
+  return MatchFeatureDescriptorsForBoxes(features, descriptors, {box_idx})[0];
+}
+
+std::vector<std::vector<FeatureCorrespondence>>
+BoxDetectorInvertedFileImpl::MatchFeatureDescriptorsForBoxes(
+    const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+    const std::vector<int> &box_indices) {
+  CHECK_EQ(features.size(), descriptors.rows);
+
+  std::vector<std::vector<FeatureCorrespondence>> correspondences(
+      box_indices.size());
+  // Maps box index to its position in box_indices, -1 for boxes that are
+  // not queried.
+  std::vector<int> box_slots(frame_box_.size(), -1);
+  for (int k = 0; k < box_indices.size(); ++k) {
+    correspondences[k].resize(frame_box_[box_indices[k]].size());
+    box_slots[box_indices[k]] = k;
+  }
+  if (box_indices.empty() || features.empty() || descriptors.rows == 0 ||
+      descriptors.cols == 0 || clusters_.empty()) {
+    return correspondences;
+  }
+
+  // Index stores descriptors as float, see GetDescriptorsWithIndices.
+  cv::Mat query_descriptors;
+  if (descriptors.type() == CV_32F) {
+    query_descriptors = descriptors;
+  } else {
+    descriptors.convertTo(query_descriptors, CV_32F);
+  }
+  const int dims = query_descriptors.cols;
+  if (dims != feature_descriptors_[box_indices[0]].cols) {
+    LOG(ERROR) << "Descriptor dimensions don't match index: " << dims
+               << " vs " << feature_descriptors_[box_indices[0]].cols;
+    return correspondences;
+  }
+
+  const int num_probes =
+      centers_.empty()
+          ? 1
+          : std::min(options_.inverted_file_settings().num_probes(),
+                     centers_.rows);
+  const float max_distance = options_.max_match_distance();
+  const float max_squared_distance = max_distance * max_distance;
+
+  // Best match per queried box for each frame descriptor.
+  std::vector<std::vector<DescriptorMatch>> query_matches(
+      query_descriptors.rows);
+  constexpr int kQueryGrainSize = 32;
+  ParallelFor(
+      0, query_descriptors.rows, kQueryGrainSize,
+      [&](const BlockedRange &range) {
+        std::vector<float> best_distance(box_indices.size(),
+                                         std::numeric_limits<float>::max());
+        std::vector<int> best_feature(box_indices.size(), -1);
+        std::vector<int> matched_slots;
+        std::vector<int> probes;
+        for (int q = range.begin(); q < range.end(); ++q) {
+          const float *descriptor = query_descriptors.ptr<float>(q);
+          ClosestClusters(descriptor, num_probes, &probes);
+          for (int cluster_idx : probes) {
+            for (const IndexEntry &entry : clusters_[cluster_idx]) {
+              const int slot = box_slots[entry.box_idx];
+              if (slot < 0) {
+                continue;
+              }
+              const float distance = SquaredL2Distance(
+                  descriptor,
+                  feature_descriptors_[entry.box_idx].ptr<float>(
+                      entry.feature_idx),
+                  dims);
+              if (distance > max_squared_distance ||
+                  distance >= best_distance[slot]) {
+                continue;
+              }
+              if (best_feature[slot] < 0) {
+                matched_slots.push_back(slot);
+              }
+              best_distance[slot] = distance;
+              best_feature[slot] = entry.feature_idx;
+            }
+          }
+
+          for (int slot : matched_slots) {
+            query_matches[q].push_back(
+                {q, slot, best_feature[slot], best_distance[slot]});
+            best_distance[slot] = std::numeric_limits<float>::max();
+            best_feature[slot] = -1;
+          }
+          matched_slots.clear();
+        }
+      });
+
+  // Group matches by box and keep the closest frame descriptor per indexed
+  // descriptor.
+  std::vector<std::vector<DescriptorMatch>> box_matches(box_indices.size());
+  for (const auto &matches : query_matches) {
+    for (const DescriptorMatch &match : matches) {
+      box_matches[match.box_slot].push_back(match);
+    }
+  }
+
+  for (int k = 0; k < box_indices.size(); ++k) {
+    auto &matches = box_matches[k];
+    std::sort(matches.begin(), matches.end(),
+              [](const DescriptorMatch &lhs, const DescriptorMatch &rhs) {
+                if (lhs.feature_idx != rhs.feature_idx) {
+                  return lhs.feature_idx < rhs.feature_idx;
+                }
+                if (lhs.distance != rhs.distance) {
+                  return lhs.distance < rhs.distance;
+                }
+                return lhs.query_idx < rhs.query_idx;
+              });
+
+    const int box_idx = box_indices[k];
+    for (int j = 0; j < matches.size(); ++j) {
+      const DescriptorMatch &match = matches[j];
+      if (j > 0 && matches[j - 1].feature_idx == match.feature_idx) {
+        continue;
+      }
+      const int frame_idx = feature_to_frame_[box_idx][match.feature_idx];
+      const Vector2_f &index_point =
+          feature_keypoints_[box_idx][match.feature_idx];
+      correspondences[k][frame_idx].points_frame.push_back(
+          cv::Point2f(features[match.query_idx].x(),
+                      features[match.query_idx].y()));
+      correspondences[k][frame_idx].points_index.push_back(
+          cv::Point2f(index_point.x(), index_point.y()));
+    }
+  }
+
+  return correspondences;
+}
+
+void BoxDetectorInvertedFileImpl::ClosestClusters(
+    const float *descriptor, int num_clusters,
+    std::vector<int> *cluster_indices) const {
+  cluster_indices->clear();
+  if (centers_.empty()) {
+    cluster_indices->push_back(0);
+    return;
+  }
+
+  std::vector<std::pair<float, int>> distances(centers_.rows);
+  for (int c = 0; c < centers_.rows; ++c) {
+    distances[c] = std::make_pair(
+        SquaredL2Distance(descriptor, centers_.ptr<float>(c), centers_.cols),
+        c);
+  }
+  num_clusters = std::min<int>(num_clusters, distances.size());
+  std::partial_sort(distances.begin(), distances.begin() + num_clusters,
+                    distances.end());
+  for (int c = 0; c < num_clusters; ++c) {
+    cluster_indices->push_back(distances[c].second);
+  }
+}
+
+void BoxDetectorInvertedFileImpl::OnFeaturesAddedToIndex(int box_idx,
+                                                         int begin, int end) {
+  num_indexed_ += end - begin;
+
+  // Re-cluster each time the index doubles in size, i.e. amortized cost per
+  // added descriptor is constant.
+  const auto &settings = options_.inverted_file_settings();
+  if (num_indexed_ >= std::max(settings.min_descriptors_for_clustering(),
+                               2 * num_indexed_at_clustering_)) {
+    BuildClusters();
+    return;
+  }
+
+  if (clusters_.empty()) {
+    clusters_.resize(1);
+  }
+  std::vector<int> closest;
+  for (int j = begin; j < end; ++j) {
+    ClosestClusters(feature_descriptors_[box_idx].ptr<float>(j), 1, &closest);
+    clusters_[closest[0]].push_back({box_idx, j});
+  }
+}
+
+void BoxDetectorInvertedFileImpl::OnBoxRemovedFromIndex(int box_idx) {
+  for (auto &cluster : clusters_) {
+    int num_kept = 0;
+    for (int j = 0; j < cluster.size(); ++j) {
+      IndexEntry entry = cluster[j];
+      if (entry.box_idx == box_idx) {
+        continue;
+      }
+      if (entry.box_idx > box_idx) {
+        --entry.box_idx;
+      }
+      cluster[num_kept++] = entry;
+    }
+    num_indexed_ -= cluster.size() - num_kept;
+    cluster.resize(num_kept);
+  }
+}
+
+void BoxDetectorInvertedFileImpl::BuildClusters() {
+  MEASURE_TIME << "Cluster box detector index";
+
+  std::vector<IndexEntry> entries;
+  entries.reserve(num_indexed_);
+  std::vector<cv::Mat> descriptors;
+  for (int box_idx = 0; box_idx < feature_descriptors_.size(); ++box_idx) {
+    if (feature_descriptors_[box_idx].rows == 0) {
+      continue;
+    }
+    descriptors.push_back(feature_descriptors_[box_idx]);
+    for (int j = 0; j < feature_descriptors_[box_idx].rows; ++j) {
+      entries.push_back({box_idx, j});
+    }
+  }
+  CHECK_EQ(num_indexed_, entries.size());
+
+  cv::Mat all_descriptors;
+  cv::vconcat(descriptors, all_descriptors);
+
+  const int num_clusters = std::max(
+      1, std::min(options_.inverted_file_settings().max_num_clusters(),
+                  static_cast<int>(std::sqrt(num_indexed_))));
+  constexpr int kMaxIterations = 10;
+  constexpr double kEpsilon = 1e-3;
+  cv::Mat labels;
+  cv::kmeans(all_descriptors, num_clusters, labels,
+             cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+                              kMaxIterations, kEpsilon),
+             /*attempts=*/1, cv::KMEANS_PP_CENTERS, centers_);
+
+  clusters_.assign(num_clusters, {});
+  for (int j = 0; j < entries.size(); ++j) {
+    clusters_[labels.at<int>(j)].push_back(entries[j]);
+  }
+  num_indexed_at_clustering_ = num_indexed_;
+}
+
 }  // namespace mediapipe
@@ -15,6 +15,8 @@
 #ifndef MEDIAPIPE_UTIL_TRACKING_BOX_DETECTOR_H_
 #define MEDIAPIPE_UTIL_TRACKING_BOX_DETECTOR_H_
 
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
@@ -131,11 +133,35 @@ class BoxDetectorInterface {
   TimedBoxProtoList DetectBox(const std::vector<Vector2_f> &features,
                               const cv::Mat &descriptors, int box_idx);
 
+  // Same as above for multiple boxes at once. Returned list has the same
+  // size as `box_indices`. Boxes are matched and located in parallel, which
+  // is thread-safe as long as MatchFeatureDescriptorsForBoxes is.
+  std::vector<TimedBoxProtoList> DetectBoxes(
+      const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
+      const std::vector<int> &box_indices);
+
   // Only matches those features from the specific box with `box_idx`.
   virtual std::vector<FeatureCorrespondence> MatchFeatureDescriptors(
       const std::vector<Vector2_f> &features, const cv::Mat &descriptors,
       int box_idx) = 0;
 
+  // Returns the result of MatchFeatureDescriptors for each box in
+  // `box_indices`. Default implementation matches each box separately, in
+  // parallel. Index based implementations override this to match all boxes
+  // in a single pass.
+  virtual std::vector<std::vector<FeatureCorrespondence>>
+  MatchFeatureDescriptorsForBoxes(const std::vector<Vector2_f> &features,
+                                  const cv::Mat &descriptors,
+                                  const std::vector<int> &box_indices);
+
+  // Notifies implementations that rows [begin, end) of
+  // feature_descriptors_[box_idx] have been added to the index.
+  virtual void OnFeaturesAddedToIndex(int box_idx, int begin, int end) {}
+
+  // Notifies implementations that the box with `box_idx` has been removed
+  // from the index. Boxes with larger indices are shifted down by one.
+  virtual void OnBoxRemovedFromIndex(int box_idx) {}
+
   // Specifies which box the correspondences come from with `box_id`, so that we
   // can figure out the transformation accordingly.
   TimedBoxProtoList FindBoxesFromFeatureCorrespondence(
@@ -0,0 +1,154 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/box_detector.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/util/tracking/box_detector.pb.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kNumFeaturesPerBox = 80;
+constexpr int kDescriptorDims = 40;
+
+// Features and descriptors of a synthetic template, located within
+// [0.25, 0.75]^2 in normalized coordinates.
+struct Template {
+  std::vector<Vector2_f> features;
+  cv::Mat descriptors;
+};
+
+std::vector<Template> MakeTemplates(int num_templates) {
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> location(0.3f, 0.7f);
+  std::vector<Template> templates(num_templates);
+  for (auto& t : templates) {
+    for (int j = 0; j < kNumFeaturesPerBox; ++j) {
+      t.features.emplace_back(location(random), location(random));
+    }
+    t.descriptors.create(kNumFeaturesPerBox, kDescriptorDims, CV_32F);
+    cv::randu(t.descriptors, 0.0f, 1.0f);
+  }
+  return templates;
+}
+
+std::unique_ptr<BoxDetectorInterface> MakeDetector(
+    BoxDetectorOptions::IndexType index_type,
+    const std::vector<Template>& templates) {
+  BoxDetectorOptions options;
+  options.set_index_type(index_type);
+  options.set_descriptor_dims(kDescriptorDims);
+  // Enforce clustering for small indices.
+  options.mutable_inverted_file_settings()->set_min_descriptors_for_clustering(
+      4 * kNumFeaturesPerBox);
+  auto detector = BoxDetectorInterface::Create(options);
+
+  // Previously added boxes are reported as tracked, so only the new box is
+  // added and no detection is run.
+  TimedBoxProtoList boxes;
+  for (int id = 0; id < templates.size(); ++id) {
+    TimedBoxProto* box = boxes.add_box();
+    box->set_id(id);
+    box->set_reacquisition(true);
+    box->set_left(0.25f);
+    box->set_right(0.75f);
+    box->set_top(0.25f);
+    box->set_bottom(0.75f);
+    TimedBoxProtoList detected_boxes;
+    detector->DetectAndAddBoxFromFeatures(
+        templates[id].features, templates[id].descriptors, boxes, id,
+        /*scale_x=*/1.0f, /*scale_y=*/1.0f, &detected_boxes);
+  }
+  return detector;
+}
+
+// Detects template displaced by (dx, dy) with slightly perturbed descriptors.
+TimedBoxProtoList Detect(const Template& t, float dx, float dy,
+                         BoxDetectorInterface* detector) {
+  std::vector<Vector2_f> features;
+  for (const auto& feature : t.features) {
+    features.emplace_back(feature.x() + dx, feature.y() + dy);
+  }
+  cv::Mat noise(t.descriptors.size(), CV_32F);
+  cv::randu(noise, -0.01f, 0.01f);
+  TimedBoxProtoList detected_boxes;
+  detector->DetectAndAddBoxFromFeatures(features, t.descriptors + noise,
+                                        TimedBoxProtoList(), 1000, 1.0f, 1.0f,
+                                        &detected_boxes);
+  return detected_boxes;
+}
+
+class BoxDetectorTest
+    : public ::testing::TestWithParam<BoxDetectorOptions::IndexType> {};
+
+TEST_P(BoxDetectorTest, DetectsDisplacedTemplate) {
+  const std::vector<Template> templates = MakeTemplates(40);
+  auto detector = MakeDetector(GetParam(), templates);
+
+  const TimedBoxProtoList detected =
+      Detect(templates[7], 0.05f, 0.03f, detector.get());
+  ASSERT_EQ(1, detected.box_size());
+  EXPECT_EQ(7, detected.box(0).id());
+  EXPECT_NEAR(0.30f, detected.box(0).left(), 0.01f);
+  EXPECT_NEAR(0.80f, detected.box(0).right(), 0.01f);
+  EXPECT_NEAR(0.28f, detected.box(0).top(), 0.01f);
+  EXPECT_NEAR(0.78f, detected.box(0).bottom(), 0.01f);
+}
+
+TEST_P(BoxDetectorTest, CancelledBoxIsNotDetected) {
+  const std::vector<Template> templates = MakeTemplates(40);
+  auto detector = MakeDetector(GetParam(), templates);
+
+  detector->CancelBoxDetection(7);
+  EXPECT_EQ(0, Detect(templates[7], 0.0f, 0.0f, detector.get()).box_size());
+
+  // Boxes after the cancelled one are still found under their id.
+  const TimedBoxProtoList detected =
+      Detect(templates[20], 0.0f, 0.0f, detector.get());
+  ASSERT_EQ(1, detected.box_size());
+  EXPECT_EQ(20, detected.box(0).id());
+}
+
+INSTANTIATE_TEST_SUITE_P(IndexTypes, BoxDetectorTest,
+                         ::testing::Values(BoxDetectorOptions::OPENCV_BF,
+                                           BoxDetectorOptions::INVERTED_FILE));
+
+void BM_DetectBoxes(benchmark::State& state,
+                    BoxDetectorOptions::IndexType index_type) {
+  const std::vector<Template> templates = MakeTemplates(state.range(0));
+  auto detector = MakeDetector(index_type, templates);
+  for (auto _ : state) {
+    Detect(templates[0], 0.01f, 0.01f, detector.get());
+  }
+}
+
+void BM_DetectBoxesBruteForce(benchmark::State& state) {
+  BM_DetectBoxes(state, BoxDetectorOptions::OPENCV_BF);
+}
+BENCHMARK(BM_DetectBoxesBruteForce)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_DetectBoxesInvertedFile(benchmark::State& state) {
+  BM_DetectBoxes(state, BoxDetectorOptions::INVERTED_FILE);
+}
+BENCHMARK(BM_DetectBoxesInvertedFile)->Arg(10)->Arg(100)->Arg(1000);
+
+}  // namespace
+}  // namespace mediapipe
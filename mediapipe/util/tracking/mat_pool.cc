@@ -0,0 +1,280 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/mat_pool.h"
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <unordered_map>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+#if CV_MAJOR_VERSION >= 4
+typedef cv::AccessFlag AccessFlag;
+#else
+typedef int AccessFlag;
+#endif
+
+// Requests up to this size are rounded to multiples of kMinBucketSize.
+constexpr size_t kMinBucketSize = 64;
+constexpr size_t kSmallBucketLimit = 1024;
+// Number of size classes per power of two for larger requests, i.e. at most
+// 1 / kBucketsPerOctave of a buffer is wasted.
+constexpr size_t kBucketsPerOctave = 4;
+
+}  // namespace.
+
+// Serves cv::Mat allocations from free lists indexed by bucket size.
+// The allocator is reference counted by its outstanding buffers: Once the
+// owning MatPool is destroyed (orphaned), the allocator deletes itself when
+// the last buffer is released.
+class MatPool::Allocator
+#if CV_MAJOR_VERSION >= 3
+    : public cv::MatAllocator
+#endif
+{
+ public:
+  explicit Allocator(int64 max_pooled_bytes)
+      : max_pooled_bytes_(max_pooled_bytes) {}
+
+  ~Allocator() { Trim(); }
+
+  Stats GetStats() const {
+    absl::MutexLock lock(&mutex_);
+    return stats_;
+  }
+
+  void Trim() {
+    absl::MutexLock lock(&mutex_);
+    for (const FreeBuffer& free_buffer : free_buffers_) {
+      cv::fastFree(free_buffer.buffer);
+      stats_.bytes_pooled -= free_buffer.bucket_size;
+    }
+    free_buffers_.clear();
+    free_lists_.clear();
+    DCHECK_EQ(0, stats_.bytes_pooled);
+  }
+
+  // Called by the owning MatPool upon destruction.
+  void Orphan() {
+    Trim();
+    bool delete_now;
+    {
+      absl::MutexLock lock(&mutex_);
+      orphaned_ = true;
+      delete_now = num_outstanding_ == 0;
+    }
+    if (delete_now) {
+      delete this;
+    }
+  }
+
+#if CV_MAJOR_VERSION >= 3
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data,
+                         size_t* step, AccessFlag /*flags*/,
+                         cv::UMatUsageFlags /*usage_flags*/) const override {
+    // Same step computation as OpenCV's default allocator.
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; --i) {
+      if (step != nullptr) {
+        if (data != nullptr && step[i] != CV_AUTOSTEP) {
+          total = step[i];
+        } else {
+          step[i] = total;
+        }
+      }
+      total *= sizes[i];
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->size = total;
+    if (data != nullptr) {
+      u->data = u->origdata = static_cast<uchar*>(data);
+      u->flags |= cv::UMatData::USER_ALLOCATED;
+      absl::MutexLock lock(&mutex_);
+      ++num_outstanding_;
+    } else {
+      u->data = u->origdata = Acquire(BucketSize(total));
+    }
+    return u;
+  }
+
+  bool allocate(cv::UMatData* u, AccessFlag /*access_flags*/,
+                cv::UMatUsageFlags /*usage_flags*/) const override {
+    return u != nullptr;
+  }
+
+  void deallocate(cv::UMatData* u) const override {
+    if (u == nullptr) {
+      return;
+    }
+    CHECK_EQ(0, u->urefcount);
+    CHECK_EQ(0, u->refcount);
+    bool delete_allocator;
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+      delete_allocator = Release(u->origdata, BucketSize(u->size));
+      u->origdata = nullptr;
+    } else {
+      absl::MutexLock lock(&mutex_);
+      delete_allocator = --num_outstanding_ == 0 && orphaned_;
+    }
+    delete u;
+
+    if (delete_allocator) {
+      delete const_cast<Allocator*>(this);
+    }
+  }
+#endif  // CV_MAJOR_VERSION >= 3
+
+ private:
+  uchar* Acquire(size_t bucket_size) const {
+    absl::MutexLock lock(&mutex_);
+    ++num_outstanding_;
+    stats_.bytes_in_use += bucket_size;
+    auto& free_list = free_lists_[bucket_size];
+    if (!free_list.empty()) {
+      // Most recently released first, as it is most likely cached.
+      const auto free_buffer = free_list.back();
+      uchar* buffer = free_buffer->buffer;
+      free_list.pop_back();
+      free_buffers_.erase(free_buffer);
+      stats_.bytes_pooled -= bucket_size;
+      ++stats_.num_reuses;
+      return buffer;
+    }
+
+    ++stats_.num_allocations;
+    stats_.peak_bytes = std::max(stats_.peak_bytes,
+                                 stats_.bytes_in_use + stats_.bytes_pooled);
+    return static_cast<uchar*>(cv::fastMalloc(bucket_size));
+  }
+
+  // Returns true if allocator is orphaned and this was the last outstanding
+  // buffer.
+  bool Release(uchar* buffer, size_t bucket_size) const {
+    absl::MutexLock lock(&mutex_);
+    stats_.bytes_in_use -= bucket_size;
+    if (orphaned_) {
+      cv::fastFree(buffer);
+    } else {
+      free_buffers_.push_back({buffer, bucket_size});
+      free_lists_[bucket_size].push_back(std::prev(free_buffers_.end()));
+      stats_.bytes_pooled += bucket_size;
+      // Evict the least recently released buffers, which are the oldest of
+      // their free lists.
+      while (max_pooled_bytes_ > 0 &&
+             stats_.bytes_pooled > max_pooled_bytes_) {
+        const FreeBuffer& oldest = free_buffers_.front();
+        auto& free_list = free_lists_[oldest.bucket_size];
+        DCHECK(free_list.front() == free_buffers_.begin());
+        free_list.pop_front();
+        cv::fastFree(oldest.buffer);
+        stats_.bytes_pooled -= oldest.bucket_size;
+        ++stats_.num_evictions;
+        free_buffers_.pop_front();
+      }
+    }
+    return --num_outstanding_ == 0 && orphaned_;
+  }
+
+  struct FreeBuffer {
+    uchar* buffer;
+    size_t bucket_size;
+  };
+
+  const int64 max_pooled_bytes_;
+
+  mutable absl::Mutex mutex_;
+  // Unused buffers, least recently released first.
+  mutable std::list<FreeBuffer> free_buffers_ ABSL_GUARDED_BY(mutex_);
+  // Entries of free_buffers_ by bucket size, least recently released first.
+  mutable std::unordered_map<size_t,
+                             std::deque<std::list<FreeBuffer>::iterator>>
+      free_lists_ ABSL_GUARDED_BY(mutex_);
+  mutable Stats stats_ ABSL_GUARDED_BY(mutex_);
+  mutable int64 num_outstanding_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool orphaned_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+std::string MatPool::Stats::ToString() const {
+  return absl::StrCat("allocations: ", num_allocations,
+                      " reuses: ", num_reuses, " evictions: ", num_evictions,
+                      " in use: ", bytes_in_use, " pooled: ", bytes_pooled,
+                      " peak: ", peak_bytes);
+}
+
+MatPool::MatPool(int64 max_pooled_bytes)
+    : allocator_(new Allocator(max_pooled_bytes)) {}
+
+MatPool::~MatPool() { allocator_->Orphan(); }
+
+MatPool* MatPool::Default() {
+  static MatPool* pool = new MatPool(kDefaultMaxPooledBytes);
+  return pool;
+}
+
+void MatPool::Create(int rows, int cols, int type, cv::Mat* mat) {
+  CHECK(mat != nullptr);
+  type = CV_MAT_TYPE(type);
+  if (mat->rows == rows && mat->cols == cols && mat->type() == type &&
+      mat->data != nullptr) {
+    return;
+  }
+  mat->release();
+  Attach(mat);
+  mat->create(rows, cols, type);
+}
+
+cv::Mat MatPool::Allocate(int rows, int cols, int type) {
+  cv::Mat mat;
+  Create(rows, cols, type, &mat);
+  return mat;
+}
+
+void MatPool::Attach(cv::Mat* mat) {
+  CHECK(mat != nullptr);
+#if CV_MAJOR_VERSION >= 3
+  mat->allocator = allocator_;
+#endif
+}
+
+MatPool::Stats MatPool::GetStats() const { return allocator_->GetStats(); }
+
+void MatPool::Trim() { allocator_->Trim(); }
+
+size_t MatPool::BucketSize(size_t num_bytes) {
+  if (num_bytes <= kSmallBucketLimit) {
+    return std::max<size_t>(
+        kMinBucketSize,
+        (num_bytes + kMinBucketSize - 1) / kMinBucketSize * kMinBucketSize);
+  }
+
+  // Round up to the next multiple of octave / kBucketsPerOctave, where
+  // octave is the largest power of two <= num_bytes.
+  size_t octave = kSmallBucketLimit;
+  while (octave * 2 <= num_bytes) {
+    octave *= 2;
+  }
+  const size_t step = octave / kBucketsPerOctave;
+  return (num_bytes + step - 1) / step * step;
+}
+
+}  // namespace mediapipe
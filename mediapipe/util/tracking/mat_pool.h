@@ -0,0 +1,112 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Size-bucketed pool of cv::Mat buffers shared by tracking components
+// (RegionFlowComputation, MotionAnalysis). Buffers are handed out via a
+// custom cv::MatAllocator and are returned to the pool automatically once the
+// last cv::Mat referencing them is released, i.e. pooled cv::Mat's can be
+// copied, shared and stored like any other cv::Mat.
+//
+// Usage example:
+// MatPool pool(64 << 20);   // Retain at most 64 MB of unused buffers.
+// cv::Mat image;
+// pool.Create(height, width, CV_8UC1, &image);
+// ...
+// MatPool::Stats stats = pool.GetStats();
+//
+// Pools are thread-safe. Buffers may outlive the pool they were allocated
+// from, in which case they are freed on release.
+// Pooling requires OpenCV 3.0 or later, with older versions Create falls back
+// to cv::Mat::create.
+
+#ifndef MEDIAPIPE_UTIL_TRACKING_MAT_POOL_H_
+#define MEDIAPIPE_UTIL_TRACKING_MAT_POOL_H_
+
+#include <cstddef>
+#include <string>
+
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+
+namespace mediapipe {
+
+class MatPool {
+ public:
+  struct Stats {
+    // Number of buffers allocated from the system.
+    int64 num_allocations = 0;
+    // Number of requests served from previously released buffers.
+    int64 num_reuses = 0;
+    // Number of released buffers freed because of the budget.
+    int64 num_evictions = 0;
+    // Bytes referenced by cv::Mat's allocated from this pool.
+    int64 bytes_in_use = 0;
+    // Bytes held in free lists, awaiting reuse.
+    int64 bytes_pooled = 0;
+    // Maximum of bytes_in_use + bytes_pooled observed so far.
+    int64 peak_bytes = 0;
+
+    std::string ToString() const;
+  };
+
+  // Budget of the Default() pool.
+  static constexpr int64 kDefaultMaxPooledBytes = 64 << 20;
+
+  // Unused buffers are retained up to max_pooled_bytes (pass zero for no
+  // limit). Beyond that, the least recently released buffers are freed, so
+  // that buffers of sizes no longer in use, e.g. after a change of
+  // resolution, make room for current ones.
+  explicit MatPool(int64 max_pooled_bytes = 0);
+  ~MatPool();
+  MatPool(const MatPool&) = delete;
+  MatPool& operator=(const MatPool&) = delete;
+
+  // Returns process wide pool, used by tracking components if no explicit
+  // pool is specified. It is never destroyed, so it retains at most
+  // kDefaultMaxPooledBytes of unused buffers: enough for the working set of a
+  // few RegionFlowComputation / MotionAnalysis instances at VGA resolution,
+  // while bounding what long running processes keep after their last use.
+  // Pass an explicit pool to use another budget.
+  static MatPool* Default();
+
+  // Same semantics as mat->create(rows, cols, type): if mat is already of
+  // the requested size and type, this is a no-op. Otherwise mat is released
+  // and re-allocated from the pool. Any later re-allocation of mat (e.g.
+  // when passed as output to OpenCV functions) also draws from the pool.
+  void Create(int rows, int cols, int type, cv::Mat* mat);
+
+  // Convenience function returning a newly created cv::Mat.
+  cv::Mat Allocate(int rows, int cols, int type);
+
+  // Assigns the pool's allocator to mat without allocating. Use for cv::Mat's
+  // that are allocated implicitly by OpenCV functions.
+  void Attach(cv::Mat* mat);
+
+  Stats GetStats() const;
+
+  // Frees all currently unused buffers.
+  void Trim();
+
+  // Size class a request of num_bytes is served from. Exposed for testing.
+  static size_t BucketSize(size_t num_bytes);
+
+ private:
+  class Allocator;
+  // Owned, but destroyed after the last pooled buffer has been released.
+  Allocator* allocator_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_TRACKING_MAT_POOL_H_
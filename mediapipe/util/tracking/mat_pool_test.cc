@@ -0,0 +1,160 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/mat_pool.h"
+
+#include <memory>
+
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/util/tracking/region_flow_computation.h"
+#include "mediapipe/util/tracking/region_flow_computation.pb.h"
+
+namespace mediapipe {
+namespace {
+
+#if CV_MAJOR_VERSION >= 3
+
+TEST(MatPoolTest, ReusesReleasedBuffers) {
+  MatPool pool;
+  {
+    cv::Mat mat = pool.Allocate(480, 640, CV_8UC3);
+    EXPECT_EQ(480, mat.rows);
+    EXPECT_EQ(640, mat.cols);
+    EXPECT_EQ(CV_8UC3, mat.type());
+    // Copies share the buffer.
+    cv::Mat copy = mat;
+    EXPECT_EQ(1, pool.GetStats().num_allocations);
+  }
+  EXPECT_EQ(0, pool.GetStats().bytes_in_use);
+  EXPECT_GT(pool.GetStats().bytes_pooled, 0);
+
+  // Same size class, different shape.
+  cv::Mat mat = pool.Allocate(640, 480, CV_8UC3);
+  const MatPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(1, stats.num_allocations);
+  EXPECT_EQ(1, stats.num_reuses);
+  EXPECT_EQ(0, stats.bytes_pooled);
+}
+
+TEST(MatPoolTest, CreateIsNoOpForMatchingSize) {
+  MatPool pool;
+  cv::Mat mat;
+  pool.Create(10, 20, CV_32F, &mat);
+  const uchar* data = mat.data;
+  pool.Create(10, 20, CV_32F, &mat);
+  EXPECT_EQ(data, mat.data);
+  EXPECT_EQ(1, pool.GetStats().num_allocations);
+
+  // Implicit re-allocation by OpenCV functions draws from the pool.
+  cv::Mat src(30, 40, CV_8U, cv::Scalar(1));
+  src.convertTo(mat, CV_32F);
+  EXPECT_EQ(2, pool.GetStats().num_allocations);
+}
+
+TEST(MatPoolTest, RespectsBudget) {
+  const int64 budget = MatPool::BucketSize(100 * 100);
+  MatPool pool(budget);
+  {
+    cv::Mat mat_1 = pool.Allocate(100, 100, CV_8U);
+    cv::Mat mat_2 = pool.Allocate(100, 100, CV_8U);
+  }
+  const MatPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(1, stats.num_evictions);
+  EXPECT_EQ(budget, stats.bytes_pooled);
+
+  pool.Trim();
+  EXPECT_EQ(0, pool.GetStats().bytes_pooled);
+}
+
+// After a change of size, buffers of the old size are evicted to make room
+// for the new ones.
+TEST(MatPoolTest, EvictsLeastRecentlyReleasedBuffers) {
+  const int64 large_size = MatPool::BucketSize(200 * 200);
+  MatPool pool(large_size);
+  pool.Allocate(100, 100, CV_8U);
+  pool.Allocate(200, 200, CV_8U);
+  MatPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(1, stats.num_evictions);
+  EXPECT_EQ(large_size, stats.bytes_pooled);
+
+  cv::Mat mat = pool.Allocate(200, 200, CV_8U);
+  stats = pool.GetStats();
+  EXPECT_EQ(1, stats.num_reuses);
+  EXPECT_EQ(0, stats.bytes_pooled);
+}
+
+TEST(MatPoolTest, BuffersOutlivePool) {
+  cv::Mat mat;
+  {
+    MatPool pool;
+    mat = pool.Allocate(16, 16, CV_8UC4);
+  }
+  mat.setTo(cv::Scalar(1, 2, 3, 4));
+  mat.release();
+}
+
+TEST(MatPoolTest, BucketSizes) {
+  EXPECT_EQ(64, MatPool::BucketSize(1));
+  EXPECT_EQ(256, MatPool::BucketSize(225));
+  EXPECT_EQ(1024, MatPool::BucketSize(1024));
+  EXPECT_EQ(1280, MatPool::BucketSize(1025));
+  // 640 x 480 and 480 x 640 share a bucket, and are within 25% of request.
+  EXPECT_GE(MatPool::BucketSize(640 * 480), 640 * 480);
+  EXPECT_LE(MatPool::BucketSize(640 * 480), 640 * 480 * 5 / 4);
+}
+
+// Only buffers drawn from the pool are counted: once warmed up, every cv::Mat
+// buffer of the computation is a pool hit. Other heap allocations, e.g. of
+// feature lists, are not measured.
+TEST(MatPoolTest, RegionFlowComputationSteadyStateReusesPooledBuffers) {
+  const int width = 320;
+  const int height = 240;
+  cv::Mat texture(height + 20, width + 20, CV_8UC3);
+  cv::randu(texture, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::GaussianBlur(texture, texture, cv::Size(5, 5), 1.5);
+
+  MatPool pool;
+  RegionFlowComputationOptions options;
+  RegionFlowComputation flow_computation(options, width, height, &pool);
+
+  auto add_frame = [&](int f) {
+    const int offset = f % 10;
+    cv::Mat frame = texture(cv::Rect(offset, offset, width, height)).clone();
+    ASSERT_TRUE(flow_computation.AddImage(frame, f));
+    std::unique_ptr<RegionFlowFeatureList> features(
+        flow_computation.RetrieveRegionFlowFeatureList(false, false, nullptr,
+                                                       nullptr));
+  };
+
+  // Warm up, until internal frame queue is filled.
+  for (int f = 0; f < 5; ++f) {
+    add_frame(f);
+  }
+  const MatPool::Stats warm_stats = pool.GetStats();
+  EXPECT_GT(warm_stats.num_allocations, 0);
+
+  for (int f = 5; f < 25; ++f) {
+    add_frame(f);
+  }
+  const MatPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(warm_stats.num_allocations, stats.num_allocations);
+  EXPECT_EQ(warm_stats.peak_bytes, stats.peak_bytes);
+}
+
+#endif  // CV_MAJOR_VERSION >= 3
+
+}  // namespace
+}  // namespace mediapipe
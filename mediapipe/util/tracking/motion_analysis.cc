@@ -39,16 +39,22 @@ namespace mediapipe {
 
 MotionAnalysis::MotionAnalysis(const MotionAnalysisOptions& options,
                                int frame_width, int frame_height)
+    : MotionAnalysis(options, frame_width, frame_height, nullptr) {}
+
+MotionAnalysis::MotionAnalysis(const MotionAnalysisOptions& options,
+                               int frame_width, int frame_height,
+                               MatPool* mat_pool)
     : options_(options),
       frame_width_(frame_width),
-      frame_height_(frame_height) {
+      frame_height_(frame_height),
+      mat_pool_(mat_pool != nullptr ? mat_pool : MatPool::Default()) {
   // Init options by policy.
   InitPolicyOptions();
   // Merge back in any overriden options.
   options_.MergeFrom(options);
 
   region_flow_computation_.reset(new RegionFlowComputation(
-      options_.flow_options(), frame_width_, frame_height_));
+      options_.flow_options(), frame_width_, frame_height_, mat_pool_));
   motion_estimation_.reset(new MotionEstimation(options_.motion_options(),
                                                 frame_width_, frame_height_));
 
@@ -71,6 +77,13 @@ MotionAnalysis::MotionAnalysis(const MotionAnalysisOptions& options,
     }
   }
 
+  if (options_.motion_options().streaming_options().activated()) {
+    // Saliency filtering requires overlapping clips, which defeats low latency
+    // output.
+    CHECK(!options_.compute_motion_saliency())
+        << "Streaming motion estimation does not support motion saliency.";
+  }
+
   long_feature_stream_.reset(new LongFeatureStream);
 
   frame_num_ = 0;
@@ -95,7 +108,8 @@ MotionAnalysis::MotionAnalysis(const MotionAnalysisOptions& options,
     CHECK_EQ(RegionFlowComputationOptions::FORMAT_RGB,
              options_.flow_options().image_format())
         << "Feature descriptors only support RGB currently.";
-    prev_frame_.reset(new cv::Mat(frame_height_, frame_width_, CV_8UC3));
+    prev_frame_.reset(new cv::Mat(
+        mat_pool_->Allocate(frame_height_, frame_width_, CV_8UC3)));
   }
 
   // Setup streaming buffer. By default we buffer features and motion.
@@ -477,6 +491,12 @@ int MotionAnalysis::GetResults(
     std::vector<std::unique_ptr<SalientPointFrame>>* saliency) {
   MEASURE_TIME << "GetResults";
 
+  if (options_.motion_options().streaming_options().activated()) {
+    CHECK(saliency == nullptr)
+        << "Streaming motion estimation does not support motion saliency.";
+    return GetResultsStreaming(flush, features, camera_motion);
+  }
+
   const int num_features_lists = buffer_->BufferSize("features");
   const int num_new_feature_lists = num_features_lists - overlap_start_;
   CHECK_GE(num_new_feature_lists, 0);
@@ -523,6 +543,115 @@ int MotionAnalysis::GetResults(
   return OutputResults(flush, features, camera_motion, saliency);
 }
 
+int MotionAnalysis::GetResultsStreaming(
+    bool flush, std::vector<std::unique_ptr<RegionFlowFeatureList>>* features,
+    std::vector<std::unique_ptr<CameraMotion>>* camera_motion) {
+  const auto& streaming_options =
+      options_.motion_options().streaming_options();
+
+  // Estimate motions for newly buffered RegionFlowFeatureLists, once enough
+  // frames are available. Irls smoothing is deferred to output time.
+  const int num_feature_lists = buffer_->BufferSize("features");
+  const int num_new_feature_lists =
+      num_feature_lists - buffer_->BufferSize("motion");
+  CHECK_GE(num_new_feature_lists, 0);
+
+  if (num_new_feature_lists > 0 &&
+      (flush ||
+       num_new_feature_lists >= streaming_options.estimation_batch_size())) {
+    std::vector<CameraMotion> camera_motions;
+    std::vector<RegionFlowFeatureList*> feature_lists;
+    for (int k = num_feature_lists - num_new_feature_lists;
+         k < num_feature_lists; ++k) {
+      feature_lists.push_back(
+          buffer_->GetMutableDatum<RegionFlowFeatureList>("features", k));
+    }
+
+    motion_estimation_->EstimateMotionsParallel(
+        false,  // Smoothing is performed per frame below.
+        &feature_lists, &camera_motions);
+
+    for (const auto& motion : camera_motions) {
+      buffer_->EmplaceDatum("motion", new CameraMotion(motion));
+    }
+  }
+
+  // Frames within [num_history_frames_, num_motions) have estimated motions
+  // but have not been output yet. A frame is output once lookahead_frames
+  // successors with estimated motions are present.
+  const int num_motions = buffer_->BufferSize("motion");
+  const int lookahead = std::max(0, streaming_options.lookahead_frames());
+  int end_frame = num_history_frames_;
+  for (; end_frame < num_motions &&
+         (flush || end_frame + lookahead < num_motions);
+       ++end_frame) {
+    if (!options_.post_irls_smoothing()) {
+      continue;
+    }
+
+    const int window_end = std::min(num_motions, end_frame + lookahead + 1);
+    std::vector<CameraMotion> window_motions;
+    std::vector<RegionFlowFeatureList*> window_features;
+    for (int k = end_frame; k < window_end; ++k) {
+      window_motions.push_back(*buffer_->GetDatum<CameraMotion>("motion", k));
+      window_features.push_back(
+          buffer_->GetMutableDatum<RegionFlowFeatureList>("features", k));
+    }
+
+    const RegionFlowFeatureList* prev_features =
+        end_frame > 0 ? buffer_->GetDatum<RegionFlowFeatureList>(
+                            "features", end_frame - 1)
+                      : nullptr;
+    motion_estimation_->SlidingWindowIRLSSmoothing(
+        prev_features, window_motions, &window_features);
+  }
+
+  const int num_output_frames = end_frame - num_history_frames_;
+  // A flush still has to drop the history frame, even without new output.
+  if (num_output_frames == 0 && !flush) {
+    return 0;
+  }
+
+  if (features) {
+    features->reserve(num_output_frames);
+  }
+  if (camera_motion) {
+    camera_motion->reserve(num_output_frames);
+  }
+
+  for (int k = num_history_frames_; k < end_frame; ++k) {
+    std::unique_ptr<RegionFlowFeatureList> out_features;
+    std::unique_ptr<CameraMotion> out_motion;
+    if (!flush && k + 1 == end_frame) {
+      // Last output frame is retained as history for the next window.
+      out_features.reset(new RegionFlowFeatureList(
+          *buffer_->GetDatum<RegionFlowFeatureList>("features", k)));
+      out_motion.reset(
+          new CameraMotion(*buffer_->GetDatum<CameraMotion>("motion", k)));
+    } else {
+      out_features =
+          buffer_->ReleaseDatum<RegionFlowFeatureList>("features", k);
+      out_motion = buffer_->ReleaseDatum<CameraMotion>("motion", k);
+    }
+
+    if (options_.subtract_camera_motion_from_features()) {
+      std::vector<RegionFlowFeatureList*> feature_view{out_features.get()};
+      SubtractCameraMotionFromFeatures({*out_motion}, &feature_view);
+    }
+
+    if (features != nullptr) {
+      features->push_back(std::move(out_features));
+    }
+    if (camera_motion != nullptr) {
+      camera_motion->push_back(std::move(out_motion));
+    }
+  }
+
+  num_history_frames_ = flush ? 0 : 1;
+  buffer_->DiscardData(buffer_->AllTags(), end_frame - num_history_frames_);
+  return num_output_frames;
+}
+
 int MotionAnalysis::OutputResults(
     bool flush, std::vector<std::unique_ptr<RegionFlowFeatureList>>* features,
     std::vector<std::unique_ptr<CameraMotion>>* camera_motion,
@@ -703,7 +832,8 @@ void MotionAnalysis::ComputeDenseForeground(
         foreground_push_pull_->filter_type() ==
             PushPullFilteringC1::GAUSSIAN_5X5);
 
-  cv::Mat foreground_map(frame_height_ + 4, frame_width_ + 4, CV_32FC2);
+  cv::Mat foreground_map =
+      mat_pool_->Allocate(frame_height_ + 4, frame_width_ + 4, CV_32FC2);
   std::vector<Vector2_f> feature_locations;
   std::vector<cv::Vec<float, 1>> feature_irls;
 
@@ -60,6 +60,7 @@
 
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/util/tracking/camera_motion.pb.h"
+#include "mediapipe/util/tracking/mat_pool.h"
 #include "mediapipe/util/tracking/motion_analysis.pb.h"
 #include "mediapipe/util/tracking/motion_estimation.h"
 #include "mediapipe/util/tracking/motion_estimation.pb.h"
@@ -78,6 +79,10 @@ class MotionAnalysis {
  public:
   MotionAnalysis(const MotionAnalysisOptions& options, int frame_width,
                  int frame_height);
+  // Same as above, drawing image buffers from the specified mat_pool (not
+  // owned, must outlive this object). If nullptr, MatPool::Default() is used.
+  MotionAnalysis(const MotionAnalysisOptions& options, int frame_width,
+                 int frame_height, MatPool* mat_pool);
   ~MotionAnalysis() = default;
   MotionAnalysis(const MotionAnalysis&) = delete;
   MotionAnalysis& operator=(const MotionAnalysis&) = delete;
@@ -133,6 +138,8 @@ class MotionAnalysis {
   // settings for saliency and features.
   // Set flush to true, to force output of all results (e.g. when the end of the
   // video stream is reached).
+  // If MotionEstimationOptions::streaming_options are activated, results
+  // are returned per frame with a latency of lookahead_frames instead.
   // Note: Passing a non-zero argument for saliency, requires
   // MotionAnalysisOptions::compute_motion_saliency to be set and
   // vice versa. (CHECKED)
@@ -182,6 +189,14 @@ class MotionAnalysis {
   // Compute saliency from buffered features and motions.
   void ComputeSaliency();
 
+  // Implements GetResults if MotionEstimationOptions::streaming_options are
+  // activated: Motions are estimated per batch of frames and each frame is
+  // output as soon as its irls smoothing look-ahead is available.
+  int GetResultsStreaming(
+      bool flush,
+      std::vector<std::unique_ptr<RegionFlowFeatureList>>* features,
+      std::vector<std::unique_ptr<CameraMotion>>* camera_motion);
+
   // Outputs computed results from the streaming buffer to the optional
   // output args. Also performs overlap handling.
   int OutputResults(
@@ -195,6 +210,9 @@ class MotionAnalysis {
   int frame_height_ = 0;
   int frame_num_ = 0;
 
+  // Pool for image buffers, not owned.
+  MatPool* mat_pool_ = nullptr;
+
   // Internal objects for actual motion analysis.
   std::unique_ptr<RegionFlowComputation> region_flow_computation_;
   std::unique_ptr<MotionEstimation> motion_estimation_;
@@ -222,6 +240,10 @@ class MotionAnalysis {
   int overlap_size_ = 0;
 
   bool feature_computation_ = true;
+
+  // Streaming mode only: Number of already output frames at the front of the
+  // buffer (zero or one), retained as history for irls smoothing.
+  int num_history_frames_ = 0;
 };
 
 }  // namespace mediapipe
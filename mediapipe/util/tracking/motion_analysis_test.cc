@@ -0,0 +1,206 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/motion_analysis.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_highgui_inc.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/tracking/camera_motion.pb.h"
+#include "mediapipe/util/tracking/region_flow.pb.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kBorder = 20;
+
+// Creates a movie by displacing the test image to random positions.
+std::vector<cv::Mat> MakeMovie(int num_frames) {
+  std::string png_data;
+  MEDIAPIPE_CHECK_OK(file::GetContents(
+      file::JoinPath("./", "/mediapipe/util/tracking/testdata/",
+                     "stabilize_test.png"),
+      &png_data));
+  std::vector<char> buffer(png_data.begin(), png_data.end());
+  cv::Mat original_frame = cv::imdecode(cv::Mat(buffer), 1);
+  CHECK(!original_frame.empty());
+
+  const int frame_width = original_frame.cols - 2 * kBorder;
+  const int frame_height = original_frame.rows - 2 * kBorder;
+
+  std::mt19937_64 random(900913);
+  std::uniform_int_distribution<> uniform_dist(-4, 4);
+  std::vector<cv::Mat> movie(num_frames);
+  int x = kBorder;
+  int y = kBorder;
+  for (int f = 0; f < num_frames; ++f) {
+    x = std::min(2 * kBorder, std::max(0, x + uniform_dist(random)));
+    y = std::min(2 * kBorder, std::max(0, y + uniform_dist(random)));
+    original_frame(cv::Rect(x, y, frame_width, frame_height))
+        .copyTo(movie[f]);
+  }
+  return movie;
+}
+
+MotionAnalysisOptions StreamingOptions(int lookahead) {
+  MotionAnalysisOptions options;
+  options.set_post_irls_smoothing(true);
+  auto* streaming_options =
+      options.mutable_motion_options()->mutable_streaming_options();
+  streaming_options->set_activated(true);
+  streaming_options->set_lookahead_frames(lookahead);
+  return options;
+}
+
+// Adds all frames and returns number of frames output after each AddFrame.
+std::vector<int> RunMotionAnalysis(const MotionAnalysisOptions& options,
+                                   const std::vector<cv::Mat>& movie,
+                                   std::vector<CameraMotion>* motions) {
+  MotionAnalysis motion_analysis(options, movie[0].cols, movie[0].rows);
+  std::vector<int> num_outputs;
+  for (int f = 0; f < movie.size(); ++f) {
+    motion_analysis.AddFrame(movie[f], f * 33333);
+    std::vector<std::unique_ptr<RegionFlowFeatureList>> features;
+    std::vector<std::unique_ptr<CameraMotion>> camera_motions;
+    num_outputs.push_back(motion_analysis.GetResults(
+        f + 1 == movie.size(), &features, &camera_motions));
+    for (const auto& motion : camera_motions) {
+      motions->push_back(*motion);
+    }
+  }
+  return num_outputs;
+}
+
+TEST(MotionAnalysisTest, StreamingOutputsWithBoundedLatency) {
+  const std::vector<cv::Mat> movie = MakeMovie(16);
+  const int lookahead = 3;
+  std::vector<CameraMotion> motions;
+  const std::vector<int> num_outputs =
+      RunMotionAnalysis(StreamingOptions(lookahead), movie, &motions);
+
+  // First output once look-ahead is filled, afterwards one frame per input.
+  for (int f = 0; f + 1 < movie.size(); ++f) {
+    EXPECT_EQ(f < lookahead ? 0 : 1, num_outputs[f]) << "Frame " << f;
+  }
+  EXPECT_EQ(lookahead + 1, num_outputs.back());
+  EXPECT_EQ(movie.size(), motions.size());
+}
+
+TEST(MotionAnalysisTest, StreamingMatchesBatchMotions) {
+  const std::vector<cv::Mat> movie = MakeMovie(16);
+  std::vector<CameraMotion> streaming_motions;
+  RunMotionAnalysis(StreamingOptions(4), movie, &streaming_motions);
+
+  MotionAnalysisOptions batch_options;
+  batch_options.set_post_irls_smoothing(true);
+  std::vector<CameraMotion> batch_motions;
+  RunMotionAnalysis(batch_options, movie, &batch_motions);
+
+  ASSERT_EQ(batch_motions.size(), streaming_motions.size());
+  for (int f = 0; f < batch_motions.size(); ++f) {
+    EXPECT_NEAR(batch_motions[f].translation().dx(),
+                streaming_motions[f].translation().dx(), 0.5);
+    EXPECT_NEAR(batch_motions[f].translation().dy(),
+                streaming_motions[f].translation().dy(), 0.5);
+  }
+}
+
+// Streams movie in two halves and returns the output features. The first half
+// is flushed along with its last frame, or with flush_separately, output
+// without flushing and then flushed twice without new frames.
+std::vector<RegionFlowFeatureList> RunInTwoHalves(
+    const std::vector<cv::Mat>& movie, bool flush_separately) {
+  MotionAnalysis motion_analysis(StreamingOptions(/*lookahead=*/0),
+                                 movie[0].cols, movie[0].rows);
+  std::vector<RegionFlowFeatureList> output_features;
+  auto get_results = [&motion_analysis, &output_features](bool flush) {
+    std::vector<std::unique_ptr<RegionFlowFeatureList>> features;
+    std::vector<std::unique_ptr<CameraMotion>> camera_motions;
+    const int num_outputs =
+        motion_analysis.GetResults(flush, &features, &camera_motions);
+    for (const auto& feature_list : features) {
+      output_features.push_back(*feature_list);
+    }
+    return num_outputs;
+  };
+  const int num_frames = movie.size();
+  const int half = num_frames / 2;
+  for (int f = 0; f < num_frames; ++f) {
+    motion_analysis.AddFrame(movie[f], f * 33333);
+    const bool last_of_half = f + 1 == half || f + 1 == num_frames;
+    EXPECT_EQ(1, get_results(last_of_half && !flush_separately));
+    if (last_of_half && flush_separately) {
+      EXPECT_EQ(0, get_results(/*flush=*/true));
+      EXPECT_EQ(0, get_results(/*flush=*/true));
+    }
+  }
+  return output_features;
+}
+
+TEST(MotionAnalysisTest, StreamingFlushesTwiceInARow) {
+  const std::vector<cv::Mat> movie = MakeMovie(8);
+  const std::vector<RegionFlowFeatureList> expected_features =
+      RunInTwoHalves(movie, /*flush_separately=*/false);
+  // Flushing without output must drop the history frame as well, so that it
+  // does not leak into the irls smoothing of the second half.
+  const std::vector<RegionFlowFeatureList> features =
+      RunInTwoHalves(movie, /*flush_separately=*/true);
+
+  ASSERT_EQ(movie.size(), expected_features.size());
+  ASSERT_EQ(expected_features.size(), features.size());
+  for (int f = 0; f < static_cast<int>(features.size()); ++f) {
+    ASSERT_EQ(expected_features[f].feature_size(), features[f].feature_size())
+        << "Frame " << f;
+    for (int i = 0; i < features[f].feature_size(); ++i) {
+      EXPECT_FLOAT_EQ(expected_features[f].feature(i).irls_weight(),
+                      features[f].feature(i).irls_weight())
+          << "Frame " << f << ", feature " << i;
+    }
+  }
+}
+
+void BM_MotionAnalysis(benchmark::State& state,
+                       const MotionAnalysisOptions& options) {
+  const std::vector<cv::Mat> movie = MakeMovie(32);
+  for (auto _ : state) {
+    std::vector<CameraMotion> motions;
+    RunMotionAnalysis(options, movie, &motions);
+  }
+  state.SetItemsProcessed(state.iterations() * movie.size());
+}
+
+void BM_MotionAnalysisBatch(benchmark::State& state) {
+  MotionAnalysisOptions options;
+  options.set_post_irls_smoothing(true);
+  BM_MotionAnalysis(state, options);
+}
+BENCHMARK(BM_MotionAnalysisBatch);
+
+void BM_MotionAnalysisStreaming(benchmark::State& state) {
+  BM_MotionAnalysis(state, StreamingOptions(state.range(0)));
+}
+BENCHMARK(BM_MotionAnalysisStreaming)->Arg(0)->Arg(2)->Arg(4)->Arg(8);
+
+}  // namespace
+}  // namespace mediapipe
@@ -6008,4 +6008,148 @@ void MotionEstimation::RunTemporalIRLSSmoothing(
   }
 }
 
+void MotionEstimation::SlidingWindowIRLSSmoothing(
+    const RegionFlowFeatureList* prev_feature_list,
+    const std::vector<CameraMotion>& camera_motions,
+    std::vector<RegionFlowFeatureList*>* feature_lists) const {
+  CHECK(feature_lists != nullptr);
+  CHECK(!feature_lists->empty());
+  CHECK_EQ(feature_lists->size(), camera_motions.size());
+
+  // Window layout: [previous frame (optional) | current frame | look-ahead].
+  // Previous and look-ahead frames are smoothed on copies, as the push pass
+  // overwrites irls weights of all frames it visits.
+  const int num_lookahead = feature_lists->size() - 1;
+  std::vector<RegionFlowFeatureList> window_copies;
+  window_copies.reserve(num_lookahead + 1);
+  std::vector<RegionFlowFeatureList*> window;
+  if (prev_feature_list != nullptr) {
+    window_copies.push_back(*prev_feature_list);
+    window.push_back(&window_copies.back());
+  }
+  const int curr_idx = window.size();
+  window.push_back((*feature_lists)[0]);
+  for (int k = 1; k <= num_lookahead; ++k) {
+    window_copies.push_back(*(*feature_lists)[k]);
+    window.push_back(&window_copies.back());
+  }
+  const int num_frames = window.size();
+
+  for (auto* feature_list : window) {
+    TransformRegionFlowFeatureList(normalization_transform_, feature_list);
+  }
+
+  std::vector<RegionFlowFeatureView> feature_views(num_frames);
+  for (int k = 0; k < num_frames; ++k) {
+    SelectFeaturesFromList(
+        [](const RegionFlowFeature& feature) -> bool {
+          return feature.irls_weight() != 0;
+        },
+        window[k], &feature_views[k]);
+    ClampRegionFlowFeatureIRLSWeights(0.01, 100, &feature_views[k]);
+  }
+
+  std::vector<FeatureGrid<RegionFlowFeature>> feature_grids;
+  std::vector<std::vector<int>> feature_taps_3;
+  std::vector<std::vector<int>> feature_taps_5;
+  BuildFeatureGrid(normalized_domain_.x(), normalized_domain_.y(),
+                   options_.feature_grid_size(),  // In normalized coords.
+                   feature_views, FeatureLocation, &feature_taps_3,
+                   &feature_taps_5, nullptr, &feature_grids);
+
+  // Frame confidence as in PostIRLSSmoothing, relative to the maximum
+  // confidence within the window. Only defined for current and look-ahead
+  // frames, the previous frame is only pulled from.
+  std::vector<float> frame_confidence(num_frames, 1.0f);
+  if (options_.frame_confidence_weighting()) {
+    float max_confidence = 0.0f;
+    for (int f = curr_idx; f < num_frames; ++f) {
+      frame_confidence[f] =
+          std::max(1e-3f, InlierCoverage(camera_motions[f - curr_idx], false));
+      frame_confidence[f] *= frame_confidence[f];
+      max_confidence = std::max(max_confidence, frame_confidence[f]);
+    }
+
+    const float cut_off_confidence =
+        options_.reset_confidence_threshold() * max_confidence;
+    for (int f = curr_idx; f < num_frames; ++f) {
+      if (frame_confidence[f] < cut_off_confidence) {
+        for (auto& feature_ptr : feature_views[f]) {
+          feature_ptr->set_irls_weight(1.0f);
+        }
+      }
+    }
+  }
+
+  const float grid_resolution = options_.feature_grid_size();
+  const int grid_dim_x =
+      std::ceil(static_cast<double>(normalized_domain_.x() / grid_resolution));
+  const float grid_scale = 1.0f / grid_resolution;
+
+  // Same LUTs as RunTemporalIRLSSmoothing. The temporal domain spans
+  // temporal_irls_diameter frames (at least the window itself).
+  const float max_space_diff = sqrt(2.0) * 3.f * grid_resolution * 1.01f;
+  std::vector<float> space_lut;
+  float space_scale;
+  InitGaussLUT(options_.spatial_sigma(), max_space_diff, &space_lut,
+               &space_scale);
+
+  const int temporal_length =
+      std::max(options_.temporal_irls_diameter(), num_lookahead + 2);
+  std::vector<float> temporal_lut;
+  InitGaussLUT(options_.temporal_sigma(), temporal_length, &temporal_lut,
+               nullptr);
+
+  const float max_feature_diff = sqrt(3.0) * 255.0;  // 3 channels.
+  std::vector<float> feature_lut;
+  float feature_scale;
+  InitGaussLUT(options_.feature_sigma(), max_feature_diff, &feature_lut,
+               &feature_scale);
+
+  const auto& feature_taps =
+      options_.filter_5_taps() ? feature_taps_5 : feature_taps_3;
+
+  // Push pass from the end of the look-ahead towards the current frame
+  // (not into the previous frame, which has already been emitted).
+  ClearInternalIRLSStructure(&feature_views[num_frames - 1]);
+  for (int f = num_frames - 1; f >= curr_idx; --f) {
+    float temporal_weight = 0;
+    for (int e = 1; e < num_frames - f; ++e) {
+      temporal_weight += temporal_lut[e];
+    }
+    temporal_weight /= temporal_lut[0];
+
+    TemporalIRLSPush(feature_grids[f],
+                     f > curr_idx ? &feature_grids[f - 1] : nullptr,
+                     feature_taps, space_scale, space_lut, feature_scale,
+                     feature_lut, temporal_weight, frame_confidence[f],
+                     grid_scale, grid_dim_x, &feature_views[f],
+                     f > curr_idx ? &feature_views[f - 1] : nullptr);
+  }
+
+  // Single pull step from the previous frame. The previous frame summarizes
+  // the stream's history, which we weight as if the current frame was
+  // positioned within a clip of temporal_length frames, followed by the
+  // look-ahead.
+  if (curr_idx > 0) {
+    const int history_length =
+        std::max(1, temporal_length - 1 - num_lookahead);
+    float temporal_weight = 0;
+    for (int e = 1; e <= history_length; ++e) {
+      temporal_weight += temporal_lut[e];
+    }
+    temporal_weight /= temporal_lut[0];
+
+    TemporalIRLSPull(feature_grids[curr_idx], feature_grids[curr_idx - 1],
+                     feature_taps, space_scale, space_lut, feature_scale,
+                     feature_lut, temporal_weight, frame_confidence[curr_idx],
+                     grid_scale, grid_dim_x, &feature_views[curr_idx],
+                     &feature_views[curr_idx - 1]);
+  }
+
+  // Only the current frame is retained, copies are discarded.
+  TransformRegionFlowFeatureList(inv_normalization_transform_,
+                                 window[curr_idx]);
+}
+
 }  // namespace mediapipe
@@ -589,6 +589,20 @@ class MotionEstimation {
       const std::vector<CameraMotion>& camera_motions,
       std::vector<RegionFlowFeatureList*>* feature_lists) const;
 
+  // Streaming variant of PostIRLSSmoothing with bounded look-ahead.
+  // Smooths irls weights of (*feature_lists)[0] spatio-temporally, pushing
+  // weights from the remaining look-ahead frames (*feature_lists)[1..N] and
+  // pulling weights from prev_feature_list, the previously smoothed frame
+  // (optional, pass nullptr for the first frame of a stream).
+  // Only (*feature_lists)[0] is modified, look-ahead frames retain their
+  // original irls weights so that the window can be advanced by one frame in
+  // the next call. Expects un-normalized features and one camera motion per
+  // feature list, i.e. the output of EstimateMotionsParallel.
+  void SlidingWindowIRLSSmoothing(
+      const RegionFlowFeatureList* prev_feature_list,
+      const std::vector<CameraMotion>& camera_motions,
+      std::vector<RegionFlowFeatureList*>* feature_lists) const;
+
   // Initializes LUT for gaussian weighting. By default discretizes the domain
   // [0, max_range] into 4K bins, returning scale to map from a value in the
   // domain to the corresponding bin. If scale is nullptr max_range bins are
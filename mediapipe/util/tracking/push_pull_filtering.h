@@ -31,16 +31,25 @@
 #include <memory>
 #include <numeric>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/util/tracking/image_util.h"
+#include "mediapipe/util/tracking/parallel_invoker.h"
 #include "mediapipe/util/tracking/push_pull_filtering.pb.h"
 
 namespace mediapipe {
 
 const float kBilateralEps = 1e-6f;
 
+// Sparse pull is used as long as at most 1 / kSparsePullDensity of a level's
+// cells hold data.
+const int kSparsePullDensity = 16;
+
+// Number of rows processed per task by separable filtering.
+const int kSeparableRowGrain = 8;
+
 // Push Pull algorithm can be decorated with mip-map visualizers,
 // per-level weight adjusters and per-filter element weight multipliers.
 // Implemented by default as no-ops below.
@@ -215,15 +224,48 @@ class PushPullFiltering {
   void InitializeImagePyramid(const cv::Mat& input_frame,
                               std::vector<cv::Mat>* pyramid);
 
-  void PerformPushPullImpl(const int readout_level, const cv::Mat* input_frame,
-                           std::vector<cv::Mat*>* mip_map_ptr);
+  // If specified, sparse_locations lists all level zero locations (w.r.t.
+  // domain, i.e. excluding border) holding data.
+  void PerformPushPullImpl(
+      const int readout_level, const cv::Mat* input_frame,
+      const std::vector<cv::Point2i>* sparse_locations,  // Optional.
+      std::vector<cv::Mat*>* mip_map_ptr);
 
   void PullDownSampling(int num_filter_elems, const float* filter_weights,
+                        const std::vector<cv::Point2i>* sparse_locations,
                         std::vector<cv::Mat*>* mip_map_ptr);
 
   void PushUpSampling(int num_filter_elems, const float* filter_weights,
                       int readout_level, std::vector<cv::Mat*>* mip_map_ptr);
 
+  // Returns true if filter weights are not modulated per sample, in which case
+  // the 2D filters are applied as separable row and column passes.
+  bool UseSeparableFilters() const {
+    return options_.use_separable_filters() && !use_bilateral_ &&
+           std::is_same<FilterWeightMultiplier,
+                        FilterWeightMultiplierOne>::value;
+  }
+
+  // Separable implementation of a single pull stage, downsampling src into
+  // dst (excluding pre-multiplication). Both are expected to have borders, src
+  // with borders already set.
+  void PullDownSampleSeparable(const cv::Mat& src, cv::Mat* buffer,
+                               cv::Mat* dst);
+
+  // Same as above, only visiting src_locations, the pixels of src holding
+  // data. Cells of dst receiving data are returned in dst_locations.
+  // Requires src to be at least 2 * border_ in each dimension.
+  void PullDownSampleSparse(const cv::Mat& src,
+                            const std::vector<cv::Point2i>& src_locations,
+                            cv::Mat* dst,
+                            std::vector<cv::Point2i>* dst_locations);
+
+  // Separable implementation of a single push stage, blending upsampled src
+  // into dst. Locations that did not receive any data are appended to
+  // zero_pos.
+  void PushUpSampleSeparable(const cv::Mat& src, cv::Mat* buffer, cv::Mat* dst,
+                             std::vector<float*>* zero_pos);
+
   // Convenience function selecting appropiate border size based on filter_type.
   template <typename T, int channels>
   void CopyNecessaryBorder(cv::Mat* mat);
@@ -257,6 +299,13 @@ class PushPullFiltering {
   std::array<float, 25> gaussian5_weights_;
   std::array<float, 9> gaussian3_weights_;
 
+  // 1D filter equivalent to the 2D filter selected by filter_type_, of size
+  // 2 * border_ + 1.
+  std::vector<float> separable_weights_;
+
+  // Intermediate results of separable filtering, one per level.
+  std::vector<cv::Mat> separable_buffers_;
+
   // Pyramids used by PushPull implementation.
   std::vector<cv::Mat> downsample_pyramid_;
   std::vector<cv::Mat> input_frame_pyramid_;
@@ -421,6 +470,32 @@ void PushPullFiltering<C, FilterWeightMultiplier>::SetupFilters() {
   for (int i = 0; i < 9; ++i) {
     gaussian3_weights_[i] *= gauss3_scale;
   }
+
+  // All filters above are outer products of a 1D filter with itself, which
+  // is recovered as marginal of the 2D filter.
+  const float* filter_weights = nullptr;
+  switch (filter_type_) {
+    case BINOMIAL_3X3:
+      filter_weights = binomial3_weights_.data();
+      break;
+    case BINOMIAL_5X5:
+      filter_weights = binomial5_weights_.data();
+      break;
+    case GAUSSIAN_3X3:
+      filter_weights = gaussian3_weights_.data();
+      break;
+    case GAUSSIAN_5X5:
+      filter_weights = gaussian5_weights_.data();
+      break;
+  }
+
+  const int diam = 2 * border_ + 1;
+  separable_weights_.assign(diam, 0.0f);
+  for (int j = 0; j < diam; ++j) {
+    for (int i = 0; i < diam; ++i) {
+      separable_weights_[i] += filter_weights[j * diam + i];
+    }
+  }
 }
 
 template <int C, class FilterWeightMultiplier>
@@ -771,19 +846,34 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PerformPushPull(
   // Use caller-allocated results Mat.
   mip_map[readout_level] = results;
 
+  // Record data locations for sparse pull, unless data is placed within the
+  // border.
+  bool use_sparse_pull = UseSeparableFilters() && options_.use_sparse_pull() &&
+                         weight_adjuster_ == nullptr;
+  std::vector<cv::Point2i> sparse_locations;
+
   // Place data_values into their final positions in mip map @ level 0.
   mip_map[0]->setTo(0);
   for (int idx = 0; idx < data_locations.size(); ++idx) {
     const Vector2_f& location = data_locations[idx];
     const cv::Vec<float, C>& value = data_values[idx];
 
-    float* ptr = mip_map[0]->ptr<float>(static_cast<int>(location.y() + 0.5f) +
-                                        origin.y) +
-                 (C + 1) * (static_cast<int>(location.x() + 0.5f) + origin.x);
+    const int row = static_cast<int>(location.y() + 0.5f) + origin.y;
+    const int col = static_cast<int>(location.x() + 0.5f) + origin.x;
+    float* ptr = mip_map[0]->ptr<float>(row) + (C + 1) * col;
 
     const float data_weight =
         data_weights ? (*data_weights)[idx] : push_pull_weight;
 
+    if (use_sparse_pull) {
+      if (row < border_ || row >= border_ + domain_size_.height ||
+          col < border_ || col >= border_ + domain_size_.width) {
+        use_sparse_pull = false;
+      } else {
+        sparse_locations.push_back(cv::Point2i(col - border_, row - border_));
+      }
+    }
+
     // Pre-multiply with data_weight.
     for (int c = 0; c < C; ++c) {
       ptr[c] = value[c] * data_weight;
@@ -795,7 +885,19 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PerformPushPull(
     ptr[C] = data_weight;
   }
 
-  PerformPushPullImpl(readout_level, input_frame, &mip_map);
+  if (use_sparse_pull) {
+    // Locations might be duplicated, retain unique ones in row-major order.
+    std::sort(sparse_locations.begin(), sparse_locations.end(),
+              [](const cv::Point2i& lhs, const cv::Point2i& rhs) {
+                return lhs.y < rhs.y || (lhs.y == rhs.y && lhs.x < rhs.x);
+              });
+    sparse_locations.erase(
+        std::unique(sparse_locations.begin(), sparse_locations.end()),
+        sparse_locations.end());
+  }
+
+  PerformPushPullImpl(readout_level, input_frame,
+                      use_sparse_pull ? &sparse_locations : nullptr, &mip_map);
 }
 
 // This is the same as PerformPushPull above except that it
@@ -834,7 +936,9 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PerformPushPullMat(
   // Place data_values into their final positions in mip map at level 0.
   mip_map_level_0.copyTo(*mip_map[0]);
 
-  PerformPushPullImpl(readout_level, input_frame, &mip_map);
+  PerformPushPullImpl(readout_level, input_frame,
+                      nullptr,  // Data is dense.
+                      &mip_map);
 }
 
 // Perform sparse data interpolation.
@@ -846,6 +950,7 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PerformPushPullMat(
 template <int C, class FilterWeightMultiplier>
 void PushPullFiltering<C, FilterWeightMultiplier>::PerformPushPullImpl(
     const int readout_level, const cv::Mat* input_frame,
+    const std::vector<cv::Point2i>* sparse_locations,
     std::vector<cv::Mat*>* mip_map_ptr) {
   const float* filter_weights;
   int num_filter_elems;
@@ -888,7 +993,12 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PerformPushPullImpl(
     InitializeImagePyramid(*input_frame, &input_frame_pyramid_);
   }
 
-  PullDownSampling(num_filter_elems, filter_weights, mip_map_ptr);
+  if (UseSeparableFilters()) {
+    separable_buffers_.resize(mip_map.size());
+  }
+
+  PullDownSampling(num_filter_elems, filter_weights, sparse_locations,
+                   mip_map_ptr);
 
   if (mip_map_visualizer_) {
     std::vector<bool> is_premultiplied(mip_map_view_ptrs.size(), true);
@@ -955,6 +1065,7 @@ inline void FillInZeros(const std::vector<float*>& zero_pos,
 template <int C, class FilterWeightMultiplier>
 void PushPullFiltering<C, FilterWeightMultiplier>::PullDownSampling(
     int num_filter_elems, const float* filter_weights,
+    const std::vector<cv::Point2i>* sparse_locations,
     std::vector<cv::Mat*>* mip_map_ptr) {
   const std::vector<cv::Mat*>& mip_map = *mip_map_ptr;
 
@@ -962,6 +1073,15 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PullDownSampling(
   // We always filter from [border, border] to
   // [width - 1 - border, height - 1 - border].
 
+  // Locations holding data at current source and destination level, if
+  // sparse.
+  bool sparse = sparse_locations != nullptr && UseSeparableFilters();
+  std::vector<cv::Point2i> src_locations;
+  std::vector<cv::Point2i> dst_locations;
+  if (sparse) {
+    src_locations = *sparse_locations;
+  }
+
   for (int l = 1; l < mip_map.size(); ++l) {
     CopyNecessaryBorder<float, C + 1>(mip_map[l - 1]);
     mip_map[l]->setTo(0);
@@ -973,98 +1093,114 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PullDownSampling(
     // Signal level to weight_multiplier.
     weight_multiplier_->SetLevel(l - 1, true);
 
-    std::vector<int> filter_offsets;
-    GetFilterOffsets(*mip_map[l - 1], border, channels, &filter_offsets);
-
-    const std::vector<int>* space_offsets =
-        use_bilateral_ ? &pyramid_space_offsets_[l - 1] : NULL;
-
     const int height = mip_map[l]->rows - 2 * border;
     const int width = mip_map[l]->cols - 2 * border;
 
-    // Downweight bilateral influence as level progress as due to iterative
-    // downsampling image becomes less and less reliable.
-    const float bilateral_scale =
-        std::pow(options_.pull_bilateral_scale(), l - 1);
-
-    // Filter odd pixels (downsample).
-    for (int i = 0; i < height; ++i) {
-      float* dst_ptr = mip_map[l]->ptr<float>(i + border) + border * channels;
-      const float* src_ptr =
-          mip_map[l - 1]->ptr<float>(2 * i + border) + border * channels;
-      const uint8* img_ptr =
-          use_bilateral_ ? (input_frame_pyramid_[l - 1].template ptr<uint8>(
-                                2 * i + border) +
-                            border * 3)
-                         : NULL;
-
-      for (int j = 0; j < width; ++j, dst_ptr += channels,
-               src_ptr += 2 * channels, img_ptr += 2 * 3) {
-        float weight_sum = 0;
-        float val_sum[C];
-        memset(val_sum, 0, C * sizeof(val_sum[0]));
-
-        const int i2 = i * 2;
-        const int j2 = j * 2;
-        if (use_bilateral_) {
-          for (int k = 0; k < num_filter_elems; ++k) {
-            const float* cur_ptr = PtrOffset(src_ptr, filter_offsets[k]);
-
-            // If neighbor is not important, skip further evaluation.
-            if (cur_ptr[C] < kBilateralEps * kBilateralEps) {
-              continue;
-            }
+    if (UseSeparableFilters()) {
+      const cv::Mat& src = *mip_map[l - 1];
+      const int src_height = src.rows - 2 * border;
+      const int src_width = src.cols - 2 * border;
+      sparse = sparse && src_height >= 2 * border && src_width >= 2 * border &&
+               src_locations.size() * kSparsePullDensity <=
+                   static_cast<size_t>(src_height) * src_width;
+      if (sparse) {
+        PullDownSampleSparse(src, src_locations, mip_map[l], &dst_locations);
+        src_locations.swap(dst_locations);
+      } else {
+        PullDownSampleSeparable(src, &separable_buffers_[l], mip_map[l]);
+      }
+    } else {
+      std::vector<int> filter_offsets;
+      GetFilterOffsets(*mip_map[l - 1], border, channels, &filter_offsets);
 
-            const uint8* match_ptr = PtrOffset(img_ptr, (*space_offsets)[k]);
+      const std::vector<int>* space_offsets =
+          use_bilateral_ ? &pyramid_space_offsets_[l - 1] : NULL;
 
-            float bilateral_w = bilateral_lut_[ColorDiffL1(img_ptr, match_ptr) *
-                                               bilateral_scale];
+      // Downweight bilateral influence as level progress as due to iterative
+      // downsampling image becomes less and less reliable.
+      const float bilateral_scale =
+          std::pow(options_.pull_bilateral_scale(), l - 1);
 
-            const float multiplier = weight_multiplier_->GetWeight(
-                src_ptr, cur_ptr, img_ptr, j2, i2);
+      // Filter odd pixels (downsample).
+      for (int i = 0; i < height; ++i) {
+        float* dst_ptr = mip_map[l]->ptr<float>(i + border) + border * channels;
+        const float* src_ptr =
+            mip_map[l - 1]->ptr<float>(2 * i + border) + border * channels;
+        const uint8* img_ptr =
+            use_bilateral_ ? (input_frame_pyramid_[l - 1].template ptr<uint8>(
+                                  2 * i + border) +
+                              border * 3)
+                           : NULL;
+
+        for (int j = 0; j < width; ++j, dst_ptr += channels,
+                 src_ptr += 2 * channels, img_ptr += 2 * 3) {
+          float weight_sum = 0;
+          float val_sum[C];
+          memset(val_sum, 0, C * sizeof(val_sum[0]));
+
+          const int i2 = i * 2;
+          const int j2 = j * 2;
+          if (use_bilateral_) {
+            for (int k = 0; k < num_filter_elems; ++k) {
+              const float* cur_ptr = PtrOffset(src_ptr, filter_offsets[k]);
+
+              // If neighbor is not important, skip further evaluation.
+              if (cur_ptr[C] < kBilateralEps * kBilateralEps) {
+                continue;
+              }
+
+              const uint8* match_ptr = PtrOffset(img_ptr, (*space_offsets)[k]);
+
+              float bilateral_w =
+                  bilateral_lut_[ColorDiffL1(img_ptr, match_ptr) *
+                                 bilateral_scale];
+
+              const float multiplier = weight_multiplier_->GetWeight(
+                  src_ptr, cur_ptr, img_ptr, j2, i2);
+
+              const float w = filter_weights[k] * bilateral_w * multiplier;
+
+              // cur_ptr is already pre-multiplied with importance
+              // weight cur_ptr[C].
+              for (int c = 0; c < C; ++c) {
+                val_sum[c] += cur_ptr[c] * w;
+              }
+              weight_sum += w * cur_ptr[C];
+            }
+          } else {
+            for (int k = 0; k < num_filter_elems; ++k) {
+              const float* cur_ptr = PtrOffset(src_ptr, filter_offsets[k]);
+              const float multiplier =
+                  weight_multiplier_->GetWeight(src_ptr, cur_ptr, NULL, j2, i2);
+              const float w = filter_weights[k] * multiplier;
+
+              // cur_ptr is already pre-multiplied with importance
+              // weight cur_ptr[C].
+              for (int c = 0; c < C; ++c) {
+                val_sum[c] += cur_ptr[c] * w;
+              }
+
+              weight_sum += w * cur_ptr[C];
+            }
+          }
 
-            const float w = filter_weights[k] * bilateral_w * multiplier;
+          DCHECK_GE(weight_sum, 0);
 
-            // cur_ptr is already pre-multiplied with importance
-            // weight cur_ptr[C].
+          if (weight_sum >= kBilateralEps * kBilateralEps) {
+            const float inv_weight_sum = 1.f / weight_sum;
             for (int c = 0; c < C; ++c) {
-              val_sum[c] += cur_ptr[c] * w;
+              dst_ptr[c] = val_sum[c] * inv_weight_sum;
             }
-            weight_sum += w * cur_ptr[C];
-          }
-        } else {
-          for (int k = 0; k < num_filter_elems; ++k) {
-            const float* cur_ptr = PtrOffset(src_ptr, filter_offsets[k]);
-            const float multiplier =
-                weight_multiplier_->GetWeight(src_ptr, cur_ptr, NULL, j2, i2);
-            const float w = filter_weights[k] * multiplier;
-
-            // cur_ptr is already pre-multiplied with importance
-            // weight cur_ptr[C].
-            for (int c = 0; c < C; ++c) {
-              val_sum[c] += cur_ptr[c] * w;
+          } else {
+            for (int c = 0; c <= C; ++c) {
+              dst_ptr[c] = 0;
             }
-
-            weight_sum += w * cur_ptr[C];
           }
-        }
-
-        DCHECK_GE(weight_sum, 0);
 
-        if (weight_sum >= kBilateralEps * kBilateralEps) {
-          const float inv_weight_sum = 1.f / weight_sum;
-          for (int c = 0; c < C; ++c) {
-            dst_ptr[c] = val_sum[c] * inv_weight_sum;
-          }
-        } else {
-          for (int c = 0; c <= C; ++c) {
-            dst_ptr[c] = 0;
-          }
+          const float prop_scale = options_.pull_propagation_scale();
+          weight_sum *= prop_scale;
+          dst_ptr[C] = std::min<float>(1.0f, weight_sum);
         }
-
-        const float prop_scale = options_.pull_propagation_scale();
-        weight_sum *= prop_scale;
-        dst_ptr[C] = std::min<float>(1.0f, weight_sum);
       }
     }
 
@@ -1085,13 +1221,25 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PullDownSampling(
     }
 
     // Pre-multiply weight for next level.
-    for (int i = 0; i < height; ++i) {
-      float* data_ptr = mip_map[l]->ptr<float>(i + border_) + border * channels;
-      for (int j = 0; j < width; ++j, data_ptr += channels) {
+    if (sparse) {
+      // Locations at current level.
+      for (const cv::Point2i& location : src_locations) {
+        float* data_ptr = mip_map[l]->ptr<float>(location.y + border) +
+                          (location.x + border) * channels;
         for (int c = 0; c < C; ++c) {
           data_ptr[c] *= data_ptr[C];
         }
       }
+    } else {
+      for (int i = 0; i < height; ++i) {
+        float* data_ptr =
+            mip_map[l]->ptr<float>(i + border_) + border * channels;
+        for (int j = 0; j < width; ++j, data_ptr += channels) {
+          for (int c = 0; c < C; ++c) {
+            data_ptr[c] *= data_ptr[C];
+          }
+        }
+      }
     }
   }  // end level processing.
 }
@@ -1108,150 +1256,155 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PushUpSampling(
     // Signal mip map level to weight_multiplier.
     weight_multiplier_->SetLevel(l, false);
 
-    // Instead of upsampling we use 4 special tap filters. See comment at above
-    // function.
-    std::vector<float> tap_weights[4];
-    std::vector<int> tap_offsets[4];
-    std::vector<int> tap_space_offsets[4];
-    const int channels = C + 1;
-
-    switch (filter_type_) {
-      case BINOMIAL_3X3:
-      case GAUSSIAN_3X3:
-        GetUpsampleTaps3(filter_weights,
-                         use_bilateral_ ? &pyramid_space_offsets_[l] : NULL,
-                         channels * sizeof(float), mip_map[l + 1]->step[0],
-                         tap_weights, tap_offsets, tap_space_offsets);
-        break;
-      case BINOMIAL_5X5:
-      case GAUSSIAN_5X5:
-        GetUpsampleTaps5(filter_weights,
-                         use_bilateral_ ? &pyramid_space_offsets_[l] : NULL,
-                         channels * sizeof(float), mip_map[l + 1]->step[0],
-                         tap_weights, tap_offsets, tap_space_offsets);
-        break;
-      default:
-        LOG(FATAL) << "Filter unknown";
-    }
-
     // Local copy for faster access.
     const int border = border_;
+    const int channels = C + 1;
     const int height = mip_map[l]->rows - 2 * border;
     const int width = mip_map[l]->cols - 2 * border;
 
-    const float bilateral_scale =
-        std::pow(options_.push_bilateral_scale(), l + 1);
-
-    // Apply filter.
     // List of zero positions that need to be smoothed.
     std::vector<float*> zero_pos;
 
-    for (int i = 0; i < height; ++i) {
-      float* dst_ptr = mip_map[l]->ptr<float>(i + border) + border * channels;
-      const float* src_ptr =
-          mip_map[l + 1]->ptr<float>(i / 2 + border) + border * channels;
-      const uint8* img_ptr =
-          use_bilateral_
-              ? (input_frame_pyramid_[l].template ptr<uint8>(i + border) +
-                 border * 3)
-              : NULL;
-
-      // Select tap offset.
-      const int tap_kind_row = 2 * (i % 2);  // odd row, case 2 & 3.
-
-      for (int j = 0; j < width;
-           // Increase src_ptr only for even rows (i.e. previous one was odd).
-           src_ptr += channels * (j % 2),
-               ++j, dst_ptr += channels, img_ptr += 3) {
-        if (dst_ptr[C] >= 1) {  // Skip if already saturated.
-          continue;
-        }
-
-        const int tap_kind = tap_kind_row + j % 2;
-        const std::vector<float>& tap_weight = tap_weights[tap_kind];
-        const std::vector<int>& tap_offset = tap_offsets[tap_kind];
-        const int tap_size = tap_weight.size();
+    if (UseSeparableFilters()) {
+      PushUpSampleSeparable(*mip_map[l + 1], &separable_buffers_[l],
+                            mip_map[l], &zero_pos);
+    } else {
+      // Instead of upsampling we use 4 special tap filters. See comment at
+      // above function.
+      std::vector<float> tap_weights[4];
+      std::vector<int> tap_offsets[4];
+      std::vector<int> tap_space_offsets[4];
+
+      switch (filter_type_) {
+        case BINOMIAL_3X3:
+        case GAUSSIAN_3X3:
+          GetUpsampleTaps3(filter_weights,
+                           use_bilateral_ ? &pyramid_space_offsets_[l] : NULL,
+                           channels * sizeof(float), mip_map[l + 1]->step[0],
+                           tap_weights, tap_offsets, tap_space_offsets);
+          break;
+        case BINOMIAL_5X5:
+        case GAUSSIAN_5X5:
+          GetUpsampleTaps5(filter_weights,
+                           use_bilateral_ ? &pyramid_space_offsets_[l] : NULL,
+                           channels * sizeof(float), mip_map[l + 1]->step[0],
+                           tap_weights, tap_offsets, tap_space_offsets);
+          break;
+        default:
+          LOG(FATAL) << "Filter unknown";
+      }
 
-        float weight_sum = 0;
-        float val_sum[C];
-        memset(val_sum, 0, C * sizeof(val_sum[0]));
+      const float bilateral_scale =
+          std::pow(options_.push_bilateral_scale(), l + 1);
 
-        if (use_bilateral_) {
-          const std::vector<int>& tap_space_offset =
-              tap_space_offsets[tap_kind];
-          for (int k = 0; k < tap_size; ++k) {
-            const float* cur_ptr = PtrOffset(src_ptr, tap_offset[k]);
+      for (int i = 0; i < height; ++i) {
+        float* dst_ptr = mip_map[l]->ptr<float>(i + border) + border * channels;
+        const float* src_ptr =
+            mip_map[l + 1]->ptr<float>(i / 2 + border) + border * channels;
+        const uint8* img_ptr =
+            use_bilateral_
+                ? (input_frame_pyramid_[l].template ptr<uint8>(i + border) +
+                   border * 3)
+                : NULL;
+
+        // Select tap offset.
+        const int tap_kind_row = 2 * (i % 2);  // odd row, case 2 & 3.
+
+        for (int j = 0; j < width;
+             // Increase src_ptr only for even rows (i.e. previous one was odd).
+             src_ptr += channels * (j % 2),
+                 ++j, dst_ptr += channels, img_ptr += 3) {
+          if (dst_ptr[C] >= 1) {  // Skip if already saturated.
+            continue;
+          }
 
-            // If neighbor is not important, skip further evaluation.
-            if (cur_ptr[C] < kBilateralEps * kBilateralEps) {
-              continue;
+          const int tap_kind = tap_kind_row + j % 2;
+          const std::vector<float>& tap_weight = tap_weights[tap_kind];
+          const std::vector<int>& tap_offset = tap_offsets[tap_kind];
+          const int tap_size = tap_weight.size();
+
+          float weight_sum = 0;
+          float val_sum[C];
+          memset(val_sum, 0, C * sizeof(val_sum[0]));
+
+          if (use_bilateral_) {
+            const std::vector<int>& tap_space_offset =
+                tap_space_offsets[tap_kind];
+            for (int k = 0; k < tap_size; ++k) {
+              const float* cur_ptr = PtrOffset(src_ptr, tap_offset[k]);
+
+              // If neighbor is not important, skip further evaluation.
+              if (cur_ptr[C] < kBilateralEps * kBilateralEps) {
+                continue;
+              }
+
+              const uint8* match_ptr = PtrOffset(img_ptr, tap_space_offset[k]);
+              float bilateral_w =
+                  bilateral_lut_[ColorDiffL1(img_ptr, match_ptr) *
+                                 bilateral_scale];
+
+              const float multiplier = weight_multiplier_->GetWeight(
+                  src_ptr, cur_ptr, img_ptr, j, i);
+
+              const float w = tap_weight[k] * bilateral_w * multiplier;
+
+              // Values in above mip map level are pre-multiplied by
+              // importance weight cur_ptr[C].
+              for (int c = 0; c < C; ++c) {
+                val_sum[c] += cur_ptr[c] * w;
+              }
+              weight_sum += w * cur_ptr[C];
             }
+          } else {
+            for (int k = 0; k < tap_size; ++k) {
+              const float* cur_ptr = PtrOffset(src_ptr, tap_offset[k]);
+              const float multiplier =
+                  weight_multiplier_->GetWeight(src_ptr, cur_ptr, NULL, j, i);
 
-            const uint8* match_ptr = PtrOffset(img_ptr, tap_space_offset[k]);
-            float bilateral_w = bilateral_lut_[ColorDiffL1(img_ptr, match_ptr) *
-                                               bilateral_scale];
+              const float w = tap_weight[k] * multiplier;
 
-            const float multiplier =
-                weight_multiplier_->GetWeight(src_ptr, cur_ptr, img_ptr, j, i);
+              // Values in above mip map level are pre-multiplied by weight
+              // cur_ptr[C].
+              for (int c = 0; c < C; ++c) {
+                val_sum[c] += cur_ptr[c] * w;
+              }
 
-            const float w = tap_weight[k] * bilateral_w * multiplier;
-
-            // Values in above mip map level are pre-multiplied by
-            // importance weight cur_ptr[C].
-            for (int c = 0; c < C; ++c) {
-              val_sum[c] += cur_ptr[c] * w;
+              weight_sum += w * cur_ptr[C];
             }
-            weight_sum += w * cur_ptr[C];
           }
-        } else {
-          for (int k = 0; k < tap_size; ++k) {
-            const float* cur_ptr = PtrOffset(src_ptr, tap_offset[k]);
-            const float multiplier =
-                weight_multiplier_->GetWeight(src_ptr, cur_ptr, NULL, j, i);
 
-            const float w = tap_weight[k] * multiplier;
-
-            // Values in above mip map level are pre-multiplied by weight
-            // cur_ptr[C].
+          if (weight_sum >= kBilateralEps * kBilateralEps) {
+            const float inv_weight_sum = 1.f / weight_sum;
             for (int c = 0; c < C; ++c) {
-              val_sum[c] += cur_ptr[c] * w;
+              val_sum[c] *= inv_weight_sum;
+            }
+          } else {
+            weight_sum = 0;
+            for (int c = 0; c < C; ++c) {
+              val_sum[c] = 0;
             }
 
-            weight_sum += w * cur_ptr[C];
-          }
-        }
-
-        if (weight_sum >= kBilateralEps * kBilateralEps) {
-          const float inv_weight_sum = 1.f / weight_sum;
-          for (int c = 0; c < C; ++c) {
-            val_sum[c] *= inv_weight_sum;
-          }
-        } else {
-          weight_sum = 0;
-          for (int c = 0; c < C; ++c) {
-            val_sum[c] = 0;
+            zero_pos.push_back(dst_ptr);
           }
 
-          zero_pos.push_back(dst_ptr);
-        }
+          const float prop_scale = options_.push_propagation_scale();
+          weight_sum *= prop_scale;
 
-        const float prop_scale = options_.push_propagation_scale();
-        weight_sum *= prop_scale;
+          // Maximum influence of pushed result on current pixel.
+          const float alpha_inv = std::min(1.0f - dst_ptr[C], weight_sum);
+          const float denom =
+              1.0f / (dst_ptr[C] + alpha_inv + kBilateralEps * kBilateralEps);
 
-        // Maximum influence of pushed result on current pixel.
-        const float alpha_inv = std::min(1.0f - dst_ptr[C], weight_sum);
-        const float denom =
-            1.0f / (dst_ptr[C] + alpha_inv + kBilateralEps * kBilateralEps);
+          // Blend (dst_ptr is premultiplied with weight dst_ptr[C],
+          //        val_sum is normalized).
+          for (int c = 0; c < C; ++c) {
+            dst_ptr[c] = (dst_ptr[c] + val_sum[c] * alpha_inv) * denom;
+          }
 
-        // Blend (dst_ptr is premultiplied with weight dst_ptr[C],
-        //        val_sum is normalized).
-        for (int c = 0; c < C; ++c) {
-          dst_ptr[c] = (dst_ptr[c] + val_sum[c] * alpha_inv) * denom;
+          // Increase current confidence by above sample.
+          dst_ptr[C] =
+              std::min(1.0f, dst_ptr[C] + std::min(weight_sum, alpha_inv));
         }
-
-        // Increase current confidence by above sample.
-        dst_ptr[C] =
-            std::min(1.0f, dst_ptr[C] + std::min(weight_sum, alpha_inv));
       }
     }
 
@@ -1291,6 +1444,292 @@ void PushPullFiltering<C, FilterWeightMultiplier>::PushUpSampling(
   }  // end mip map levels.
 }
 
+// Normalizes pull result ptr (pre-multiplied values, accumulated weight at
+// ptr[C]) and sets its weight to the accumulated weight scaled by prop_scale.
+template <int C>
+inline void NormalizePullSample(float prop_scale, float* ptr) {
+  const float weight_sum = ptr[C];
+  if (weight_sum >= kBilateralEps * kBilateralEps) {
+    const float inv_weight_sum = 1.f / weight_sum;
+    for (int c = 0; c < C; ++c) {
+      ptr[c] *= inv_weight_sum;
+    }
+  } else {
+    for (int c = 0; c < C; ++c) {
+      ptr[c] = 0;
+    }
+  }
+  ptr[C] = std::min<float>(1.0f, weight_sum * prop_scale);
+}
+
+// Returns positions of the bordered domain [-border, size + border) holding a
+// copy of position p within [0, size), i.e. p and its reflections created by
+// CopyMatBorder. Requires size >= border.
+inline int MirroredPositions(int p, int size, int border, int positions[3]) {
+  int num_positions = 0;
+  positions[num_positions++] = p;
+  if (p < border) {
+    positions[num_positions++] = -1 - p;
+  }
+  if (p >= size - border) {
+    positions[num_positions++] = 2 * size - 1 - p;
+  }
+  return num_positions;
+}
+
+template <int C, class FilterWeightMultiplier>
+void PushPullFiltering<C, FilterWeightMultiplier>::PullDownSampleSeparable(
+    const cv::Mat& src, cv::Mat* buffer, cv::Mat* dst) {
+  const int border = border_;
+  const int channels = C + 1;
+  const int diam = 2 * border + 1;
+  const float* weights = separable_weights_.data();
+  const int height = dst->rows - 2 * border;
+  const int width = dst->cols - 2 * border;
+  if (height <= 0 || width <= 0) {
+    return;
+  }
+
+  // Horizontal pass: buffer(r, j) filters src row r at columns
+  // [2 * j, 2 * j + diam), for all rows read by the vertical pass below.
+  const int buffer_rows = 2 * (height - 1) + diam;
+  buffer->create(buffer_rows, width, CV_32FC(channels));
+  ParallelFor(0, buffer_rows, kSeparableRowGrain,
+              [&](const BlockedRange& range) {
+                for (int r = range.begin(); r < range.end(); ++r) {
+                  const float* src_ptr = src.ptr<float>(r);
+                  float* buffer_ptr = buffer->ptr<float>(r);
+                  for (int j = 0; j < width; ++j, src_ptr += 2 * channels,
+                           buffer_ptr += channels) {
+                    float sum[C + 1] = {0};
+                    for (int k = 0; k < diam; ++k) {
+                      for (int c = 0; c < channels; ++c) {
+                        sum[c] += weights[k] * src_ptr[k * channels + c];
+                      }
+                    }
+                    std::copy(sum, sum + channels, buffer_ptr);
+                  }
+                }
+              });
+
+  // Vertical pass over contiguous rows of buffer, followed by normalization.
+  // Values are pre-multiplied with their weight, therefore filtering all
+  // C + 1 channels alike yields the weighted values and the weight sum.
+  const float prop_scale = options_.pull_propagation_scale();
+  const int row_elems = width * channels;
+  ParallelFor(0, height, kSeparableRowGrain, [&](const BlockedRange& range) {
+    for (int i = range.begin(); i < range.end(); ++i) {
+      float* dst_ptr = dst->ptr<float>(i + border) + border * channels;
+      const float* buffer_ptr = buffer->ptr<float>(2 * i);
+      for (int e = 0; e < row_elems; ++e) {
+        dst_ptr[e] = weights[0] * buffer_ptr[e];
+      }
+      for (int k = 1; k < diam; ++k) {
+        const float w = weights[k];
+        buffer_ptr = buffer->ptr<float>(2 * i + k);
+        for (int e = 0; e < row_elems; ++e) {
+          dst_ptr[e] += w * buffer_ptr[e];
+        }
+      }
+
+      for (int j = 0; j < width; ++j, dst_ptr += channels) {
+        NormalizePullSample<C>(prop_scale, dst_ptr);
+      }
+    }
+  });
+}
+
+template <int C, class FilterWeightMultiplier>
+void PushPullFiltering<C, FilterWeightMultiplier>::PullDownSampleSparse(
+    const cv::Mat& src, const std::vector<cv::Point2i>& src_locations,
+    cv::Mat* dst, std::vector<cv::Point2i>* dst_locations) {
+  const int border = border_;
+  const int channels = C + 1;
+  const int diam = 2 * border + 1;
+  const float* weights = separable_weights_.data();
+  const int src_height = src.rows - 2 * border;
+  const int src_width = src.cols - 2 * border;
+  const int height = dst->rows - 2 * border;
+  const int width = dst->cols - 2 * border;
+  DCHECK_GE(src_height, border);
+  DCHECK_GE(src_width, border);
+
+  // Scatter each source sample to all destination cells whose filter
+  // support covers it. As border values are copies of domain values, a
+  // sample is scattered from each of its mirrored positions as well.
+  dst_locations->clear();
+  for (const cv::Point2i& location : src_locations) {
+    const float* src_ptr = src.ptr<float>(location.y + border) +
+                           (location.x + border) * channels;
+    if (src_ptr[C] <= 0) {
+      continue;
+    }
+
+    int ys[3];
+    int xs[3];
+    const int num_ys = MirroredPositions(location.y, src_height, border, ys);
+    const int num_xs = MirroredPositions(location.x, src_width, border, xs);
+    for (int y_idx = 0; y_idx < num_ys; ++y_idx) {
+      const int y = ys[y_idx];
+      // Destination row i filters source rows [2 * i - border,
+      // 2 * i + border].
+      const int i_end = std::min(height - 1, (y + border) / 2);
+      for (int i = std::max(0, (y - border) / 2); i <= i_end; ++i) {
+        const int k_y = y - 2 * i + border;
+        if (k_y < 0 || k_y >= diam) {
+          continue;
+        }
+        for (int x_idx = 0; x_idx < num_xs; ++x_idx) {
+          const int x = xs[x_idx];
+          const int j_end = std::min(width - 1, (x + border) / 2);
+          for (int j = std::max(0, (x - border) / 2); j <= j_end; ++j) {
+            const int k_x = x - 2 * j + border;
+            if (k_x < 0 || k_x >= diam) {
+              continue;
+            }
+            float* dst_ptr =
+                dst->ptr<float>(i + border) + (j + border) * channels;
+            if (dst_ptr[C] == 0) {
+              dst_locations->push_back(cv::Point2i(j, i));
+            }
+            const float w = weights[k_y] * weights[k_x];
+            for (int c = 0; c < channels; ++c) {
+              dst_ptr[c] += w * src_ptr[c];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  const float prop_scale = options_.pull_propagation_scale();
+  for (const cv::Point2i& location : *dst_locations) {
+    NormalizePullSample<C>(prop_scale, dst->ptr<float>(location.y + border) +
+                                           (location.x + border) * channels);
+  }
+}
+
+template <int C, class FilterWeightMultiplier>
+void PushPullFiltering<C, FilterWeightMultiplier>::PushUpSampleSeparable(
+    const cv::Mat& src, cv::Mat* buffer, cv::Mat* dst,
+    std::vector<float*>* zero_pos) {
+  const int border = border_;
+  const int channels = C + 1;
+  const int diam = 2 * border + 1;
+  const int height = dst->rows - 2 * border;
+  const int width = dst->cols - 2 * border;
+  if (height <= 0 || width <= 0) {
+    return;
+  }
+
+  // Polyphase decomposition of the 1D filter (see GetUpsampleTaps3 and
+  // GetUpsampleTaps5 for the 2D equivalent): An even (phase 0) or odd
+  // (phase 1) position 2 * q + phase only receives taps k that coincide with
+  // low-res samples, i.e. from low-res position q + (phase + k - border) / 2.
+  std::vector<float> tap_weights[2];
+  std::vector<int> tap_offsets[2];
+  int min_offset = 0;
+  int max_offset = 0;
+  for (int phase = 0; phase < 2; ++phase) {
+    for (int k = 0; k < diam; ++k) {
+      if ((phase + k - border) % 2 == 0) {
+        const int offset = (phase + k - border) / 2;
+        tap_weights[phase].push_back(separable_weights_[k]);
+        tap_offsets[phase].push_back(offset);
+        min_offset = std::min(min_offset, offset);
+        max_offset = std::max(max_offset, offset);
+      }
+    }
+  }
+
+  // Horizontal pass: buffer(r, j) upsamples src row r to column j, for all
+  // rows read by the vertical pass below.
+  buffer->create(src.rows, width, CV_32FC(channels));
+  const int row_begin = border + min_offset;
+  const int row_end = border + (height - 1) / 2 + max_offset + 1;
+  ParallelFor(
+      row_begin, row_end, kSeparableRowGrain, [&](const BlockedRange& range) {
+        for (int r = range.begin(); r < range.end(); ++r) {
+          const float* src_ptr = src.ptr<float>(r) + border * channels;
+          float* buffer_ptr = buffer->ptr<float>(r);
+          for (int j = 0; j < width; ++j, buffer_ptr += channels) {
+            const std::vector<float>& tap_weight = tap_weights[j % 2];
+            const std::vector<int>& tap_offset = tap_offsets[j % 2];
+            const float* base_ptr = src_ptr + (j / 2) * channels;
+            float sum[C + 1] = {0};
+            for (int k = 0; k < tap_weight.size(); ++k) {
+              const float* cur_ptr = base_ptr + tap_offset[k] * channels;
+              for (int c = 0; c < channels; ++c) {
+                sum[c] += tap_weight[k] * cur_ptr[c];
+              }
+            }
+            std::copy(sum, sum + channels, buffer_ptr);
+          }
+        }
+      });
+
+  // Vertical pass, followed by blending into dst. Zero positions are
+  // collected per row to retain row-major order.
+  const float prop_scale = options_.push_propagation_scale();
+  const int row_elems = width * channels;
+  std::vector<std::vector<float*>> row_zero_pos(height);
+  ParallelFor(0, height, kSeparableRowGrain, [&](const BlockedRange& range) {
+    std::vector<float> row_sum(row_elems);
+    for (int i = range.begin(); i < range.end(); ++i) {
+      const std::vector<float>& tap_weight = tap_weights[i % 2];
+      const std::vector<int>& tap_offset = tap_offsets[i % 2];
+      std::fill(row_sum.begin(), row_sum.end(), 0.0f);
+      for (int k = 0; k < tap_weight.size(); ++k) {
+        const float w = tap_weight[k];
+        const float* buffer_ptr =
+            buffer->ptr<float>(i / 2 + border + tap_offset[k]);
+        for (int e = 0; e < row_elems; ++e) {
+          row_sum[e] += w * buffer_ptr[e];
+        }
+      }
+
+      float* dst_ptr = dst->ptr<float>(i + border) + border * channels;
+      const float* sum_ptr = row_sum.data();
+      for (int j = 0; j < width;
+           ++j, dst_ptr += channels, sum_ptr += channels) {
+        if (dst_ptr[C] >= 1) {  // Skip if already saturated.
+          continue;
+        }
+
+        // Same blending as in PushUpSampling.
+        float weight_sum = sum_ptr[C];
+        float val_sum[C];
+        if (weight_sum >= kBilateralEps * kBilateralEps) {
+          const float inv_weight_sum = 1.f / weight_sum;
+          for (int c = 0; c < C; ++c) {
+            val_sum[c] = sum_ptr[c] * inv_weight_sum;
+          }
+        } else {
+          weight_sum = 0;
+          for (int c = 0; c < C; ++c) {
+            val_sum[c] = 0;
+          }
+          row_zero_pos[i].push_back(dst_ptr);
+        }
+
+        weight_sum *= prop_scale;
+        const float alpha_inv = std::min(1.0f - dst_ptr[C], weight_sum);
+        const float denom =
+            1.0f / (dst_ptr[C] + alpha_inv + kBilateralEps * kBilateralEps);
+        for (int c = 0; c < C; ++c) {
+          dst_ptr[c] = (dst_ptr[c] + val_sum[c] * alpha_inv) * denom;
+        }
+        dst_ptr[C] =
+            std::min(1.0f, dst_ptr[C] + std::min(weight_sum, alpha_inv));
+      }
+    }
+  });
+
+  for (const auto& row : row_zero_pos) {
+    zero_pos->insert(zero_pos->end(), row.begin(), row.end());
+  }
+}
+
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_UTIL_TRACKING_PUSH_PULL_FILTERING_H_
@@ -0,0 +1,157 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tracking/push_pull_filtering.h"
+
+#include <random>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/vector.h"
+#include "mediapipe/util/tracking/push_pull_filtering.pb.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kWidth = 160;
+constexpr int kHeight = 90;
+
+struct ScatteredData {
+  std::vector<Vector2_f> locations;
+  std::vector<cv::Vec<float, 2>> values;
+  std::vector<float> weights;
+};
+
+ScatteredData MakeScatteredData(int num_points) {
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> x_dist(0, kWidth - 1);
+  std::uniform_real_distribution<float> y_dist(0, kHeight - 1);
+  std::uniform_real_distribution<float> unit_dist(0, 1);
+  ScatteredData data;
+  for (int k = 0; k < num_points; ++k) {
+    data.locations.push_back(Vector2_f(x_dist(random), y_dist(random)));
+    data.values.push_back(
+        cv::Vec<float, 2>(unit_dist(random), 2 * unit_dist(random) - 1));
+    data.weights.push_back(unit_dist(random));
+  }
+  return data;
+}
+
+cv::Mat RunPushPull(PushPullFilteringC2::FilterType filter_type,
+                    bool use_separable_filters, bool use_sparse_pull,
+                    int readout_level, const ScatteredData& data) {
+  PushPullFilteringC2 push_pull(cv::Size(kWidth, kHeight), filter_type,
+                                false,     // No bilateral term.
+                                nullptr,   // Default weight multiplier.
+                                nullptr,   // No mip map visualizer.
+                                nullptr);  // No weight adjustment.
+  PushPullOptions options;
+  options.set_use_separable_filters(use_separable_filters);
+  options.set_use_sparse_pull(use_sparse_pull);
+  push_pull.SetOptions(options);
+
+  cv::Mat result(push_pull.NthPyramidDomain(readout_level), CV_32FC3);
+  push_pull.PerformPushPull(data.locations, data.values, 0.5f,
+                            cv::Point2i(0, 0), readout_level, &data.weights,
+                            nullptr,  // No bilateral term.
+                            &result);
+  return result;
+}
+
+// Compares values and weights within the domain, i.e. excluding border.
+void ExpectResultsNear(const cv::Mat& expected, const cv::Mat& actual,
+                       int border) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = border; i < expected.rows - border; ++i) {
+    const float* expected_ptr = expected.ptr<float>(i);
+    const float* actual_ptr = actual.ptr<float>(i);
+    for (int j = border * 3; j < (expected.cols - border) * 3; ++j) {
+      ASSERT_NEAR(expected_ptr[j], actual_ptr[j], 1e-4f)
+          << "Row " << i << " element " << j;
+    }
+  }
+}
+
+class SeparablePushPullTest
+    : public ::testing::TestWithParam<PushPullFilteringC2::FilterType> {
+ protected:
+  int Border() const {
+    return PushPullFilteringC2::BorderFromFilterType(GetParam());
+  }
+};
+
+TEST_P(SeparablePushPullTest, SeparableMatchesReference) {
+  const ScatteredData data = MakeScatteredData(2000);
+  for (int readout_level : {0, 1}) {
+    const cv::Mat reference =
+        RunPushPull(GetParam(), false, false, readout_level, data);
+    ExpectResultsNear(
+        reference, RunPushPull(GetParam(), true, false, readout_level, data),
+        Border());
+  }
+}
+
+TEST_P(SeparablePushPullTest, SparseMatchesReference) {
+  // Few points to exercise sparse pull across several levels, including
+  // points at the domain boundary.
+  ScatteredData data = MakeScatteredData(50);
+  data.locations.push_back(Vector2_f(0, 0));
+  data.locations.push_back(Vector2_f(kWidth - 1, kHeight - 1));
+  data.locations.push_back(Vector2_f(0, kHeight - 1));
+  // Duplicated location.
+  data.locations.push_back(data.locations[0]);
+  for (int k = 0; k < 4; ++k) {
+    data.values.push_back(cv::Vec<float, 2>(0.5f, -0.5f));
+    data.weights.push_back(0.8f);
+  }
+
+  const cv::Mat reference = RunPushPull(GetParam(), false, false, 0, data);
+  ExpectResultsNear(reference, RunPushPull(GetParam(), true, true, 0, data),
+                    Border());
+}
+
+INSTANTIATE_TEST_SUITE_P(FilterTypes, SeparablePushPullTest,
+                         ::testing::Values(PushPullFilteringC2::BINOMIAL_3X3,
+                                           PushPullFilteringC2::BINOMIAL_5X5,
+                                           PushPullFilteringC2::GAUSSIAN_3X3,
+                                           PushPullFilteringC2::GAUSSIAN_5X5));
+
+// Args: use_separable_filters, use_sparse_pull, number of points.
+void BM_PushPull(benchmark::State& state) {
+  const ScatteredData data = MakeScatteredData(state.range(2));
+  PushPullFilteringC2 push_pull(cv::Size(kWidth * 4, kHeight * 4),
+                                PushPullFilteringC2::BINOMIAL_5X5, false,
+                                nullptr, nullptr, nullptr);
+  PushPullOptions options;
+  options.set_use_separable_filters(state.range(0));
+  options.set_use_sparse_pull(state.range(1));
+  push_pull.SetOptions(options);
+  cv::Mat result(push_pull.NthPyramidDomain(0), CV_32FC3);
+  for (auto _ : state) {
+    push_pull.PerformPushPull(data.locations, data.values, 0.5f,
+                              cv::Point2i(0, 0), 0, &data.weights, nullptr,
+                              &result);
+  }
+}
+BENCHMARK(BM_PushPull)
+    ->Args({0, 0, 1000})
+    ->Args({1, 0, 1000})
+    ->Args({1, 1, 1000})
+    ->Args({0, 0, 10000})
+    ->Args({1, 1, 10000});
+
+}  // namespace
+}  // namespace mediapipe
@@ -119,10 +119,11 @@ void InvertFeatureList(const TrackedFeatureList& list,
 
 // Allocates pyramid images of sufficient size (suggested OpenCV settings,
 // independent of number of pyramid levels).
-void AllocatePyramid(int frame_width, int frame_height, cv::Mat* pyramid) {
+void AllocatePyramid(int frame_width, int frame_height, MatPool* mat_pool,
+                     cv::Mat* pyramid) {
   const int pyramid_width = frame_width + 8;
   const int pyramid_height = frame_height / 2 + 1;
-  pyramid->create(pyramid_height, pyramid_width, CV_8UC1);
+  mat_pool->Create(pyramid_height, pyramid_width, CV_8UC1, pyramid);
 }
 
 namespace {
@@ -368,14 +369,18 @@ struct RegionFlowComputation::FrameTrackingData {
 
   bool use_cv_tracking = false;
 
+  // Pool for all image buffers, not owned.
+  MatPool* mat_pool = nullptr;
+
   FrameTrackingData(int width, int height, int extraction_levels,
-                    bool _use_cv_tracking)
-      : use_cv_tracking(_use_cv_tracking) {
+                    bool _use_cv_tracking, MatPool* _mat_pool)
+      : use_cv_tracking(_use_cv_tracking), mat_pool(_mat_pool) {
     // Extraction pyramid.
     extraction_pyramid.clear();
     for (int i = 0, iwidth = width, iheight = height; i < extraction_levels;
          ++i) {
-      extraction_pyramid.push_back(cv::Mat(iheight, iwidth, CV_8UC1));
+      extraction_pyramid.push_back(
+          mat_pool->Allocate(iheight, iwidth, CV_8UC1));
       iwidth = (iwidth + 1) / 2;
       iheight = (iheight + 1) / 2;
     }
@@ -383,16 +388,31 @@ struct RegionFlowComputation::FrameTrackingData {
     // Frame is the same as first extraction level.
     frame = extraction_pyramid[0];
 
+    // Allocated on demand.
+    mat_pool->Attach(&blur_data);
+    mat_pool->Attach(&tiny_image);
+    mat_pool->Attach(&mask);
+
     if (!use_cv_tracking) {
       // Tracking pyramid for old c-interface.
       pyramid.resize(1);
-      AllocatePyramid(width, height, &pyramid[0]);
+      AllocatePyramid(width, height, mat_pool, &pyramid[0]);
     }
   }
 
   void BuildPyramid(int levels, int window_size, bool with_derivative) {
     if (use_cv_tracking) {
 #if CV_MAJOR_VERSION >= 3
+      // Pyramid levels are allocated by OpenCV, ensure they are drawn from
+      // the pool. Levels are reused across frames, as FrameTrackingData is
+      // recycled.
+      const int num_levels = (levels + 1) * (with_derivative ? 2 : 1);
+      if (static_cast<int>(pyramid.size()) != num_levels) {
+        pyramid.resize(num_levels);
+        for (auto& level : pyramid) {
+          mat_pool->Attach(&level);
+        }
+      }
       // No-op if not called for opencv 3.0 (c interface computes
       // pyramids in place).
       // OpenCV changed how window size gets specified from our radius setting
@@ -472,7 +492,7 @@ struct RegionFlowComputation::FrameTrackingData {
   // image frame and stores result in patch.
   void ExtractPatch(const cv::Point2f& center, int patch_size, cv::Mat* patch) {
     CHECK(patch != nullptr);
-    patch->create(patch_size, patch_size, CV_8UC1);
+    mat_pool->Create(patch_size, patch_size, CV_8UC1, patch);
     cv::getRectSubPix(frame, cv::Size(patch_size, patch_size), center, *patch);
   }
 };
@@ -569,9 +589,15 @@ std::unique_ptr<T> MakeUnique(T* ptr) {
 RegionFlowComputation::RegionFlowComputation(
     const RegionFlowComputationOptions& options, int frame_width,
     int frame_height)
+    : RegionFlowComputation(options, frame_width, frame_height, nullptr) {}
+
+RegionFlowComputation::RegionFlowComputation(
+    const RegionFlowComputationOptions& options, int frame_width,
+    int frame_height, MatPool* mat_pool)
     : options_(options),
       frame_width_(frame_width),
-      frame_height_(frame_height) {
+      frame_height_(frame_height),
+      mat_pool_(mat_pool != nullptr ? mat_pool : MatPool::Default()) {
   switch (options_.gain_correct_mode()) {
     case RegionFlowComputationOptions::GAIN_CORRECT_DEFAULT_USER:
       // Do nothing, simply use supplied bounds.
@@ -694,14 +720,14 @@ RegionFlowComputation::RegionFlowComputation(
   switch (options_.image_format()) {
     case RegionFlowComputationOptions::FORMAT_RGB:
     case RegionFlowComputationOptions::FORMAT_BGR:
-      curr_color_image_.reset(
-          new cv::Mat(frame_height_, frame_width_, CV_8UC3));
+      curr_color_image_.reset(new cv::Mat(
+          mat_pool_->Allocate(frame_height_, frame_width_, CV_8UC3)));
       break;
 
     case RegionFlowComputationOptions::FORMAT_RGBA:
     case RegionFlowComputationOptions::FORMAT_BGRA:
-      curr_color_image_.reset(
-          new cv::Mat(frame_height_, frame_width_, CV_8UC4));
+      curr_color_image_.reset(new cv::Mat(
+          mat_pool_->Allocate(frame_height_, frame_width_, CV_8UC4)));
       break;
 
     case RegionFlowComputationOptions::FORMAT_GRAYSCALE:
@@ -710,9 +736,12 @@ RegionFlowComputation::RegionFlowComputation(
   }
 
   if (options_.compute_blur_score()) {
-    corner_values_.reset(new cv::Mat(frame_height_, frame_width_, CV_32F));
-    corner_filtered_.reset(new cv::Mat(frame_height_, frame_width_, CV_32F));
-    corner_mask_.reset(new cv::Mat(frame_height_, frame_width_, CV_8U));
+    corner_values_.reset(new cv::Mat(
+        mat_pool_->Allocate(frame_height_, frame_width_, CV_32F)));
+    corner_filtered_.reset(new cv::Mat(
+        mat_pool_->Allocate(frame_height_, frame_width_, CV_32F)));
+    corner_mask_.reset(new cv::Mat(
+        mat_pool_->Allocate(frame_height_, frame_width_, CV_8U)));
   }
 
   max_long_track_length_ = 1;
@@ -770,10 +799,12 @@ RegionFlowComputation::RegionFlowComputation(
 #endif
 
   if (options_.gain_correction()) {
-    gain_image_.reset(new cv::Mat(frame_height_, frame_width_, CV_8UC1));
+    gain_image_.reset(new cv::Mat(
+        mat_pool_->Allocate(frame_height_, frame_width_, CV_8UC1)));
     if (!use_cv_tracking_) {
       gain_pyramid_.reset(new cv::Mat());
-      AllocatePyramid(frame_width_, frame_height_, gain_pyramid_.get());
+      AllocatePyramid(frame_width_, frame_height_, mat_pool_,
+                      gain_pyramid_.get());
     }
   }
 
@@ -792,8 +823,10 @@ RegionFlowComputation::RegionFlowComputation(
           << " levels, starting at size (width, height): (" << frame_width_
           << ", " << frame_height_ << ")";
 
-  feature_tmp_image_1_.reset(new cv::Mat(frame_height_, frame_width_, CV_32F));
-  feature_tmp_image_2_.reset(new cv::Mat(frame_height_, frame_width_, CV_32F));
+  feature_tmp_image_1_.reset(new cv::Mat(
+      mat_pool_->Allocate(frame_height_, frame_width_, CV_32F)));
+  feature_tmp_image_2_.reset(new cv::Mat(
+      mat_pool_->Allocate(frame_height_, frame_width_, CV_32F)));
 
   // Allocate feature point arrays.
   max_features_ = options_.tracking_options().max_features();
@@ -1079,8 +1112,9 @@ bool RegionFlowComputation::AddImageAndTrack(
     data_queue_.push_back(std::move(data_queue_.front()));
     data_queue_.pop_front();
   } else {
-    data_queue_.push_back(MakeUnique(new FrameTrackingData(
-        frame_width_, frame_height_, extraction_levels_, use_cv_tracking_)));
+    data_queue_.push_back(MakeUnique(
+        new FrameTrackingData(frame_width_, frame_height_, extraction_levels_,
+                              use_cv_tracking_, mat_pool_)));
   }
 
   FrameTrackingData* curr_data = data_queue_.back().get();
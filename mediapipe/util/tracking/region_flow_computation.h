@@ -54,6 +54,7 @@
 
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/util/tracking/mat_pool.h"
 #include "mediapipe/util/tracking/motion_models.pb.h"
 #include "mediapipe/util/tracking/region_flow.h"
 #include "mediapipe/util/tracking/region_flow.pb.h"
@@ -74,6 +75,10 @@ class RegionFlowComputation {
  public:
   RegionFlowComputation(const RegionFlowComputationOptions& options,
                         int frame_width, int frame_height);
+  // Same as above, drawing all image buffers from the specified mat_pool (not
+  // owned, must outlive this object). If nullptr, MatPool::Default() is used.
+  RegionFlowComputation(const RegionFlowComputationOptions& options,
+                        int frame_width, int frame_height, MatPool* mat_pool);
   virtual ~RegionFlowComputation();
   RegionFlowComputation(const RegionFlowComputation&) = delete;
   RegionFlowComputation& operator=(const RegionFlowComputation&) = delete;
@@ -415,6 +420,9 @@ class RegionFlowComputation {
   // List of RegionFlow frames of size options_.frames_to_track.
   RegionFlowFeatureListVector region_flow_results_;
 
+  // Pool for all image buffers, not owned.
+  MatPool* mat_pool_;
+
   // Gain adapted version.
   std::unique_ptr<cv::Mat> gain_image_;
   std::unique_ptr<cv::Mat> gain_pyramid_;